@@ -0,0 +1,48 @@
+﻿//
+// Created by 沈昊 on 2026/10/19.
+//
+/// SRT转发服务
+/// 推流端的stream id为#!::r=[vhost/]app/stream,m=publish, 按照vhost/app/stream注册media_source
+/// 播放端的stream id为#!::r=[vhost/]app/stream, 在自己的poller上attach源的RingBuffer, 每个poller只收到一份数据
+#include "Util/cmdline.hpp"
+#include "Util/semaphore.h"
+#include "protocol/srt/srt_server.hpp"
+#include "protocol/srt/srt_session.hpp"
+#include "spdlog/logger.hpp"
+#include <csignal>
+#include <string>
+int main(int argc, char *argv[]) {
+    cmdline::parser parser;
+    parser.add<int>("port", 'p', "listen port", false, 9000, cmdline::range(1, 65535));
+    parser.add<int>("latency", 'l', "receive latency(ms)", false, 120, cmdline::range(0, 10000));
+    parser.add<int>("wait", 'w', "players wait for the publisher for n ms, 0 to close immediately", false, 5000, cmdline::range(0, 600000));
+    parser.add<int>("rebalance", 'r', "rebalance sessions between pollers every n ms, 0 to disable", false, 0, cmdline::range(0, 60000));
+    parser.add("connected", 'c', "create a connected socket for each session");
+    parser.add("debug", 'd', "debug log level");
+    parser.add("help", 0, "print this message");
+    parser.set_program_name("srtrelay");
+    parser.parse_check(argc, argv);
+
+    logger::initialize("logs/srtrelay.log", parser.exist("debug") ? spdlog::level::debug : spdlog::level::info);
+    auto latency = (uint32_t) parser.get<int>("latency");
+    auto wait = (uint32_t) parser.get<int>("wait");
+    auto server = std::make_shared<srt::srt_server>();
+    server->set_connected_session_socket(parser.exist("connected"));
+    server->on_create_session([latency, wait](const std::shared_ptr<asio::ip::udp::socket> &sock, const event_poller::Ptr &context) -> std::shared_ptr<srt::srt_session_base> {
+        auto session = std::make_shared<srt::srt_session>(sock, context);
+        session->set_time_based_deliver(latency);
+        session->set_play_wait_time_out(wait);
+        return session;
+    });
+    if (parser.get<int>("rebalance")) {
+        server->set_auto_rebalance((uint32_t) parser.get<int>("rebalance"));
+    }
+    server->start(asio::ip::udp::endpoint(asio::ip::udp::v4(), (uint16_t) parser.get<int>("port")));
+    Info("srt relay listen on {}", parser.get<int>("port"));
+
+    static toolkit::semaphore sem;
+    signal(SIGINT, [](int) { sem.post(); });
+    signal(SIGTERM, [](int) { sem.post(); });
+    sem.wait();
+    return 0;
+}
@@ -0,0 +1,133 @@
+﻿//
+// Created by 沈昊 on 2026/10/19.
+//
+/// RingBuffer扇出测试: 每个源由一个poller按照固定包率写入, 读取器平均分布在各个poller上
+/// 分别测试逐个派发和自动合并两种方式, 输出每秒跨线程投递的次数和写入到读取的平均延迟
+/// ringbuffer_fanout [源数量, 默认4] [poller数量, 默认8] [每个源的读取器数量, 默认32] [每个源每秒的包数, 默认10000] [时长s, 默认3]
+#include "Util/RingBuffer.h"
+#include "net/buffer.hpp"
+#include "net/event_poller.hpp"
+#include "spdlog/logger.hpp"
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+using ring_type = toolkit::RingBuffer<std::shared_ptr<buffer>>;
+
+static uint64_t now_ns() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+struct fanout_result {
+    double posts_per_second = 0;
+    double latency_us = 0;
+    uint64_t reads = 0;
+};
+
+static fanout_result run(bool coalesce, uint32_t sources, uint32_t pollers, uint32_t readers, uint32_t rate, uint32_t seconds) {
+    std::vector<event_poller::Ptr> reader_pollers;
+    for (uint32_t i = 0; i < pollers; i++) {
+        reader_pollers.emplace_back(std::make_shared<event_poller>());
+        reader_pollers.back()->start();
+    }
+    std::vector<event_poller::Ptr> writer_pollers;
+    std::vector<std::shared_ptr<ring_type>> rings;
+    for (uint32_t i = 0; i < sources; i++) {
+        writer_pollers.emplace_back(std::make_shared<event_poller>());
+        writer_pollers.back()->start();
+        rings.emplace_back(std::make_shared<ring_type>());
+        if (coalesce) {
+            rings.back()->setCoalescePoller(writer_pollers.back());
+        }
+    }
+
+    std::atomic<uint64_t> reads{0};
+    std::atomic<uint64_t> latency{0};
+    std::vector<std::shared_ptr<ring_type::RingReader>> ring_readers(sources * readers);
+    std::atomic<uint32_t> attached{0};
+    for (uint32_t i = 0; i < sources; i++) {
+        for (uint32_t j = 0; j < readers; j++) {
+            auto poller = reader_pollers[j % pollers];
+            auto &slot = ring_readers[i * readers + j];
+            auto ring = rings[i];
+            poller->async([&, poller, ring]() {
+                slot = ring->attach(poller, false);
+                slot->setReadCB([&](const std::shared_ptr<buffer> &buff) {
+                    latency.fetch_add(now_ns() - *(const uint64_t *) buff->data(), std::memory_order_relaxed);
+                    reads.fetch_add(1, std::memory_order_relaxed);
+                });
+                ++attached;
+            });
+        }
+    }
+    while (attached.load() < sources * readers) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    /// 每毫秒写入一轮, 模拟一次收到多个包
+    const uint32_t per_tick = rate / 1000 ? rate / 1000 : 1;
+    std::atomic<bool> running{true};
+    for (uint32_t i = 0; i < sources; i++) {
+        auto ring = rings[i];
+        writer_pollers[i]->do_delay_task(std::chrono::milliseconds(1), [&running, ring, per_tick]() -> size_t {
+            if (!running.load()) {
+                return 0;
+            }
+            for (uint32_t n = 0; n < per_tick; n++) {
+                auto buff = std::make_shared<buffer>();
+                buff->resize(1316);
+                *(uint64_t *) buff->data() = now_ns();
+                ring->write(buff);
+            }
+            return 1;
+        });
+    }
+    std::this_thread::sleep_for(std::chrono::seconds(seconds));
+    running.store(false);
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    uint64_t posts = 0;
+    for (auto &item: rings) {
+        posts += item->postCount();
+    }
+
+    fanout_result result;
+    result.posts_per_second = (double) posts / seconds;
+    result.reads = reads.load();
+    result.latency_us = result.reads ? (double) latency.load() / result.reads / 1000 : 0;
+
+    /// 读取器在自己的poller中释放
+    for (uint32_t i = 0; i < sources * readers; i++) {
+        auto poller = reader_pollers[i % readers % pollers];
+        std::shared_ptr<ring_type::RingReader> reader;
+        reader.swap(ring_readers[i]);
+        poller->async([reader]() {});
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    for (auto &item: writer_pollers) {
+        item->stop();
+    }
+    for (auto &item: reader_pollers) {
+        item->stop();
+    }
+    return result;
+}
+
+int main(int argc, char **argv) {
+    logger::initialize("logs/ringbuffer_fanout.log", spdlog::level::warn);
+    uint32_t sources = argc > 1 ? (uint32_t) std::stoul(argv[1]) : 4;
+    uint32_t pollers = argc > 2 ? (uint32_t) std::stoul(argv[2]) : 8;
+    uint32_t readers = argc > 3 ? (uint32_t) std::stoul(argv[3]) : 32;
+    uint32_t rate = argc > 4 ? (uint32_t) std::stoul(argv[4]) : 10000;
+    uint32_t seconds = argc > 5 ? (uint32_t) std::stoul(argv[5]) : 3;
+
+    std::cout << "sources=" << sources << ", pollers=" << pollers << ", readers/source=" << readers << ", packets/s/source=" << rate << std::endl;
+    for (auto coalesce: {false, true}) {
+        auto result = run(coalesce, sources, pollers, readers, rate, seconds);
+        std::cout << (coalesce ? "coalesce:   " : "per packet: ") << "posts/s=" << (uint64_t) result.posts_per_second << ", reads=" << result.reads
+                  << ", latency=" << result.latency_us << "us" << std::endl;
+    }
+    return 0;
+}
@@ -0,0 +1,157 @@
+﻿//
+// Created by 沈昊 on 2026/10/19.
+//
+/// 本地回环文件传输测试: 文件模式发送一个大文件, 接收端直接写入fd, 最后校验内容
+/// srt_file_transfer [size MB, 默认2048] [port, 默认9000]
+#include "Util/mapped_file.hpp"
+#include "event_poller_pool.hpp"
+#include "protocol/srt/srt_client.hpp"
+#include "protocol/srt/srt_server.hpp"
+#include <chrono>
+#include <cstring>
+#include <fcntl.h>
+#include <future>
+#include <iostream>
+#include <random>
+#include <spdlog/logger.hpp>
+#include <string>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+#ifdef ENABLE_PREF_TOOL
+#include <gperftools/profiler.h>
+#endif
+using namespace srt;
+
+static const char *source_path = "srt_file_transfer.src";
+static const char *dest_path = "srt_file_transfer.dst";
+
+class file_session : public srt_session_base {
+public:
+    file_session(const std::shared_ptr<asio::ip::udp::socket> &sock, const event_poller::Ptr &context) : srt_session_base(sock, context) {
+        fd = ::open(dest_path, O_CREAT | O_TRUNC | O_WRONLY, 0644);
+    }
+    ~file_session() override {
+        if (fd >= 0) {
+            ::close(fd);
+        }
+    }
+
+protected:
+    void begin() override {
+        srt_session_base::begin();
+        set_receive_fd(fd);
+    }
+    void onRecv(const std::shared_ptr<buffer> &) override {}
+    void onConnected() override {
+        Info("file session connected, buffer mode={}", get_buffer_mode());
+    }
+    void onError(const std::error_code &e) override {
+        Info("file session closed, {}", e.message());
+    }
+
+private:
+    int fd = -1;
+};
+
+static bool create_source_file(size_t size) {
+    auto fd = ::open(source_path, O_CREAT | O_TRUNC | O_WRONLY, 0644);
+    if (fd < 0) {
+        return false;
+    }
+    std::mt19937 mt(20261019);
+    std::vector<uint32_t> block(1024 * 1024 / sizeof(uint32_t));
+    for (auto &item: block) {
+        item = mt();
+    }
+    size_t written = 0;
+    uint32_t index = 0;
+    while (written < size) {
+        /// 每一块都不同, 用于发现乱序
+        block[0] = index++;
+        auto length = (std::min)(size - written, block.size() * sizeof(uint32_t));
+        if (::write(fd, block.data(), length) != (ssize_t) length) {
+            ::close(fd);
+            return false;
+        }
+        written += length;
+    }
+    ::close(fd);
+    return true;
+}
+
+static size_t file_size(const char *path) {
+    try {
+        return mapped_file::open(path)->size();
+    } catch (const std::system_error &) {
+        return 0;
+    }
+}
+
+int main(int argc, char **argv) {
+    const char *exec_name = "srt_file_transfer.profile";
+    logger::initialize("logs/srt_file_transfer.log", spdlog::level::info);
+    size_t size = (argc > 1 ? std::stoull(argv[1]) : 2048) * 1024 * 1024;
+    uint16_t port = argc > 2 ? (uint16_t) std::stoi(argv[2]) : 9000;
+
+    if (!create_source_file(size)) {
+        std::cerr << "create source file failed" << std::endl;
+        return -1;
+    }
+
+    auto server = std::make_shared<srt_server>();
+    server->on_create_session([](const std::shared_ptr<asio::ip::udp::socket> &sock, const event_poller::Ptr &context) -> std::shared_ptr<srt_session_base> {
+        return std::make_shared<file_session>(sock, context);
+    });
+    server->start(asio::ip::udp::endpoint(asio::ip::udp::v4(), port));
+
+    srt_client client;
+    client.set_buffer_mode(true);
+    std::promise<std::error_code> connected;
+    client.async_connect(asio::ip::udp::endpoint(asio::ip::address::from_string("127.0.0.1"), port), [&](const std::error_code &e) {
+        connected.set_value(e);
+    });
+    auto e = connected.get_future().get();
+    if (e) {
+        std::cerr << "connect failed, " << e.message() << std::endl;
+        return -1;
+    }
+#ifdef ENABLE_PREF_TOOL
+    ProfilerStart(exec_name);
+#endif
+    auto begin = std::chrono::steady_clock::now();
+    std::promise<std::error_code> finished;
+    client.async_send_file(source_path, [&](const std::error_code &e) {
+        finished.set_value(e);
+    });
+    e = finished.get_future().get();
+    auto spend = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - begin).count();
+#ifdef ENABLE_PREF_TOOL
+    ProfilerStop();
+#endif
+    if (e) {
+        std::cerr << "send file failed, " << e.message() << std::endl;
+        return -1;
+    }
+    std::cout << "send " << size << " bytes in " << spend << " ms, throughput=" << (spend ? size / 1000.0 / spend : 0) << " MB/s"
+              << ", send bytes/syscall=" << client.send_bytes_per_syscall() << ", receive bytes/syscall=" << server->get_receive_bytes_per_syscall() << std::endl;
+
+    /// 等待接收端写完
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+    while (file_size(dest_path) < size && std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    }
+
+    bool same = false;
+    try {
+        auto src = mapped_file::open(source_path);
+        auto dst = mapped_file::open(dest_path);
+        same = src->size() == dst->size() && (src->size() == 0 || std::memcmp(src->data(), dst->data(), src->size()) == 0);
+        std::cout << "source size=" << src->size() << ", dest size=" << dst->size() << ", content " << (same ? "match" : "mismatch") << std::endl;
+    } catch (const std::system_error &err) {
+        std::cerr << err.what() << std::endl;
+    }
+    ::unlink(source_path);
+    ::unlink(dest_path);
+    return same ? 0 : -1;
+}
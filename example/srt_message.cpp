@@ -0,0 +1,138 @@
+﻿//
+// Created by 沈昊 on 2026/10/19.
+//
+/// 本地回环消息传输测试: 发送任意长度的消息, 接收端按消息整体交付并校验
+/// srt_message [消息数量, 默认1000] [port, 默认9001] [内核调度, 默认0] [会话独立socket, 默认0]
+#include "Util/endian.hpp"
+#include "event_poller_pool.hpp"
+#include "protocol/srt/srt_client.hpp"
+#include "protocol/srt/srt_server.hpp"
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <iostream>
+#include <random>
+#include <spdlog/logger.hpp>
+#include <string>
+#include <thread>
+#include <vector>
+using namespace srt;
+
+static std::atomic<uint32_t> received{0};
+static std::atomic<uint32_t> corrupted{0};
+
+/// 消息的前4个字节是长度, 之后的内容由长度生成
+static bool check_message(const std::vector<std::shared_ptr<buffer>> &fragments) {
+    std::string message;
+    for (const auto &item: fragments) {
+        message.append(item->data(), item->size());
+    }
+    if (message.size() < 4) {
+        return false;
+    }
+    auto length = load_be32(message.data());
+    if (length != message.size()) {
+        return false;
+    }
+    for (size_t i = 4; i < message.size(); i++) {
+        if (message[i] != (char) ((length + i) & 0xFF)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+class message_session : public srt_session_base {
+public:
+    message_session(const std::shared_ptr<asio::ip::udp::socket> &sock, const event_poller::Ptr &context) : srt_session_base(sock, context) {}
+
+protected:
+    void onRecv(const std::shared_ptr<buffer> &buff) override {
+        on_message({buff});
+    }
+    void onRecvMessage(const std::vector<std::shared_ptr<buffer>> &fragments) override {
+        on_message(fragments);
+    }
+    void onConnected() override {
+        Info("message session connected");
+    }
+    void onError(const std::error_code &e) override {
+        Info("message session closed, {}", e.message());
+    }
+
+private:
+    static void on_message(const std::vector<std::shared_ptr<buffer>> &fragments) {
+        if (!check_message(fragments)) {
+            ++corrupted;
+        }
+        ++received;
+    }
+};
+
+int main(int argc, char **argv) {
+    logger::initialize("logs/srt_message.log", spdlog::level::info);
+    uint32_t count = argc > 1 ? (uint32_t) std::stoul(argv[1]) : 1000;
+    uint16_t port = argc > 2 ? (uint16_t) std::stoi(argv[2]) : 9001;
+    bool kernel_pacing = argc > 3 && std::stoi(argv[3]) != 0;
+    bool connected_socket = argc > 4 && std::stoi(argv[4]) != 0;
+
+    auto server = std::make_shared<srt_server>();
+    server->set_connected_session_socket(connected_socket);
+    server->on_create_session([](const std::shared_ptr<asio::ip::udp::socket> &sock, const event_poller::Ptr &context) -> std::shared_ptr<srt_session_base> {
+        return std::make_shared<message_session>(sock, context);
+    });
+    server->start(asio::ip::udp::endpoint(asio::ip::udp::v4(), port));
+
+    srt_client client;
+    client.set_enable_drop_late_packet(false);
+    client.set_kernel_pacing(kernel_pacing);
+    std::promise<std::error_code> connected;
+    client.async_connect(asio::ip::udp::endpoint(asio::ip::address::from_string("127.0.0.1"), port), [&](const std::error_code &e) {
+        connected.set_value(e);
+    });
+    auto e = connected.get_future().get();
+    if (e) {
+        std::cerr << "connect failed, " << e.message() << std::endl;
+        return -1;
+    }
+
+    std::mt19937 mt(20261019);
+    std::uniform_int_distribution<uint32_t> dist(4, 64 * 1024);
+    uint64_t bytes = 0;
+    auto begin = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < count; i++) {
+        auto length = dist(mt);
+        auto message = std::make_shared<buffer>();
+        message->resize(length);
+        auto data = (char *) message->data();
+        set_be32(data, length);
+        for (size_t j = 4; j < length; j++) {
+            data[j] = (char) ((length + j) & 0xFF);
+        }
+        while (true) {
+            std::error_code err;
+            auto ret = client.async_send_message(message, err);
+            if (ret > 0) {
+                bytes += ret;
+                break;
+            }
+            if (ret < 0) {
+                std::cerr << "send message failed, " << err.message() << std::endl;
+                return -1;
+            }
+            /// 发送缓冲区不足, 等待窗口滑动
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    }
+
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+    while (received.load() < count && std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    auto spend = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - begin).count();
+    std::cout << "send " << count << " messages, " << bytes << " bytes in " << spend << " ms, received=" << received.load() << ", corrupted=" << corrupted.load()
+              << ", kernel_pacing=" << client.kernel_pacing_active() << ", send bytes/syscall=" << client.send_bytes_per_syscall()
+              << ", receive bytes/syscall=" << server->get_receive_bytes_per_syscall() << ", client receive delay=" << client.receive_delay() << "us"
+              << ", server kernel drops=" << server->get_kernel_drops() << std::endl;
+    return received.load() == count && corrupted.load() == 0 ? 0 : -1;
+}
@@ -0,0 +1,127 @@
+﻿//
+// Created by 沈昊 on 2026/10/19.
+//
+/// 发送和接收流水线中每个包的CPU开销: 发送队列 -> 过滤 -> 内存传输 -> 接收队列 -> 应用层
+/// 同样的几级分别用模板参数静态组合和std::function回调连接, 比较每个包的平均耗时
+/// srt_pipeline [包数量, 默认1000000] [重复次数, 默认3]
+#include "event_poller_pool.hpp"
+#include "net/buffer.hpp"
+#include "protocol/srt/packet_pipeline.hpp"
+#include "protocol/srt/packet_receive_queue.hpp"
+#include "protocol/srt/packet_sending_queue.hpp"
+#include "protocol/srt/srt_ack.hpp"
+#include <chrono>
+#include <future>
+#include <iostream>
+#include <memory>
+#include <spdlog/logger.hpp>
+#include <string>
+using namespace srt;
+using payload_type = std::shared_ptr<buffer>;
+using packet_pointer = std::shared_ptr<packet<payload_type>>;
+
+struct statistic {
+    uint64_t packets = 0;
+    uint64_t bytes = 0;
+};
+
+/// 丢弃空包
+struct payload_filter {
+    bool operator()(const packet_pointer &p) const {
+        return p->pkt && !p->pkt->empty();
+    }
+};
+
+//// 静态组合
+struct app_sink {
+    statistic *stat;
+    void on_packet(const packet_pointer &p) {
+        ++stat->packets;
+        stat->bytes += p->pkt->size();
+    }
+    void on_drop_packet(uint32_t, uint32_t) {}
+};
+
+using static_receiver = packet_receive_queue<payload_type, app_sink>;
+
+/// 内存中的传输, 发送的包直接输入接收队列
+struct memory_transport {
+    static_receiver *receiver;
+    void on_packet(const packet_pointer &p) {
+        receiver->input_packet(p->pkt, p->seq, p->submit_time);
+    }
+    void on_drop_packet(uint32_t, uint32_t) {}
+    void on_writable() {}
+    void on_flush() {}
+};
+
+using static_sender = packet_sending_queue<payload_type, packet_filter<payload_type, payload_filter, memory_transport>>;
+
+/// 每64个包确认一次, 让发送队列保持很短
+template<typename Sender>
+static void run_sender(Sender &sender, const payload_type &payload, uint32_t count) {
+    for (uint32_t i = 0; i < count; i++) {
+        sender.input_packet(payload, 0, 0);
+        if ((i & 63) == 63) {
+            sender.ack_sequence_to(true, sender.get_current_sequence(), 0, 0);
+        }
+    }
+    sender.ack_sequence_to(true, sender.get_current_sequence(), 0, 0);
+}
+
+static uint64_t run_static(const event_poller::Ptr &poller, const payload_type &payload, uint32_t count, statistic &stat) {
+    auto receiver = std::make_shared<static_receiver>();
+    receiver->set_next(app_sink{&stat});
+    auto sender = std::make_shared<static_sender>(poller, std::make_shared<srt_ack_queue>(), true, false);
+    sender->set_next(packet_filter<payload_type, payload_filter, memory_transport>(payload_filter(), memory_transport{receiver.get()}));
+    auto begin = std::chrono::steady_clock::now();
+    run_sender(*sender, payload, count);
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - begin).count();
+}
+
+//// 类型擦除
+static uint64_t run_dynamic(const event_poller::Ptr &poller, const payload_type &payload, uint32_t count, statistic &stat) {
+    auto receiver = std::make_shared<packet_receive_queue<payload_type>>();
+    receiver->set_on_packet([&stat](const packet_pointer &p) {
+        ++stat.packets;
+        stat.bytes += p->pkt->size();
+    });
+    auto sender = std::make_shared<packet_sending_queue<payload_type>>(poller, std::make_shared<srt_ack_queue>(), true, false);
+    std::function<bool(const packet_pointer &)> filter = payload_filter();
+    std::function<void(const packet_pointer &)> transport = [receiver](const packet_pointer &p) {
+        receiver->input_packet(p->pkt, p->seq, p->submit_time);
+    };
+    sender->set_on_packet([filter, transport](const packet_pointer &p) {
+        if (filter(p)) {
+            transport(p);
+        }
+    });
+    auto begin = std::chrono::steady_clock::now();
+    run_sender(*sender, payload, count);
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - begin).count();
+}
+
+int main(int argc, char **argv) {
+    logger::initialize("logs/srt_pipeline.log", spdlog::level::warn);
+    uint32_t count = argc > 1 ? (uint32_t) std::stoul(argv[1]) : 1000000;
+    uint32_t rounds = argc > 2 ? (uint32_t) std::stoul(argv[2]) : 3;
+    auto poller = event_poller_pool::Instance().get_poller(false);
+    auto payload = std::make_shared<buffer>();
+    payload->resize(1316);
+
+    /// 队列的定时器属于poller, 整个流水线在poller线程中运行
+    std::promise<bool> done;
+    poller->async([&]() {
+        bool ok = true;
+        for (uint32_t round = 0; round < rounds; round++) {
+            statistic static_stat, dynamic_stat;
+            auto static_ns = run_static(poller, payload, count, static_stat);
+            auto dynamic_ns = run_dynamic(poller, payload, count, dynamic_stat);
+            ok = ok && static_stat.packets == count && dynamic_stat.packets == count;
+            std::cout << "round " << round << ": " << count << " packets, static=" << (double) static_ns / count << " ns/packet"
+                      << ", std::function=" << (double) dynamic_ns / count << " ns/packet, delivered=" << static_stat.packets << "/" << dynamic_stat.packets << std::endl;
+        }
+        done.set_value(ok);
+    });
+    return done.get_future().get() ? 0 : -1;
+}
@@ -0,0 +1,117 @@
+﻿//
+// Created by 沈昊 on 2026/10/19.
+//
+/// 转发服务本地回环压测: 一个推流端按照固定码率推流, N个播放端从转发服务拉流
+/// 统计进程的CPU时间(包括本进程中的推流端和播放端)和转发给播放端的出口码率, 输出每Gbps出口占用的CPU核数
+/// srt_relay [播放端数量, 默认8] [推流码率Mbps, 默认20] [时长s, 默认5] [port, 默认9002]
+#include "media/media_source.hpp"
+#include "protocol/srt/srt_client.hpp"
+#include "protocol/srt/srt_server.hpp"
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <iostream>
+#include <memory>
+#include <spdlog/logger.hpp>
+#include <string>
+#include <sys/resource.h>
+#include <thread>
+#include <vector>
+using namespace srt;
+
+static double cpu_seconds() {
+    struct rusage usage {};
+    getrusage(RUSAGE_SELF, &usage);
+    return (double) usage.ru_utime.tv_sec + usage.ru_utime.tv_usec / 1e6 + (double) usage.ru_stime.tv_sec + usage.ru_stime.tv_usec / 1e6;
+}
+
+static bool connect_client(srt_client &client, uint16_t port) {
+    std::promise<std::error_code> connected;
+    client.async_connect(asio::ip::udp::endpoint(asio::ip::address::from_string("127.0.0.1"), port), [&](const std::error_code &e) {
+        connected.set_value(e);
+    });
+    auto future = connected.get_future();
+    return future.wait_for(std::chrono::seconds(5)) == std::future_status::ready && !future.get();
+}
+
+int main(int argc, char **argv) {
+    logger::initialize("logs/srt_relay.log", spdlog::level::warn);
+    uint32_t players = argc > 1 ? (uint32_t) std::stoul(argv[1]) : 8;
+    uint32_t mbps = argc > 2 ? (uint32_t) std::stoul(argv[2]) : 20;
+    uint32_t seconds = argc > 3 ? (uint32_t) std::stoul(argv[3]) : 5;
+    uint16_t port = argc > 4 ? (uint16_t) std::stoi(argv[4]) : 9002;
+    const size_t packet_size = 1316;
+
+    /// 默认的会话就是srt_session, 按照stream id推流或者播放
+    auto server = std::make_shared<srt_server>();
+    server->start(asio::ip::udp::endpoint(asio::ip::udp::v4(), port));
+
+    srt_client publisher;
+    publisher.set_stream_id("#!::r=live/relay,m=publish");
+    if (!connect_client(publisher, port)) {
+        std::cerr << "publisher connect failed" << std::endl;
+        return -1;
+    }
+    /// 源在会话的executor中注册
+    for (int i = 0; i < 300 && !media_source::find_source("", "live", "relay"); i++) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    if (!media_source::find_source("", "live", "relay")) {
+        std::cerr << "media source is not registered" << std::endl;
+        return -1;
+    }
+
+    std::vector<std::shared_ptr<srt_client>> clients;
+    std::vector<std::shared_ptr<std::atomic<uint64_t>>> received;
+    for (uint32_t i = 0; i < players; i++) {
+        auto client = std::make_shared<srt_client>();
+        auto bytes = std::make_shared<std::atomic<uint64_t>>(0);
+        client->set_stream_id("#!::r=live/relay");
+        client->set_on_receive([bytes](const std::shared_ptr<buffer> &buff) {
+            bytes->fetch_add(buff->size(), std::memory_order_relaxed);
+        });
+        if (!connect_client(*client, port)) {
+            std::cerr << "player " << i << " connect failed" << std::endl;
+            return -1;
+        }
+        clients.push_back(client);
+        received.push_back(bytes);
+    }
+    /// 等待播放端在各自的poller上attach
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+
+    std::string payload(packet_size, 'a');
+    uint64_t sent = 0, rejected = 0;
+    auto begin = std::chrono::steady_clock::now();
+    auto cpu_begin = cpu_seconds();
+    auto deadline = begin + std::chrono::seconds(seconds);
+    /// 每毫秒补齐到目标码率
+    while (std::chrono::steady_clock::now() < deadline) {
+        auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - begin).count();
+        auto target = (uint64_t) elapsed * mbps / 8;
+        while (sent < target) {
+            if (publisher.async_send(payload.data(), payload.size()) <= 0) {
+                ++rejected;
+                break;
+            }
+            sent += payload.size();
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    auto spend = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - begin).count() / 1e6;
+    std::this_thread::sleep_for(std::chrono::milliseconds(500));
+    auto cpu = cpu_seconds() - cpu_begin;
+
+    uint64_t egress = 0, min_bytes = sent;
+    for (auto &item: received) {
+        egress += item->load();
+        min_bytes = std::min<uint64_t>(min_bytes, item->load());
+    }
+    auto egress_gbps = egress * 8 / spend / 1e9;
+    auto cores = cpu / spend;
+    std::cout << "players=" << players << ", publish=" << sent * 8 / spend / 1e6 << " Mbps, egress=" << egress_gbps << " Gbps, cpu=" << cores << " cores"
+              << ", cpu per egress Gbps=" << (egress_gbps > 0 ? cores / egress_gbps : 0) << " cores, slowest player received " << min_bytes << "/" << sent
+              << " bytes, send buffer full=" << rejected << std::endl;
+    clients.clear();
+    return players && min_bytes == 0 ? -1 : 0;
+}
@@ -12,6 +12,7 @@
 #define UTIL_RINGBUFFER_H_
 
 #include "net/event_poller.hpp"
+#include "net/executor.hpp"
 #include <atomic>
 #include <condition_variable>
 #include <functional>
@@ -20,8 +21,13 @@
 #include <mutex>
 #include <unordered_map>
 #include <algorithm>
+#include <cstdint>
+#include <utility>
+#include <vector>
 //GOP缓存最大长度下限值
 #define RING_MIN_SIZE 32
+//GOP缓存每个分段连续存放的数据个数
+#define RING_SEGMENT_SIZE 64
 #define LOCK_GUARD(mtx) std::lock_guard<decltype(mtx)> lck(mtx)
 
 namespace toolkit {
@@ -42,6 +48,74 @@ namespace toolkit {
     template<typename T>
     class _RingReaderDispatcher;
 
+    /**
+* GOP缓存的分段, 连续存放RING_SEGMENT_SIZE个数据
+* 只有写入线程追加, 已经发布的数据不再修改, 所有poller共享同一条分段链
+* 分段链由各个poller的派发位置引用, GOP更新之后旧的分段在最后一个引用释放时回收
+* @tparam T
+*/
+    template<typename T>
+    class _RingSegment {
+    public:
+        using Ptr = std::shared_ptr<_RingSegment>;
+
+        explicit _RingSegment(uint64_t first_seq) : _first_seq(first_seq), _items(new std::pair<bool, T>[RING_SEGMENT_SIZE]) {}
+
+        /**
+     * 写入线程调用
+     */
+        bool full() const {
+            return _written == RING_SEGMENT_SIZE;
+        }
+
+        void append(bool is_key, T in) {
+            _items[_written].first = is_key;
+            _items[_written].second = std::move(in);
+            _size.store(++_written, std::memory_order_release);
+        }
+
+        void link(const Ptr &next) {
+            std::atomic_store(&_next, next);
+        }
+
+        /**
+     * 从segment开始依次读取序号不超过last_seq的数据, 可以在任意线程调用
+     */
+        template<typename F>
+        static void forEach(Ptr segment, uint64_t last_seq, F &&f) {
+            while (segment) {
+                auto size = segment->_size.load(std::memory_order_acquire);
+                for (size_t i = 0; i < size; i++) {
+                    if (segment->_first_seq + i > last_seq) {
+                        return;
+                    }
+                    const auto &item = segment->_items[i];
+                    f(item.second, item.first);
+                }
+                segment = std::atomic_load(&segment->_next);
+            }
+        }
+
+    private:
+        const uint64_t _first_seq;
+        std::unique_ptr<std::pair<bool, T>[]> _items;
+        size_t _written = 0;
+        std::atomic<size_t> _size{0};
+        Ptr _next;
+    };
+
+    /**
+* 一个poller已经派发到的位置: 所在GOP的第一个分段和最后派发的数据的序号
+* 只在该poller线程中访问
+* @tparam T
+*/
+    template<typename T>
+    struct _RingCursor {
+        using Ptr = std::shared_ptr<_RingCursor>;
+        typename _RingSegment<T>::Ptr gop;
+        uint64_t seq = 0;
+    };
+
     /**
 * 环形缓存读取器
 * 该对象的事件触发都会在绑定的poller线程中执行
@@ -55,8 +129,8 @@ namespace toolkit {
         using Ptr = std::shared_ptr<_RingReader>;
         friend class _RingReaderDispatcher<T>;
 
-        _RingReader(const std::shared_ptr<_RingStorage<T>> &storage, bool use_cache) {
-            _storage = storage;
+        _RingReader(const typename _RingCursor<T>::Ptr &cursor, bool use_cache) {
+            _cursor = cursor;
             _use_cache = use_cache;
         }
 
@@ -92,23 +166,28 @@ namespace toolkit {
             if (!_use_cache) {
                 return;
             }
-            const auto &cache = _storage->getCache();
-            std::for_each(cache.begin(), cache.end(), [this](const std::pair<bool, T> &pr) {
-                onRead(pr.second, pr.first);
+            //引用共享的分段链, 重放到本poller已经派发的位置
+            _RingSegment<T>::forEach(_cursor->gop, _cursor->seq, [this](const T &data, bool is_key) {
+                onRead(data, is_key);
             });
         }
 
     private:
         bool _use_cache;
-        std::shared_ptr<_RingStorage<T>> _storage;
+        typename _RingCursor<T>::Ptr _cursor;
         std::function<void(void)> _detach_cb = []() {};
         std::function<void(const T &)> _read_cb = [](const T &) {};
     };
 
+    /**
+* GOP缓存, 只由RingBuffer在写锁中访问
+* @tparam T
+*/
     template<typename T>
     class _RingStorage {
     public:
         using Ptr = std::shared_ptr<_RingStorage>;
+        using Segment = _RingSegment<T>;
 
         _RingStorage(int max_size) {
             //gop缓存个数不能小于32
@@ -124,55 +203,65 @@ namespace toolkit {
      * 写入环形缓存数据
      * @param in 数据
      * @param is_key 是否为关键帧
-     * @return 是否触发重置环形缓存大小
      */
         void write(T in, bool is_key = true) {
+            ++_seq;
             if (is_key) {
-                //遇到I帧，那么移除老数据
+                //遇到I帧，那么开始新的分段链, 老数据由引用计数释放
                 _size = 0;
                 _have_idr = true;
-                _data_cache.clear();
+                _head = _tail = nullptr;
             }
 
             if (!_have_idr) {
                 //缓存中没有关键帧，那么gop缓存无效
                 return;
             }
-            _data_cache.emplace_back(std::make_pair(is_key, std::move(in)));
             if (++_size > _max_size) {
                 //GOP缓存溢出，清空关老数据
                 _size = 0;
                 _have_idr = false;
-                _data_cache.clear();
+                _head = _tail = nullptr;
+                return;
+            }
+            if (!_tail || _tail->full()) {
+                auto segment = std::make_shared<Segment>(_seq);
+                if (_tail) {
+                    _tail->link(segment);
+                } else {
+                    _head = segment;
+                }
+                _tail = std::move(segment);
             }
+            _tail->append(is_key, std::move(in));
         }
 
-        Ptr clone() const {
-            Ptr ret(new _RingStorage());
-            ret->_size = _size;
-            ret->_have_idr = _have_idr;
-            ret->_max_size = _max_size;
-            ret->_data_cache = _data_cache;
-            return ret;
+        /**
+     * 当前GOP的第一个分段, 没有缓存时为空
+     */
+        const typename Segment::Ptr &getGop() const {
+            return _head;
         }
 
-        const std::list<std::pair<bool, T>> &getCache() const {
-            return _data_cache;
+        /**
+     * 最后写入的数据的序号
+     */
+        uint64_t getSeq() const {
+            return _seq;
         }
 
         void clearCache() {
             _size = 0;
-            _data_cache.clear();
+            _head = _tail = nullptr;
         }
 
-    private:
-        _RingStorage() = default;
-
     private:
         bool _have_idr = false;
         int _size = 0;
         int _max_size;
-        std::list<std::pair<bool, T>> _data_cache;
+        uint64_t _seq = 0;
+        typename Segment::Ptr _head;
+        typename Segment::Ptr _tail;
     };
 
     template<typename T>
@@ -187,7 +276,8 @@ namespace toolkit {
     public:
         using Ptr = std::shared_ptr<_RingReaderDispatcher>;
         using RingReader = _RingReader<T>;
-        using RingStorage = _RingStorage<T>;
+        using RingCursor = _RingCursor<T>;
+        using Segment = _RingSegment<T>;
 
         friend class RingBuffer<T>;
 
@@ -203,13 +293,13 @@ namespace toolkit {
         }
 
     private:
-        _RingReaderDispatcher(const typename RingStorage::Ptr &storage, const std::function<void(int, bool)> &onSizeChanged) {
-            _storage = storage;
+        _RingReaderDispatcher(const typename RingCursor::Ptr &cursor, const std::function<void(int, bool)> &onSizeChanged) {
+            _cursor = cursor;
             _reader_size = 0;
             _on_size_changed = onSizeChanged;
         }
 
-        void write(T in, bool is_key = true) {
+        void write(const T &in, bool is_key, const typename Segment::Ptr &gop, uint64_t seq) {
             for (auto it = _reader_map.begin(); it != _reader_map.end();) {
                 auto reader = it->second.lock();
                 if (!reader) {
@@ -221,7 +311,27 @@ namespace toolkit {
                 reader->onRead(in, is_key);
                 ++it;
             }
-            _storage->write(std::move(in), is_key);
+            _cursor->gop = gop;
+            _cursor->seq = seq;
+        }
+
+        /// 一次派发一批数据, 每个读取器按顺序读完整批
+        void writeBatch(const std::shared_ptr<const std::vector<std::pair<bool, T>>> &batch, const typename Segment::Ptr &gop, uint64_t seq) {
+            for (auto it = _reader_map.begin(); it != _reader_map.end();) {
+                auto reader = it->second.lock();
+                if (!reader) {
+                    it = _reader_map.erase(it);
+                    --_reader_size;
+                    onSizeChanged(false);
+                    continue;
+                }
+                for (auto &item: *batch) {
+                    reader->onRead(item.second, item.first);
+                }
+                ++it;
+            }
+            _cursor->gop = gop;
+            _cursor->seq = seq;
         }
 
         std::shared_ptr<RingReader> attach(const event_poller::Ptr &poller, bool use_cache) {
@@ -241,7 +351,7 @@ namespace toolkit {
                 });
             };
 
-            std::shared_ptr<RingReader> reader(new RingReader(_storage, use_cache), on_dealloc);
+            std::shared_ptr<RingReader> reader(new RingReader(_cursor, use_cache), on_dealloc);
             _reader_map[reader.get()] = reader;
             ++_reader_size;
             onSizeChanged(true);
@@ -254,14 +364,14 @@ namespace toolkit {
 
         void clearCache() {
             if (_reader_size == 0) {
-                _storage->clearCache();
+                _cursor->gop = nullptr;
             }
         }
 
     private:
         std::atomic_int _reader_size;
         std::function<void(int, bool)> _on_size_changed;
-        typename RingStorage::Ptr _storage;
+        typename RingCursor::Ptr _cursor;
         std::unordered_map<void *, std::weak_ptr<RingReader>> _reader_map;
     };
 
@@ -273,6 +383,7 @@ namespace toolkit {
         using RingStorage = _RingStorage<T>;
         using RingReaderDispatcher = _RingReaderDispatcher<T>;
         using onReaderChanged = std::function<void(int size)>;
+        using Batch = std::vector<std::pair<bool, T>>;
 
         RingBuffer(int max_size = 1024, const onReaderChanged &cb = nullptr) {
             _on_reader_changed = cb;
@@ -287,15 +398,101 @@ namespace toolkit {
                 return;
             }
 
+            if (_coalescing.load(std::memory_order_relaxed)) {
+                std::lock_guard<std::mutex> lck(_mtx_pending);
+                if (_coalesce_post) {
+                    _pending.emplace_back(is_key, std::move(in));
+                    /// 本轮的第一个数据, 在写入线程处理完本轮事件之后一起派发
+                    if (_pending.size() == 1) {
+                        std::weak_ptr<RingBuffer> weakSelf = this->shared_from_this();
+                        _coalesce_post([weakSelf]() {
+                            if (auto strongSelf = weakSelf.lock()) {
+                                strongSelf->flushPending();
+                            }
+                        });
+                    }
+                    return;
+                }
+            }
+
             LOCK_GUARD(_mtx_map);
+            //先写入共享的GOP缓存, 派发时带上写入之后的位置
+            _storage->write(in, is_key);
+            auto gop = _storage->getGop();
+            auto seq = _storage->getSeq();
             for (auto &pr: _dispatcher_map) {
                 auto &second = pr.second;
+                ++_post_count;
                 //切换线程后触发onRead事件
-                pr.first->async([second, in, is_key]() {
-                    second->write(std::move(const_cast<T &>(in)), is_key);
+                pr.first->async([second, in, is_key, gop, seq]() {
+                    second->write(in, is_key, gop, seq);
                 });
             }
-            _storage->write(std::move(in), is_key);
+        }
+
+        /**
+         * 批量写入, 每个poller只投递一次
+         * @param batch 数据和是否为关键帧
+         */
+        void writeBatch(Batch batch) {
+            if (batch.empty()) {
+                return;
+            }
+            if (_delegate) {
+                for (auto &item: batch) {
+                    _delegate->onWrite(std::move(item.second), item.first);
+                }
+                return;
+            }
+
+            std::shared_ptr<const Batch> shared = std::make_shared<Batch>(std::move(batch));
+            LOCK_GUARD(_mtx_map);
+            for (auto &item: *shared) {
+                _storage->write(item.second, item.first);
+            }
+            auto gop = _storage->getGop();
+            auto seq = _storage->getSeq();
+            for (auto &pr: _dispatcher_map) {
+                auto &second = pr.second;
+                ++_post_count;
+                pr.first->async([second, shared, gop, seq]() {
+                    second->writeBatch(shared, gop, seq);
+                });
+            }
+        }
+
+        /**
+         * 自动合并: write写入的数据先缓存, 在poller的本轮事件处理完之后作为一批派发
+         * 适合在同一个线程中连续写入的场景(例如一次收到多个包), 跨线程投递的次数和写入次数无关
+         * @param poller 为空时关闭, 缓存中的数据立即派发
+         */
+        void setCoalescePoller(const event_poller::Ptr &poller) {
+            if (!poller) {
+                return setCoalescePost(nullptr);
+            }
+            setCoalescePost([poller](const std::function<void()> &f) {
+                poller->get_executor().post(f);
+            });
+        }
+
+        /**
+         * 同setCoalescePoller, 写入来自executor线程时使用, 在executor本轮任务执行完之后派发
+         * @param exec 为空时关闭, 缓存中的数据立即派发
+         */
+        void setCoalesceExecutor(const std::shared_ptr<executor> &exec) {
+            if (!exec) {
+                return setCoalescePost(nullptr);
+            }
+            setCoalescePost([exec](const std::function<void()> &f) {
+                exec->post(f);
+            });
+        }
+
+        /**
+         * 投递到读取器所在poller的任务数量
+         */
+        uint64_t postCount() const {
+            return _post_count.load(std::memory_order_relaxed);
         }
 
         void setDelegate(const typename RingDelegate<T>::Ptr &delegate) {
@@ -322,7 +519,11 @@ namespace toolkit {
                             delete ptr;
                         });
                     };
-                    ref.reset(new RingReaderDispatcher(_storage->clone(), std::move(onSizeChanged)), std::move(onDealloc));
+                    //新的poller从当前位置开始派发, 只引用共享的分段链, 不复制GOP缓存
+                    auto cursor = std::make_shared<typename RingReaderDispatcher::RingCursor>();
+                    cursor->gop = _storage->getGop();
+                    cursor->seq = _storage->getSeq();
+                    ref.reset(new RingReaderDispatcher(cursor, std::move(onSizeChanged)), std::move(onDealloc));
                 }
                 dispatcher = ref;
             }
@@ -348,6 +549,28 @@ namespace toolkit {
         }
 
     private:
+        void flushPending() {
+            Batch batch;
+            {
+                std::lock_guard<std::mutex> lck(_mtx_pending);
+                batch.swap(_pending);
+            }
+            writeBatch(std::move(batch));
+        }
+
+        void setCoalescePost(std::function<void(const std::function<void()> &)> post) {
+            Batch batch;
+            {
+                std::lock_guard<std::mutex> lck(_mtx_pending);
+                _coalescing.store(post != nullptr);
+                _coalesce_post = std::move(post);
+                if (!_coalesce_post) {
+                    batch.swap(_pending);
+                }
+            }
+            writeBatch(std::move(batch));
+        }
+
         void onSizeChanged(const event_poller::Ptr &poller, int size, bool add_flag) {
             if (size == 0) {
                 LOCK_GUARD(_mtx_map);
@@ -379,6 +602,13 @@ namespace toolkit {
         typename RingDelegate<T>::Ptr _delegate;
         onReaderChanged _on_reader_changed;
         std::unordered_map<event_poller::Ptr, typename RingReaderDispatcher::Ptr, HashOfPtr> _dispatcher_map;
+        std::atomic<uint64_t> _post_count{0};
+        //自动合并
+        std::atomic<bool> _coalescing{false};
+        std::mutex _mtx_pending;
+        /// 投递到写入线程, 在本轮写入结束之后执行
+        std::function<void(const std::function<void()> &)> _coalesce_post;
+        Batch _pending;
     };
 
 } /* namespace toolkit */
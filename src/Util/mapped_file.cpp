@@ -0,0 +1,96 @@
+﻿//
+// Created by 沈昊 on 2026/10/19.
+//
+#include "mapped_file.hpp"
+#include <system_error>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+mapped_file::Ptr mapped_file::open(const std::string &path) {
+    Ptr file(new mapped_file());
+    file->_path = path;
+#ifdef _WIN32
+    file->_file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (file->_file == INVALID_HANDLE_VALUE) {
+        file->_file = nullptr;
+        throw std::system_error((int) GetLastError(), std::system_category(), path);
+    }
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file->_file, &size)) {
+        throw std::system_error((int) GetLastError(), std::system_category(), path);
+    }
+    file->_size = static_cast<size_t>(size.QuadPart);
+    if (file->_size == 0) {
+        return file;
+    }
+    file->_mapping = CreateFileMappingA(file->_file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (!file->_mapping) {
+        throw std::system_error((int) GetLastError(), std::system_category(), path);
+    }
+    file->_data = (char *) MapViewOfFile(file->_mapping, FILE_MAP_READ, 0, 0, 0);
+    if (!file->_data) {
+        throw std::system_error((int) GetLastError(), std::system_category(), path);
+    }
+#else
+    file->_fd = ::open(path.c_str(), O_RDONLY);
+    if (file->_fd < 0) {
+        throw std::system_error(errno, std::system_category(), path);
+    }
+    struct stat st {};
+    if (fstat(file->_fd, &st) < 0) {
+        throw std::system_error(errno, std::system_category(), path);
+    }
+    file->_size = static_cast<size_t>(st.st_size);
+    /// 空文件不需要映射
+    if (file->_size == 0) {
+        return file;
+    }
+    auto *addr = mmap(nullptr, file->_size, PROT_READ, MAP_SHARED, file->_fd, 0);
+    if (addr == MAP_FAILED) {
+        throw std::system_error(errno, std::system_category(), path);
+    }
+    file->_data = (char *) addr;
+    /// 顺序读取, 让内核提前预读
+    madvise(addr, file->_size, MADV_SEQUENTIAL);
+#endif
+    return file;
+}
+
+mapped_file::~mapped_file() {
+#ifdef _WIN32
+    if (_data) {
+        UnmapViewOfFile(_data);
+    }
+    if (_mapping) {
+        CloseHandle(_mapping);
+    }
+    if (_file) {
+        CloseHandle(_file);
+    }
+#else
+    if (_data) {
+        munmap(_data, _size);
+    }
+    if (_fd >= 0) {
+        ::close(_fd);
+    }
+#endif
+}
+
+const char *mapped_file::data() const {
+    return _data;
+}
+
+size_t mapped_file::size() const {
+    return _size;
+}
+
+const std::string &mapped_file::path() const {
+    return _path;
+}
@@ -0,0 +1,43 @@
+﻿//
+// Created by 沈昊 on 2026/10/19.
+//
+
+#ifndef TOOLKIT_MAPPED_FILE_HPP
+#define TOOLKIT_MAPPED_FILE_HPP
+#include "nocopyable.hpp"
+#include <cstddef>
+#include <memory>
+#include <string>
+
+/// 只读映射整个文件, 映射的内存在对象析构时释放
+/// 发送时多个包可以通过shared_ptr直接引用映射的页, 不需要拷贝
+class mapped_file : public noncopyable {
+public:
+    using Ptr = std::shared_ptr<mapped_file>;
+
+public:
+    /// 打开失败抛出std::system_error
+    static Ptr open(const std::string &path);
+    ~mapped_file();
+
+public:
+    const char *data() const;
+    size_t size() const;
+    const std::string &path() const;
+
+private:
+    mapped_file() = default;
+
+private:
+    std::string _path;
+    char *_data = nullptr;
+    size_t _size = 0;
+#ifdef _WIN32
+    void *_file = nullptr;
+    void *_mapping = nullptr;
+#else
+    int _fd = -1;
+#endif
+};
+
+#endif//TOOLKIT_MAPPED_FILE_HPP
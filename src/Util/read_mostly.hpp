@@ -0,0 +1,183 @@
+﻿/*
+* @file_name: read_mostly.hpp
+* @date: 2026/10/19
+* @author: shen hao
+* Copyright @ hz shen hao, All rights reserved.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+
+#ifndef TOOLKIT_READ_MOSTLY_HPP
+#define TOOLKIT_READ_MOSTLY_HPP
+#include "nocopyable.hpp"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+//// 读多写少的数据, 读不加锁也不修改共享的引用计数
+//// 写时复制一份新的数据, 修改之后整体替换指针, 旧数据放到退休列表中
+//// 读者在读之前把当前的epoch登记到自己线程的槽位, 写者替换指针之后推进epoch
+//// 所有正在读的槽位的epoch都不小于旧数据退休时的epoch时, 旧数据不会再被引用, 可以释放
+namespace read_mostly_detail {
+    constexpr size_t max_threads = 256;
+
+    /// 所有read_mostly共用的线程槽位, 线程退出时归还
+    inline std::atomic<bool> *slot_flags() {
+        static std::atomic<bool> flags[max_threads];
+        return flags;
+    }
+
+    struct thread_slot {
+        size_t index = max_threads;
+        thread_slot() {
+            auto flags = slot_flags();
+            for (size_t i = 0; i < max_threads; i++) {
+                bool expected = false;
+                if (!flags[i].load(std::memory_order_relaxed) && flags[i].compare_exchange_strong(expected, true)) {
+                    index = i;
+                    break;
+                }
+            }
+        }
+        ~thread_slot() {
+            if (index < max_threads) {
+                slot_flags()[index].store(false, std::memory_order_release);
+            }
+        }
+    };
+
+    /// 槽位用完时返回max_threads, 这些线程读的时候退化为加锁
+    inline size_t this_thread_slot() {
+        static thread_local thread_slot slot;
+        return slot.index;
+    }
+}// namespace read_mostly_detail
+
+template<typename T>
+class read_mostly : public noncopyable {
+public:
+    read_mostly() : _current(new T()), _slots(new reader_slot[read_mostly_detail::max_threads]) {}
+
+    ~read_mostly() {
+        delete _current.load(std::memory_order_relaxed);
+        for (auto &item: _retired) {
+            delete item.first;
+        }
+    }
+
+public:
+    /// 在f中读取当前的数据, f返回之后不能再持有数据的引用, 可以嵌套
+    template<typename F>
+    auto read(F &&f) const -> decltype(f(std::declval<const T &>())) {
+        reader_guard guard(*this);
+        return f(*_current.load(std::memory_order_seq_cst));
+    }
+
+    /// 复制一份当前的数据交给f修改, f返回false时放弃修改; 写者之间串行化
+    template<typename F>
+    bool update(F &&f) {
+        std::lock_guard<std::recursive_mutex> lock(_mtx);
+        std::unique_ptr<T> next(new T(*_current.load(std::memory_order_relaxed)));
+        if (!f(*next)) {
+            return false;
+        }
+        auto old = _current.exchange(next.release(), std::memory_order_seq_cst);
+        auto epoch = _epoch.fetch_add(1, std::memory_order_seq_cst) + 1;
+        _retired.emplace_back(old, epoch);
+        reclaim();
+        return true;
+    }
+
+    /// 还没有释放的旧数据
+    size_t retired_size() const {
+        std::lock_guard<std::recursive_mutex> lock(_mtx);
+        return _retired.size();
+    }
+
+private:
+    struct reader_slot {
+        /// 0表示没有在读
+        std::atomic<uint64_t> epoch{0};
+        /// 只由拥有槽位的线程访问
+        uint32_t depth = 0;
+        /// 避免伪共享
+        char pad[64 - sizeof(std::atomic<uint64_t>) - sizeof(uint32_t)]{};
+    };
+
+    class reader_guard {
+    public:
+        explicit reader_guard(const read_mostly &owner) : _owner(owner), _index(read_mostly_detail::this_thread_slot()) {
+            if (_index >= read_mostly_detail::max_threads) {
+                _owner._mtx.lock();
+                return;
+            }
+            auto &slot = _owner._slots[_index];
+            if (slot.depth++ == 0) {
+                slot.epoch.store(_owner._epoch.load(std::memory_order_seq_cst), std::memory_order_seq_cst);
+            }
+        }
+
+        ~reader_guard() {
+            if (_index >= read_mostly_detail::max_threads) {
+                _owner._mtx.unlock();
+                return;
+            }
+            auto &slot = _owner._slots[_index];
+            if (--slot.depth == 0) {
+                slot.epoch.store(0, std::memory_order_release);
+            }
+        }
+
+    private:
+        const read_mostly &_owner;
+        size_t _index;
+    };
+
+    /// 释放所有读者都已经离开的旧数据, 持有写锁时调用
+    void reclaim() {
+        auto oldest = (std::numeric_limits<uint64_t>::max)();
+        for (size_t i = 0; i < read_mostly_detail::max_threads; i++) {
+            auto epoch = _slots[i].epoch.load(std::memory_order_seq_cst);
+            if (epoch && epoch < oldest) {
+                oldest = epoch;
+            }
+        }
+        auto it = _retired.begin();
+        while (it != _retired.end() && it->second <= oldest) {
+            delete it->first;
+            ++it;
+        }
+        _retired.erase(_retired.begin(), it);
+    }
+
+private:
+    std::atomic<T *> _current;
+    /// 从1开始, 槽位中的0表示空闲
+    std::atomic<uint64_t> _epoch{1};
+    std::unique_ptr<reader_slot[]> _slots;
+    /// 退休的数据和退休时的epoch, epoch递增
+    std::vector<std::pair<T *, uint64_t>> _retired;
+    mutable std::recursive_mutex _mtx;
+};
+
+#endif//TOOLKIT_READ_MOSTLY_HPP
@@ -0,0 +1,171 @@
+﻿/*
+* @file_name: spsc_ring.hpp
+* @date: 2026/10/19
+* @author: shen hao
+* Copyright @ hz shen hao, All rights reserved.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+
+#ifndef TOOLKIT_SPSC_RING_HPP
+#define TOOLKIT_SPSC_RING_HPP
+#include "nocopyable.hpp"
+#include <atomic>
+#include <cstddef>
+#include <memory>
+//// 单生产者单消费者的无锁环形队列, 读写不加锁
+//// 生产者只修改tail, 消费者只修改head, 两者放在不同的cache line上
+//// 槽位按分段(最多64个)按需分配, 消费者读完一个分段后立即释放, 内存只和队列中的数据量成正比
+//// 生产者一侧(free_size/producer_slot/commit/push)同一时刻只能有一个线程调用, 消费者同样只能有一个
+//// 多个线程写入时必须在外部把从free_size到commit的整个写入过程串行化, 这时队列相当于多生产者单消费者
+template<typename T>
+class spsc_ring : public noncopyable {
+public:
+    explicit spsc_ring(size_t capacity) {
+        size_t cap = 1;
+        while (cap < capacity) {
+            cap <<= 1;
+        }
+        _mask = cap - 1;
+        _segment_size = cap < 64 ? cap : 64;
+        while ((size_t) 1 << _segment_shift < _segment_size) {
+            ++_segment_shift;
+        }
+        /// 队列满时数据最多横跨capacity / segment_size + 1个分段, 分段表取两倍避免新旧分段冲突
+        _segment_count = cap / _segment_size * 2;
+        _segments.reset(new std::atomic<T *>[_segment_count]);
+        for (size_t i = 0; i < _segment_count; i++) {
+            _segments[i].store(nullptr, std::memory_order_relaxed);
+        }
+    }
+
+    ~spsc_ring() {
+        for (size_t i = 0; i < _segment_count; i++) {
+            delete[] _segments[i].load(std::memory_order_relaxed);
+        }
+    }
+
+public:
+    size_t capacity() const {
+        return _mask + 1;
+    }
+
+    size_t size() const {
+        auto tail = _tail.load(std::memory_order_acquire);
+        auto head = _head.load(std::memory_order_acquire);
+        return tail - head;
+    }
+
+    bool empty() const {
+        return size() == 0;
+    }
+
+    /// 已经分配的分段数量
+    size_t allocated_segments() const {
+        size_t count = 0;
+        for (size_t i = 0; i < _segment_count; i++) {
+            if (_segments[i].load(std::memory_order_relaxed)) {
+                ++count;
+            }
+        }
+        return count;
+    }
+
+    //// 生产者
+    /// 还未提交的第index个空闲槽位, 写完之后调用commit一次性发布
+    T &producer_slot(size_t index) {
+        auto position = _tail.load(std::memory_order_relaxed) + index;
+        auto &segment = _segments[(position >> _segment_shift) & (_segment_count - 1)];
+        auto slots = segment.load(std::memory_order_acquire);
+        if (!slots) {
+            slots = new T[_segment_size];
+            segment.store(slots, std::memory_order_release);
+        }
+        return slots[position & (_segment_size - 1)];
+    }
+
+    /// 空闲槽位数量
+    size_t free_size() const {
+        return capacity() - (_tail.load(std::memory_order_relaxed) - _head.load(std::memory_order_acquire));
+    }
+
+    void commit(size_t count) {
+        _tail.store(_tail.load(std::memory_order_relaxed) + count, std::memory_order_release);
+    }
+
+    bool push(T &&t) {
+        if (!free_size()) {
+            return false;
+        }
+        producer_slot(0) = std::move(t);
+        commit(1);
+        return true;
+    }
+
+    //// 消费者
+    /// 队列为空时返回nullptr
+    T *front() {
+        return peek(0);
+    }
+
+    /// 第index个可读的元素, 不存在时返回nullptr
+    T *peek(size_t index) {
+        auto head = _head.load(std::memory_order_relaxed);
+        if (_tail.load(std::memory_order_acquire) - head <= index) {
+            return nullptr;
+        }
+        return &consumer_slot(head + index);
+    }
+
+    /// 释放槽位中的对象, 避免长时间持有引用的资源
+    /// 分段的最后一个槽位被读取后释放整个分段, 必须在发布head之前完成
+    void pop() {
+        auto head = _head.load(std::memory_order_relaxed);
+        auto &segment = _segments[(head >> _segment_shift) & (_segment_count - 1)];
+        auto slots = segment.load(std::memory_order_acquire);
+        if ((head & (_segment_size - 1)) == _segment_size - 1) {
+            segment.store(nullptr, std::memory_order_relaxed);
+            delete[] slots;
+        } else {
+            slots[head & (_segment_size - 1)] = T();
+        }
+        _head.store(head + 1, std::memory_order_release);
+    }
+
+private:
+    T &consumer_slot(size_t position) {
+        auto slots = _segments[(position >> _segment_shift) & (_segment_count - 1)].load(std::memory_order_acquire);
+        return slots[position & (_segment_size - 1)];
+    }
+
+private:
+    std::unique_ptr<std::atomic<T *>[]> _segments;
+    size_t _segment_count = 0;
+    size_t _segment_size = 1;
+    size_t _segment_shift = 0;
+    size_t _mask = 0;
+    /// 避免伪共享
+    char _pad0[64]{};
+    std::atomic<size_t> _head{0};
+    char _pad1[64]{};
+    std::atomic<size_t> _tail{0};
+    char _pad2[64]{};
+};
+
+#endif//TOOLKIT_SPSC_RING_HPP
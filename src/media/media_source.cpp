@@ -23,9 +23,13 @@
 * SOFTWARE.
 */
 #include "media_source.hpp"
+#include "Util/read_mostly.hpp"
 #include "net/executor_pool.hpp"
+#include <algorithm>
+#include <atomic>
 #include <mutex>
 #include <unordered_map>
+#include <vector>
 using pointer = typename media_source::pointer;
 using ring_buffer_pointer = typename media_source::ring_buffer_pointer;
 media_source::media_source() {
@@ -60,8 +64,20 @@ const ring_buffer_pointer &media_source::get_ring() const {
     return _ring_buffer;
 }
 
-static std::unordered_map<std::string, std::unordered_map<size_t, pointer>> source_map;
-static std::mutex source_mtx;
+/// 查找远多于注册和注销, 查找不加锁; 注册和注销复制整张表
+using source_table = std::unordered_map<std::string, std::unordered_map<size_t, pointer>>;
+static read_mostly<source_table> source_map;
+
+struct source_waiter {
+    event_poller::Ptr poller;
+    std::function<void(const pointer &)> f;
+    std::shared_ptr<event_poller::timer_type> timer;
+    /// 唤醒和超时只有一个生效
+    std::atomic<bool> done{false};
+};
+using waiter_list = std::vector<std::shared_ptr<source_waiter>>;
+static std::unordered_map<std::string, std::unordered_map<size_t, waiter_list>> waiter_map;
+static std::mutex waiter_mtx;
 static size_t identify_l(const string_view &app, const string_view &stream) {
     constexpr uint64_t offset_basis = 14695981039346656037ULL;
     constexpr uint64_t prime = 1099511628211ULL;
@@ -77,43 +93,100 @@ static size_t identify_l(const string_view &app, const string_view &stream) {
     return static_cast<size_t>(val);
 }
 
+static pointer find_source_l(const source_table &table, const std::string &vhost, size_t identify) {
+    auto it = table.find(vhost);
+    if (it == table.end()) {
+        return nullptr;
+    }
+    auto iter = it->second.find(identify);
+    if (iter == it->second.end()) {
+        return nullptr;
+    }
+    return iter->second;
+}
+
+/// 按poller分组, 每个poller只投递一个任务
+static void wake_up_waiters(waiter_list &waiters, const pointer &p) {
+    std::unordered_map<event_poller *, std::shared_ptr<waiter_list>> groups;
+    for (auto &item: waiters) {
+        auto &group = groups[item->poller.get()];
+        if (!group) {
+            group = std::make_shared<waiter_list>();
+        }
+        group->emplace_back(std::move(item));
+    }
+    for (auto &pr: groups) {
+        auto group = pr.second;
+        group->front()->poller->async([group, p]() {
+            for (auto &item: *group) {
+                if (item->done.exchange(true)) {
+                    continue;
+                }
+                if (item->timer) {
+                    item->timer->cancel();
+                }
+                item->f(p);
+            }
+        });
+    }
+}
+
 pointer media_source::add_or_remove_source(bool add, const pointer &p) {
     auto identify = identify_l(p->app(), p->stream());
-    std::lock_guard<std::mutex> lmtx(source_mtx);
-    auto it = source_map.find(p->vhost());
     if (add) {
-        if (it == source_map.end()) {
-            std::string v(p->vhost().data(), p->vhost().size());
-            auto pair_ = source_map.insert(std::make_pair(v, std::unordered_map<size_t, pointer>()));
-            it = pair_.first;
-        }
-        auto iter = it->second.find(identify);
-        if (iter != it->second.end()) {
+        auto added = source_map.update([&](source_table &table) {
+            auto &sources = table[p->vhost()];
+            return sources.emplace(identify, p).second;
+        });
+        if (!added) {
             return nullptr;
         }
-        it->second.emplace(identify, p);
+        /// 注册之后才取出等待者, 等待者在waiter_mtx中检查源是否存在, 不会错过唤醒
+        waiter_list waiters;
+        {
+            std::lock_guard<std::mutex> lmtx(waiter_mtx);
+            auto it = waiter_map.find(p->vhost());
+            if (it != waiter_map.end()) {
+                auto iter = it->second.find(identify);
+                if (iter != it->second.end()) {
+                    waiters.swap(iter->second);
+                    it->second.erase(iter);
+                }
+                if (it->second.empty()) {
+                    waiter_map.erase(it);
+                }
+            }
+        }
+        if (!waiters.empty()) {
+            wake_up_waiters(waiters, p);
+        }
         return p;
     }
-    if (it == source_map.end()) {
-        return nullptr;
-    }
-    it->second.erase(identify);
+    /// 只移除自己注册的源, 同名的新源不受影响
+    source_map.update([&](source_table &table) {
+        auto it = table.find(p->vhost());
+        if (it == table.end()) {
+            return false;
+        }
+        auto iter = it->second.find(identify);
+        if (iter == it->second.end() || iter->second != p) {
+            return false;
+        }
+        it->second.erase(iter);
+        if (it->second.empty()) {
+            table.erase(it);
+        }
+        return true;
+    });
     return nullptr;
 }
 
 pointer media_source::find_source(const string_view &vhost, const string_view &app, const string_view &stream) {
     auto identify = identify_l(app, stream);
     std::string _vhost(vhost.data(), vhost.size());
-    std::lock_guard<std::mutex> lmtx(source_mtx);
-    auto it = source_map.find(_vhost);
-    if (it == source_map.end()) {
-        return nullptr;
-    }
-    auto iter = it->second.find(identify);
-    if (iter == it->second.end()) {
-        return nullptr;
-    }
-    return iter->second;
+    return source_map.read([&](const source_table &table) {
+        return find_source_l(table, _vhost, identify);
+    });
 }
 
 void media_source::async_find_source(const string_view &vhost, const string_view &app, const string_view &stream, const std::function<void(const pointer &)> &f) {
@@ -127,6 +200,73 @@ void media_source::async_find_source(const string_view &vhost, const string_view
     });
 }
 
+void media_source::async_wait_source(const string_view &vhost, const string_view &app, const string_view &stream, const event_poller::Ptr &poller, uint32_t timeout_ms,
+                                     const std::function<void(const pointer &)> &f) {
+    auto p = find_source(vhost, app, stream);
+    if (p) {
+        return poller->async([f, p]() { f(p); });
+    }
+    std::string _vhost(vhost.data(), vhost.size());
+    auto identify = identify_l(app, stream);
+    auto waiter = std::make_shared<source_waiter>();
+    waiter->poller = poller;
+    waiter->f = f;
+    /// 在挂起之前启动定时器, 唤醒时定时器已经可以取消
+    if (timeout_ms) {
+        std::weak_ptr<source_waiter> weak_waiter(waiter);
+        waiter->timer = poller->create_timer();
+        waiter->timer->expires_after(std::chrono::milliseconds(timeout_ms));
+        waiter->timer->async_wait([weak_waiter, _vhost, identify](const std::error_code &e) {
+            auto waiter = weak_waiter.lock();
+            if (e || !waiter || waiter->done.exchange(true)) {
+                return;
+            }
+            {
+                std::lock_guard<std::mutex> lmtx(waiter_mtx);
+                auto it = waiter_map.find(_vhost);
+                if (it != waiter_map.end()) {
+                    auto iter = it->second.find(identify);
+                    if (iter != it->second.end()) {
+                        auto &waiters = iter->second;
+                        waiters.erase(std::remove(waiters.begin(), waiters.end(), waiter), waiters.end());
+                        if (waiters.empty()) {
+                            it->second.erase(iter);
+                        }
+                    }
+                    if (it->second.empty()) {
+                        waiter_map.erase(it);
+                    }
+                }
+            }
+            waiter->f(nullptr);
+        });
+    }
+    {
+        std::lock_guard<std::mutex> lmtx(waiter_mtx);
+        /// 加锁之后再检查一次, 注册发生在加锁之前时源已经可见
+        p = source_map.read([&](const source_table &table) {
+            return find_source_l(table, _vhost, identify);
+        });
+        if (!p) {
+            waiter_map[_vhost][identify].emplace_back(waiter);
+            return;
+        }
+    }
+    waiter_list waiters{waiter};
+    wake_up_waiters(waiters, p);
+}
+
+size_t media_source::waiting_size() {
+    std::lock_guard<std::mutex> lmtx(waiter_mtx);
+    size_t size = 0;
+    for (auto &pr: waiter_map) {
+        for (auto &item: pr.second) {
+            size += item.second.size();
+        }
+    }
+    return size;
+}
+
 size_t media_source::identify(const string_view &app, const string_view &stream) {
     return identify_l(app, stream);
 }
\ No newline at end of file
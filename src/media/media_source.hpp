@@ -29,7 +29,9 @@
 #include "Util/nocopyable.hpp"
 #include "Util/string_view.h"
 #include "net/buffer.hpp"
+#include "net/event_poller.hpp"
 #include "source_event.hpp"
+#include <cstdint>
 #include <functional>
 #include <memory>
 class media_source : public source_event, public noncopyable, public std::enable_shared_from_this<media_source> {
@@ -55,6 +57,12 @@ public:
     static pointer add_or_remove_source(bool add, const pointer &p);
     static pointer find_source(const string_view &vhost, const string_view &app, const string_view &stream);
     static void async_find_source(const string_view &vhost, const string_view &app, const string_view &stream, const std::function<void(const pointer &)> &f);
+    /// 等待源注册, 已经存在时立即回调; 否则挂起, 推流端注册时同一个poller上等待的所有回调在一个任务中批量执行
+    /// 超过timeout_ms(为0时一直等待)仍未注册时回调nullptr, 回调在poller中执行
+    static void async_wait_source(const string_view &vhost, const string_view &app, const string_view &stream, const event_poller::Ptr &poller, uint32_t timeout_ms,
+                                  const std::function<void(const pointer &)> &f);
+    /// 正在等待源注册的数量
+    static size_t waiting_size();
     static size_t identify(const string_view &app, const string_view &stream);
 
 private:
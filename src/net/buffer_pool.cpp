@@ -0,0 +1,78 @@
+﻿/*
+* @file_name: buffer_pool.cpp
+* @date: 2026/10/19
+* @author: oaho
+* Copyright @ hz oaho, All rights reserved.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+
+#include "buffer_pool.hpp"
+#include <algorithm>
+#include <atomic>
+
+constexpr size_t buffer_pool::scan_limit;
+
+buffer_pool::buffer_pool(size_t max_size) : _max_size(max_size) {}
+
+std::shared_ptr<buffer> buffer_pool::obtain() {
+    /// buffer大多按照接收的顺序释放, 从上一次的位置继续查找
+    auto count = std::min(_buffers.size(), scan_limit);
+    for (size_t i = 0; i < count; i++) {
+        auto &item = _buffers[_cursor];
+        _cursor = (_cursor + 1) % _buffers.size();
+        if (item.use_count() == 1) {
+            /// 和其他线程释放引用时的写入同步
+            std::atomic_thread_fence(std::memory_order_acquire);
+            item->backward();
+            return item;
+        }
+    }
+    auto buff = std::make_shared<buffer>();
+    if (_buffers.size() < _max_size) {
+        _buffers.push_back(buff);
+    }
+    return buff;
+}
+
+std::shared_ptr<buffer> buffer_pool::obtain(size_t capacity) {
+    auto buff = obtain();
+    if (buff->capacity() < capacity) {
+        /// 有内容的string扩容时至少翻倍, 空的string按照请求的大小分配
+        buffer replace;
+        replace.reserve(capacity);
+        buff->swap(replace);
+    }
+    return buff;
+}
+
+size_t buffer_pool::size() const {
+    return _buffers.size();
+}
+
+size_t buffer_pool::idle() const {
+    return (size_t) std::count_if(_buffers.begin(), _buffers.end(), [](const std::shared_ptr<buffer> &item) {
+        return item.use_count() == 1;
+    });
+}
+
+buffer_pool &buffer_pool::this_thread() {
+    static thread_local buffer_pool pool;
+    return pool;
+}
@@ -0,0 +1,61 @@
+﻿/*
+* @file_name: buffer_pool.hpp
+* @date: 2026/10/19
+* @author: oaho
+* Copyright @ hz oaho, All rights reserved.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+
+#ifndef TOOLKIT_BUFFER_POOL_HPP
+#define TOOLKIT_BUFFER_POOL_HPP
+#include "Util/nocopyable.hpp"
+#include "buffer.hpp"
+#include <cstddef>
+#include <memory>
+#include <vector>
+//// 接收缓存池: 每个数据报读到池中独立的buffer里, 同一个buffer作为接收队列的元素并直接交付给应用层, 不再拷贝
+//// 池为每个buffer保留一个引用, 应用层释放最后一个引用(引用计数回到1)后buffer回到池中, 已经分配的容量被复用
+//// 只能在创建池的线程中获取, 可以在任意线程释放
+class buffer_pool : public noncopyable {
+public:
+    /// 每次获取最多检查的buffer数量
+    static constexpr size_t scan_limit = 8;
+
+public:
+    explicit buffer_pool(size_t max_size = 1024);
+    /// 获取一个空闲的buffer, 池已满并且没有空闲时返回不属于池的buffer
+    std::shared_ptr<buffer> obtain();
+    /// 获取容量至少为capacity的buffer, 需要扩容时按照capacity分配, 不按照已有容量翻倍
+    /// 扩容的buffer内容被清空, 之后resize到capacity以内不会重新分配
+    std::shared_ptr<buffer> obtain(size_t capacity);
+    /// 池中的buffer数量
+    size_t size() const;
+    /// 没有被外部引用的buffer数量
+    size_t idle() const;
+    /// 当前线程的接收缓存池
+    static buffer_pool &this_thread();
+
+private:
+    std::vector<std::shared_ptr<buffer>> _buffers;
+    size_t _cursor = 0;
+    size_t _max_size;
+};
+
+#endif//TOOLKIT_BUFFER_POOL_HPP
@@ -26,6 +26,9 @@
 #include "Util/onceToken.h"
 #include "asio/executor_work_guard.hpp"
 #include "spdlog/logger.hpp"
+#if defined(__linux__)
+#include <pthread.h>
+#endif
 class thread_quit_exception : public std::exception {};
 
 event_poller::event_poller() : _running(false) {
@@ -77,9 +80,29 @@ bool event_poller::is_current_thread() const {
     return thread_id == get_thread_id();
 }
 
+uint64_t event_poller::get_busy_time() const {
+#if defined(__linux__)
+    if (_has_cpu_clock.load(std::memory_order_acquire)) {
+        std::lock_guard<std::mutex> lmtx(_mtx_cpu_clock);
+        struct timespec ts {};
+        if (_has_cpu_clock.load(std::memory_order_relaxed) && clock_gettime(_cpu_clock, &ts) == 0) {
+            return (uint64_t) ts.tv_sec * 1000000 + (uint64_t) ts.tv_nsec / 1000;
+        }
+    }
+#endif
+    /// 还没有启动时为0, 退出之后为退出时保存的值
+    return _busy_time.load(std::memory_order_acquire);
+}
+
 void event_poller::run() {
     Trace("event_poller 启动");
     this->id = std::this_thread::get_id();
+#if defined(__linux__)
+    /// 线程的CPU时间只包含执行任务和系统调用的时间, 阻塞在epoll_wait中不计入
+    if (pthread_getcpuclockid(pthread_self(), &_cpu_clock) == 0) {
+        _has_cpu_clock.store(true, std::memory_order_release);
+    }
+#endif
     auto construct_func = [&] { this->_running.store(true, std::memory_order_relaxed); };
     auto destroy_func = [&] { this->_running.store(false, std::memory_order_relaxed); };
     toolkit::onceToken token(construct_func, destroy_func);
@@ -93,6 +116,17 @@ void event_poller::run() {
             Error(e.what());
         }
     }
+#if defined(__linux__)
+    /// 线程退出之后时钟失效(线程id可能被复用), 等待正在读取的线程结束之后保存最后的值
+    std::lock_guard<std::mutex> lmtx(_mtx_cpu_clock);
+    if (_has_cpu_clock.load(std::memory_order_relaxed)) {
+        struct timespec ts {};
+        if (clock_gettime(_cpu_clock, &ts) == 0) {
+            _busy_time.store((uint64_t) ts.tv_sec * 1000000 + (uint64_t) ts.tv_nsec / 1000, std::memory_order_release);
+        }
+        _has_cpu_clock.store(false, std::memory_order_release);
+    }
+#endif
 }
 
 void event_poller::timer_func_helper(const std::error_code &e, const std::shared_ptr<timer_type> &timer, const std::function<size_t()> &func) {
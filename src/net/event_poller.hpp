@@ -28,6 +28,7 @@
 #include "asio/io_context.hpp"
 #include "executor_pool.hpp"
 #include <atomic>
+#include <ctime>
 #include <functional>
 #include <memory>
 #include <thread>
@@ -66,6 +67,11 @@ public:
      */
     const std::thread::id &get_thread_id() const;
     bool is_current_thread() const;
+    /*!
+     * poller线程已经消耗的CPU时间(us), 两次采样的差值除以经过的时间就是忙碌比例, 可以在任意线程调用
+     * @return 线程还没有启动或者平台不支持时返回0, 线程退出之后返回退出时的值
+     */
+    uint64_t get_busy_time() const;
     /*!
      * 异步执行任务,如果在本线程，则直接执行
      */
@@ -128,6 +134,16 @@ private:
      */
     std::atomic<bool> _running;
     std::mutex _mtx_running;
+    /*!
+     * 线程的CPU时钟, 在run中获取, 线程退出之前失效并且保存最后的值
+     * 其他线程持有_mtx_cpu_clock读取时钟, 线程不会在读取过程中退出
+     */
+    std::atomic<bool> _has_cpu_clock{false};
+    std::atomic<uint64_t> _busy_time{0};
+    mutable std::mutex _mtx_cpu_clock;
+#if defined(__linux__)
+    clockid_t _cpu_clock{};
+#endif
 };
 
 
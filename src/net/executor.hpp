@@ -51,6 +51,14 @@ public:
         cv.notify_one();
     }
 
+    /// 在执行器线程中调用时也不会立即执行, 在本轮任务全部执行完之后执行
+    template<typename FUNC>
+    void post(FUNC &&F) {
+        std::lock_guard<std::mutex> lmtx(mtx);
+        funcs.emplace_back(std::forward<FUNC>(F));
+        cv.notify_one();
+    }
+
     void start();
     void stop();
     void wait();
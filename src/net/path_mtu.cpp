@@ -0,0 +1,79 @@
+﻿/*
+* @file_name: path_mtu.cpp
+* @date: 2026/10/19
+* @author: oaho
+* Copyright @ hz oaho, All rights reserved.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+
+#include "path_mtu.hpp"
+#include "spdlog/logger.hpp"
+#if defined(__linux__)
+#include <cerrno>
+#include <cstring>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#endif
+
+#if defined(__linux__)
+static int socket_family(int fd) {
+    struct sockaddr_storage address {};
+    socklen_t length = sizeof(address);
+    if (getsockname(fd, (struct sockaddr *) &address, &length) != 0) {
+        return AF_UNSPEC;
+    }
+    return address.ss_family;
+}
+#endif
+
+bool path_mtu::enable_probe(int fd) {
+#if defined(__linux__) && defined(IP_PMTUDISC_PROBE)
+    auto family = socket_family(fd);
+    int value = IP_PMTUDISC_PROBE;
+    /// IPv6的socket上设置IPv4选项只对映射的地址生效, 失败不影响结果
+    auto ret = setsockopt(fd, IPPROTO_IP, IP_MTU_DISCOVER, &value, sizeof(value));
+#if defined(IPV6_PMTUDISC_PROBE)
+    if (family == AF_INET6) {
+        value = IPV6_PMTUDISC_PROBE;
+        ret = setsockopt(fd, IPPROTO_IPV6, IPV6_MTU_DISCOVER, &value, sizeof(value));
+    }
+#endif
+    if (ret == 0) {
+        return true;
+    }
+    Warn("set path mtu discover probe failed, {}", strerror(errno));
+#endif
+    return false;
+}
+
+uint32_t path_mtu::query(int fd) {
+#if defined(__linux__) && defined(IP_MTU)
+    int value = 0;
+    socklen_t length = sizeof(value);
+#if defined(IPV6_MTU)
+    if (socket_family(fd) == AF_INET6) {
+        return getsockopt(fd, IPPROTO_IPV6, IPV6_MTU, &value, &length) == 0 && value > 0 ? (uint32_t) value : 0;
+    }
+#endif
+    return getsockopt(fd, IPPROTO_IP, IP_MTU, &value, &length) == 0 && value > 0 ? (uint32_t) value : 0;
+#else
+    return 0;
+#endif
+}
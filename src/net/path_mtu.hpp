@@ -0,0 +1,42 @@
+﻿/*
+* @file_name: path_mtu.hpp
+* @date: 2026/10/19
+* @author: oaho
+* Copyright @ hz oaho, All rights reserved.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+
+#ifndef TOOLKIT_PATH_MTU_HPP
+#define TOOLKIT_PATH_MTU_HPP
+#include <cstdint>
+//// 路径MTU探测(PLPMTUD, RFC 8899):
+//// IP_MTU_DISCOVER=IP_PMTUDISC_PROBE: 设置DF不分片, 同时忽略内核缓存的路径MTU, 由协议层用探测包确认路径能通过的大小
+//// IPV6_MTU_DISCOVER=IPV6_PMTUDISC_PROBE: IPv6对应的选项, IPv6的socket同时设置两者以覆盖映射的IPv4地址
+//// IP_MTU/IPV6_MTU: 已经connect的socket上内核当前知道的路径MTU(出口网卡MTU或ICMP学习到的值)
+//// 选项作用于socket上的所有数据报, 只应该在socket只属于一个连接时开启
+class path_mtu {
+public:
+    /// 开启探测模式, 不支持的平台返回false
+    static bool enable_probe(int fd);
+    /// 内核当前知道的路径MTU, socket没有connect或者不支持时返回0
+    static uint32_t query(int fd);
+};
+
+#endif//TOOLKIT_PATH_MTU_HPP
@@ -0,0 +1,138 @@
+﻿/*
+* @file_name: socket_buffer.cpp
+* @date: 2026/10/19
+* @author: oaho
+* Copyright @ hz oaho, All rights reserved.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+
+#include "socket_buffer.hpp"
+#include "spdlog/logger.hpp"
+#include <algorithm>
+#if defined(__linux__)
+#include <cerrno>
+#include <cstring>
+#include <sys/socket.h>
+#endif
+
+constexpr size_t socket_buffer::min_size;
+constexpr size_t socket_buffer::max_size;
+constexpr uint32_t socket_buffer::max_scale;
+constexpr uint32_t socket_buffer::quiet_rounds;
+
+#if defined(__linux__)
+static size_t set_buffer(int fd, int force_option, int option, size_t size) {
+    int value = (int) std::min<size_t>(size, 0x3FFFFFFF);
+    /// 没有CAP_NET_ADMIN权限时返回EPERM, 只能设置到rmem_max/wmem_max
+    if (setsockopt(fd, SOL_SOCKET, force_option, &value, sizeof(value)) != 0 && setsockopt(fd, SOL_SOCKET, option, &value, sizeof(value)) != 0) {
+        Warn("set socket buffer failed, size={}, {}", size, strerror(errno));
+        return 0;
+    }
+    value = 0;
+    socklen_t length = sizeof(value);
+    if (getsockopt(fd, SOL_SOCKET, option, &value, &length) != 0) {
+        return 0;
+    }
+    /// 内核返回的大小包含了一倍的额外开销
+    return (size_t) value / 2;
+}
+#endif
+
+size_t socket_buffer::set_receive_buffer(int fd, size_t size) {
+#if defined(__linux__) && defined(SO_RCVBUFFORCE)
+    return set_buffer(fd, SO_RCVBUFFORCE, SO_RCVBUF, size);
+#else
+    return 0;
+#endif
+}
+
+size_t socket_buffer::set_send_buffer(int fd, size_t size) {
+#if defined(__linux__) && defined(SO_SNDBUFFORCE)
+    return set_buffer(fd, SO_SNDBUFFORCE, SO_SNDBUF, size);
+#else
+    return 0;
+#endif
+}
+
+bool socket_buffer::enable_drop_counter(int fd) {
+#if defined(__linux__) && defined(SO_RXQ_OVFL)
+    int on = 1;
+    if (setsockopt(fd, SOL_SOCKET, SO_RXQ_OVFL, &on, sizeof(on)) == 0) {
+        return true;
+    }
+    Warn("set SO_RXQ_OVFL failed, {}", strerror(errno));
+#endif
+    return false;
+}
+
+void socket_buffer::update(int fd, uint64_t bandwidth_delay_product) {
+    _bandwidth_delay_product = bandwidth_delay_product;
+    if (_scale > 1 && ++_quiet >= quiet_rounds) {
+        _scale >>= 1;
+        _quiet = 0;
+    }
+    /// 留出一倍的余量吸收突发
+    auto target = (size_t) std::min<uint64_t>(bandwidth_delay_product * 2 * _scale, max_size);
+    target = std::max(target, min_size);
+    if (target > _target || target * 2 < _target) {
+        apply(fd, target);
+    }
+}
+
+uint32_t socket_buffer::on_drop_counter(int fd, uint32_t counter) {
+    /// 计数器只增不减, 回绕时按照无符号差值计算
+    auto drops = counter - _counter;
+    _counter = counter;
+    if (!drops) {
+        return 0;
+    }
+    _drops += drops;
+    _quiet = 0;
+    auto now = std::chrono::steady_clock::now();
+    if (_scale < max_scale && now - _last_grow >= std::chrono::milliseconds(100)) {
+        _last_grow = now;
+        _scale <<= 1;
+        auto target = (size_t) std::min<uint64_t>(std::max<uint64_t>(_bandwidth_delay_product * 2, min_size) * _scale, max_size);
+        if (target > _target) {
+            Info("socket receive queue overflow, drops={}, grow buffer to {}", _drops, target);
+            apply(fd, target);
+        }
+    }
+    return drops;
+}
+
+size_t socket_buffer::get_receive_buffer() const {
+    return _receive_buffer;
+}
+
+size_t socket_buffer::get_send_buffer() const {
+    return _send_buffer;
+}
+
+uint64_t socket_buffer::get_drops() const {
+    return _drops;
+}
+
+void socket_buffer::apply(int fd, size_t target) {
+    _target = target;
+    _receive_buffer = set_receive_buffer(fd, target);
+    _send_buffer = set_send_buffer(fd, target);
+    Debug("socket buffer, target={}, receive={}, send={}", target, _receive_buffer, _send_buffer);
+}
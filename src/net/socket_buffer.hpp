@@ -0,0 +1,77 @@
+﻿/*
+* @file_name: socket_buffer.hpp
+* @date: 2026/10/19
+* @author: oaho
+* Copyright @ hz oaho, All rights reserved.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+
+#ifndef TOOLKIT_SOCKET_BUFFER_HPP
+#define TOOLKIT_SOCKET_BUFFER_HPP
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+//// socket收发缓冲区:
+//// SO_RCVBUFFORCE/SO_SNDBUFFORCE: 有CAP_NET_ADMIN权限时可以超过rmem_max/wmem_max, 没有权限时回退到SO_RCVBUF/SO_SNDBUF
+//// SO_RXQ_OVFL: recvmsg时通过控制消息返回接收队列溢出丢弃的数据报累计数量
+//// 缓冲区按照带宽时延积调整, 检测到内核丢包时成倍增大, 长时间没有丢包后逐渐恢复
+class socket_buffer {
+public:
+    /// 缓冲区的上下限
+    static constexpr size_t min_size = 256 * 1024;
+    static constexpr size_t max_size = 64 * 1024 * 1024;
+    /// 内核丢包时缓冲区的最大倍数
+    static constexpr uint32_t max_scale = 16;
+    /// 连续多少次调整没有丢包后倍数减半
+    static constexpr uint32_t quiet_rounds = 30;
+
+public:
+    /// 设置缓冲区大小, 返回内核实际使用的大小(不包含内核额外预留的一倍), 失败返回0
+    static size_t set_receive_buffer(int fd, size_t size);
+    static size_t set_send_buffer(int fd, size_t size);
+    /// 开启SO_RXQ_OVFL
+    static bool enable_drop_counter(int fd);
+
+public:
+    /// 根据带宽时延积(字节)调整缓冲区, 增大立即生效, 目标小于当前的一半时才缩小
+    void update(int fd, uint64_t bandwidth_delay_product);
+    /// counter为SO_RXQ_OVFL返回的累计丢包数, 返回新增的丢包数; 有新增丢包时增大缓冲区, 每100ms最多一次
+    uint32_t on_drop_counter(int fd, uint32_t counter);
+    /// 当前的缓冲区大小
+    size_t get_receive_buffer() const;
+    size_t get_send_buffer() const;
+    uint64_t get_drops() const;
+
+private:
+    void apply(int fd, size_t target);
+
+private:
+    uint64_t _bandwidth_delay_product = 0;
+    size_t _target = 0;
+    size_t _receive_buffer = 0;
+    size_t _send_buffer = 0;
+    uint32_t _scale = 1;
+    uint32_t _quiet = 0;
+    uint32_t _counter = 0;
+    uint64_t _drops = 0;
+    std::chrono::steady_clock::time_point _last_grow{};
+};
+
+#endif//TOOLKIT_SOCKET_BUFFER_HPP
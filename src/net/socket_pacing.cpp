@@ -0,0 +1,252 @@
+﻿/*
+* @file_name: socket_pacing.cpp
+* @date: 2026/10/19
+* @author: oaho
+* Copyright @ hz oaho, All rights reserved.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+#include "socket_pacing.hpp"
+#include "spdlog/logger.hpp"
+#include <chrono>
+#if defined(__linux__)
+#include <cerrno>
+#include <cstring>
+#include <linux/net_tstamp.h>
+#include <linux/rtnetlink.h>
+#include <netinet/in.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <time.h>
+#endif
+
+#if defined(__linux__) && defined(SO_TXTIME) && defined(SO_MAX_PACING_RATE)
+#define TOOLKIT_KERNEL_PACING 1
+#endif
+
+#ifdef TOOLKIT_KERNEL_PACING
+namespace {
+    /// 发送一个rtnetlink请求, 对每个回复的消息调用f, f返回true时停止
+    template<typename FUNC>
+    bool rtnetlink_request(struct nlmsghdr *request, FUNC &&f) {
+        int fd = socket(AF_NETLINK, SOCK_RAW | SOCK_CLOEXEC, NETLINK_ROUTE);
+        if (fd < 0) {
+            return false;
+        }
+        struct sockaddr_nl addr {};
+        addr.nl_family = AF_NETLINK;
+        if (sendto(fd, request, request->nlmsg_len, 0, (struct sockaddr *) &addr, sizeof(addr)) < 0) {
+            close(fd);
+            return false;
+        }
+        alignas(struct nlmsghdr) char buf[16384];
+        bool done = false;
+        while (!done) {
+            auto length = recv(fd, buf, sizeof(buf), 0);
+            if (length <= 0) {
+                break;
+            }
+            for (auto nh = (struct nlmsghdr *) buf; NLMSG_OK(nh, length); nh = NLMSG_NEXT(nh, length)) {
+                if (nh->nlmsg_type == NLMSG_DONE || nh->nlmsg_type == NLMSG_ERROR || f(nh)) {
+                    done = true;
+                    break;
+                }
+            }
+            /// 非dump请求只有一个回复
+            if (!(request->nlmsg_flags & NLM_F_DUMP)) {
+                break;
+            }
+        }
+        close(fd);
+        return true;
+    }
+
+    /// 查询路由得到出口网卡
+    int route_output_interface(const struct sockaddr *to) {
+        struct {
+            struct nlmsghdr nh;
+            struct rtmsg rt;
+            char attrs[64];
+        } request{};
+        const void *address = nullptr;
+        size_t address_size = 0;
+        if (to->sa_family == AF_INET) {
+            address = &((const struct sockaddr_in *) to)->sin_addr;
+            address_size = sizeof(struct in_addr);
+        } else if (to->sa_family == AF_INET6) {
+            address = &((const struct sockaddr_in6 *) to)->sin6_addr;
+            address_size = sizeof(struct in6_addr);
+        } else {
+            return 0;
+        }
+        request.nh.nlmsg_len = NLMSG_LENGTH(sizeof(struct rtmsg));
+        request.nh.nlmsg_type = RTM_GETROUTE;
+        request.nh.nlmsg_flags = NLM_F_REQUEST;
+        request.rt.rtm_family = to->sa_family;
+        request.rt.rtm_dst_len = (unsigned char) (address_size * 8);
+        auto rta = (struct rtattr *) ((char *) &request + NLMSG_ALIGN(request.nh.nlmsg_len));
+        rta->rta_type = RTA_DST;
+        rta->rta_len = RTA_LENGTH(address_size);
+        memcpy(RTA_DATA(rta), address, address_size);
+        request.nh.nlmsg_len = NLMSG_ALIGN(request.nh.nlmsg_len) + RTA_ALIGN(rta->rta_len);
+
+        int index = 0;
+        rtnetlink_request(&request.nh, [&](struct nlmsghdr *nh) {
+            if (nh->nlmsg_type != RTM_NEWROUTE) {
+                return false;
+            }
+            auto rt = (struct rtmsg *) NLMSG_DATA(nh);
+            int length = (int) RTM_PAYLOAD(nh);
+            for (auto attr = RTM_RTA(rt); RTA_OK(attr, length); attr = RTA_NEXT(attr, length)) {
+                if (attr->rta_type == RTA_OIF) {
+                    memcpy(&index, RTA_DATA(attr), sizeof(index));
+                }
+            }
+            return true;
+        });
+        return index;
+    }
+
+    /// 网卡上是否有fq或etf, 多队列网卡的fq挂在mq下面, 所以不只检查根节点
+    bool interface_has_txtime_qdisc(int index) {
+        struct {
+            struct nlmsghdr nh;
+            struct tcmsg tc;
+        } request{};
+        request.nh.nlmsg_len = NLMSG_LENGTH(sizeof(struct tcmsg));
+        request.nh.nlmsg_type = RTM_GETQDISC;
+        request.nh.nlmsg_flags = NLM_F_REQUEST | NLM_F_DUMP;
+        request.tc.tcm_family = AF_UNSPEC;
+        request.tc.tcm_ifindex = index;
+
+        bool found = false;
+        rtnetlink_request(&request.nh, [&](struct nlmsghdr *nh) {
+            if (nh->nlmsg_type != RTM_NEWQDISC) {
+                return false;
+            }
+            auto tc = (struct tcmsg *) NLMSG_DATA(nh);
+            if (tc->tcm_ifindex != index) {
+                return false;
+            }
+            int length = (int) TCA_PAYLOAD(nh);
+            for (auto attr = TCA_RTA(tc); RTA_OK(attr, length); attr = RTA_NEXT(attr, length)) {
+                if (attr->rta_type != TCA_KIND) {
+                    continue;
+                }
+                auto kind = (const char *) RTA_DATA(attr);
+                if (strcmp(kind, "fq") == 0 || strcmp(kind, "etf") == 0) {
+                    found = true;
+                }
+            }
+            return false;
+        });
+        return found;
+    }
+};// namespace
+#endif
+
+bool socket_pacing::egress_supports_txtime(const struct sockaddr *to, size_t to_size) {
+#ifdef TOOLKIT_KERNEL_PACING
+    if (!to || to_size < sizeof(struct sockaddr_in)) {
+        return false;
+    }
+    auto index = route_output_interface(to);
+    return index > 0 && interface_has_txtime_qdisc(index);
+#else
+    return false;
+#endif
+}
+
+bool socket_pacing::set_max_pacing_rate(int fd, uint64_t bytes_per_second) {
+#ifdef TOOLKIT_KERNEL_PACING
+    /// 内核的老接口是32位, 新内核接受64位
+    uint64_t rate = bytes_per_second ? bytes_per_second : ~0ULL;
+    if (setsockopt(fd, SOL_SOCKET, SO_MAX_PACING_RATE, &rate, sizeof(rate)) == 0) {
+        return true;
+    }
+    uint32_t rate32 = rate > 0xFFFFFFFFULL ? 0xFFFFFFFFU : (uint32_t) rate;
+    if (setsockopt(fd, SOL_SOCKET, SO_MAX_PACING_RATE, &rate32, sizeof(rate32)) == 0) {
+        return true;
+    }
+    Warn("set SO_MAX_PACING_RATE failed, {}", strerror(errno));
+#endif
+    return false;
+}
+
+bool socket_pacing::enable_txtime(int fd) {
+#ifdef TOOLKIT_KERNEL_PACING
+    struct sock_txtime txtime {};
+    txtime.clockid = CLOCK_MONOTONIC;
+    txtime.flags = 0;
+    if (setsockopt(fd, SOL_SOCKET, SO_TXTIME, &txtime, sizeof(txtime)) == 0) {
+        return true;
+    }
+    Warn("set SO_TXTIME failed, {}", strerror(errno));
+#endif
+    return false;
+}
+
+uint64_t socket_pacing::now_ns() {
+#if defined(__linux__)
+    struct timespec ts {};
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t) ts.tv_sec * 1000000000ULL + (uint64_t) ts.tv_nsec;
+#else
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
+int socket_pacing::send_at(int fd, const void *header, size_t header_size, const void *payload, size_t payload_size,
+                           const struct sockaddr *to, size_t to_size, uint64_t launch_ns, std::error_code &e) {
+#ifdef TOOLKIT_KERNEL_PACING
+    struct iovec iov[2];
+    iov[0].iov_base = const_cast<void *>(header);
+    iov[0].iov_len = header_size;
+    iov[1].iov_base = const_cast<void *>(payload);
+    iov[1].iov_len = payload_size;
+    char control[CMSG_SPACE(sizeof(uint64_t))] = {0};
+    struct msghdr msg {};
+    msg.msg_name = const_cast<struct sockaddr *>(to);
+    msg.msg_namelen = to ? (socklen_t) to_size : 0;
+    msg.msg_iov = iov;
+    msg.msg_iovlen = payload_size ? 2 : 1;
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof(control);
+    auto cmsg = CMSG_FIRSTHDR(&msg);
+    cmsg->cmsg_level = SOL_SOCKET;
+    cmsg->cmsg_type = SCM_TXTIME;
+    cmsg->cmsg_len = CMSG_LEN(sizeof(uint64_t));
+    memcpy(CMSG_DATA(cmsg), &launch_ns, sizeof(uint64_t));
+    auto ret = sendmsg(fd, &msg, 0);
+    if (ret < 0) {
+        e = std::error_code(errno, std::system_category());
+        return -1;
+    }
+    e.clear();
+    return (int) ret;
+#else
+    e = std::make_error_code(std::errc::operation_not_supported);
+    return -1;
+#endif
+}
+
+bool socket_pacing::is_unsupported(const std::error_code &e) {
+    return e == std::errc::invalid_argument || e == std::errc::operation_not_supported || e == std::errc::no_protocol_option;
+}
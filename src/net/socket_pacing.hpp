@@ -0,0 +1,55 @@
+﻿/*
+* @file_name: socket_pacing.hpp
+* @date: 2026/10/19
+* @author: oaho
+* Copyright @ hz oaho, All rights reserved.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+
+#ifndef TOOLKIT_SOCKET_PACING_HPP
+#define TOOLKIT_SOCKET_PACING_HPP
+#include <cstddef>
+#include <cstdint>
+#include <system_error>
+struct sockaddr;
+//// 内核发包调度, 需要在网卡(或lo)上配置fq qdisc:
+//// SO_MAX_PACING_RATE: fq按照该速率对socket上的所有包进行调度, 只适用于一个socket对应一条流的情况
+//// SO_TXTIME + SCM_TXTIME: 每个包携带发送时间(CLOCK_MONOTONIC, 纳秒), fq在该时间之前不会发出
+//// 没有fq(或etf)的网卡会忽略发送时间点立即发出, 需要先通过egress_supports_txtime确认
+//// 不支持的平台或内核上设置失败, 调用方回退到用户态定时器
+class socket_pacing {
+public:
+    /// 到达目的地址的出口网卡上是否配置了按照发送时间点调度的qdisc(fq, etf)
+    static bool egress_supports_txtime(const struct sockaddr *to, size_t to_size);
+    /// 设置socket的最大发送速率(字节/秒), 0为不限制
+    static bool set_max_pacing_rate(int fd, uint64_t bytes_per_second);
+    /// 开启SO_TXTIME, 之后才能通过send_at指定发送时间
+    static bool enable_txtime(int fd);
+    /// 当前的CLOCK_MONOTONIC时间(纳秒), 和std::chrono::steady_clock一致
+    static uint64_t now_ns();
+    /// 包头和负载聚合发送, 由内核在launch_ns时刻发出, to为nullptr时用于已经connect的socket
+    /// 返回发送的字节数, 失败返回-1, e为错误原因
+    static int send_at(int fd, const void *header, size_t header_size, const void *payload, size_t payload_size,
+                       const struct sockaddr *to, size_t to_size, uint64_t launch_ns, std::error_code &e);
+    /// send_at的错误是否说明socket不支持指定发送时间, 此时应该改为立即发送
+    static bool is_unsupported(const std::error_code &e);
+};
+
+#endif//TOOLKIT_SOCKET_PACING_HPP
@@ -0,0 +1,232 @@
+﻿/*
+* @file_name: udp_offload.cpp
+* @date: 2026/10/19
+* @author: oaho
+* Copyright @ hz oaho, All rights reserved.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+#include "udp_offload.hpp"
+#include "spdlog/logger.hpp"
+#include <algorithm>
+#if defined(__linux__)
+#include <cerrno>
+#include <cstring>
+#include <memory>
+#include <netinet/in.h>
+#include <netinet/udp.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <time.h>
+#endif
+
+#if defined(__linux__) && defined(UDP_SEGMENT) && defined(UDP_GRO)
+#define TOOLKIT_UDP_OFFLOAD 1
+#endif
+
+#if defined(__linux__)
+/// 内核时间戳是CLOCK_REALTIME, 用数据报已经等待的时间换算到steady_clock, 不受系统时间跳变的影响
+static std::chrono::steady_clock::time_point to_steady(const struct timespec &ts) {
+    struct timespec realtime {};
+    clock_gettime(CLOCK_REALTIME, &realtime);
+    auto now = std::chrono::steady_clock::now();
+    auto age = (int64_t) (realtime.tv_sec - ts.tv_sec) * 1000000000LL + (realtime.tv_nsec - ts.tv_nsec);
+    /// 系统时间刚刚被调整过, 时间戳不可信
+    if (age < 0 || age > 1000000000LL) {
+        return now;
+    }
+    return now - std::chrono::nanoseconds(age);
+}
+#endif
+
+constexpr size_t udp_offload::max_segments;
+constexpr size_t udp_offload::max_bytes;
+constexpr size_t udp_offload::max_datagram;
+
+bool udp_offload::gso_supported(int fd) {
+#ifdef TOOLKIT_UDP_OFFLOAD
+    int value = 0;
+    socklen_t length = sizeof(value);
+    return getsockopt(fd, SOL_UDP, UDP_SEGMENT, &value, &length) == 0;
+#else
+    return false;
+#endif
+}
+
+bool udp_offload::enable_receive_timestamp(int fd) {
+#if defined(__linux__) && defined(SO_TIMESTAMPNS)
+    int on = 1;
+    if (setsockopt(fd, SOL_SOCKET, SO_TIMESTAMPNS, &on, sizeof(on)) == 0) {
+        return true;
+    }
+    Warn("set SO_TIMESTAMPNS failed, {}", strerror(errno));
+#endif
+    return false;
+}
+
+bool udp_offload::enable_gro(int fd) {
+#ifdef TOOLKIT_UDP_OFFLOAD
+    int on = 1;
+    if (setsockopt(fd, SOL_UDP, UDP_GRO, &on, sizeof(on)) == 0) {
+        return true;
+    }
+    Warn("set UDP_GRO failed, {}", strerror(errno));
+#endif
+    return false;
+}
+
+int udp_offload::send_segments(int fd, const asio::const_buffer *buffers, size_t count, uint16_t segment_size,
+                               const struct sockaddr *to, size_t to_size, std::error_code &e) {
+#ifdef TOOLKIT_UDP_OFFLOAD
+    /// 每个包最多包头和负载两段
+    struct iovec iov[max_segments * 2];
+    if (count > max_segments * 2) {
+        e = std::make_error_code(std::errc::invalid_argument);
+        return -1;
+    }
+    for (size_t i = 0; i < count; i++) {
+        iov[i].iov_base = const_cast<void *>(buffers[i].data());
+        iov[i].iov_len = buffers[i].size();
+    }
+    char control[CMSG_SPACE(sizeof(uint16_t))] = {0};
+    struct msghdr msg {};
+    msg.msg_name = const_cast<struct sockaddr *>(to);
+    msg.msg_namelen = to ? (socklen_t) to_size : 0;
+    msg.msg_iov = iov;
+    msg.msg_iovlen = count;
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof(control);
+    auto cmsg = CMSG_FIRSTHDR(&msg);
+    cmsg->cmsg_level = SOL_UDP;
+    cmsg->cmsg_type = UDP_SEGMENT;
+    cmsg->cmsg_len = CMSG_LEN(sizeof(uint16_t));
+    memcpy(CMSG_DATA(cmsg), &segment_size, sizeof(uint16_t));
+    auto ret = sendmsg(fd, &msg, 0);
+    if (ret < 0) {
+        e = std::error_code(errno, std::system_category());
+        return -1;
+    }
+    e.clear();
+    return (int) ret;
+#else
+    e = std::make_error_code(std::errc::operation_not_supported);
+    return -1;
+#endif
+}
+
+int udp_offload::send_batch(int fd, const udp_datagram *datagrams, size_t count, std::error_code &e) {
+    e.clear();
+#if defined(__linux__)
+    struct mmsghdr messages[max_segments];
+    struct iovec iov[max_segments];
+    size_t sent = 0;
+    while (sent < count) {
+        auto batch = std::min(count - sent, max_segments);
+        memset(messages, 0, sizeof(struct mmsghdr) * batch);
+        for (size_t i = 0; i < batch; i++) {
+            const auto &datagram = datagrams[sent + i];
+            iov[i].iov_base = const_cast<void *>(datagram.data);
+            iov[i].iov_len = datagram.size;
+            messages[i].msg_hdr.msg_name = const_cast<struct sockaddr *>(datagram.to);
+            messages[i].msg_hdr.msg_namelen = datagram.to ? (socklen_t) datagram.to_size : 0;
+            messages[i].msg_hdr.msg_iov = &iov[i];
+            messages[i].msg_hdr.msg_iovlen = 1;
+        }
+        auto ret = sendmmsg(fd, messages, (unsigned int) batch, 0);
+        if (ret >= 0) {
+            sent += ret;
+            continue;
+        }
+        e = std::error_code(errno, std::system_category());
+        if (errno == ENOSYS) {
+            return -1;
+        }
+        if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) {
+            break;
+        }
+        /// sendmmsg在第一个出错的数据报处停止, 跳过它继续发送之后的数据报
+        ++sent;
+    }
+    return (int) sent;
+#else
+    e = std::make_error_code(std::errc::operation_not_supported);
+    return -1;
+#endif
+}
+
+int udp_offload::receive(int fd, void *data, size_t size, struct sockaddr *from, size_t &from_size, udp_receive_info &info, std::error_code &e) {
+    info = udp_receive_info();
+#if defined(__linux__)
+    struct iovec iov;
+    iov.iov_base = data;
+    iov.iov_len = size;
+    char control[CMSG_SPACE(sizeof(int)) + CMSG_SPACE(sizeof(struct timespec)) + CMSG_SPACE(sizeof(uint32_t))] = {0};
+    struct msghdr msg {};
+    msg.msg_name = from;
+    msg.msg_namelen = (socklen_t) from_size;
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof(control);
+    auto ret = recvmsg(fd, &msg, MSG_DONTWAIT);
+    if (ret < 0) {
+        e = std::error_code(errno, std::system_category());
+        return -1;
+    }
+    from_size = msg.msg_namelen;
+    for (auto cmsg = CMSG_FIRSTHDR(&msg); cmsg; cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+#ifdef TOOLKIT_UDP_OFFLOAD
+        if (cmsg->cmsg_level == SOL_UDP && cmsg->cmsg_type == UDP_GRO) {
+            int gso_size = 0;
+            memcpy(&gso_size, CMSG_DATA(cmsg), sizeof(int));
+            info.segment_size = (uint16_t) gso_size;
+        }
+#endif
+#ifdef SCM_TIMESTAMPNS
+        if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_TIMESTAMPNS) {
+            struct timespec ts {};
+            memcpy(&ts, CMSG_DATA(cmsg), sizeof(ts));
+            info.arrival = to_steady(ts);
+        }
+#endif
+#ifdef SO_RXQ_OVFL
+        if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SO_RXQ_OVFL) {
+            memcpy(&info.drop_counter, CMSG_DATA(cmsg), sizeof(uint32_t));
+        }
+#endif
+    }
+    e.clear();
+    return (int) ret;
+#else
+    e = std::make_error_code(std::errc::operation_not_supported);
+    return -1;
+#endif
+}
+
+char *udp_offload::offload_buffer() {
+    static thread_local std::unique_ptr<char[]> buffer;
+    if (!buffer) {
+        buffer.reset(new char[max_datagram]);
+    }
+    return buffer.get();
+}
+
+bool udp_offload::is_unsupported(const std::error_code &e) {
+    return e == std::errc::io_error || e == std::errc::invalid_argument || e == std::errc::operation_not_supported || e == std::errc::no_protocol_option;
+}
@@ -0,0 +1,142 @@
+﻿/*
+* @file_name: udp_offload.hpp
+* @date: 2026/10/19
+* @author: oaho
+* Copyright @ hz oaho, All rights reserved.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+
+#ifndef TOOLKIT_UDP_OFFLOAD_HPP
+#define TOOLKIT_UDP_OFFLOAD_HPP
+#include "asio/buffer.hpp"
+#include "asio/ip/udp.hpp"
+#include "buffer_pool.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <system_error>
+struct sockaddr;
+//// UDP分段卸载:
+//// UDP_SEGMENT(GSO): 多个等长的数据报一次sendmsg, 由内核(或网卡)按照分段大小切分, 只有最后一段可以更短
+//// UDP_GRO: 内核把同一条流上连续的等长数据报合并成一个, recvmsg时通过控制消息返回分段大小
+//// SO_TIMESTAMPNS: 内核收到数据报的时间, 不受poller排队延迟的影响
+//// SO_RXQ_OVFL: 接收队列溢出丢弃的数据报累计数量, 由socket_buffer开启
+//// sendmmsg: 一次系统调用发送多个数据报
+//// 不支持的平台或内核上返回false, 调用方逐个发送/接收
+struct udp_receive_info {
+    /// GRO合并时每个分段的大小, 没有合并时为0
+    uint16_t segment_size = 0;
+    /// 内核收到数据报的时间, 没有开启时间戳时为空
+    std::chrono::steady_clock::time_point arrival{};
+    /// 内核接收队列累计丢弃的数据报数量, 还没有丢包或者没有开启时为0
+    uint32_t drop_counter = 0;
+};
+
+/// 批量发送的一个数据报, to为nullptr时用于已经connect的socket
+struct udp_datagram {
+    const void *data = nullptr;
+    size_t size = 0;
+    const struct sockaddr *to = nullptr;
+    size_t to_size = 0;
+};
+
+class udp_offload {
+public:
+    /// 一次发送的最大分段数和总字节数
+    static constexpr size_t max_segments = 64;
+    static constexpr size_t max_bytes = 63 * 1024;
+    /// socket是否支持UDP_SEGMENT
+    static bool gso_supported(int fd);
+    /// 开启UDP_GRO
+    static bool enable_gro(int fd);
+    /// 开启SO_TIMESTAMPNS, 之后receive返回内核收到数据报的时间
+    static bool enable_receive_timestamp(int fd);
+    /// buffers按顺序拼接之后每segment_size字节一个数据报, to为nullptr时用于已经connect的socket
+    /// 返回发送的字节数, 失败返回-1, e为错误原因
+    static int send_segments(int fd, const asio::const_buffer *buffers, size_t count, uint16_t segment_size,
+                             const struct sockaddr *to, size_t to_size, std::error_code &e);
+    /// 非阻塞接收一个(可能被GRO合并的)数据报, info返回分段大小, 内核接收时间和累计丢包数
+    /// from的长度通过from_size传入传出, 返回接收的字节数, 失败返回-1
+    /// 一次sendmmsg发送多个数据报(可以是不同的目的地址), 返回处理过的数据报数量, 小于count说明发送缓冲区已满
+    /// 单个数据报出错(例如目的地址不可达)时跳过它, e为最后一个错误; 不支持sendmmsg时返回-1, 调用方逐个发送
+    static int send_batch(int fd, const udp_datagram *datagrams, size_t count, std::error_code &e);
+    static int receive(int fd, void *data, size_t size, struct sockaddr *from, size_t &from_size, udp_receive_info &info, std::error_code &e);
+    /// send_segments的错误是否说明不支持分段卸载(例如网卡不支持校验和卸载时返回EIO), 此时应该逐个发送
+    static bool is_unsupported(const std::error_code &e);
+
+    /// 接收一个(可能被GRO合并的)数据报, 每个分段放到池中独立的buffer里依次回调on_segment(buff, info)
+    /// gro为false时直接读到池中mss大小的buffer; gro为true时读到线程的64KB合并缓冲区, 按照分段大小拆分, 最后一个分段可以更短
+    /// 合并之后的时间戳和累计丢包数只属于第一个分段, 其余分段的info中为空, 避免包间隔被算成0或者丢包被重复计算
+    /// from为nullptr时不获取源地址(已经connect的socket), 返回接收的字节数, 失败返回-1
+    template<typename OnSegment>
+    static int receive_segments(int fd, buffer_pool &pool, size_t mss, bool gro, asio::ip::udp::endpoint *from, std::error_code &e, OnSegment &&on_segment) {
+        std::shared_ptr<buffer> buff;
+        char *data = nullptr;
+        size_t capacity = mss;
+        if (gro) {
+            data = offload_buffer();
+            capacity = max_datagram;
+        } else {
+            /// 池中的buffer保留上一次的长度, 扩大时只填充多出的部分
+            buff = pool.obtain(capacity);
+            buff->resize(capacity);
+            buff->backward();
+            data = (char *) buff->data();
+        }
+        size_t from_size = from ? from->capacity() : 0;
+        udp_receive_info info;
+        auto length = receive(fd, data, capacity, from ? from->data() : nullptr, from_size, info, e);
+        if (length <= 0) {
+            return length;
+        }
+        if (from) {
+            from->resize(from_size);
+        }
+        if (!gro) {
+            buff->resize(length);
+            buff->backward();
+            on_segment(buff, info);
+            return length;
+        }
+        /// 每个分段拷贝到池中按分段大小分配的buffer, 不做合并缓冲区的切片:
+        /// 分段会在接收队列、GOP缓存和播放端的发送队列中停留, 一个切片会让整块64KB的合并缓冲区无法复用,
+        /// 拷贝一个mss的代价远小于为每次recvmsg重新分配64KB
+        auto segment_size = info.segment_size ? info.segment_size : (uint16_t) length;
+        for (int offset = 0; offset < length; offset += segment_size) {
+            auto size = (std::min)((int) segment_size, length - offset);
+            buff = pool.obtain(size);
+            buff->clear();
+            buff->append(data + offset, size);
+            on_segment(buff, info);
+            info.arrival = {};
+            info.drop_counter = 0;
+        }
+        return length;
+    }
+
+private:
+    /// GRO合并之后最大为一个64KB的数据报
+    static constexpr size_t max_datagram = 65536;
+    /// 当前线程的合并缓冲区, 第一次使用时分配
+    static char *offload_buffer();
+};
+
+#endif//TOOLKIT_UDP_OFFLOAD_HPP
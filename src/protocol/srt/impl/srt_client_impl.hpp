@@ -22,31 +22,48 @@
 * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
 * SOFTWARE.
 */
+#include <algorithm>
+#include <array>
+#include <limits>
 #include <mutex>
+#include <random>
 
 #include "../srt_client.hpp"
+#include "../srt_client_multiplexer.hpp"
 #include "../srt_error.hpp"
 #include "executor_pool.hpp"
+#include "net/buffer_pool.hpp"
 #include "net/event_poller.hpp"
+#include "net/path_mtu.hpp"
+#include "net/socket_buffer.hpp"
+#include "net/socket_pacing.hpp"
+#include "net/udp_offload.hpp"
+#include "spdlog/logger.hpp"
 
 namespace srt {
     class srt_client::impl : public srt_socket_service {
     public:
-        impl(const event_poller::Ptr &poller, const endpoint_type &host) : poller(poller), srt_socket_service(poller), _sock(poller->get_executor()) {
-            _sock.open(host.protocol());
-            _sock.bind(host);
-            _sock.native_non_blocking(true);
-            asio::socket_base::receive_buffer_size rbs(256 * 1024);
-            asio::socket_base::send_buffer_size sbs(256 * 1024);
-            _sock.set_option(rbs);
-            _sock.set_option(sbs);
-            this->host = host;
-            receive_cache = std::make_shared<buffer>();
-            receive_cache->resize(1500);
+        impl(const event_poller::Ptr &poller, const endpoint_type &host, bool multiplex) : poller(poller), srt_socket_service(poller), _sock(poller->get_executor()) {
             conn_func = [](const std::error_code &e) {};
             receive_func = [](const std::shared_ptr<buffer> &) {};
             err_func = conn_func;
             task_executor = executor_pool::instance().get_executor();
+            /// 同一个poller上的客户端共用socket, 收包和发包都由复用器完成
+            if (multiplex) {
+                multiplexer = srt_client_multiplexer::get(poller, host);
+                this->host = multiplexer->get_local_endpoint();
+                return;
+            }
+            _sock.open(host.protocol());
+            _sock.bind(host);
+            _sock.native_non_blocking(true);
+            /// 连接之后每秒按照带宽时延积调整
+            sock_buffer.update(_sock.native_handle(), 0);
+            /// 用内核接收时间计算RTT和带宽, 不受poller排队延迟的影响
+            receive_control = udp_offload::enable_receive_timestamp(_sock.native_handle());
+            /// 区分内核丢包和网络丢包
+            receive_control = socket_buffer::enable_drop_counter(_sock.native_handle()) || receive_control;
+            this->host = _sock.local_endpoint();
         }
 
         const asio::ip::udp::endpoint &get_remote_endpoint() override {
@@ -67,6 +84,31 @@ namespace srt {
             this->receive_func = f;
         }
 
+        void set_on_writable(const std::function<void()> &f) {
+            std::lock_guard<std::recursive_mutex> lmtx(mtx);
+            this->writable_func = f;
+        }
+
+        void set_on_receive_message(const std::function<void(const std::vector<std::shared_ptr<buffer>> &)> &f) {
+            std::lock_guard<std::recursive_mutex> lmtx(mtx);
+            this->receive_message_func = f;
+        }
+
+        void set_on_reconnect(const std::function<void()> &f) {
+            std::lock_guard<std::recursive_mutex> lmtx(mtx);
+            this->reconnect_func = f;
+        }
+
+        void set_reconnect(uint32_t max_attempts, uint32_t min_delay_ms, uint32_t max_delay_ms) {
+            reconnect_max_attempts.store(max_attempts);
+            reconnect_min_delay.store(min_delay_ms ? min_delay_ms : 1);
+            reconnect_max_delay.store(std::max(min_delay_ms, max_delay_ms));
+        }
+
+        uint32_t get_reconnects() const {
+            return reconnect_count.load(std::memory_order_relaxed);
+        }
+
         void async_connect(const endpoint_type &_remote, const std::function<void(const std::error_code &e)> &f) {
             std::weak_ptr<impl> self(std::static_pointer_cast<impl>(shared_from_this()));
             poller->async([self, _remote, f]() {
@@ -83,6 +125,15 @@ namespace srt {
             });
         }
 
+        /// 复用器按照目的socket id分发的包, 包头已经移除
+        void receive_multiplexed(const std::shared_ptr<srt_packet> &pkt, const std::shared_ptr<buffer> &buff) {
+            try {
+                input_packet(pkt, buff);
+            } catch (const std::system_error &err) {
+                Error("catch exception, code={}, msg={}", err.code().value(), err.what());
+            }
+        }
+
     protected:
         std::shared_ptr<executor> get_executor() const override {
             return task_executor;
@@ -96,20 +147,127 @@ namespace srt {
             return receive_func(buff);
         }
 
+        void onRecvMessage(const std::vector<std::shared_ptr<buffer>> &fragments) override {
+            {
+                std::lock_guard<std::recursive_mutex> lmtx(mtx);
+                if (receive_message_func) {
+                    return receive_message_func(fragments);
+                }
+            }
+            return srt_socket_service::onRecvMessage(fragments);
+        }
+
+        void onWritable() override {
+            std::lock_guard<std::recursive_mutex> lmtx(mtx);
+            if (!writable_func) {
+                return;
+            }
+            return writable_func();
+        }
+
         void send(const std::shared_ptr<buffer> &buff, const asio::ip::udp::endpoint &where) override {
-            try {
-                auto ret = _sock.send(asio::buffer(buff->data(), buff->size()));
-            } catch (const std::system_error &e) {
-                return on_error_in(e.code());
+            if (multiplexer) {
+                auto buffers = asio::buffer(buff->data(), buff->size());
+                return multiplexer->send(&buffers, 1, remote);
+            }
+            return send_l(asio::buffer(buff->data(), buff->size()));
+        }
+
+        void send(const std::shared_ptr<buffer> &header, const packet_payload &payload, const asio::ip::udp::endpoint &where) override {
+            std::array<asio::const_buffer, 2> buffers{asio::buffer(header->data(), header->size()), asio::buffer(payload.data, payload.size)};
+            if (multiplexer) {
+                return multiplexer->send(buffers.data(), buffers.size(), remote);
+            }
+            return send_l(buffers);
+        }
+
+        bool send_at(const std::shared_ptr<buffer> &header, const packet_payload &payload, const asio::ip::udp::endpoint &where, uint64_t launch_ns) override {
+            std::error_code e;
+            socket_pacing::send_at(_sock.native_handle(), header->data(), header->size(), payload.data, payload.size, nullptr, 0, launch_ns, e);
+            if (e && socket_pacing::is_unsupported(e)) {
+                return false;
+            }
+            if (e && !is_transient_send_error(e)) {
+                on_error_in(e);
+            }
+            return true;
+        }
+
+        bool enable_kernel_txtime() override {
+            /// 共用的socket由复用器批量发送, 不按照单个包的发送时间调度
+            if (multiplexer) {
+                return false;
+            }
+            return socket_pacing::enable_txtime(_sock.native_handle());
+        }
+
+        bool send_segments(const std::vector<asio::const_buffer> &buffers, uint16_t segment_size, const asio::ip::udp::endpoint &where) override {
+            std::error_code e;
+            if (multiplexer) {
+                if (!multiplexer->send_segments(buffers.data(), buffers.size(), segment_size, remote, e)) {
+                    return false;
+                }
+            } else {
+                udp_offload::send_segments(_sock.native_handle(), buffers.data(), buffers.size(), segment_size, nullptr, 0, e);
+                if (e && udp_offload::is_unsupported(e)) {
+                    return false;
+                }
+            }
+            if (e && !is_transient_send_error(e)) {
+                on_error_in(e);
+            }
+            return true;
+        }
+
+        bool segmentation_offload_supported() override {
+            return udp_offload::gso_supported(multiplexer ? multiplexer->native_handle() : _sock.native_handle());
+        }
+
+        /// 客户端独占socket, 可以由内核限制整个socket的速度; 共用的socket不能按照单个客户端限速
+        bool set_kernel_pacing_rate(uint64_t bytes_per_second) override {
+            if (multiplexer) {
+                return false;
             }
+            return socket_pacing::set_max_pacing_rate(_sock.native_handle(), bytes_per_second);
+        }
+
+        /// 共用的socket上设置不分片会影响其他客户端, 只在独占socket时探测路径MTU
+        bool enable_path_mtu_probe() override {
+            if (multiplexer) {
+                return false;
+            }
+            return path_mtu::enable_probe(_sock.native_handle());
+        }
+
+        uint32_t get_kernel_path_mtu() override {
+            if (multiplexer) {
+                return 0;
+            }
+            return path_mtu::query(_sock.native_handle());
         }
 
         /**
          * 为兼容srt_session在io线程触发，这里会自己切换到其他线程，预防client阻塞io线程
          */
         void on_connected() override {
-            is_connect_func.store(true);
             std::weak_ptr<srt_client::impl> self(std::static_pointer_cast<srt_client::impl>(shared_from_this()));
+            if (reconnecting.exchange(false)) {
+                reconnect_attempts.store(0);
+                reconnect_count.fetch_add(1);
+                Info("reconnect to {}:{} success, fast={}", remote.address().to_string(), remote.port(), get_fast_connected());
+                get_executor()->async([self]() {
+                    auto stronger_self = self.lock();
+                    if (!stronger_self) {
+                        return;
+                    }
+                    std::lock_guard<std::recursive_mutex> lmtx(stronger_self->mtx);
+                    if (stronger_self->reconnect_func)
+                        stronger_self->reconnect_func();
+                });
+                return;
+            }
+            is_connect_func.store(true);
+            was_connected.store(true);
             get_executor()->async([self]() {
                 auto stronger_self = self.lock();
                 if (!stronger_self) {
@@ -123,7 +281,27 @@ namespace srt {
             });
         }
 
+        /// 握手中的socket id, 复用时对端以它为目的socket id发包
+        uint32_t get_unique_socket_id() override {
+            if (!local_sock_id) {
+                std::default_random_engine random(std::random_device{}());
+                std::uniform_int_distribution<uint32_t> dist(1, (std::numeric_limits<int32_t>::max)());
+                local_sock_id = dist(random);
+            }
+            return local_sock_id;
+        }
+
         void on_error(const std::error_code &e) override {
+            if (multiplexer) {
+                auto _multiplexer = multiplexer;
+                auto sock_id = local_sock_id;
+                poller->async([_multiplexer, sock_id]() {
+                    _multiplexer->remove(sock_id);
+                });
+            }
+            if (schedule_reconnect(e)) {
+                return;
+            }
             bool _ = false;
             bool cas = is_connect_func.compare_exchange_strong(_, true);
             std::lock_guard<std::recursive_mutex> lmtx(mtx);
@@ -138,7 +316,63 @@ namespace srt {
         }
 
     private:
+        /// 连接建立之后断开时按照指数退避加随机抖动重连, 被对端拒绝或者超过最大次数时不再重连
+        bool schedule_reconnect(const std::error_code &e) {
+            if (!was_connected.load() || e.category() == *generator_srt_reject_category()) {
+                return false;
+            }
+            auto attempt = reconnect_attempts.fetch_add(1);
+            if (attempt >= reconnect_max_attempts.load()) {
+                reconnecting.store(false);
+                return false;
+            }
+            uint64_t delay = (uint64_t) reconnect_min_delay.load() << std::min<uint32_t>(attempt, 16);
+            delay = std::min<uint64_t>(delay, reconnect_max_delay.load());
+            /// 随机等待[delay/2, delay], 避免同时断开的客户端一起重连
+            std::default_random_engine random(std::random_device{}());
+            std::uniform_int_distribution<uint64_t> jitter(delay / 2, delay);
+            delay = std::max<uint64_t>(jitter(random), 1);
+            reconnecting.store(true);
+            Warn("connection to {}:{} lost, {}, reconnect after {} ms, attempt={}", remote.address().to_string(), remote.port(), e.message(), delay, attempt + 1);
+            std::weak_ptr<impl> self(std::static_pointer_cast<impl>(shared_from_this()));
+            poller->do_delay_task(std::chrono::milliseconds(delay), [self]() -> size_t {
+                if (auto stronger_self = self.lock()) {
+                    stronger_self->reconnect_self();
+                }
+                return 0;
+            });
+            return true;
+        }
+
+        void reconnect_self() {
+            reset_connection();
+            if (multiplexer) {
+                local_sock_id = multiplexer->add(std::static_pointer_cast<impl>(shared_from_this()));
+                return connect();
+            }
+            /// 新的本端socket id, 旧连接残留的包不会被当作新连接的包
+            local_sock_id = 0;
+            if (!is_reading) {
+                reading();
+            }
+            return connect();
+        }
+
+        template<typename ConstBufferSequence>
+        void send_l(const ConstBufferSequence &buffers) {
+            std::error_code e;
+            _sock.send(buffers, 0, e);
+            if (e && !is_transient_send_error(e)) {
+                return on_error_in(e);
+            }
+        }
+
         void connect_self() {
+            /// 没有单独的socket和读操作, 由复用器分发
+            if (multiplexer) {
+                local_sock_id = multiplexer->add(std::static_pointer_cast<impl>(shared_from_this()));
+                return connect();
+            }
             std::weak_ptr<impl> self(std::static_pointer_cast<impl>(shared_from_this()));
             endpoint_type _tmp_endpoint = remote;
             _sock.async_connect(_tmp_endpoint, [self, _tmp_endpoint](const std::error_code &e) {
@@ -148,6 +382,7 @@ namespace srt {
                     } else {
                         /// begin to read
                         stronger_self->reading();
+                        stronger_self->start_socket_buffer_timer();
                         return stronger_self->connect();
                     }
                 }
@@ -155,6 +390,30 @@ namespace srt {
         }
         void reading() {
             std::weak_ptr<impl> self(std::static_pointer_cast<impl>(shared_from_this()));
+            is_reading = true;
+            if (receive_control) {
+                _sock.async_wait(asio::ip::udp::socket::wait_read, [self](const std::error_code &e) {
+                    auto stronger_self = self.lock();
+                    if (!stronger_self) {
+                        return;
+                    }
+                    if (e) {
+                        stronger_self->is_reading = false;
+                        return;
+                    }
+                    stronger_self->receive_with_control();
+                    if (stronger_self->flag.load(std::memory_order_relaxed)) {
+                        return;
+                    }
+                    stronger_self->reading();
+                });
+                return;
+            }
+            /// 每个数据报读到池中独立的buffer里, 交付给应用层时不再拷贝
+            /// 对端的数据报不超过协商的mss, 缓冲区不按照协议允许的最大值分配
+            auto receive_size = get_receive_size();
+            receive_cache = buffer_pool::this_thread().obtain(receive_size);
+            receive_cache->resize(receive_size);
             _sock.async_receive(asio::buffer((char *) receive_cache->data(), receive_cache->size()), [self](const std::error_code &e, size_t length) {
                 auto stronger_self = self.lock();
                 if (!stronger_self) {
@@ -165,27 +424,89 @@ namespace srt {
                     return;
                 }
 
+                /// 探测包超过路径MTU时connect的socket会收到EMSGSIZE, 不影响后续的读取
+                if (e == asio::error::message_size) {
+                    return stronger_self->reading();
+                }
                 if (e) {
+                    /// 对端不可达(ICMP)等错误, 重连时重新开始读取
+                    stronger_self->is_reading = false;
                     return;
                 }
 
-                stronger_self->receive_cache->resize(length);
-                stronger_self->receive_cache->backward();
-                stronger_self->input_packet(stronger_self->receive_cache);
-                /// 恢复之
-                stronger_self->receive_cache->backward();
-                stronger_self->receive_cache->resize(1500);
+                auto buff = std::move(stronger_self->receive_cache);
+                buff->resize(length);
+                buff->backward();
+                stronger_self->input_packet(buff);
                 stronger_self->reading();
             });
         }
 
+        /// 读取socket中所有可读的数据报, 每个包带上内核接收时间和新增的内核丢包数
+        void receive_with_control() {
+            auto &pool = buffer_pool::this_thread();
+            auto on_segment = [this](const std::shared_ptr<buffer> &buff, const udp_receive_info &info) {
+                try {
+                    auto pkt = from_buffer(buff->data(), buff->size());
+                    pkt->set_arrival_time(info.arrival);
+                    if (info.drop_counter) {
+                        pkt->set_kernel_drops(sock_buffer.on_drop_counter(_sock.native_handle(), info.drop_counter));
+                    }
+                    buff->remove(16);
+                    input_packet(pkt, buff);
+                } catch (const std::system_error &err) {
+                    Error("catch exception, code={}, msg={}", err.code().value(), err.what());
+                }
+            };
+            /// 一次唤醒最多读取的次数, 避免长时间占用poller
+            for (int i = 0; i < 64; i++) {
+                if (flag.load(std::memory_order_relaxed)) {
+                    return;
+                }
+                std::error_code e;
+                if (udp_offload::receive_segments(_sock.native_handle(), pool, get_receive_size(), false, nullptr, e, on_segment) < 0) {
+                    return;
+                }
+            }
+        }
+
+        void start_socket_buffer_timer() {
+            std::weak_ptr<impl> self(std::static_pointer_cast<impl>(shared_from_this()));
+            poller->do_delay_task(std::chrono::milliseconds(1000), [self]() -> size_t {
+                auto stronger_self = self.lock();
+                if (!stronger_self || stronger_self->flag.load(std::memory_order_relaxed)) {
+                    return 0;
+                }
+                stronger_self->sock_buffer.update(stronger_self->_sock.native_handle(), stronger_self->get_bandwidth_delay_product());
+                return 1000;
+            });
+        }
+
     private:
+        /// 正在进行的异步读取使用的buffer
         std::shared_ptr<buffer> receive_cache;
+        /// 开启了内核接收时间戳或者丢包计数, 需要通过recvmsg读取控制消息
+        bool receive_control = false;
+        /// 只在poller线程访问
+        socket_buffer sock_buffer;
         asio::ip::udp::socket _sock;
+        /// 复用时为共用socket的复用器, 否则为空
+        std::shared_ptr<srt_client_multiplexer> multiplexer;
+        uint32_t local_sock_id = 0;
+        /// 只在poller线程访问
+        bool is_reading = false;
         event_poller::Ptr poller;
         std::shared_ptr<executor> task_executor;
         std::atomic<bool> flag{false};
         std::atomic<bool> is_connect_func{false};
+        /// 重连
+        std::atomic<bool> was_connected{false};
+        std::atomic<bool> reconnecting{false};
+        std::atomic<uint32_t> reconnect_attempts{0};
+        std::atomic<uint32_t> reconnect_max_attempts{0};
+        std::atomic<uint32_t> reconnect_min_delay{100};
+        std::atomic<uint32_t> reconnect_max_delay{2000};
+        std::atomic<uint32_t> reconnect_count{0};
         endpoint_type host;
         endpoint_type remote;
         /// callback
@@ -193,5 +514,8 @@ namespace srt {
         std::function<void(const std::error_code &)> conn_func;
         std::function<void(const std::error_code &)> err_func;
         std::function<void(const std::shared_ptr<buffer> &)> receive_func;
+        std::function<void()> writable_func;
+        std::function<void(const std::vector<std::shared_ptr<buffer>> &)> receive_message_func;
+        std::function<void()> reconnect_func;
     };
 }// namespace srt
\ No newline at end of file
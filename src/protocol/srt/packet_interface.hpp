@@ -25,11 +25,22 @@
 
 #ifndef TOOLKIT_PACKET_INTERFACE_HPP
 #define TOOLKIT_PACKET_INTERFACE_HPP
+#include "event_poller.hpp"
 #include "srt_bandwidth.hpp"
+#include <atomic>
 #include <cstdint>
+#include <functional>
 #include <memory>
 #include <utility>
 #include <vector>
+
+/// 引用外部内存的负载(如mmap映射的文件), holder负责保持内存有效
+struct packet_payload {
+    std::shared_ptr<const void> holder;
+    const char *data = nullptr;
+    size_t size = 0;
+};
+
 template<typename T>
 struct packet {
     uint32_t seq = 0;
@@ -37,10 +48,31 @@ struct packet {
     uint16_t retransmit_count = 1;
     uint64_t retransmit_time_point = 0;
     T pkt;
+    /// 不为空时pkt只包含包头, 负载直接引用外部内存, 发送时聚合写出
+    packet_payload payload;
+    /// 包在消息中的位置(PP): 0b10首包, 0b00中间, 0b01尾包, 0b11单包
+    uint8_t position = 0b11;
+    /// 已经在重传队列中等待发送
+    bool rexmit_pending = false;
+    /// 已经被确认或者丢弃, 离开了发送窗口, 重传队列中的引用不再发送
+    bool removed = false;
+    uint32_t message_number = 0;
+    /// 内核调度时的发送时间点(ns, steady_clock), 为0时立即发送
+    uint64_t launch_time = 0;
+
+    size_t size() const {
+        return pkt->size() + payload.size;
+    }
 };
 
+template<typename T, typename Next>
+class packet_stage;
+
 template<typename T>
 class packet_interface {
+    template<typename, typename>
+    friend class packet_stage;
+
 public:
     using packet_pointer = std::shared_ptr<packet<T>>;
 
@@ -162,29 +194,98 @@ private:
 
 template<typename T>
 class packet_send_interface : public packet_interface<T> {
+    template<typename, typename>
+    friend class packet_stage;
+
 public:
     packet_send_interface() {
         set_bandwidth_mode(std::make_shared<estimated_bandwidth_mode>());
     }
     ~packet_send_interface() override = default;
+    /// 可以在运行时替换, 读写都是原子的
+    /// 热路径通过current_bandwidth_mode读取裸指针, 旧的模式交给retire_bandwidth_mode在没有读者之后释放
     void set_bandwidth_mode(const std::shared_ptr<bandwidth_mode> &mode) {
-        _mode = mode;
+        auto old = std::atomic_exchange(&_mode, mode);
+        _mode_ptr.store(mode.get(), std::memory_order_release);
+        retire_bandwidth_mode(std::move(old));
     }
 
-    const std::shared_ptr<bandwidth_mode> &get_bandwidth_mode() {
-        return _mode;
+    std::shared_ptr<bandwidth_mode> get_bandwidth_mode() const {
+        return std::atomic_load(&_mode);
     }
 
     void drop(uint32_t seq, uint32_t seq_) override = 0;
 
+    void set_on_writable(const std::function<void()> &f) {
+        this->_on_writable_func_ = f;
+    }
+
+    /// 一次调度连续发送的包全部回调之后调用, 上层可以把这些包合并成一次系统调用
+    void set_on_flush(const std::function<void()> &f) {
+        this->_on_flush_func_ = f;
+    }
+
 public:
+    /// 输入引用外部内存的负载, 不支持时返回-1
+    virtual int input_payload(const packet_payload &) {
+        return -1;
+    }
+    /// 输入一个消息的所有分片, 共享同一个消息号, 要么全部进入缓存要么全部拒绝, 不支持时返回-1
+    virtual int input_message(const std::vector<packet_payload> &) {
+        return -1;
+    }
+    /// 还未进入发送窗口的包数量
+    virtual uint32_t get_cached_size() const {
+        return 0;
+    }
+    /// 缓存和发送窗口中的总字节数
+    virtual uint64_t get_buffered_bytes() {
+        return this->get_allocated_bytes();
+    }
+    /// 缓存中最早的数据已经等待的时间(ms)
+    virtual uint32_t get_buffered_time() const {
+        return 0;
+    }
+    /// 由内核(fq qdisc)按照包的发送时间点调度, 关闭时使用用户态定时器
+    virtual void set_kernel_pacing(bool) {}
+    virtual bool get_kernel_pacing() const {
+        return false;
+    }
+    /// 路径MTU探测确认之后修改最大负载, 之后合并的小包不超过新的大小
+    virtual void set_max_payload(uint32_t) {}
+    /// 迁移到另一个poller, 需要在原poller线程调用; 定时器绑定到新的poller, 正在进行的发送在新的poller中继续
+    virtual void migrate(const event_poller::Ptr &) {}
     virtual void send_again(uint32_t begin, uint32_t end) = 0;
     virtual void ack_sequence_to(bool full_ack, uint32_t seq, uint32_t receive_rate, uint32_t link_capacity) = 0;
     virtual void update_flow_window(uint32_t) = 0;
     void on_size_changed(bool, uint32_t) override = 0;
 
+protected:
+    /// 不加锁读取当前模式, 只能在poller线程或者retire_bandwidth_mode能够等待的读者中使用
+    bandwidth_mode *current_bandwidth_mode() const {
+        return _mode_ptr.load(std::memory_order_acquire);
+    }
+
+    /// 旧的模式可能还在被其他线程的读者使用, 子类需要等待这些读者结束之后再释放
+    virtual void retire_bandwidth_mode(std::shared_ptr<bandwidth_mode> old) {}
+
+    void on_writable() {
+        if (_on_writable_func_) {
+            _on_writable_func_();
+        }
+    }
+
+    void on_flush() {
+        if (_on_flush_func_) {
+            _on_flush_func_();
+        }
+    }
+
 protected:
     std::shared_ptr<bandwidth_mode> _mode;
+    std::atomic<bandwidth_mode *> _mode_ptr{nullptr};
+    std::function<void()> _on_writable_func_;
+    std::function<void()> _on_flush_func_;
 };
 
 template<typename T>
@@ -192,9 +293,91 @@ class packet_receive_interface : public packet_interface<T> {
 public:
     ~packet_receive_interface() override = default;
     virtual uint32_t get_expected_size() const = 0;
-    virtual std::vector<std::pair<uint32_t, uint32_t>> get_pending_packets() const = 0;
+    /// 需要通过NAK上报的丢包区间, 还在乱序容忍范围内的空洞不上报
+    virtual std::vector<std::pair<uint32_t, uint32_t>> get_pending_packets() = 0;
+    /// 携带消息边界(PP和消息号)和重传标志的输入, 默认忽略
+    virtual int input_message_packet(const T &t, uint32_t seq, uint64_t time_point, uint8_t, uint32_t, bool) {
+        return this->input_packet(t, seq, time_point);
+    }
+    /// 乱序容忍(LOSSMAXTTL): 空洞之后到达的包数量小于容忍度, 并且没有超过timeout_ms时暂不上报丢包
+    /// 容忍度从0开始, 根据实际的乱序距离自适应调整, 不超过max_packets
+    virtual void set_reorder_tolerance(uint32_t max_packets) {}
+    virtual void set_reorder_timeout(uint32_t timeout_ms) {}
+    virtual uint32_t get_reorder_tolerance() const {
+        return 0;
+    }
+    /// 上一次get_pending_packets是否因为乱序容忍暂缓上报了空洞, 为true时需要在容忍时间之后再检查
+    virtual bool has_reorder_pending() const {
+        return false;
+    }
+    /// 在NAK之后才到达的原始包数量, 即多余的重传
+    virtual uint64_t get_belated_count() const {
+        return 0;
+    }
+    /// 通过NAK上报过的丢包数量
+    virtual uint64_t get_lost_count() const {
+        return 0;
+    }
+    /// 空闲时释放按需增长的缓存
+    virtual void shrink() {}
     void on_size_changed(bool, uint32_t) override {}
 };
 
 
+/// 队列在流水线中的下一级
+/// Next为void时转发给set_on_packet/set_on_drop_packet(发送队列还有set_on_writable/set_on_flush)设置的std::function, 兼容原来的用法
+/// 否则下一级在编译期确定, 队列直接调用Next::on_packet/on_drop_packet/on_writable/on_flush, 不经过类型擦除, 调用可以内联, 此时set_on_packet等不起作用
+/// Next按值保存, 一般是只包含一个指针的适配器, 也可以是另一个静态组合的阶段
+template<typename T, typename Next>
+class packet_stage {
+public:
+    void set_next(const Next &next) {
+        _next = next;
+    }
+
+    Next &get_next() {
+        return _next;
+    }
+
+protected:
+    void next_packet(packet_interface<T> &, const std::shared_ptr<packet<T>> &p) {
+        _next.on_packet(p);
+    }
+
+    void next_drop_packet(packet_interface<T> &, uint32_t begin, uint32_t end) {
+        _next.on_drop_packet(begin, end);
+    }
+
+    void next_writable(packet_send_interface<T> &) {
+        _next.on_writable();
+    }
+
+    void next_flush(packet_send_interface<T> &) {
+        _next.on_flush();
+    }
+
+private:
+    Next _next{};
+};
+
+template<typename T>
+class packet_stage<T, void> {
+protected:
+    void next_packet(packet_interface<T> &self, const std::shared_ptr<packet<T>> &p) {
+        self._on_packet_func_(p);
+    }
+
+    void next_drop_packet(packet_interface<T> &self, uint32_t begin, uint32_t end) {
+        self._on_drop_packet_func_(begin, end);
+    }
+
+    void next_writable(packet_send_interface<T> &self) {
+        self.on_writable();
+    }
+
+    void next_flush(packet_send_interface<T> &self) {
+        self.on_flush();
+    }
+};
+
 #endif//TOOLKIT_PACKET_INTERFACE_HPP
@@ -25,21 +25,35 @@
 
 #ifndef TOOLKIT_PACKET_LIMITED_SEND_RATE_QUEUE_HPP
 #define TOOLKIT_PACKET_LIMITED_SEND_RATE_QUEUE_HPP
+#include "Util/spsc_ring.hpp"
 #include "packet_sending_queue.hpp"
 #include "spdlog/logger.hpp"
 #include "srt_congestion.hpp"
 #include "srt_packet.h"
 #include <atomic>
+#include <deque>
 #include <map>
-#include <mutex>
-template<typename T>
-class packet_limited_send_rate_queue : public packet_sending_queue<T>, public congestion_holder {
+#include <memory>
+#include <thread>
+/// Next为下一级的类型, 见packet_stage
+template<typename T, typename Next = void>
+class packet_limited_send_rate_queue : public packet_sending_queue<T, Next>, public congestion_holder {
 public:
-    using base_type = packet_sending_queue<T>;
+    using base_type = packet_sending_queue<T, Next>;
     using packet_pointer = typename base_type::packet_pointer;
 
 private:
     using duration_type = std::chrono::nanoseconds;
+    struct cache_entry {
+        packet_payload payload;
+        /// 输入的时间点(ms)
+        uint64_t input_time = 0;
+        /// 消息中的位置和消息号
+        uint8_t position = 0b11;
+        uint32_t message_number = 0;
+        /// 小包合并的最迟发送时间点(us), 为0时不参与合并
+        uint64_t coalesce_deadline = 0;
+    };
 
 public:
     packet_limited_send_rate_queue(const event_poller::Ptr &poller,
@@ -48,8 +62,8 @@ public:
                                    uint32_t sock_id,
                                    uint32_t max_payload,
                                    const std::chrono::steady_clock::time_point &t,
-                                   uint16_t payload = 1456) : base_type(poller, ack, enable_retransmit), _size(0), timer(poller->get_executor()) {
-        avg_payload_size = payload > 1456 ? 1472 : (payload + 16);
+                                   uint16_t payload = 1456) : base_type(poller, ack, enable_retransmit), timer(poller->get_executor()) {
+        avg_payload_size = payload + 16;
         Trace("average payload size={}", avg_payload_size);
         this->_sock_id = sock_id;
         this->_conn = t;
@@ -62,46 +76,77 @@ public:
 public:
     void start() override {
         Trace("the temporary buffer cache initial size={}", this->get_window_size());
-        _size.store(this->get_window_size(), std::memory_order_relaxed);
+        _buffer_cache.reset(new spsc_ring<cache_entry>(this->get_window_size()));
     }
 
     int input_packet(const T &t, uint32_t seq, uint64_t time_point) override {
-        /// 更新输入率
-        /// Trace("input packet to bandwidth, size={}", t->size());
-        packet_send_interface<T>::get_bandwidth_mode()->input_packet((uint16_t) t->size());
+        packet_payload payload;
+        payload.holder = t;
+        payload.data = t->data();
+        payload.size = t->size();
+        return input_payload(payload);
+    }
 
-        auto size = _size.load(std::memory_order_relaxed);
-        if (wait_capacity() || size <= 0) {
-            //Trace("window temporary size={}, wait it...", size);
-            return 0;
-        }
-        {
-            std::lock_guard<std::recursive_mutex> lmtx(mtx);
-            _buffer_cache.push_back(t);
-            _size.fetch_sub(1);
-            if (_is_commit) {
-                return static_cast<int>(t->size());
-            }
-            _is_commit = true;
+    int input_payload(const packet_payload &payload) override {
+        return input_fragments(&payload, 1, true);
+    }
+
+    int input_message(const std::vector<packet_payload> &fragments) override {
+        return input_fragments(fragments.data(), fragments.size(), false);
+    }
+
+    /// 小包合并的最大等待时间(us), 为0时不合并, 需要在start之前设置
+    void set_coalesce_delay(uint32_t us) {
+        _coalesce_delay = us;
+    }
+
+    uint32_t get_cached_size() const override {
+        auto cache = _buffer_cache.get();
+        return cache ? static_cast<uint32_t>(cache->size()) : 0;
+    }
+
+    uint64_t get_buffered_bytes() override {
+        return _cache_bytes.load(std::memory_order_relaxed) + this->get_allocated_bytes();
+    }
+
+    uint32_t get_buffered_time() const override {
+        auto oldest = _window_first_time.load(std::memory_order_relaxed);
+        if (!oldest) {
+            oldest = _cache_first_time.load(std::memory_order_relaxed);
         }
+        auto now = get_now_ms();
+        return oldest && now > oldest ? static_cast<uint32_t>(now - oldest) : 0;
+    }
 
-        /// 如果比较成功，说明在进程中..
-        std::weak_ptr<packet_limited_send_rate_queue<T>> self(std::static_pointer_cast<packet_limited_send_rate_queue<T>>(base_type::shared_from_this()));
-        base_type::get_poller()->async([self]() {
-            auto stronger_self = self.lock();
-            if (!stronger_self) {
-                return;
-            }
-            /// 直接调用
-            stronger_self->on_timer();
-        });
-        return static_cast<int>(t->size());
+    /// 内核调度模式下, 定时器只负责把未来kernel_pacing_horizon内要发送的包提前交给内核
+    void set_kernel_pacing(bool on) override {
+        _kernel_pacing.store(on);
+        _launch_ns = 0;
+    }
+
+    bool get_kernel_pacing() const override {
+        return _kernel_pacing.load(std::memory_order_relaxed);
+    }
+
+    /// 替换拥塞控制算法, 文件模式下使用file_congestion
+    void set_congestion(const std::shared_ptr<congestion> &c) {
+        if (c) {
+            _congestion = c;
+        }
     }
 
     ///(1) On sending a data packet (either original or retransmitted),
     /// update the value of average packet payload size (AvgPayloadSize):
-    void on_packet(const packet_pointer &p) override {
-        update_avg_payload(static_cast<uint16_t>(p->pkt->size()));
+    /// final: 队列内部的调用在编译期确定
+    void on_packet(const packet_pointer &p) final {
+        update_avg_payload(static_cast<uint16_t>(p->size()));
+        if (_kernel_pacing.load(std::memory_order_relaxed)) {
+            /// 发送晚于预定时间时从实际发送时间开始计算下一个发送时间点
+            _launch_ns = std::max(_launch_ns, get_now_ns());
+            p->launch_time = _launch_ns;
+        } else {
+            p->launch_time = 0;
+        }
         base_type::on_packet(p);
     }
 
@@ -112,35 +157,31 @@ public:
             this->_receive_rate = receive_rate;
         }
         base_type::ack_sequence_to(full_ack, seq, receive_rate, link_capacity);
+        update_window_time();
         /// 更新参数值
         this->_last_ack_number.store(seq);
         // auto average_size = this->get_allocated_bytes() / this->get_buffer_size();
         // update_avg_payload(average_size == 0 ? 1456 : average_size);
         update_snd_period();
+        /// 窗口滑动后通知上层继续写入
+        this->next_writable(*this);
     }
 
     void send_again(uint32_t begin, uint32_t end) override {
         /// 更新拥塞控制
         _congestion->rexmit_pkt_event(true, begin, end);
-        packet_sending_queue<T>::send_again(begin, end);
+        base_type::send_again(begin, end);
     }
 
     void on_size_changed(bool full, uint32_t size) override {
+        update_window_time();
         if (full || size >= this->get_window_size()) {
             ///Trace("window is full, wait not full to recover");
             return;
         }
-        //// 重新开启定时器
-        bool _not_empty = false;
-        {
-            std::lock_guard<std::recursive_mutex> lmtx(mtx);
-            _is_commit = size != 0;
-            if (!_buffer_cache.empty() && !_is_commit) {
-                _not_empty = _is_commit = true;
-            }
-        }
-        /// 重新开启定时器
-        if (_not_empty) {
+        /// 发送线程已经空闲但是缓存中还有数据, 重新开启定时器
+        auto cache = _buffer_cache.get();
+        if (cache && !cache->empty() && !_is_commit.exchange(true)) {
             on_timer();
         }
     }
@@ -150,30 +191,80 @@ public:
         Trace("update flow window, peer cwnd={}, current window size={}", flow_window, this->get_window_size());
     }
 
+    void migrate(const event_poller::Ptr &target) override {
+        timer.cancel();
+        timer = asio::steady_timer(target->get_executor());
+        base_type::migrate(target);
+    }
+
     void clear() override {
         base_type::clear();
         timer.cancel();
-        std::lock_guard<std::recursive_mutex> lmtx(mtx);
-        _buffer_cache.clear();
-        _is_commit = false;
-        _size.store(this->get_window_size());
+        if (_buffer_cache) {
+            while (_buffer_cache->front()) {
+                _buffer_cache->pop();
+            }
+        }
+        _cache_bytes.store(0);
+        _cache_first_time.store(0);
+        _window_first_time.store(0);
+        _is_commit.store(false);
+        _coalesce_waiting.store(false);
+        for (auto &p: _rexmit_queue) {
+            p->rexmit_pending = false;
+        }
+        _rexmit_queue.clear();
     }
 
     void rexmit_packet(const packet_pointer &p) override {
         /// ON RTO
         _congestion->rexmit_pkt_event(false, 0, 0);
-        update_avg_payload(static_cast<uint16_t>(p->pkt->size()));
+        update_avg_payload(static_cast<uint16_t>(p->size()));
         base_type::rexmit_packet(p);
     }
 
+    /// 被重传预算推迟的重传包数量
+    uint64_t get_rexmit_deferred_count() const {
+        return _rexmit_deferred.load(std::memory_order_relaxed);
+    }
+
+protected:
+    /// 生产者只在持有锁时使用模式的裸指针, 拿到锁之后不会再有读者使用旧的模式
+    void retire_bandwidth_mode(std::shared_ptr<bandwidth_mode> old) override {
+        producer_spin_lock guard(_producer_spin);
+        old.reset();
+    }
+
+    void on_migrated() override {
+        base_type::on_migrated();
+        /// 发送线程在原poller中等待的定时器已经取消, 立即调度一次, 之后按照发送周期继续
+        if (_is_commit.load()) {
+            _coalesce_waiting.store(false);
+            on_timer();
+        }
+    }
+
+    /// 重传包不直接发送, 交给发送定时器按照重传预算和新数据一起调度
+    void on_retransmit(const packet_pointer &p) override {
+        if (p->rexmit_pending) {
+            return;
+        }
+        p->rexmit_pending = true;
+        _rexmit_queue.push_back(p);
+        /// 发送线程空闲, 或者正在等待凑满一个包
+        if (!_is_commit.exchange(true) || _coalesce_waiting.exchange(false)) {
+            on_timer();
+        }
+    }
+
 public:
     //// congestion holder
     uint32_t get_current_seq() const override {
-        return packet_sending_queue<T>::get_current_sequence();
+        return base_type::get_current_sequence();
     }
 
     uint32_t get_RTT() const override {
-        return packet_sending_queue<T>::get_ack_queue()->get_rto();
+        return base_type::get_ack_queue()->get_rto();
     }
 
     uint32_t get_ack_last_number() const override {
@@ -185,53 +276,246 @@ public:
     }
 
     uint32_t get_max_window_size() const override {
-        return packet_sending_queue<T>::get_window_size();
+        return base_type::get_window_size();
     }
 
     uint32_t get_max_payload() const override {
         return max_payload;
     }
 
+    void set_max_payload(uint32_t payload) override {
+        max_payload = payload;
+    }
+
     uint32_t get_deliver_rate() const override {
         return _receive_rate;
     }
 
 private:
-    void on_timer() {
-        T t;
+    /// 所有分片共享同一个消息号, 只有缓存能容纳全部分片时才输入
+    /// coalesce为true时小于最大负载的数据可以和相邻的数据合并成一个包
+    int input_fragments(const packet_payload *fragments, size_t count, bool coalesce) {
+        if (!count) {
+            return 0;
+        }
+        size_t bytes = 0;
+        for (size_t i = 0; i < count; i++) {
+            bytes += fragments[i].size;
+        }
+
+        auto cache = _buffer_cache.get();
+        if (!cache || wait_capacity()) {
+            return 0;
+        }
         {
-            std::lock_guard<std::recursive_mutex> lmtx(mtx);
-            if (_buffer_cache.empty()) {
-                _is_commit = false;
+            /// 生产者之间串行化, 和发送线程之间无锁
+            producer_spin_lock guard(_producer_spin);
+            auto free_size = cache->free_size();
+            auto cached = cache->capacity() - free_size;
+            if (free_size < count || cached + count > this->get_window_size()) {
+                //Trace("window temporary size={}, wait it...", cached);
+                return 0;
+            }
+            /// 更新输入率, 在生产者锁内读取模式, 替换模式时等待锁释放之后才释放旧的模式
+            auto mode = base_type::current_bandwidth_mode();
+            for (size_t i = 0; i < count; i++) {
+                mode->input_packet((uint16_t) fragments[i].size);
+            }
+            auto number = get_next_packet_message_number();
+            auto now = get_now_ms();
+            uint64_t deadline = 0;
+            if (coalesce && _coalesce_delay && bytes < max_payload) {
+                deadline = get_now_us() + _coalesce_delay;
+            }
+            for (size_t i = 0; i < count; i++) {
+                auto &entry = cache->producer_slot(i);
+                entry.payload = fragments[i];
+                entry.input_time = now;
+                entry.coalesce_deadline = deadline;
+                entry.message_number = number;
+                if (count == 1) {
+                    entry.position = 0b11;
+                } else if (i == 0) {
+                    entry.position = 0b10;
+                } else if (i == count - 1) {
+                    entry.position = 0b01;
+                } else {
+                    entry.position = 0b00;
+                }
+            }
+            if (!cached) {
+                _cache_first_time.store(now);
+            }
+            _cache_bytes.fetch_add(bytes);
+            /// 所有分片一次性对发送线程可见
+            cache->commit(count);
+        }
+        /// 只有发送线程空闲时(队列由空变为非空)才唤醒poller
+        if (!_is_commit.exchange(true)) {
+            wake_up();
+            return static_cast<int>(bytes);
+        }
+        /// 发送线程在等待凑满一个包, 再来一个同样大小的数据就放不下了, 不用等到最迟发送时间
+        if (coalesce) {
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            if (_coalesce_waiting.load(std::memory_order_relaxed) && _cache_bytes.load() + bytes > max_payload && _coalesce_waiting.exchange(false)) {
+                wake_up();
+            }
+        }
+        return static_cast<int>(bytes);
+    }
+
+    void wake_up() {
+        /// 如果比较成功，说明在进程中..
+        std::weak_ptr<packet_limited_send_rate_queue<T, Next>> self(std::static_pointer_cast<packet_limited_send_rate_queue<T, Next>>(base_type::shared_from_this()));
+        base_type::get_poller()->async([self]() {
+            auto stronger_self = self.lock();
+            if (!stronger_self) {
                 return;
             }
-            t = std::move(_buffer_cache.front());
-            _buffer_cache.pop_front();
-            _size.fetch_add(1);
+            /// 投递之后队列迁移到了其他poller, 转发过去
+            if (!stronger_self->in_poller_thread()) {
+                return stronger_self->wake_up();
+            }
+            /// 直接调用
+            stronger_self->on_timer();
+        });
+    }
+
+    /// 把缓存头部连续的小包合并成一个不超过最大负载的包
+    /// 返回false说明还没有凑满一个包并且没有到最迟发送时间, 此时已经设置好定时器
+    bool coalesce_entries(spsc_ring<cache_entry> *cache, cache_entry &entry) {
+        size_t count = 0;
+        size_t bytes = 0;
+        size_t last = 0;
+        while (true) {
+            while (auto item = cache->peek(count)) {
+                if (!item->coalesce_deadline || bytes + item->payload.size > max_payload) {
+                    break;
+                }
+                bytes += item->payload.size;
+                last = item->payload.size;
+                ++count;
+            }
+            /// 后面还有放不下的数据, 或者剩余的空间已经放不下一个同样大小的数据
+            bool full = cache->peek(count) || max_payload - bytes < last;
+            auto now = get_now_us();
+            auto deadline = cache->front()->coalesce_deadline;
+            if (full || now >= deadline) {
+                _coalesce_waiting.store(false);
+                break;
+            }
+            _coalesce_waiting.store(true);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            /// 设置等待标志的同时可能有新数据写入
+            if (cache->peek(count)) {
+                continue;
+            }
+            std::weak_ptr<packet_limited_send_rate_queue<T, Next>> self(std::static_pointer_cast<packet_limited_send_rate_queue<T, Next>>(base_type::shared_from_this()));
+            timer.expires_after(std::chrono::microseconds(deadline - now));
+            timer.async_wait([self](const std::error_code &e) {
+                auto stronger_self = self.lock();
+                if (!stronger_self || e || !stronger_self->in_poller_thread()) {
+                    return;
+                }
+                stronger_self->on_timer();
+            });
+            return false;
         }
 
+        auto front = cache->front();
+        entry.input_time = front->input_time;
+        entry.message_number = front->message_number;
+        entry.position = 0b11;
+        if (count == 1) {
+            entry.payload = std::move(front->payload);
+            cache->pop();
+        } else {
+            /// 小包拷贝到一起, 每个包只拷贝一次
+            auto buff = std::make_shared<buffer>();
+            buff->reserve(bytes);
+            for (size_t i = 0; i < count; i++) {
+                front = cache->front();
+                buff->append(front->payload.data, front->payload.size);
+                cache->pop();
+            }
+            entry.payload.data = buff->data();
+            entry.payload.size = buff->size();
+            entry.payload.holder = std::move(buff);
+        }
+        _cache_bytes.fetch_sub(bytes);
+        return true;
+    }
+
+    void on_timer() {
+        ++_send_depth;
+        send_next();
+        /// 最外层的调度结束, 本次连续发送的包一起写出
+        if (--_send_depth == 0) {
+            this->next_flush(*this);
+        }
+    }
+
+    void send_next() {
         auto now = std::chrono::steady_clock::now();
+        /// 重传预算足够时优先发送重传包, 否则让给新数据
+        if (send_rexmit_packet(now)) {
+            return schedule_next(now);
+        }
+        auto cache = _buffer_cache.get();
+        auto front = cache ? cache->front() : nullptr;
+        if (!front) {
+            /// 只剩下等待重传预算的包
+            if (!_rexmit_queue.empty()) {
+                return wait_rexmit_tokens();
+            }
+            /// 空闲期间有新数据写入
+            if (!on_idle()) {
+                on_timer();
+            }
+            return;
+        }
+        cache_entry entry;
+        if (front->coalesce_deadline) {
+            if (!coalesce_entries(cache, entry)) {
+                return;
+            }
+        } else {
+            entry = std::move(*front);
+            cache->pop();
+            _cache_bytes.fetch_sub(entry.payload.size);
+        }
+
+        now = std::chrono::steady_clock::now();
         auto seq = this->get_next_sequence();
         srt::srt_packet pkt;
         pkt.set_control(false);
         pkt.set_packet_sequence_number(seq);
-        pkt.set_message_number(this->get_next_packet_message_number());
+        pkt.set_packet_position_flag(entry.position);
+        pkt.set_message_number(entry.message_number);
         pkt.set_timestamp(static_cast<uint32_t>(std::chrono::duration_cast<std::chrono::microseconds>(now - _conn).count()));
         pkt.set_socket_id(_sock_id);
+        /// 只生成包头, 负载直接引用, 发送时聚合写出
         auto pkt_buf = create_packet(pkt);
-
-        pkt_buf->append(t->data(), t->size());
-        auto p = base_type::insert_packet(pkt_buf, seq, std::chrono::duration_cast<std::chrono::milliseconds>(now.time_since_epoch()).count());
+        auto p = base_type::insert_packet(pkt_buf, seq, std::chrono::duration_cast<std::chrono::milliseconds>(now.time_since_epoch()).count(), entry.payload);
+        p->position = entry.position;
+        p->message_number = entry.message_number;
+        update_window_time();
         /// 尝试发送数据
         on_packet(p);
-        {
-            std::lock_guard<std::recursive_mutex> lmtx(mtx);
-            if (_buffer_cache.empty()) {
-                _is_commit = false;
-                return;
-            }
+        /// 缓存已经发送完毕, 通知上层继续写入
+        /// 定时器继续运行到下一个发送时间点, 期间写入的数据只进入缓存, 不会绕过发送间隔
+        if (cache->empty()) {
+            this->next_writable(*this);
+        }
+        schedule_next(now);
+    }
+
+    /// 计算下一个发送时间点并设置定时器
+    void schedule_next(const std::chrono::steady_clock::time_point &now) {
+        if (_kernel_pacing.load(std::memory_order_relaxed)) {
+            return schedule_launch(now);
         }
-        ////////
         uint64_t _next_send_point = 1000;
         /// 如果在慢启动阶段
         if (_congestion->slow_starting()) {
@@ -248,13 +532,7 @@ private:
             _last_send_point = now_nano;
 
             /// 计算出下一次应该发送的时间间隔
-            _next_send_point = (uint64_t) (_pkt_snd_period * 1000);
-            /// 拿到拥塞控制发送的建议时间间隔
-            auto _congestion_period = (uint64_t) (_congestion->get_send_period() * 1000);
-            Trace("congestion_period={} ns, next_send_point={} ns", _congestion_period, _next_send_point);
-            if (_next_send_point < _congestion_period) {
-                _next_send_point = _congestion_period;
-            }
+            _next_send_point = get_send_period_ns();
 
             /// 如果间隔大于下一次发送时间
             if (internal > _next_send_point) {
@@ -263,11 +541,44 @@ private:
         }
 
         Trace("next send duration={} ns", _next_send_point);
-        std::weak_ptr<packet_limited_send_rate_queue<T>> self(std::static_pointer_cast<packet_limited_send_rate_queue<T>>(base_type::shared_from_this()));
+        std::weak_ptr<packet_limited_send_rate_queue<T, Next>> self(std::static_pointer_cast<packet_limited_send_rate_queue<T, Next>>(base_type::shared_from_this()));
         timer.expires_after(duration_type(_next_send_point));
         timer.async_wait([self](const std::error_code &e) {
             auto stronger_self = self.lock();
-            if (!stronger_self || e) {
+            if (!stronger_self || e || !stronger_self->in_poller_thread()) {
+                return;
+            }
+            stronger_self->on_timer();
+        });
+    }
+
+    /// 发送间隔(ns), 取发送步长和拥塞控制建议间隔中较大的一个, 慢启动阶段只使用拥塞控制的间隔
+    uint64_t get_send_period_ns() {
+        auto _congestion_period = (uint64_t) (_congestion->get_send_period() * 1000);
+        if (_congestion->slow_starting()) {
+            return _congestion_period;
+        }
+        auto period = (uint64_t) (_pkt_snd_period * 1000);
+        Trace("congestion_period={} ns, next_send_point={} ns", _congestion_period, period);
+        return period < _congestion_period ? _congestion_period : period;
+    }
+
+    /// 内核调度: 每个包的发送时间点在上一个包的基础上加上发送间隔, 空闲之后从当前时间重新开始
+    /// 发送时间点落在horizon之内的包直接交给内核, 否则等到距离发送时间点还有horizon时再唤醒
+    void schedule_launch(const std::chrono::steady_clock::time_point &now) {
+        auto now_ns = (uint64_t) std::chrono::duration_cast<std::chrono::nanoseconds>(now.time_since_epoch()).count();
+        _launch_ns = std::max(_launch_ns, now_ns) + get_send_period_ns();
+        /// 限制一次唤醒交给内核的包数量, 避免长时间占用poller
+        if (_launch_ns <= now_ns + kernel_pacing_horizon && ++_launch_burst < kernel_pacing_burst) {
+            return on_timer();
+        }
+        _launch_burst = 0;
+        auto wait = _launch_ns > now_ns + kernel_pacing_horizon ? _launch_ns - now_ns - kernel_pacing_horizon : 0;
+        std::weak_ptr<packet_limited_send_rate_queue<T, Next>> self(std::static_pointer_cast<packet_limited_send_rate_queue<T, Next>>(base_type::shared_from_this()));
+        timer.expires_after(duration_type(wait));
+        timer.async_wait([self](const std::error_code &e) {
+            auto stronger_self = self.lock();
+            if (!stronger_self || e || !stronger_self->in_poller_thread()) {
                 return;
             }
             stronger_self->on_timer();
@@ -275,6 +586,111 @@ private:
     }
 
 private:
+    /// async_send可以在任意线程调用, 多个生产者持有这个自旋锁串行化之后共用_buffer_cache的生产者一侧,
+    /// spsc_ring在这里是多生产者单消费者的用法; 临界区只有写入几个槽位, 所以自旋并让出时间片, 不使用mutex
+    class producer_spin_lock {
+    public:
+        explicit producer_spin_lock(std::atomic_flag &flag) : _flag(flag) {
+            while (_flag.test_and_set(std::memory_order_acquire)) {
+                std::this_thread::yield();
+            }
+        }
+        ~producer_spin_lock() {
+            _flag.clear(std::memory_order_release);
+        }
+
+    private:
+        std::atomic_flag &_flag;
+    };
+
+    /// 按照OHEADBW补充重传令牌, 重传带宽 = 输入码率 * 百分比
+    void refill_rexmit_tokens(const std::chrono::steady_clock::time_point &now) {
+        auto mode = base_type::current_bandwidth_mode();
+        auto overhead = mode->get_overhead();
+        auto rate = (double) mode->get_bandwidth() * overhead / (100 + overhead);
+        /// 最多积累20ms的预算, 至少能发送4个满包
+        auto burst = std::max(rate / 50, 4.0 * max_payload);
+        if (_rexmit_refill_point == std::chrono::steady_clock::time_point{}) {
+            _rexmit_tokens = burst;
+        } else {
+            auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(now - _rexmit_refill_point).count();
+            _rexmit_tokens = std::min(burst, _rexmit_tokens + rate * elapsed / 1e9);
+        }
+        _rexmit_refill_point = now;
+        _rexmit_rate = rate;
+    }
+
+    /// 发送一个重传包, 返回false说明没有需要重传的包或者预算不足
+    bool send_rexmit_packet(const std::chrono::steady_clock::time_point &now) {
+        if (_rexmit_queue.empty()) {
+            return false;
+        }
+        refill_rexmit_tokens(now);
+        while (!_rexmit_queue.empty()) {
+            auto p = _rexmit_queue.front();
+            /// 已经被确认或者丢弃
+            if (p->removed) {
+                p->rexmit_pending = false;
+                _rexmit_queue.pop_front();
+                continue;
+            }
+            if (_rexmit_tokens < p->size()) {
+                ++_rexmit_deferred;
+                return false;
+            }
+            _rexmit_queue.pop_front();
+            p->rexmit_pending = false;
+            _rexmit_tokens -= p->size();
+            on_packet(p);
+            return true;
+        }
+        return false;
+    }
+
+    /// 没有新数据可以发送, 等到预算足够发送下一个重传包
+    void wait_rexmit_tokens() {
+        auto need = (double) _rexmit_queue.front()->size() - _rexmit_tokens;
+        auto wait = _rexmit_rate > 0 ? (uint64_t) (need * 1e9 / _rexmit_rate) : 1000000;
+        std::weak_ptr<packet_limited_send_rate_queue<T, Next>> self(std::static_pointer_cast<packet_limited_send_rate_queue<T, Next>>(base_type::shared_from_this()));
+        timer.expires_after(duration_type(std::max<uint64_t>(wait, 1000)));
+        timer.async_wait([self](const std::error_code &e) {
+            auto stronger_self = self.lock();
+            if (!stronger_self || e || !stronger_self->in_poller_thread()) {
+                return;
+            }
+            stronger_self->on_timer();
+        });
+    }
+
+    /// 缓存为空时发送线程进入空闲, 返回false说明有新数据在此期间写入, 需要继续发送
+    bool on_idle() {
+        _cache_first_time.store(0);
+        _is_commit.store(false);
+        auto cache = _buffer_cache.get();
+        if (cache && !cache->empty() && !_is_commit.exchange(true)) {
+            return false;
+        }
+        return true;
+    }
+
+    static uint64_t get_now_ns() {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    static uint64_t get_now_us() {
+        return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    static uint64_t get_now_ms() {
+        return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    /// 记录发送窗口中最早的包的时间
+    void update_window_time() {
+        auto first = this->get_first_block();
+        _window_first_time.store(first ? first->submit_time : 0);
+    }
+
     bool wait_capacity() {
         /// 如果窗口的容量 和 发送
         uint32_t cwnd = std::min(flow_window, this->get_window_size());
@@ -300,34 +716,63 @@ private:
 
     inline void update_snd_period() {
         /// 求出步长
-        _pkt_snd_period = avg_payload_size * 1e6 / base_type::get_bandwidth_mode()->get_bandwidth() * 1.0;
+        _pkt_snd_period = avg_payload_size * 1e6 / base_type::current_bandwidth_mode()->get_bandwidth() * 1.0;
         Trace("update packet send period={} us", static_cast<uint64_t>(_pkt_snd_period));
     }
 
 private:
+    /// 内核调度时提前交给内核的时间范围(ns)和一次唤醒最多交给内核的包数量
+    static constexpr uint64_t kernel_pacing_horizon = 1000000;
+    static constexpr uint32_t kernel_pacing_burst = 64;
     /// AvgPayloadSize is equal to the maximum
-    /// allowed packet payload size, which cannot be larger than 1456 bytes.
+    /// allowed packet payload size, which is the negotiated mss minus 44 bytes.
     /// AvgPayloadSize = 7/8 * AvgPayloadSize + 1/8 * PacketPayloadSize
     uint16_t avg_payload_size = 1472;
     /// PKT_SND_PERIOD = PktSize * 1000000 / MAX_BW
     ///  microseconds
     double _pkt_snd_period = 11.776;
     asio::steady_timer timer;
-    std::recursive_mutex mtx;
-    std::list<T> _buffer_cache;
-    std::atomic<int> _size;
-    bool _is_commit = false;
+    /// 多个应用线程持有_producer_spin写入, 只有发送线程读取
+    std::unique_ptr<spsc_ring<cache_entry>> _buffer_cache;
+    std::atomic_flag _producer_spin = ATOMIC_FLAG_INIT;
+    std::atomic<uint64_t> _cache_bytes{0};
+    std::atomic<uint64_t> _cache_first_time{0};
+    std::atomic<uint64_t> _window_first_time{0};
+    /// 发送线程是否正在运行
+    std::atomic<bool> _is_commit{false};
+    /// 发送线程正在等待凑满一个包
+    std::atomic<bool> _coalesce_waiting{false};
+    uint32_t _coalesce_delay = 0;
     uint32_t _sock_id = 0;
-    uint32_t max_payload = 1500;
+    /// 应用线程合并小包时读取, 路径MTU探测时由poller修改
+    std::atomic<uint32_t> max_payload{1500};
     std::chrono::steady_clock::time_point _conn;
-    /// 上一次发送包的序号
+    /// 下一个消息的消息号
     uint32_t message_number = 1;
     uint32_t flow_window = 0;
     uint32_t _receive_rate = 0;
     std::atomic<uint32_t> _last_ack_number{0};
     uint64_t _last_send_point = 0;
     std::shared_ptr<congestion> _congestion;
+    /// 等待发送的重传包, 只在poller线程中访问
+    std::deque<packet_pointer> _rexmit_queue;
+    /// 重传令牌桶(字节)
+    double _rexmit_tokens = 0;
+    double _rexmit_rate = 0;
+    std::chrono::steady_clock::time_point _rexmit_refill_point{};
+    std::atomic<uint64_t> _rexmit_deferred{0};
+    /// 是否由内核调度, 以及下一个包的发送时间点(ns)
+    std::atomic<bool> _kernel_pacing{false};
+    uint64_t _launch_ns = 0;
+    uint32_t _launch_burst = 0;
+    /// on_timer的递归深度
+    uint32_t _send_depth = 0;
 };
 
+template<typename T, typename Next>
+constexpr uint64_t packet_limited_send_rate_queue<T, Next>::kernel_pacing_horizon;
+template<typename T, typename Next>
+constexpr uint32_t packet_limited_send_rate_queue<T, Next>::kernel_pacing_burst;
+
 
 #endif//TOOLKIT_PACKET_LIMITED_SEND_RATE_QUEUE_HPP
@@ -0,0 +1,106 @@
+﻿/*
+* @file_name: packet_pipeline.hpp
+* @date: 2026/10/19
+* @author: shen hao
+* Copyright @ hz shen hao, All rights reserved.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+#ifndef TOOLKIT_PACKET_PIPELINE_HPP
+#define TOOLKIT_PACKET_PIPELINE_HPP
+#include "packet_interface.hpp"
+#include <cstdint>
+#include <functional>
+#include <memory>
+//// 静态组合的包处理流水线: 发送队列(含限速) -> 过滤 -> 传输, 传输 -> 接收队列 -> 应用层
+//// 每一级是下一级的模板参数(见packet_stage), 相邻两级之间直接调用, 不经过类型擦除
+
+/// 过滤: Filter返回false的包不再向下传递, 其余事件原样转发
+template<typename T, typename Filter, typename Next>
+class packet_filter {
+public:
+    packet_filter() = default;
+    packet_filter(const Filter &filter, const Next &next) : _filter(filter), _next(next) {}
+
+public:
+    void on_packet(const std::shared_ptr<packet<T>> &p) {
+        if (_filter(p)) {
+            _next.on_packet(p);
+        }
+    }
+
+    void on_drop_packet(uint32_t begin, uint32_t end) {
+        _next.on_drop_packet(begin, end);
+    }
+
+    void on_writable() {
+        _next.on_writable();
+    }
+
+    void on_flush() {
+        _next.on_flush();
+    }
+
+    Filter &get_filter() {
+        return _filter;
+    }
+
+    Next &get_next() {
+        return _next;
+    }
+
+private:
+    Filter _filter{};
+    Next _next{};
+};
+
+/// 类型擦除的下一级, 下一级只能在运行时确定时使用; 没有设置的回调忽略
+template<typename T>
+struct function_next {
+    std::function<void(const std::shared_ptr<packet<T>> &)> packet_func;
+    std::function<void(uint32_t, uint32_t)> drop_packet_func;
+    std::function<void()> writable_func;
+    std::function<void()> flush_func;
+
+    void on_packet(const std::shared_ptr<packet<T>> &p) {
+        if (packet_func) {
+            packet_func(p);
+        }
+    }
+
+    void on_drop_packet(uint32_t begin, uint32_t end) {
+        if (drop_packet_func) {
+            drop_packet_func(begin, end);
+        }
+    }
+
+    void on_writable() {
+        if (writable_func) {
+            writable_func();
+        }
+    }
+
+    void on_flush() {
+        if (flush_func) {
+            flush_func();
+        }
+    }
+};
+
+#endif//TOOLKIT_PACKET_PIPELINE_HPP
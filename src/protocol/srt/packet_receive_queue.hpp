@@ -25,14 +25,30 @@
 
 #ifndef TOOLKIT_PACKET_RECEIVE_QUEUE_HPP
 #define TOOLKIT_PACKET_RECEIVE_QUEUE_HPP
+#include "packet_interface.hpp"
+#include "spdlog/logger.hpp"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <map>
 #include <vector>
-template<typename T>
-class packet_receive_queue : public packet_receive_interface<T> {
+/// Next为下一级的类型, 见packet_stage
+template<typename T, typename Next = void>
+class packet_receive_queue : public packet_receive_interface<T>, public packet_stage<T, Next> {
 public:
     using packet_pointer = typename packet_interface<T>::packet_pointer;
 
 private:
     using iterator = typename std::map<uint32_t, packet_pointer>::iterator;
+    /// 空洞被发现的时间(ms)和是否已经上报
+    struct lost_entry {
+        uint64_t time = 0;
+        bool reported = false;
+    };
+
+public:
+    /// 槽位从initial_slots开始, 只有乱序或丢包时才按需增长, 最大为窗口大小
+    static constexpr uint32_t initial_slots = 32;
 
 public:
     ~packet_receive_queue() override = default;
@@ -72,10 +88,55 @@ public:
 
     void set_window_size(uint32_t size) override {
         packet_interface<T>::set_window_size(size);
-        _pkt_buf.resize(size);
+        resize_slots(size < initial_slots ? size : initial_slots);
+    }
+
+    /// 没有缓存的包时恢复到初始大小
+    void shrink() override {
+        auto window = packet_interface<T>::get_window_size();
+        auto slots = window < initial_slots ? window : initial_slots;
+        if (_size == 0 && _pkt_buf.size() > slots) {
+            resize_slots(slots);
+        }
+    }
+
+    /// 当前分配的槽位数量
+    size_t get_slot_size() const {
+        return _pkt_buf.size();
+    }
+
+    void set_reorder_tolerance(uint32_t max_packets) override {
+        _max_tolerance = max_packets;
+        if (_tolerance.load() > max_packets) {
+            _tolerance.store(max_packets);
+        }
+    }
+
+    void set_reorder_timeout(uint32_t timeout_ms) override {
+        _reorder_timeout = timeout_ms;
+    }
+
+    uint32_t get_reorder_tolerance() const override {
+        return _tolerance.load(std::memory_order_relaxed);
+    }
+
+    bool has_reorder_pending() const override {
+        return _reorder_pending;
+    }
+
+    uint64_t get_belated_count() const override {
+        return _belated.load(std::memory_order_relaxed);
+    }
+
+    uint64_t get_lost_count() const override {
+        return _lost_count.load(std::memory_order_relaxed);
     }
 
     int input_packet(const T &t, uint32_t seq, uint64_t time_point) override {
+        return input_message_packet(t, seq, time_point, 0b11, 0, false);
+    }
+
+    int input_message_packet(const T &t, uint32_t seq, uint64_t time_point, uint8_t position, uint32_t message_number, bool retransmitted) override {
 
         if (_cur_seq > seq && !is_seq_cycle(seq, _cur_seq)) {
             Warn("too old packet seq, seq={}, current_seq={}, ignore it", seq, _cur_seq);
@@ -83,6 +144,11 @@ public:
         }
 
         Trace("input packet, seq={}, time_point={}", seq, time_point);
+        auto window = packet_interface<T>::get_window_size();
+        /// 槽位已经用完但是还没有达到窗口大小
+        if (_size > 0 && _start == _end && _pkt_buf.size() < window) {
+            grow_slots(_pkt_buf.size() + 1);
+        }
         /// 窗口已经满了
         while (_size > 0 && _start == _end) {
             if (_pkt_buf[_start]) {
@@ -91,15 +157,19 @@ public:
                 --_size;
                 _pkt_buf[_start] = nullptr;
             }
+            _lost[_start] = lost_entry();
             _start = (_start + 1) % _pkt_buf.size();
             _cur_seq = (_cur_seq + 1) % packet_interface<T>::get_max_sequence();
         }
 
         uint32_t diff = packet_interface<T>::sequence_diff(_cur_seq, seq);
-        if (diff >= _pkt_buf.size()) {
+        if (diff >= window) {
             Debug("cycle packet too new packet seq, current seq={}, seq={}, diff={}", _cur_seq, seq, diff);
             return -1;
         }
+        if (diff >= _pkt_buf.size()) {
+            grow_slots(diff + 1);
+        }
 
 
         auto pos = (_start + diff) % _pkt_buf.size();
@@ -108,11 +178,14 @@ public:
             Debug("same seq packet, ignore it, seq={}", _pkt_buf[pos]->seq);
             return -1;
         }
+        update_reorder(diff, pos, retransmitted);
 
         auto pkt = std::make_shared<packet<T>>();
         pkt->seq = seq;
         pkt->pkt = t;
         pkt->submit_time = time_point;
+        pkt->position = position;
+        pkt->message_number = message_number;
         _pkt_buf[pos] = pkt;
         ++_size;
 
@@ -149,6 +222,7 @@ public:
                 on_packet(iter);
                 --_size;
             }
+            _lost[_start] = lost_entry();
             _cur_seq = (_cur_seq + 1) % packet_interface<T>::get_max_sequence();
             _start = (_start + 1) % _pkt_buf.size();
         }
@@ -184,6 +258,7 @@ public:
             } else {
                 on_drop_packet(seq_, seq_);
             }
+            _lost[pos] = lost_entry();
             seq_ = (seq_ + 1) % packet_interface<T>::get_max_sequence();
         }
 
@@ -196,17 +271,22 @@ public:
 
     void clear() override {
         _pkt_buf.clear();
+        _lost.clear();
         _start = _end = _size = 0;
         bytes = 0;
-        _pkt_buf.resize(packet_interface<T>::get_window_size());
+        _ordered_count = 0;
+        _tolerance.store(0);
+        auto window = packet_interface<T>::get_window_size();
+        resize_slots(window < initial_slots ? window : initial_slots);
     }
 
-    void on_packet(const packet_pointer &p) override {
-        return packet_interface<T>::_on_packet_func_(p);
+    /// 队列内部的调用在编译期确定
+    void on_packet(const packet_pointer &p) final {
+        return this->next_packet(*this, p);
     }
 
-    void on_drop_packet(uint32_t begin, uint32_t end) override {
-        return packet_interface<T>::_on_drop_packet_func_(begin, end);
+    void on_drop_packet(uint32_t begin, uint32_t end) final {
+        return this->next_drop_packet(*this, begin, end);
     }
 
     uint32_t get_expected_size() const override {
@@ -235,7 +315,8 @@ public:
         return max - get_current_sequence() + 1;
     }
 
-    std::vector<std::pair<uint32_t, uint32_t>> get_pending_packets() const override {
+    std::vector<std::pair<uint32_t, uint32_t>> get_pending_packets() override {
+        _reorder_pending = false;
         if (_size <= 0) {
             Trace("no pending packets.");
             return {};
@@ -245,8 +326,30 @@ public:
         auto begin = _start;
         auto end = _end;
         auto size = _size;
+        auto span = get_span();
+        auto tolerance = _tolerance.load(std::memory_order_relaxed);
+        auto now = get_now_ms();
         Trace("pending packet, begin={}, end={}, size={}", begin, end, size);
         while (begin != end && size > 0) {
+            /// 求出当前的序号
+            uint32_t diff = 0;
+            if (begin >= _start) {
+                diff = begin - _start;
+            } else {
+                diff = (uint32_t) _pkt_buf.size() - _start + begin;
+            }
+            /// 空洞之后到达的包数量和等待时间都还在容忍范围内, 可能只是乱序
+            auto &lost = _lost[begin];
+            if (!_pkt_buf[begin] && !lost.reported && tolerance && lost.time && span - 1 - diff < tolerance && now - lost.time < _reorder_timeout) {
+                _reorder_pending = true;
+                if (begin_seq >= 0 && end_seq >= 0) {
+                    Debug("insert nak pair, {}-{}", begin_seq, end_seq);
+                    vec.emplace_back((uint32_t) begin_seq, (uint32_t) end_seq);
+                    begin_seq = end_seq = -1;
+                }
+                begin = (begin + 1) % _pkt_buf.size();
+                continue;
+            }
             if (_pkt_buf[begin]) {
                 if (begin_seq >= 0 && end_seq >= 0) {
                     Debug("insert nak pair, {}-{}", begin_seq, end_seq);
@@ -257,14 +360,10 @@ public:
                 --size;
                 continue;
             }
-
-            /// 求出当前的序号
-            uint32_t diff = 0;
-            if (begin >= _start) {
-                diff = begin - _start;
-            } else {
-                diff = (uint32_t) _pkt_buf.size() - _start + begin;
+            if (!lost.reported) {
+                ++_lost_count;
             }
+            lost.reported = true;
             uint32_t sequence = (_cur_seq + diff) % packet_interface<T>::get_max_sequence();
             if (begin_seq == -1) {
                 begin_seq = end_seq = sequence;
@@ -285,6 +384,83 @@ public:
     }
 
 private:
+    static uint64_t get_now_ms() {
+        return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    /// 至少容纳count个槽位, 按两倍增长
+    void grow_slots(size_t count) {
+        auto window = (size_t) packet_interface<T>::get_window_size();
+        auto slots = _pkt_buf.size() ? _pkt_buf.size() : 1;
+        while (slots < count) {
+            slots <<= 1;
+        }
+        resize_slots(slots < window ? slots : window);
+    }
+
+    /// 重新分配槽位, 已经缓存的包按顺序从头排列
+    void resize_slots(size_t slots) {
+        auto span = get_span();
+        std::vector<packet_pointer> pkt_buf(slots);
+        std::vector<lost_entry> lost(slots);
+        for (uint32_t i = 0; i < span; i++) {
+            auto index = (_start + i) % _pkt_buf.size();
+            pkt_buf[i] = std::move(_pkt_buf[index]);
+            lost[i] = _lost[index];
+        }
+        Trace("resize receive slots, {} -> {}, span={}", _pkt_buf.size(), slots, span);
+        _pkt_buf.swap(pkt_buf);
+        _lost.swap(lost);
+        _start = 0;
+        _end = (uint32_t) (span % slots);
+    }
+
+    /// 从当前序号到收到的最大序号之间的位置数
+    uint32_t get_span() const {
+        if (_size <= 0) {
+            return 0;
+        }
+        auto n = (uint32_t) _pkt_buf.size();
+        return _end == _start ? n : (_end + n - _start) % n;
+    }
+
+    /// 记录新出现的空洞, 根据填补空洞的原始包调整乱序容忍度
+    void update_reorder(uint32_t diff, size_t pos, bool retransmitted) {
+        auto span = get_span();
+        if (diff >= span) {
+            /// 比已经收到的序号都大, 中间空出来的位置是新发现的空洞
+            auto now = get_now_ms();
+            for (uint32_t i = span; i < diff; i++) {
+                auto &lost = _lost[(_start + i) % _pkt_buf.size()];
+                lost.time = now;
+                lost.reported = false;
+            }
+            /// 连续按序到达一段时间后逐渐降低容忍度
+            if (diff == span && ++_ordered_count >= 50) {
+                _ordered_count = 0;
+                auto tolerance = _tolerance.load(std::memory_order_relaxed);
+                if (tolerance) {
+                    _tolerance.store(tolerance - 1);
+                }
+            }
+            return;
+        }
+        /// 填补了之前的空洞
+        auto &lost = _lost[pos];
+        if (!retransmitted) {
+            _ordered_count = 0;
+            /// 原始包在NAK之后才到达, 说明是乱序而不是丢包, 对应的重传是多余的
+            if (lost.reported) {
+                ++_belated;
+                auto distance = span - diff;
+                auto tolerance = std::min(_max_tolerance, std::max(_tolerance.load(std::memory_order_relaxed), distance));
+                Debug("belated packet, reorder distance={}, tolerance={}", distance, tolerance);
+                _tolerance.store(tolerance);
+            }
+        }
+        lost = lost_entry();
+    }
+
     bool is_seq_cycle(uint32_t first, uint32_t second) {
         uint32_t diff = 0;
         if (first > second) {
@@ -305,7 +481,19 @@ private:
     uint32_t _size = 0;
     uint32_t _cur_seq = 0;
     uint64_t bytes = 0;
+    std::vector<lost_entry> _lost;
+    uint32_t _max_tolerance = 0;
+    uint32_t _reorder_timeout = 20;
+    /// 上一次检查时有空洞在乱序容忍范围内没有上报
+    bool _reorder_pending = false;
+    uint32_t _ordered_count = 0;
+    std::atomic<uint32_t> _tolerance{0};
+    std::atomic<uint64_t> _belated{0};
+    std::atomic<uint64_t> _lost_count{0};
 };
 
+template<typename T, typename Next>
+constexpr uint32_t packet_receive_queue<T, Next>::initial_slots;
+
 
 #endif//TOOLKIT_PACKET_RECEIVE_QUEUE_HPP
@@ -38,8 +38,9 @@
 #include <numeric>
 #include <utility>
 #include <vector>
-template<typename T>
-class packet_sending_queue : public packet_send_interface<T>, public std::enable_shared_from_this<packet_sending_queue<T>> {
+/// Next为下一级的类型, 见packet_stage
+template<typename T, typename Next = void>
+class packet_sending_queue : public packet_send_interface<T>, public packet_stage<T, Next>, public std::enable_shared_from_this<packet_sending_queue<T, Next>> {
 public:
     using packet_pointer = typename packet_interface<T>::packet_pointer;
 
@@ -115,6 +116,11 @@ public:
 
     void clear() override {
         rexmit_timer.cancel();
+        for (auto &_list: _pkt_cache) {
+            for (auto &p: *_list) {
+                p->removed = true;
+            }
+        }
         _pkt_cache.clear();
         _allocated_bytes = 0;
         _size.store(0);
@@ -170,8 +176,23 @@ public:
         return this->_ack_queue;
     }
 
+    /// 迁移时由原poller线程修改, 可以在任意线程读取
     event_poller::Ptr get_poller() {
-        return poller;
+        return std::atomic_load(&poller);
+    }
+
+    void migrate(const event_poller::Ptr &target) override {
+        rexmit_timer.cancel();
+        std::atomic_store(&poller, target);
+        rexmit_timer = asio::steady_timer(target->get_executor());
+        std::weak_ptr<packet_sending_queue<T, Next>> self(packet_sending_queue<T, Next>::shared_from_this());
+        target->async([self]() {
+            auto stronger_self = self.lock();
+            /// 执行之前又迁移到了其他poller, 由最后一次迁移恢复
+            if (stronger_self && stronger_self->in_poller_thread()) {
+                stronger_self->on_migrated();
+            }
+        });
     }
 
 protected:
@@ -205,15 +226,16 @@ protected:
     }
 
 
-    packet_pointer insert_packet(const T &t, uint32_t seq, uint64_t submit_time = 0) {
+    packet_pointer insert_packet(const T &t, uint32_t seq, uint64_t submit_time = 0, const packet_payload &payload = {}) {
         Trace("current capacity={}, seq={}", packet_interface<T>::capacity(), seq);
         if (packet_interface<T>::capacity() <= 0) {
             auto entry = get_minimum_expired(false);
             if (entry.first) {
                 auto pkt = *(_pkt_cache[entry.second]->begin());
                 _pkt_cache[entry.second]->pop_front();
+                pkt->removed = true;
                 _size.fetch_sub(1);
-                _allocated_bytes -= pkt->pkt->size();
+                _allocated_bytes -= pkt->size();
                 on_drop_packet(pkt->seq, pkt->seq);
             }
         }
@@ -224,10 +246,11 @@ protected:
         else
             pkt->submit_time = submit_time;
         pkt->pkt = t;
+        pkt->payload = payload;
         /// 设置重传的的时间点
         pkt->retransmit_time_point = pkt->submit_time + pkt_RTO(1) / 1000;
         /// 增加总字节数目
-        _allocated_bytes += pkt->pkt->size();
+        _allocated_bytes += pkt->size();
 
         _size.fetch_add(1);
         //        Debug("pkt add queue, subtime_time={}, rexmit_time={}", pkt->submit_time, pkt->retransmit_time_point);
@@ -243,11 +266,11 @@ protected:
     }
 
     void on_packet(const packet_pointer &p) override {
-        return packet_interface<T>::_on_packet_func_(p);
+        return this->next_packet(*this, p);
     }
 
     void on_drop_packet(uint32_t begin, uint32_t end) override {
-        return packet_interface<T>::_on_drop_packet_func_(begin, end);
+        return this->next_drop_packet(*this, begin, end);
     }
 
     uint64_t get_allocated_bytes() override {
@@ -257,6 +280,18 @@ protected:
     void on_size_changed(bool, uint32_t) override {}
     void update_flow_window(uint32_t) override {}
 
+    /// 在新的poller中恢复迁移时取消的定时器
+    virtual void on_migrated() {
+        if (_size.load(std::memory_order_relaxed)) {
+            update_rexmit_timer();
+        }
+    }
+
+    /// 迁移之前已经到期的定时器回调仍然在原poller中执行, 需要忽略
+    bool in_poller_thread() {
+        return get_poller()->is_current_thread();
+    }
+
     /// 更新定时器
     void update_rexmit_timer() {
         /// 拿到最小的超时
@@ -272,14 +307,14 @@ protected:
         /// 当前这个包的重传时间 us
         auto next_expired = pkt->retransmit_time_point;
         Trace("seq {} set retransmit packet time={} ms", pkt->seq, next_expired);
-        std::weak_ptr<packet_sending_queue<T>> self(packet_sending_queue<T>::shared_from_this());
+        std::weak_ptr<packet_sending_queue<T, Next>> self(packet_sending_queue<T, Next>::shared_from_this());
         rexmit_timer.expires_at(time_point() + duration(next_expired));
         rexmit_timer.async_wait([self, index, seq, next_expired](const std::error_code &e) {
             auto stronger_self = self.lock();
             if (!stronger_self) {
                 return;
             }
-            if (e) return;
+            if (e || !stronger_self->in_poller_thread()) return;
             stronger_self->on_timer(index, seq, next_expired);
         });
     }
@@ -298,8 +333,9 @@ protected:
             /// 丢弃包
             if (now - (*it)->submit_time >= latency && latency) {
                 _size.fetch_sub(1);
-                _allocated_bytes -= (*it)->pkt->size();
+                _allocated_bytes -= (*it)->size();
                 on_drop_packet((*it)->seq, (*it)->seq);
+                (*it)->removed = true;
                 it = _list->erase(it);
                 drop = true;
                 continue;
@@ -335,10 +371,15 @@ protected:
 
     virtual void rexmit_packet(const packet_pointer &p) {
         if (!enable_nak) {
-            return on_packet(p);
+            return on_retransmit(p);
         }
     }
 
+    /// 发送需要重传的包, 默认立即发送
+    virtual void on_retransmit(const packet_pointer &p) {
+        on_packet(p);
+    }
+
     std::pair<iterator, iterator> find_packet_by_sequence(std::list<packet_pointer> &target, uint32_t begin, uint32_t end) {
         auto begin_it = target.begin();
         auto end_it = target.end();
@@ -379,7 +420,8 @@ private:
         ++pair.second;
         uint32_t couple = 0;
         std::for_each(pair.first, pair.second, [&](const packet_pointer &p) {
-            _allocated_bytes -= p->pkt->size();
+            _allocated_bytes -= p->size();
+            p->removed = true;
             ++couple;
         });
         _list->erase(pair.first, pair.second);
@@ -399,7 +441,7 @@ private:
         while (pair.first != pair.second) {
             /// 设置为重传
             ++((*pair.first)->retransmit_count);
-            on_packet(*pair.first);
+            on_retransmit(*pair.first);
             ++pair.first;
         }
         if ((int) _pkt_cache.size() < index + 2) {
@@ -416,7 +458,8 @@ private:
             if (element->seq >= seq && !packet_send_interface<T>::is_cycle()) {
                 break;
             }
-            _allocated_bytes -= element->pkt->size();
+            _allocated_bytes -= element->size();
+            element->removed = true;
             _list->pop_front();
             _size.fetch_sub(1);
         }
@@ -469,7 +512,7 @@ private:
     ///表示有多少个重传桶
     std::vector<std::shared_ptr<std::list<packet_pointer>>> _pkt_cache;
     std::shared_ptr<srt::srt_ack_queue> _ack_queue;
-    uint64_t _allocated_bytes = 0;
+    std::atomic<uint64_t> _allocated_bytes{0};
     bool enable_nak = true;
     bool enable_drop = true;
 };
@@ -3,28 +3,78 @@
 #include <algorithm>
 #include <vector>
 namespace srt {
+    constexpr uint32_t srt_ack_queue::ack_window_size;
+    constexpr uint32_t srt_ack_queue::min_ack_window_size;
+    constexpr uint32_t srt_ack_frequency::light_ack_packets;
+    constexpr uint32_t srt_ack_frequency::min_full_ack_interval;
+    constexpr uint32_t srt_ack_frequency::max_full_ack_interval;
 
     void srt_ack_queue::set_rtt(uint32_t _rtt, uint32_t _rtt_var) {
         this->_rtt = _rtt;
         this->_rtt_var = _rtt_var;
     }
 
-    void srt_ack_queue::add_ack(uint32_t seq) {
-        ack_queue.emplace(seq, std::chrono::steady_clock::now());
+    void srt_ack_queue::add_ack(uint32_t ack_number) {
+        auto now = std::chrono::steady_clock::now();
+        if (ack_window.empty()) {
+            ack_window.resize(min_ack_window_size);
+        }
+        auto *slot = &ack_window[ack_number % ack_window.size()];
+        /// 要覆盖的槽位还在等待ack ack, 说明RTT超过了窗口覆盖的时间, 扩大窗口
+        if (slot->valid && now - slot->time_point < std::chrono::seconds(10) && ack_window.size() < ack_window_size) {
+            resize_window(ack_window.size() * 2);
+            slot = &ack_window[ack_number % ack_window.size()];
+        }
+        slot->valid = true;
+        slot->ack_number = ack_number;
+        slot->time_point = now;
+    }
+
+    void srt_ack_queue::resize_window(size_t size) {
+        std::vector<ack_slot> window(size);
+        for (const auto &item: ack_window) {
+            if (!item.valid) {
+                continue;
+            }
+            auto &slot = window[item.ack_number % size];
+            if (!slot.valid || slot.time_point < item.time_point) {
+                slot = item;
+            }
+        }
+        ack_window.swap(window);
+        Debug("ack window size={}", ack_window.size());
+    }
+
+    void srt_ack_queue::shrink() {
+        auto now = std::chrono::steady_clock::now();
+        for (const auto &item: ack_window) {
+            if (item.valid && now - item.time_point < std::chrono::seconds(10)) {
+                return;
+            }
+        }
+        std::vector<ack_slot>().swap(ack_window);
+    }
+
+    size_t srt_ack_queue::get_window_size() const {
+        return ack_window.size();
     }
 
-    void srt_ack_queue::calculate(uint32_t seq) {
-        auto it = ack_queue.find(seq);
-        if (it == ack_queue.end()) {
+    void srt_ack_queue::calculate(uint32_t ack_number, std::chrono::steady_clock::time_point now) {
+        if (ack_window.empty()) {
+            return;
+        }
+        auto &slot = ack_window[ack_number % ack_window.size()];
+        if (!slot.valid || slot.ack_number != ack_number) {
             return;
         }
-        auto rtt = (uint32_t) (std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - it->second).count());
+        slot.valid = false;
+        now = (std::max)(now, slot.time_point);
+        auto rtt = (uint32_t) (std::chrono::duration_cast<std::chrono::microseconds>(now - slot.time_point).count());
         /// rtt = 7/8 * RTT + 1/8 * rtt
         /// rtt_var = 3/4 * rtt_var + 1/4 * abs(RTT - rtt)
         _rtt_var = (3 * _rtt_var + std::abs((long) _rtt - (long) rtt)) / 4;
         _rtt = (7 * rtt + _rtt) / 8;
         Trace("rtt={}, rtt_variance={}, ms={}", _rtt, _rtt_var, rtt);
-        ack_queue.erase(it);
     }
 
 
@@ -36,4 +86,38 @@ namespace srt {
         return this->_rtt_var;
     }
 
+    bool srt_ack_frequency::on_data_packet(uint32_t seq) {
+        if (++packets < light_ack_packets) {
+            return false;
+        }
+        packets = 0;
+        if (seq == last_ack_seq) {
+            return false;
+        }
+        last_ack_seq = seq;
+        return true;
+    }
+
+    uint32_t srt_ack_frequency::on_full_ack(uint32_t seq) {
+        packets = 0;
+        if (!has_full_ack || seq != last_full_ack_seq) {
+            full_ack_interval = min_full_ack_interval;
+        } else {
+            full_ack_interval = (std::min)(full_ack_interval << 1, max_full_ack_interval);
+        }
+        has_full_ack = true;
+        last_ack_seq = last_full_ack_seq = seq;
+        return full_ack_interval;
+    }
+
+    uint32_t srt_ack_frequency::get_full_ack_interval() const {
+        return full_ack_interval;
+    }
+
+    void srt_ack_frequency::reset() {
+        packets = 0;
+        has_full_ack = false;
+        full_ack_interval = min_full_ack_interval;
+    }
+
 }// namespace srt
\ No newline at end of file
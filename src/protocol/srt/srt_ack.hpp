@@ -26,9 +26,11 @@
 #ifndef TOOLKIT_SRT_ACK_HPP
 #define TOOLKIT_SRT_ACK_HPP
 #include <algorithm>
+#include <array>
 #include <chrono>
 #include <cmath>
-#include <unordered_map>
+#include <cstdint>
+#include <vector>
 namespace srt {
 
     struct receive_rate {
@@ -46,19 +48,21 @@ namespace srt {
         }
 
     public:
-        void update_receive_rate(uint16_t size) {
-            auto now = std::chrono::steady_clock::now();
+        /// now为包到达的时间, 有内核接收时间时使用内核时间, 避免把poller的排队延迟算进包间隔
+        void update_receive_rate(uint16_t size, std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now()) {
+            /// 内核时间和处理时间混用时可能倒退
+            now = (std::max)(now, last_receive_point);
             pkt_window[index] = (uint32_t) std::chrono::duration_cast<std::chrono::microseconds>(now - last_receive_point).count();
             bytes_window[index] = size;
             index = (index + 1) % NUM;
             last_receive_point = now;
         }
 
-        void update_estimated_capacity(uint32_t seq, uint16_t size, bool unordered) {
+        void update_estimated_capacity(uint32_t seq, uint16_t size, bool unordered, std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now()) {
             auto mod = seq % 16;
             /// 每16个包一次
             if (!mod) {
-                estimated_1(seq, unordered);
+                estimated_1(seq, unordered, now);
             }
 
             if (unordered) {
@@ -66,7 +70,7 @@ namespace srt {
             }
 
             if (mod == 1) {
-                estimated_2(seq, size);
+                estimated_2(seq, size, now);
             }
         }
 
@@ -126,21 +130,21 @@ namespace srt {
         }
 
     private:
-        void estimated_1(uint32_t seq, bool unordered) {
+        void estimated_1(uint32_t seq, bool unordered, const std::chrono::steady_clock::time_point &now) {
             if (unordered && (int64_t) (seq) == sequence_1) {
                 sequence_1 = -1;
                 return;
             }
-            commit_1 = std::chrono::steady_clock::now();
+            commit_1 = now;
             sequence_1 = seq;
         }
 
-        void estimated_2(uint32_t seq, uint16_t size) {
+        void estimated_2(uint32_t seq, uint16_t size, std::chrono::steady_clock::time_point now) {
             auto next_seq = (sequence_1 + 1) % 0x7FFFFFFF;
             if (sequence_1 == -1 || next_seq != seq) {
                 return;
             }
-            auto now = std::chrono::steady_clock::now();
+            now = (std::max)(now, commit_1);
             auto micro_dur = std::chrono::duration_cast<std::chrono::microseconds>(now - commit_1).count();
             auto pl_size = 1456 * micro_dur;
 
@@ -164,18 +168,67 @@ namespace srt {
 
 
     class srt_ack_queue {
+    public:
+        /// full ack 最多每10ms一次, 1024个槽位可以覆盖10秒以上的RTT
+        static constexpr uint32_t ack_window_size = 1024;
+        /// 窗口从16个槽位开始, 只有RTT超过窗口覆盖的时间才扩大
+        static constexpr uint32_t min_ack_window_size = 16;
+
     public:
         void set_rtt(uint32_t _rtt, uint32_t _rtt_var);
         void add_ack(uint32_t);
-        void calculate(uint32_t);
+        /// now为ack ack到达的时间, 有内核接收时间时使用内核时间
+        void calculate(uint32_t, std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now());
         uint32_t get_rto() const;
         uint32_t get_rtt_var() const;
+        /// 没有等待ack ack的槽位时释放整个窗口, 下一次add_ack时重新分配
+        void shrink();
+        size_t get_window_size() const;
+
+    private:
+        void resize_window(size_t size);
+
+    private:
+        struct ack_slot {
+            bool valid = false;
+            uint32_t ack_number = 0;
+            std::chrono::steady_clock::time_point time_point;
+        };
 
     private:
         /// 单位是微秒
         uint32_t _rtt = 100000;
         uint32_t _rtt_var = 50000;
-        std::unordered_map<uint32_t, std::chrono::steady_clock::time_point> ack_queue;
+        /// 以ack number取模作为下标的环形窗口, 槽位被覆盖说明对应的ack ack已经过期
+        std::vector<ack_slot> ack_window;
+    };
+
+    /// 接收端的ack发送频率控制
+    /// light ack: 每收到light_ack_packets个数据包, 如果确认序号有推进, 立即发送只携带序号的light ack,
+    ///            高码率下发送端不必等待下一个full ack才能滑动窗口, 且light ack不需要回复ack ack.
+    /// full ack:  默认每10ms发送一次, 如果两次full ack之间确认序号没有推进, 则把间隔加倍退避,
+    ///            最大不超过max_full_ack_interval, 序号一旦推进立即恢复到10ms.
+    class srt_ack_frequency {
+    public:
+        static constexpr uint32_t light_ack_packets = 64;
+        /// 单位是微秒
+        static constexpr uint32_t min_full_ack_interval = 10000;
+        static constexpr uint32_t max_full_ack_interval = 80000;
+
+    public:
+        /// 收到一个数据包, seq为接收队列当前确认到的序号, 返回是否需要发送light ack
+        bool on_data_packet(uint32_t seq);
+        /// 发送了一个full ack, 返回下一次full ack的间隔(微秒)
+        uint32_t on_full_ack(uint32_t seq);
+        uint32_t get_full_ack_interval() const;
+        void reset();
+
+    private:
+        uint32_t packets = 0;
+        uint32_t last_ack_seq = 0;
+        uint32_t last_full_ack_seq = 0;
+        bool has_full_ack = false;
+        uint32_t full_ack_interval = min_full_ack_interval;
     };
 }// namespace srt
 
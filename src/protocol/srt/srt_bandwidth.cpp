@@ -37,11 +37,25 @@ uint64_t bandwidth_mode::get_bandwidth() const {
     return this->band_width;
 }
 
+void bandwidth_mode::set_overhead(uint32_t percent) {
+    if (percent < 5) {
+        percent = 5;
+    }
+    if (percent > 100) {
+        percent = 100;
+    }
+    this->overhead = percent;
+}
+
+uint32_t bandwidth_mode::get_overhead() const {
+    return this->overhead;
+}
+
 void max_set_bandwidth_mode::input_packet(uint16_t) {}
 
 void constant_rate_mode::input_packet(uint16_t size) {}
 void constant_rate_mode::set_bandwidth(uint64_t t) {
-    this->bandwidth() = static_cast<uint64_t>(t * 1.25 + 0.5);
+    this->bandwidth() = static_cast<uint64_t>(t * (100 + get_overhead()) / 100.0 + 0.5);
 }
 
 estimated_bandwidth_mode::estimated_bandwidth_mode() {
@@ -53,7 +67,7 @@ void estimated_bandwidth_mode::input_packet(uint16_t size) {
     std::lock_guard<std::mutex> lmtx(mtx);
     bytes += size;
     if (now - _last_input_time_point >= 1000 && _last_input_time_point) {
-        this->bandwidth() = static_cast<uint64_t>((double) bytes * 1.25);
+        this->bandwidth() = static_cast<uint64_t>((double) bytes * (100 + get_overhead()) / 100.0);
         bytes = 0;
         _last_input_time_point = now;
     }
@@ -71,3 +85,11 @@ uint64_t estimated_bandwidth_mode::get_bandwidth() const {
     Trace("get bandwidth {}", v);
     return v;
 }
+
+void estimated_bandwidth_mode::restore(uint64_t bytes_per_second) {
+    if (!bytes_per_second) {
+        return;
+    }
+    std::lock_guard<std::mutex> lmtx(mtx);
+    this->bandwidth() = bytes_per_second;
+}
@@ -25,6 +25,7 @@
 
 #ifndef TOOLKIT_SRT_BANDWIDTH_HPP
 #define TOOLKIT_SRT_BANDWIDTH_HPP
+#include <atomic>
 #include <cstdint>
 #include <mutex>
 /***
@@ -51,12 +52,16 @@ public:
     virtual void input_packet(uint16_t size) = 0;
     virtual void set_bandwidth(uint64_t);
     virtual uint64_t get_bandwidth() const;
+    /// OHEADBW, 在输入码率之上为重传保留的带宽百分比, 范围为5-100
+    void set_overhead(uint32_t percent);
+    uint32_t get_overhead() const;
 
 protected:
     uint64_t &bandwidth();
 
 private:
     uint64_t band_width = 1000000000 / 8;
+    std::atomic<uint32_t> overhead{25};
 };
 
 
@@ -78,6 +83,8 @@ public:
     ~estimated_bandwidth_mode() override = default;
     void input_packet(uint16_t size) override;
     uint64_t get_bandwidth() const override;
+    /// 重连时恢复上一次连接估计的输入码率, 不需要重新从默认值收敛
+    void restore(uint64_t bytes_per_second);
 
 private:
     mutable std::mutex mtx;
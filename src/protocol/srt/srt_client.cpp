@@ -26,15 +26,29 @@
 #include "impl/srt_client_impl.hpp"
 namespace srt {
 
-    srt_client::srt_client(const endpoint_type &host) {
-        _impl = std::make_shared<srt_client::impl>(event_poller_pool::Instance().get_poller(false), host);
+    srt_client::srt_client(const endpoint_type &host, bool multiplex) {
+        _impl = std::make_shared<srt_client::impl>(event_poller_pool::Instance().get_poller(false), host, multiplex);
         _impl->begin();
     }
 
+    srt_client::~srt_client() {
+        /// 发送队列投递到poller中的任务持有队列, 队列回调连接的方法; 最后一个引用交给poller释放
+        auto poller = _impl->get_poller();
+        poller->async([](const std::shared_ptr<impl> &) {}, std::move(_impl));
+    }
+
     void srt_client::set_max_payload(uint16_t length) {
         _impl->set_max_payload(length);
     }
 
+    void srt_client::set_min_payload(uint16_t length) {
+        _impl->set_min_payload(length);
+    }
+
+    void srt_client::set_path_mtu_discovery(bool on) {
+        _impl->set_path_mtu_discovery(on);
+    }
+
     void srt_client::set_max_window_size(uint16_t size) {
         _impl->set_max_flow_window_size(size);
     }
@@ -59,6 +73,46 @@ namespace srt {
         _impl->set_max_receive_time_out(ms);
     }
 
+    void srt_client::set_buffer_mode(bool on) {
+        _impl->set_buffer_mode(on);
+    }
+
+    void srt_client::set_send_coalesce_delay(uint32_t us) {
+        _impl->set_send_coalesce_delay(us);
+    }
+
+    void srt_client::set_max_bandwidth(uint64_t bytes_per_second) {
+        _impl->set_max_bandwidth(bytes_per_second);
+    }
+
+    void srt_client::set_input_bandwidth(uint64_t bytes_per_second) {
+        _impl->set_input_bandwidth(bytes_per_second);
+    }
+
+    void srt_client::set_overhead_bandwidth(uint32_t percent) {
+        _impl->set_overhead_bandwidth(percent);
+    }
+
+    void srt_client::set_max_reorder_tolerance(uint32_t packets) {
+        _impl->set_max_reorder_tolerance(packets);
+    }
+
+    void srt_client::set_kernel_pacing(bool on) {
+        _impl->set_kernel_pacing(on);
+    }
+
+    void srt_client::set_segmentation_offload(bool on) {
+        _impl->set_segmentation_offload(on);
+    }
+
+    void srt_client::set_reconnect(uint32_t max_attempts, uint32_t min_delay_ms, uint32_t max_delay_ms) {
+        _impl->set_reconnect(max_attempts, min_delay_ms, max_delay_ms);
+    }
+
+    void srt_client::set_on_reconnect(const std::function<void()> &f) {
+        _impl->set_on_reconnect(f);
+    }
+
     uint16_t srt_client::get_max_payload() const {
         return (uint16_t) _impl->get_max_payload();
     }
@@ -91,6 +145,46 @@ namespace srt {
         return _impl->get_max_receive_time_out();
     }
 
+    bool srt_client::buffer_mode() const {
+        return _impl->get_buffer_mode();
+    }
+
+    uint32_t srt_client::send_coalesce_delay() const {
+        return _impl->get_send_coalesce_delay();
+    }
+
+    uint64_t srt_client::max_bandwidth() const {
+        return _impl->get_max_bandwidth();
+    }
+
+    uint64_t srt_client::input_bandwidth() const {
+        return _impl->get_input_bandwidth();
+    }
+
+    uint32_t srt_client::overhead_bandwidth() const {
+        return _impl->get_overhead_bandwidth();
+    }
+
+    uint32_t srt_client::max_reorder_tolerance() const {
+        return _impl->get_max_reorder_tolerance();
+    }
+
+    bool srt_client::kernel_pacing() const {
+        return _impl->get_kernel_pacing();
+    }
+
+    uint32_t srt_client::reconnects() const {
+        return _impl->get_reconnects();
+    }
+
+    bool srt_client::fast_connected() const {
+        return _impl->get_fast_connected();
+    }
+
+    uint16_t srt_client::path_mtu() const {
+        return (uint16_t) _impl->get_path_mss();
+    }
+
     void srt_client::async_connect(const endpoint_type &remote, const std::function<void(const std::error_code &e)> &f) {
         _impl->async_connect(remote, f);
     }
@@ -103,4 +197,67 @@ namespace srt {
     int srt_client::async_send(const char *data, size_t length) {
         return _impl->async_send(data, length);
     }
+    int srt_client::async_send(const char *data, size_t length, std::error_code &e) {
+        return _impl->async_send(data, length, e);
+    }
+    int srt_client::async_send(const std::shared_ptr<buffer> &buff, std::error_code &e) {
+        return _impl->async_send(buff, e);
+    }
+    int srt_client::async_send_message(const char *data, size_t length, std::error_code &e) {
+        return _impl->async_send_message(data, length, e);
+    }
+    int srt_client::async_send_message(const std::shared_ptr<buffer> &buff, std::error_code &e) {
+        return _impl->async_send_message(buff, e);
+    }
+    void srt_client::set_on_receive_message(const std::function<void(const std::vector<std::shared_ptr<buffer>> &)> &f) {
+        return _impl->set_on_receive_message(f);
+    }
+    void srt_client::set_send_buffer_water_mark(uint32_t high, uint32_t low) {
+        return _impl->set_send_buffer_water_mark(high, low);
+    }
+    void srt_client::set_on_writable(const std::function<void()> &f) {
+        return _impl->set_on_writable(f);
+    }
+    uint64_t srt_client::send_buffered_bytes() const {
+        return _impl->get_send_buffered_bytes();
+    }
+    uint32_t srt_client::send_buffered_time() const {
+        return _impl->get_send_buffered_time();
+    }
+    uint32_t srt_client::reorder_tolerance() const {
+        return _impl->get_reorder_tolerance();
+    }
+    uint64_t srt_client::belated_packets() const {
+        return _impl->get_belated_packets();
+    }
+    bool srt_client::kernel_pacing_active() const {
+        return _impl->get_kernel_pacing_active();
+    }
+    bool srt_client::segmentation_offload_active() const {
+        return _impl->get_segmentation_offload_active();
+    }
+    double srt_client::send_bytes_per_syscall() const {
+        return _impl->get_send_bytes_per_syscall();
+    }
+    uint32_t srt_client::receive_delay() const {
+        return _impl->get_receive_delay();
+    }
+    const srt_client::endpoint_type &srt_client::local_endpoint() const {
+        return _impl->get_local_endpoint();
+    }
+    uint64_t srt_client::kernel_drops() const {
+        return _impl->get_kernel_drops();
+    }
+    uint64_t srt_client::lost_packets() const {
+        return _impl->get_lost_packets();
+    }
+    void srt_client::async_send_file(const std::string &path, const std::function<void(const std::error_code &)> &f) {
+        return _impl->async_send_file(path, f);
+    }
+    void srt_client::async_send_file(const std::shared_ptr<mapped_file> &file, size_t offset, size_t length, const std::function<void(const std::error_code &)> &f) {
+        return _impl->async_send_file(file, offset, length, f);
+    }
+    void srt_client::set_receive_fd(int fd) {
+        return _impl->set_receive_fd(fd);
+    }
 };// namespace srt
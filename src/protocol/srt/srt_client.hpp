@@ -34,13 +34,34 @@ namespace srt {
         class impl;
 
     public:
-        explicit srt_client(const endpoint_type &host = {asio::ip::udp::v4(), 0});
         /**
-         * @description 设置最大MTU, 最大不超过1500
+         * @param host      本地绑定的地址
+         * @param multiplex 同一个poller上绑定相同地址的客户端共用一个socket, 按照目的socket id分发收到的包, 发送时批量sendmmsg
+         *                  没有单独的socket和读操作, 不支持内核调度(set_kernel_pacing)
+         */
+        explicit srt_client(const endpoint_type &host = {asio::ip::udp::v4(), 0}, bool multiplex = false);
+        /**
+         * @description 连接在poller中释放, 不会和poller中正在执行的发送任务并发
+         */
+        ~srt_client();
+        /**
+         * @description 设置最大MTU, 最大不超过9000, 握手时取两端的较小值
          * @default     默认值为1500
          * @param length MTU length
          */
         void set_max_payload(uint16_t length);
+        /**
+         * @description 设置路径MTU探测的起点, 认为路径一定能够通过的MTU
+         * @default     默认值为1500
+         * @param length MTU length
+         */
+        void set_min_payload(uint16_t length);
+        /**
+         * @description 连接之后从最小MTU开始探测路径MTU, 确认之后增大负载, 不超过协商的MTU
+         *              多个客户端共用socket时不支持, 使用最小MTU
+         * @default     默认不开启
+         */
+        void set_path_mtu_discovery(bool on);
         /**
          * @desciption 设置滑动窗口大小
          * @default    默认窗口大小为8192
@@ -76,6 +97,70 @@ namespace srt {
          * @param ms    单位为ms
          */
         void set_max_receive_time_out(uint32_t ms);
+        /**
+         * @description 设置文件传输模式(buffer mode), 不丢包, 使用文件拥塞控制
+         * @default     默认为live模式
+         * @param on    true为文件模式
+         */
+        void set_buffer_mode(bool on);
+        /**
+         * @description 开启小包合并, 连续的小数据(如188字节的TS包)合并成不超过最大负载的包发送
+         *              凑满一个包或者等待超过us微秒后发送, 可以成倍减少包的数量、ACK/NAK和系统调用
+         * @default     0, 不合并
+         * @param us    最大等待时间(微秒)
+         */
+        void set_send_coalesce_delay(uint32_t us);
+        /**
+         * @description 设置最大发送带宽(MAXBW), 连接之后也可以修改
+         * @default     0, 不限制, 由输入码率决定
+         * @param bytes_per_second 字节/秒
+         */
+        void set_max_bandwidth(uint64_t bytes_per_second);
+        /**
+         * @description 设置输入码率(INPUTBW), 发送带宽为输入码率加上重传开销, 连接之后也可以修改
+         * @default     0, 根据写入的数据估计输入码率
+         * @param bytes_per_second 字节/秒
+         */
+        void set_input_bandwidth(uint64_t bytes_per_second);
+        /**
+         * @description 设置重传开销(OHEADBW), 重传占用的带宽不超过输入码率的percent%, 连接之后也可以修改
+         * @default     25
+         * @param percent 5-100
+         */
+        void set_overhead_bandwidth(uint32_t percent);
+        /**
+         * @description 设置最大乱序容忍度(LOSSMAXTTL), 空洞之后到达的包少于容忍度时暂不发送NAK
+         *              容忍度从0开始, 原始包在NAK之后才到达时增大到实际的乱序距离, 连续按序到达后逐渐降低
+         * @default     10
+         * @param packets 包数量, 0为立即上报丢包
+         */
+        void set_max_reorder_tolerance(uint32_t packets);
+        /**
+         * @description 由内核按照每个包的发送时间点调度(SO_TXTIME), 固定码率时同时设置SO_MAX_PACING_RATE
+         *              需要网卡上配置fq qdisc, socket不支持时回退到用户态定时器, 需要在连接之前设置
+         * @default     false
+         */
+        void set_kernel_pacing(bool on);
+        /**
+         * @description 一次调度连续发送的等长数据包合并成一次UDP_SEGMENT(GSO)发送, socket不支持时逐个发送
+         *              需要在连接之前设置
+         * @default     true
+         */
+        void set_segmentation_offload(bool on);
+        /**
+         * @description 连接建立之后断开(读超时、对端关闭、socket错误)时自动重连, 等待时间按指数退避并加入随机抖动
+         *              重连到同一个服务端时使用上一次连接的cookie直接发送conclusion, 并恢复RTT、发送码率和拥塞窗口
+         *              被对端拒绝或者连续失败max_attempts次后回调on_error
+         * @default     max_attempts为0, 不重连
+         * @param max_attempts 连续重连的最大次数
+         * @param min_delay_ms 第一次重连前的最大等待时间(ms), 之后每次翻倍
+         * @param max_delay_ms 等待时间的上限(ms)
+         */
+        void set_reconnect(uint32_t max_attempts, uint32_t min_delay_ms = 100, uint32_t max_delay_ms = 2000);
+        /**
+         * @description 重连成功的回调, 在executor线程中执行
+         */
+        void set_on_reconnect(const std::function<void()> &f);
         /**
          * @description 得到最大payload
          */
@@ -108,11 +193,145 @@ namespace srt {
          * @description 最大读超时
          */
         uint32_t max_receive_time_out() const;
+        /**
+         * @description 是否为文件传输模式
+         */
+        bool buffer_mode() const;
+        /**
+         * @description 小包合并的最大等待时间(微秒)
+         */
+        uint32_t send_coalesce_delay() const;
+        /**
+         * @description 最大发送带宽(字节/秒)
+         */
+        uint64_t max_bandwidth() const;
+        /**
+         * @description 输入码率(字节/秒)
+         */
+        uint64_t input_bandwidth() const;
+        /**
+         * @description 重传开销百分比
+         */
+        uint32_t overhead_bandwidth() const;
+        /**
+         * @description 最大乱序容忍度
+         */
+        uint32_t max_reorder_tolerance() const;
+        /**
+         * @description 是否开启了内核调度
+         */
+        bool kernel_pacing() const;
+        /**
+         * @description 成功重连的次数
+         */
+        uint32_t reconnects() const;
+        /**
+         * @description 当前连接是否使用缓存的cookie跳过了induction
+         */
+        bool fast_connected() const;
+        /**
+         * @description 当前使用的MTU, 开启路径MTU探测时为已经确认的大小, 连接之前为0
+         */
+        uint16_t path_mtu() const;
 
         void async_connect(const endpoint_type &remote, const std::function<void(const std::error_code &e)> &f);
         void set_on_error(const std::function<void(const std::error_code &)> &f);
         void set_on_receive(const std::function<void(const std::shared_ptr<buffer> &)> &f);
         int async_send(const char *data, size_t length);
+        /**
+         * @description 发送数据, 返回0时e为send_buffer_full, 需要等待on_writable回调
+         * @return      写入的字节数, -1表示未连接
+         */
+        int async_send(const char *data, size_t length, std::error_code &e);
+        /**
+         * @description 发送数据, 不拷贝负载, 超过最大负载时切分成多个包, 发送和重传都引用buff的内存
+         *              同一个buff可以发送给多个连接, 每个连接只生成自己的包头
+         */
+        int async_send(const std::shared_ptr<buffer> &buff, std::error_code &e);
+        /**
+         * @description 发送一个完整的消息, 按最大负载分片, 对端整体交付, 任意分片丢失则整个消息被丢弃
+         * @return      消息长度; 0表示发送缓冲区不足(send_buffer_full); -1表示未连接或者消息超过发送窗口
+         */
+        int async_send_message(const char *data, size_t length, std::error_code &e);
+        /**
+         * @description 发送一个完整的消息, 分片直接引用buff的内存
+         */
+        int async_send_message(const std::shared_ptr<buffer> &buff, std::error_code &e);
+        /**
+         * @description 多个分片组成的消息完整到达时回调, 分片按顺序排列, 不做拷贝
+         *              未设置时拼接成一个buffer回调on_receive, 单包消息始终回调on_receive
+         */
+        void set_on_receive_message(const std::function<void(const std::vector<std::shared_ptr<buffer>> &)> &f);
+        /**
+         * @description 设置发送缓冲区的高低水位, 超过高水位async_send返回0
+         * @default     high为0, 不限制
+         * @param high  高水位(字节)
+         * @param low   低水位(字节), 为0时取高水位的一半
+         */
+        void set_send_buffer_water_mark(uint32_t high, uint32_t low = 0);
+        /**
+         * @description 发送缓冲区降到低水位以下时回调, 在executor线程中执行
+         */
+        void set_on_writable(const std::function<void()> &f);
+        /**
+         * @description 发送缓冲区中未被确认的字节数
+         */
+        uint64_t send_buffered_bytes() const;
+        /**
+         * @description 发送缓冲区中最早的数据已经缓存的时间(ms), 编码器可据此调整码率
+         */
+        uint32_t send_buffered_time() const;
+        /**
+         * @description 当前的乱序容忍度(包数量)
+         */
+        uint32_t reorder_tolerance() const;
+        /**
+         * @description 在NAK之后才到达的原始包数量, 即多余的重传
+         */
+        uint64_t belated_packets() const;
+        /**
+         * @description 当前是否由内核调度发送, 不支持时为false
+         */
+        bool kernel_pacing_active() const;
+        /**
+         * @description 当前是否使用UDP_SEGMENT合并发送
+         */
+        bool segmentation_offload_active() const;
+        /**
+         * @description 平均每次发送系统调用写出的字节数
+         */
+        double send_bytes_per_syscall() const;
+        /**
+         * @description 内核收到数据报到协议栈处理之间的平均延迟(us), 内核不支持接收时间戳时为0
+         */
+        uint32_t receive_delay() const;
+        /**
+         * @description 本地绑定的地址, 复用的客户端返回共用socket的地址
+         */
+        const endpoint_type &local_endpoint() const;
+        /**
+         * @description 内核接收队列溢出丢弃的包数量, 检测到时自动增大socket缓冲区
+         */
+        uint64_t kernel_drops() const;
+        /**
+         * @description 网络丢包数量, 不包含内核丢弃的包
+         */
+        uint64_t lost_packets() const;
+        /**
+         * @description 发送文件, 文件被映射到内存, 包直接引用映射的页
+         * @param path  文件路径
+         * @param f     全部数据被对端确认或者出错后回调
+         */
+        void async_send_file(const std::string &path, const std::function<void(const std::error_code &)> &f);
+        /**
+         * @description 发送已经映射的文件区域
+         */
+        void async_send_file(const std::shared_ptr<mapped_file> &file, size_t offset, size_t length, const std::function<void(const std::error_code &)> &f);
+        /**
+         * @description 按序收到的数据合并后直接写入fd, 设置后不再回调on_receive
+         * @param fd    文件描述符, 由调用者负责关闭
+         */
+        void set_receive_fd(int fd);
 
     private:
         std::shared_ptr<impl> _impl;
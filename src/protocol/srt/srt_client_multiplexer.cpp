@@ -0,0 +1,309 @@
+﻿/*
+* @file_name: srt_client_multiplexer.cpp
+* @date: 2026/10/19
+* @author: shen hao
+* Copyright @ hz shen hao, All rights reserved.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+#include "srt_client_multiplexer.hpp"
+#include "impl/srt_client_impl.hpp"
+#include "net/buffer_pool.hpp"
+#include "spdlog/logger.hpp"
+#include "srt_packet.h"
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <mutex>
+#include <random>
+#include <system_error>
+namespace srt {
+    /// 每个poller上的复用器, 按照请求绑定的地址区分
+    static std::mutex multiplexer_mtx;
+    static std::unordered_map<event_poller *, std::vector<std::weak_ptr<srt_client_multiplexer>>> multiplexers;
+
+    constexpr size_t srt_client_multiplexer::max_batch;
+    constexpr size_t srt_client_multiplexer::max_datagram_size;
+
+    srt_client_multiplexer::srt_client_multiplexer(const event_poller::Ptr &poller, const endpoint_type &host) : _poller(poller), _host(host), _sock(poller->get_executor()) {
+        _sock.open(host.protocol());
+        _sock.bind(host);
+        _sock.native_non_blocking(true);
+        _local = _sock.local_endpoint();
+        /// 之后每秒按照所有客户端的带宽时延积调整
+        _sock_buffer.update(_sock.native_handle(), 0);
+        _receive_offload = udp_offload::enable_gro(_sock.native_handle());
+        /// 用内核接收时间计算RTT和带宽, 不受poller排队延迟的影响
+        _receive_control = udp_offload::enable_receive_timestamp(_sock.native_handle());
+        /// 区分内核丢包和网络丢包
+        _receive_control = socket_buffer::enable_drop_counter(_sock.native_handle()) || _receive_control;
+        _batch_buffer.reset(new char[max_batch * max_datagram_size]);
+        _batch_endpoints.resize(max_batch);
+        _batch.reserve(max_batch);
+    }
+
+    std::shared_ptr<srt_client_multiplexer> srt_client_multiplexer::get(const event_poller::Ptr &poller, const endpoint_type &host) {
+        std::lock_guard<std::mutex> lock(multiplexer_mtx);
+        auto &list = multiplexers[poller.get()];
+        for (auto it = list.begin(); it != list.end();) {
+            auto multiplexer = it->lock();
+            if (!multiplexer) {
+                it = list.erase(it);
+                continue;
+            }
+            if (multiplexer->_host == host) {
+                return multiplexer;
+            }
+            ++it;
+        }
+        auto multiplexer = std::make_shared<srt_client_multiplexer>(poller, host);
+        list.push_back(multiplexer);
+        Info("srt client multiplexer bind on {}:{}", multiplexer->_local.address().to_string(), multiplexer->_local.port());
+        std::weak_ptr<srt_client_multiplexer> self(multiplexer);
+        poller->async([self, poller]() {
+            auto stronger_self = self.lock();
+            if (!stronger_self) {
+                return;
+            }
+            stronger_self->read_l();
+            poller->do_delay_task(std::chrono::milliseconds(1000), [self]() -> size_t {
+                auto stronger_self = self.lock();
+                if (!stronger_self) {
+                    return 0;
+                }
+                stronger_self->update_socket_buffer();
+                return 1000;
+            });
+        });
+        return multiplexer;
+    }
+
+    const srt_client_multiplexer::endpoint_type &srt_client_multiplexer::get_local_endpoint() const {
+        return _local;
+    }
+
+    int srt_client_multiplexer::native_handle() {
+        return _sock.native_handle();
+    }
+
+    uint32_t srt_client_multiplexer::add(const std::shared_ptr<srt_client::impl> &client) {
+        std::default_random_engine random(std::random_device{}());
+        std::uniform_int_distribution<uint32_t> dist(1, (std::numeric_limits<int32_t>::max)());
+        uint32_t sock_id = 0;
+        do {
+            sock_id = dist(random);
+        } while (_clients.find(sock_id) != _clients.end());
+        _clients.emplace(sock_id, client);
+        /// 协商的mss不超过客户端配置的mss
+        _receive_size = std::max(_receive_size, client->get_receive_size());
+        return sock_id;
+    }
+
+    void srt_client_multiplexer::remove(uint32_t sock_id) {
+        _clients.erase(sock_id);
+    }
+
+    size_t srt_client_multiplexer::size() const {
+        return _clients.size();
+    }
+
+    void srt_client_multiplexer::send(const asio::const_buffer *buffers, size_t count, const endpoint_type &to) {
+        size_t size = 0;
+        for (size_t i = 0; i < count; i++) {
+            size += buffers[i].size();
+        }
+        if (!_poller->is_current_thread() || size > max_datagram_size) {
+            std::error_code e;
+            _sock.send_to(std::vector<asio::const_buffer>(buffers, buffers + count), to, 0, e);
+            _send_syscalls.fetch_add(1, std::memory_order_relaxed);
+            _send_datagrams.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        auto index = _batch.size();
+        auto slot = _batch_buffer.get() + index * max_datagram_size;
+        size_t offset = 0;
+        for (size_t i = 0; i < count; i++) {
+            memcpy(slot + offset, buffers[i].data(), buffers[i].size());
+            offset += buffers[i].size();
+        }
+        _batch_endpoints[index] = to;
+        udp_datagram datagram;
+        datagram.data = slot;
+        datagram.size = size;
+        datagram.to = _batch_endpoints[index].data();
+        datagram.to_size = _batch_endpoints[index].size();
+        _batch.push_back(datagram);
+        if (_batch.size() == max_batch) {
+            return flush();
+        }
+        if (_flush_scheduled) {
+            return;
+        }
+        /// 排在本轮已经就绪的任务之后, 同一轮中所有客户端的数据报一起发送
+        _flush_scheduled = true;
+        std::weak_ptr<srt_client_multiplexer> self(shared_from_this());
+        asio::post(_poller->get_executor(), [self]() {
+            if (auto stronger_self = self.lock()) {
+                stronger_self->flush();
+            }
+        });
+    }
+
+    bool srt_client_multiplexer::send_segments(const asio::const_buffer *buffers, size_t count, uint16_t segment_size, const endpoint_type &to, std::error_code &e) {
+        flush();
+        auto ret = udp_offload::send_segments(_sock.native_handle(), buffers, count, segment_size, to.data(), to.size(), e);
+        if (e && udp_offload::is_unsupported(e)) {
+            return false;
+        }
+        _send_syscalls.fetch_add(1, std::memory_order_relaxed);
+        if (ret > 0) {
+            _send_datagrams.fetch_add((ret + segment_size - 1) / segment_size, std::memory_order_relaxed);
+        }
+        return true;
+    }
+
+    void srt_client_multiplexer::flush() {
+        _flush_scheduled = false;
+        if (_batch.empty()) {
+            return;
+        }
+        std::error_code e;
+        auto sent = udp_offload::send_batch(_sock.native_handle(), _batch.data(), _batch.size(), e);
+        if (sent >= 0) {
+            _send_syscalls.fetch_add(1, std::memory_order_relaxed);
+        } else {
+            /// 不支持sendmmsg时逐个发送
+            sent = 0;
+            for (size_t i = 0; i < _batch.size(); i++) {
+                _sock.send_to(asio::buffer(_batch[i].data, _batch[i].size), _batch_endpoints[i], 0, e);
+                _send_syscalls.fetch_add(1, std::memory_order_relaxed);
+                if (e && (e == asio::error::would_block || e == asio::error::try_again)) {
+                    break;
+                }
+                ++sent;
+            }
+        }
+        _send_datagrams.fetch_add(sent, std::memory_order_relaxed);
+        /// 发送缓冲区满时剩余的数据报当作丢包处理, 由重传恢复
+        if (e && e != asio::error::would_block && e != asio::error::try_again) {
+            Warn("srt client multiplexer send failed, {}", e.message());
+        }
+        _batch.clear();
+    }
+
+    double srt_client_multiplexer::get_datagrams_per_syscall() const {
+        auto syscalls = _send_syscalls.load(std::memory_order_relaxed);
+        return syscalls ? (double) _send_datagrams.load(std::memory_order_relaxed) / (double) syscalls : 0;
+    }
+
+    uint64_t srt_client_multiplexer::get_kernel_drops() const {
+        return _kernel_drops.load(std::memory_order_relaxed);
+    }
+
+    void srt_client_multiplexer::read_l() {
+        std::weak_ptr<srt_client_multiplexer> self(shared_from_this());
+        _sock.async_wait(asio::ip::udp::socket::wait_read, [self](const std::error_code &e) {
+            auto stronger_self = self.lock();
+            if (!stronger_self || e) {
+                return;
+            }
+            stronger_self->receive_l();
+            return stronger_self->read_l();
+        });
+    }
+
+    void srt_client_multiplexer::receive_l() {
+        auto &pool = buffer_pool::this_thread();
+        /// 一次唤醒最多读取的次数, 避免长时间占用poller
+        for (int i = 0; i < 64; i++) {
+            std::error_code e;
+            /// 每个数据报读到池中独立的buffer里, 交付给应用层时不再拷贝
+            endpoint_type from;
+            if (!_receive_offload && !_receive_control) {
+                auto buff = pool.obtain(_receive_size);
+                buff->resize(_receive_size);
+                buff->backward();
+                auto length = _sock.receive_from(asio::buffer((char *) buff->data(), buff->size()), from, 0, e);
+                if (e) {
+                    return;
+                }
+                buff->resize(length);
+                buff->backward();
+                on_receive(buff, from, {}, 0);
+                continue;
+            }
+            auto on_segment = [&](const std::shared_ptr<buffer> &segment, const udp_receive_info &info) {
+                /// 内核丢包归属到之后第一个到达的包
+                uint32_t drops = 0;
+                if (info.drop_counter) {
+                    drops = _sock_buffer.on_drop_counter(_sock.native_handle(), info.drop_counter);
+                    _kernel_drops.fetch_add(drops, std::memory_order_relaxed);
+                }
+                on_receive(segment, from, info.arrival, drops);
+            };
+            if (udp_offload::receive_segments(_sock.native_handle(), pool, _receive_size, _receive_offload, &from, e, on_segment) < 0) {
+                return;
+            }
+        }
+    }
+
+    void srt_client_multiplexer::on_receive(const std::shared_ptr<buffer> &buff, const endpoint_type &from, const std::chrono::steady_clock::time_point &arrival, uint32_t kernel_drops) {
+        try {
+            auto pkt = from_buffer(buff->data(), buff->size());
+            auto it = _clients.find(pkt->get_socket_id());
+            if (it == _clients.end()) {
+                Trace("no client with socket id={}, ignore it", pkt->get_socket_id());
+                return;
+            }
+            auto client = it->second.lock();
+            if (!client) {
+                _clients.erase(it);
+                return;
+            }
+            if (!(from == client->get_remote_endpoint())) {
+                Trace("packet for socket id={} from {}:{} is not from the peer, ignore it", pkt->get_socket_id(), from.address().to_string(), from.port());
+                return;
+            }
+            pkt->set_arrival_time(arrival);
+            pkt->set_kernel_drops(kernel_drops);
+            buff->remove(16);
+            client->receive_multiplexed(pkt, buff);
+        } catch (const std::system_error &e) {
+            Error("catch exception, code={}, msg={}", e.code().value(), e.what());
+        }
+    }
+
+    void srt_client_multiplexer::update_socket_buffer() {
+        uint64_t bandwidth_delay_product = 0;
+        uint32_t receive_size = 1500;
+        for (auto it = _clients.begin(); it != _clients.end();) {
+            auto client = it->second.lock();
+            if (!client) {
+                it = _clients.erase(it);
+                continue;
+            }
+            bandwidth_delay_product += client->get_bandwidth_delay_product();
+            receive_size = std::max(receive_size, client->get_receive_size());
+            ++it;
+        }
+        /// 配置了巨帧的客户端释放之后缩小
+        _receive_size = receive_size;
+        _sock_buffer.update(_sock.native_handle(), bandwidth_delay_product);
+    }
+}// namespace srt
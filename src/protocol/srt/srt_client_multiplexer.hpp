@@ -0,0 +1,109 @@
+﻿/*
+* @file_name: srt_client_multiplexer.hpp
+* @date: 2026/10/19
+* @author: shen hao
+* Copyright @ hz shen hao, All rights reserved.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+
+#ifndef TOOLKIT_SRT_CLIENT_MULTIPLEXER_HPP
+#define TOOLKIT_SRT_CLIENT_MULTIPLEXER_HPP
+#include "Util/nocopyable.hpp"
+#include "asio.hpp"
+#include "net/buffer.hpp"
+#include "net/event_poller.hpp"
+#include "net/socket_buffer.hpp"
+#include "net/udp_offload.hpp"
+#include "srt_client.hpp"
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+namespace srt {
+    //// 同一个poller上的多个客户端共用一个绑定的UDP socket
+    //// 收包: 只有一个等待读的socket, 和srt_server一样按照目的socket id分发到客户端
+    //// 发包: 数据报拷贝到批量缓存, 本轮poller任务结束或者缓存满时一次sendmmsg发出
+    //// 除了get和send之外的接口只能在poller线程调用
+    class srt_client_multiplexer : public std::enable_shared_from_this<srt_client_multiplexer>, public noncopyable {
+    public:
+        using endpoint_type = asio::ip::udp::endpoint;
+        /// 批量缓存的数据报数量和每个数据报的最大长度, 更大的数据报(巨帧)直接发送
+        static constexpr size_t max_batch = udp_offload::max_segments;
+        static constexpr size_t max_datagram_size = 1500;
+
+    public:
+        srt_client_multiplexer(const event_poller::Ptr &poller, const endpoint_type &host);
+        /// poller上绑定host的复用器, 没有时创建并开始读; 所有客户端释放之后关闭socket
+        static std::shared_ptr<srt_client_multiplexer> get(const event_poller::Ptr &poller, const endpoint_type &host);
+
+    public:
+        /// 实际绑定的地址
+        const endpoint_type &get_local_endpoint() const;
+        int native_handle();
+        /// 注册客户端, 返回复用器内唯一的socket id, 对端发来的包以它为目的socket id
+        uint32_t add(const std::shared_ptr<srt_client::impl> &client);
+        void remove(uint32_t sock_id);
+        /// 注册的客户端数量
+        size_t size() const;
+        /// 拷贝数据报到批量缓存, 不在poller线程时直接发送
+        void send(const asio::const_buffer *buffers, size_t count, const endpoint_type &to);
+        /// 通过UDP_SEGMENT发送, 先发出缓存中的数据报保证同一个客户端的包不乱序
+        /// 返回false表示不支持分段卸载
+        bool send_segments(const asio::const_buffer *buffers, size_t count, uint16_t segment_size, const endpoint_type &to, std::error_code &e);
+        /// 一次sendmmsg发出缓存中所有的数据报
+        void flush();
+        /// 平均每次发送系统调用发出的数据报数量
+        double get_datagrams_per_syscall() const;
+        /// 内核接收队列溢出丢弃的数据报数量
+        uint64_t get_kernel_drops() const;
+
+    private:
+        void read_l();
+        /// 读取socket中所有可读的数据报, GRO合并的数据报按照分段大小拆分
+        void receive_l();
+        /// 按照目的socket id分发, 源地址不是该客户端的对端时丢弃, 避免其他地址伪造socket id注入数据或者关闭连接
+        void on_receive(const std::shared_ptr<buffer> &buff, const endpoint_type &from, const std::chrono::steady_clock::time_point &arrival, uint32_t kernel_drops);
+        /// 按照所有客户端的带宽时延积之和调整socket缓冲区, 同时清理已经释放的客户端并重新计算接收缓冲区大小
+        void update_socket_buffer();
+
+    private:
+        event_poller::Ptr _poller;
+        endpoint_type _host;
+        endpoint_type _local;
+        asio::ip::udp::socket _sock;
+        socket_buffer _sock_buffer;
+        bool _receive_offload = false;
+        /// 开启了内核接收时间戳或者丢包计数, 需要通过recvmsg读取控制消息
+        bool _receive_control = false;
+        /// 一个数据报的接收缓冲区大小, 取所有客户端配置的mss中最大的一个
+        uint32_t _receive_size = 1500;
+        std::unordered_map<uint32_t, std::weak_ptr<srt_client::impl>> _clients;
+        /// 批量发送缓存, 只在poller线程访问
+        std::unique_ptr<char[]> _batch_buffer;
+        std::vector<endpoint_type> _batch_endpoints;
+        std::vector<udp_datagram> _batch;
+        bool _flush_scheduled = false;
+        std::atomic<uint64_t> _send_syscalls{0};
+        std::atomic<uint64_t> _send_datagrams{0};
+        std::atomic<uint64_t> _kernel_drops{0};
+    };
+}// namespace srt
+#endif//TOOLKIT_SRT_CLIENT_MULTIPLEXER_HPP
@@ -72,6 +72,16 @@ bool file_congestion::slow_starting() const {
     return in_slow_start.load(std::memory_order_relaxed);
 }
 
+void file_congestion::restore(double send_period, uint32_t cwnd) {
+    if (send_period <= 0 || cwnd == 0) {
+        return;
+    }
+    _pkt_send_period = send_period;
+    last_dec_period = send_period;
+    cwnd_size.store(cwnd, std::memory_order_relaxed);
+    in_slow_start.store(false, std::memory_order_relaxed);
+}
+
 void file_congestion::rexmit_pkt_event(bool is_nak, uint32_t begin, uint32_t end) {
     /// slow start phase ends
     /// set the pkt sending period pkt_snd_period  in step 5 of section(1)
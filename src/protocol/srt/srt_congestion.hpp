@@ -65,6 +65,8 @@ public:
     double get_send_period() const override;
     uint32_t get_cwnd_window() const override;
     bool slow_starting() const override;
+    /// 重连时恢复上一次连接的发送间隔和拥塞窗口, 直接进入拥塞避免阶段
+    void restore(double send_period, uint32_t cwnd);
 
     void rexmit_pkt_event(bool is_nak, uint32_t begin, uint32_t end) override;
     void ack_sequence_to(uint32_t seq, uint32_t receive_rate, uint32_t link_capacity) override;
@@ -66,6 +66,10 @@ namespace srt {
                 return "peer has lost connection";
             case peer_has_terminated_connection:
                 return "peer active terminated connection";
+            case send_buffer_full:
+                return "send buffer is full, wait for writable";
+            case too_large_message:
+                return "too large message, which fragments exceed the send window";
         }
         return "unknown";
     }
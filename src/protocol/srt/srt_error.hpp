@@ -46,6 +46,8 @@ namespace srt {
         socket_shutdown_op,            /// 主动断开连接
         lost_peer_connection,          /// 对端主动断开连接
         peer_has_terminated_connection,/// 对端主动关闭了连接
+        send_buffer_full,              /// 发送缓冲区超过高水位
+        too_large_message,             /// 消息的分片数超过发送窗口
     };
 
     class srt_category : public std::error_category {
@@ -156,7 +156,7 @@ namespace srt {
         }
     }
 
-    size_t set_extension(handshake_context &ctx, const std::shared_ptr<buffer> &buf, uint16_t ts, bool drop, bool nak, uint16_t sender_ts, const std::string &stream_id) {
+    size_t set_extension(handshake_context &ctx, const std::shared_ptr<buffer> &buf, uint16_t ts, bool drop, bool nak, uint16_t sender_ts, const std::string &stream_id, bool buffer_mode) {
         auto origin_size = buf->size();
         auto space = 20 + (stream_id.size() + 3) / 4;
         buf->reserve(space);
@@ -180,17 +180,21 @@ namespace srt {
         if (drop)
             flags |= static_cast<uint32_t>(TLPKTDROP);
         else
-            flags ^= static_cast<uint32_t>(TLPKTDROP);
+            flags &= ~static_cast<uint32_t>(TLPKTDROP);
 
         /// set nak report
         if (nak)
             flags |= static_cast<uint32_t>(PERIODICNAK);
         else
-            flags ^= static_cast<uint32_t>(PERIODICNAK);
+            flags &= ~static_cast<uint32_t>(PERIODICNAK);
 
         /// set transmit
         flags |= static_cast<uint32_t>(REXMITFLG);
 
+        /// buffer mode
+        if (buffer_mode)
+            flags |= static_cast<uint32_t>(STREAM);
+
         //// MUST set
         flags |= static_cast<uint32_t>(PACKET_FILTER);
         flags |= static_cast<uint32_t>(CRYPT);
@@ -0,0 +1,83 @@
+﻿/*
+* @file_name: srt_message.cpp
+* @date: 2026/10/19
+* @author: shen hao
+* Copyright @ hz shen hao, All rights reserved.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+#include "srt_message.hpp"
+#include "spdlog/logger.hpp"
+namespace srt {
+    void srt_message_assembler::reset(uint32_t next_seq, uint32_t max_seq) {
+        _fragments.clear();
+        _message_number = 0;
+        _next_seq = next_seq;
+        _max_seq = max_seq;
+    }
+
+    bool srt_message_assembler::input(uint32_t seq, uint8_t position, uint32_t message_number, const std::shared_ptr<buffer> &pkt, fragments &out) {
+        if (seq != _next_seq) {
+            drop();
+        }
+        _next_seq = (seq + 1) % _max_seq;
+
+        switch (position) {
+            /// 首包
+            case 0b10:
+                drop();
+                _message_number = message_number;
+                _fragments.emplace_back(pkt);
+                return false;
+            /// 中间包和尾包
+            case 0b00:
+            case 0b01:
+                if (_fragments.empty() || _message_number != message_number) {
+                    Debug("discard fragment of incomplete message, seq={}, message_number={}", seq, message_number);
+                    return false;
+                }
+                _fragments.emplace_back(pkt);
+                if (position == 0b00) {
+                    return false;
+                }
+                out.clear();
+                out.swap(_fragments);
+                return true;
+            /// 单包
+            default:
+                drop();
+                out.clear();
+                out.emplace_back(pkt);
+                return true;
+        }
+    }
+
+    uint64_t srt_message_assembler::get_dropped_messages() const {
+        return _dropped;
+    }
+
+    void srt_message_assembler::drop() {
+        if (_fragments.empty()) {
+            return;
+        }
+        Warn("drop incomplete message, message_number={}, received fragments={}", _message_number, _fragments.size());
+        _fragments.clear();
+        ++_dropped;
+    }
+}// namespace srt
@@ -0,0 +1,59 @@
+﻿/*
+* @file_name: srt_message.hpp
+* @date: 2026/10/19
+* @author: shen hao
+* Copyright @ hz shen hao, All rights reserved.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+
+#ifndef TOOLKIT_SRT_MESSAGE_HPP
+#define TOOLKIT_SRT_MESSAGE_HPP
+#include "net/buffer.hpp"
+#include <cstdint>
+#include <memory>
+#include <vector>
+namespace srt {
+    /// 消息模式的重组: 接收队列按序交付的包, 按位置标志(首包0b10, 中间包0b00, 尾包0b01, 单包0b11)拼成完整的消息
+    /// 序号不连续说明中间的包已经被丢弃, 正在重组的消息整体丢弃, 不会交付不完整的消息
+    class srt_message_assembler {
+    public:
+        using fragments = std::vector<std::shared_ptr<buffer>>;
+
+    public:
+        /// next_seq为下一个应该交付的序号, 序号在max_seq处回绕
+        void reset(uint32_t next_seq, uint32_t max_seq);
+        /// 输入按序交付的包, 消息完整时返回true, 分片按顺序放入out; 单包消息out中只有一个元素
+        bool input(uint32_t seq, uint8_t position, uint32_t message_number, const std::shared_ptr<buffer> &pkt, fragments &out);
+        /// 因为空洞整体丢弃的消息数量
+        uint64_t get_dropped_messages() const;
+
+    private:
+        void drop();
+
+    private:
+        fragments _fragments;
+        uint32_t _message_number = 0;
+        uint32_t _next_seq = 0;
+        uint32_t _max_seq = 0x7FFFFFFF;
+        uint64_t _dropped = 0;
+    };
+}// namespace srt
+
+#endif//TOOLKIT_SRT_MESSAGE_HPP
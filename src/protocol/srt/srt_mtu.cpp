@@ -0,0 +1,87 @@
+﻿/*
+* @file_name: srt_mtu.cpp
+* @date: 2026/10/19
+* @author: shen hao
+* Copyright @ hz shen hao, All rights reserved.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+#include "srt_mtu.hpp"
+namespace srt {
+    constexpr uint32_t srt_mtu_search::header_size;
+    constexpr uint32_t srt_mtu_search::max_probes;
+    constexpr uint32_t srt_mtu_search::granularity;
+    constexpr uint32_t srt_mtu_search::min_probe_timeout;
+    constexpr uint32_t srt_mtu_search::raise_interval;
+
+    void srt_mtu_search::reset(uint32_t min_mss, uint32_t max_mss) {
+        this->low = min_mss < max_mss ? min_mss : max_mss;
+        this->high = max_mss;
+        this->max_mss = max_mss;
+        /// 大部分路径能够通过允许的最大值, 第一次直接探测它
+        this->probing = high > low ? high : 0;
+        this->probes = 0;
+    }
+
+    uint32_t srt_mtu_search::next_probe() {
+        if (!probing) {
+            if (high - low < granularity) {
+                high = low;
+                return 0;
+            }
+            probing = low + (high - low + 1) / 2;
+        }
+        ++probes;
+        return probing;
+    }
+
+    bool srt_mtu_search::on_probe_ack(uint32_t mss) {
+        /// 过期的回复或者超出范围
+        if (mss <= low || mss > high) {
+            return false;
+        }
+        low = mss;
+        if (probing <= mss) {
+            probing = 0;
+            probes = 0;
+        }
+        return true;
+    }
+
+    void srt_mtu_search::on_probe_timeout() {
+        if (!probing || !probes || probes < max_probes) {
+            return;
+        }
+        high = probing - 1;
+        probing = 0;
+        probes = 0;
+    }
+
+    uint32_t srt_mtu_search::get_mss() const {
+        return low;
+    }
+
+    uint32_t srt_mtu_search::get_max_mss() const {
+        return max_mss;
+    }
+
+    bool srt_mtu_search::is_done() const {
+        return high <= low;
+    }
+}// namespace srt
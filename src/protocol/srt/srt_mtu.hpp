@@ -0,0 +1,70 @@
+﻿/*
+* @file_name: srt_mtu.hpp
+* @date: 2026/10/19
+* @author: shen hao
+* Copyright @ hz shen hao, All rights reserved.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+
+#ifndef TOOLKIT_SRT_MTU_HPP
+#define TOOLKIT_SRT_MTU_HPP
+#include <cstdint>
+namespace srt {
+    /// 路径MTU搜索(PLPMTUD, RFC 8899): 在确认可用的mss和允许的最大mss之间查找路径能通过的最大包
+    /// 先直接探测最大值, 失败之后二分查找; 同一个大小连续max_probes次没有回复, 认为超过了路径MTU
+    /// 探测包是填充到指定大小的keepalive, type_information为探测的mss, 对端完整收到后用user_defined控制包回复
+    class srt_mtu_search {
+    public:
+        /// IPv4 + UDP + SRT包头, mss减去它就是数据包的负载
+        static constexpr uint32_t header_size = 44;
+        /// 同一个大小的最大探测次数
+        static constexpr uint32_t max_probes = 3;
+        /// 搜索范围小于该值时停止
+        static constexpr uint32_t granularity = 32;
+        /// 等待探测回复的最短时间(ms), 实际为两个RTT
+        static constexpr uint32_t min_probe_timeout = 100;
+        /// 搜索结束之后重新向上探测的间隔(ms), 路径可能已经变化
+        static constexpr uint32_t raise_interval = 600000;
+
+    public:
+        /// 从min_mss(已经确认或者配置的下限)开始向上搜索到max_mss
+        void reset(uint32_t min_mss, uint32_t max_mss);
+        /// 下一次探测的mss, 搜索结束时返回0
+        uint32_t next_probe();
+        /// 收到对端对mss大小的探测回复, 返回确认的mss是否增大
+        bool on_probe_ack(uint32_t mss);
+        /// 上一次探测没有回复
+        void on_probe_timeout();
+        /// 当前确认可用的mss
+        uint32_t get_mss() const;
+        uint32_t get_max_mss() const;
+        bool is_done() const;
+
+    private:
+        uint32_t low = 0;
+        uint32_t high = 0;
+        uint32_t max_mss = 0;
+        /// 正在探测的mss, 0表示还没有选择
+        uint32_t probing = 0;
+        uint32_t probes = 0;
+    };
+}// namespace srt
+
+#endif//TOOLKIT_SRT_MTU_HPP
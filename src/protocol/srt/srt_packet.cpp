@@ -123,10 +123,36 @@ namespace srt {
         return this->type_information;
     }
 
+    void srt_packet::set_arrival_time(const std::chrono::steady_clock::time_point &arrival) {
+        this->arrival_time = arrival;
+    }
+
+    std::chrono::steady_clock::time_point srt_packet::get_arrival_time() const {
+        if (!has_arrival_time()) {
+            return std::chrono::steady_clock::now();
+        }
+        return this->arrival_time;
+    }
+
+    bool srt_packet::has_arrival_time() const {
+        return this->arrival_time != std::chrono::steady_clock::time_point{};
+    }
 
-    std::shared_ptr<buffer> create_packet(const srt_packet &pkt) noexcept {
+    void srt_packet::set_kernel_drops(uint32_t drops) {
+        this->kernel_drops = drops;
+    }
+
+    uint32_t srt_packet::get_kernel_drops() const {
+        return this->kernel_drops;
+    }
+
+
+    std::shared_ptr<buffer> create_packet(const srt_packet &pkt, size_t capacity) noexcept {
         auto buff = std::make_shared<buffer>();
-        buff->reserve(1500);
+        if (!capacity) {
+            capacity = pkt.is_control ? control_packet_capacity : 16 + pkt.get_data().size();
+        }
+        buff->reserve(capacity);
         if (pkt.is_control) {
             /// control type
             buff->put_be<uint16_t>(static_cast<uint16_t>(pkt.get_control_type()) | 0x8000);
@@ -137,8 +163,8 @@ namespace srt {
             /// sequence number
             buff->put_be<uint32_t>(pkt.get_packet_sequence_number() & 0x7FFFFFFF);
             /// flag + message_number
-            uint8_t flag = (pkt.get_packet_position_flag() << 6) | (pkt.get_key_based_encryption_flag() << 3) | (pkt.is_retransmitted() << 2);
-            uint32_t message_number = (flag << 24) | pkt.get_message_number();
+            uint8_t flag = (pkt.get_packet_position_flag() << 6) | (pkt.get_in_order() << 5) | (pkt.get_key_based_encryption_flag() << 3) | (pkt.is_retransmitted() << 2);
+            uint32_t message_number = (flag << 24) | (pkt.get_message_number() & 0x03FFFFFF);
             buff->put_be<uint32_t>(message_number);
         }
         /// timestamp
@@ -167,15 +193,16 @@ namespace srt {
             pkt->set_type_information(load_be32(data + 4));
         } else {
             pkt->set_packet_sequence_number(load_be32(data));
-            uint8_t position = data[5] & 0xc0;
-            uint8_t in_order = data[5] & 0x20;
-            uint8_t key_entry = data[5] & 0x18;
-            uint8_t retransmit = data[5] & 0x04;
+            /// PP(2) O(1) KK(2) R(1) + message number(26)
+            uint8_t position = (data[4] & 0xc0) >> 6;
+            uint8_t in_order = data[4] & 0x20;
+            uint8_t key_entry = (data[4] & 0x18) >> 3;
+            uint8_t retransmit = data[4] & 0x04;
             pkt->set_packet_position_flag(position);
             pkt->set_in_order(static_cast<bool>(in_order));
             pkt->set_key_encryption_flag(key_entry);
             pkt->set_retransmitted(static_cast<bool>(retransmit));
-            pkt->set_message_number(load_be32(data + 4) & 0x3FFFFFFF);
+            pkt->set_message_number(load_be32(data + 4) & 0x03FFFFFF);
         }
 
         pkt->set_timestamp(load_be32(data + 8));
@@ -26,6 +26,7 @@
 #define TOOLKIT_SRT_PACKET_H
 #include "net/buffer.hpp"
 #include "srt_control_type.h"
+#include <chrono>
 #include <cstdint>
 #include <memory>
 /**
@@ -70,7 +71,7 @@
 namespace srt {
 
     class srt_packet {
-        friend std::shared_ptr<buffer> create_packet(const srt_packet &) noexcept;
+        friend std::shared_ptr<buffer> create_packet(const srt_packet &, size_t) noexcept;
         friend std::shared_ptr<srt_packet> from_buffer(const char *data, size_t length);
 
     public:
@@ -118,9 +119,18 @@ namespace srt {
         void set_type_information(uint32_t);
         control_type get_control_type() const;
         uint32_t get_type_information() const;
+        /// 内核收到数据报的时间, 不在报文中传输; 为空时使用处理时的当前时间
+        void set_arrival_time(const std::chrono::steady_clock::time_point &arrival);
+        std::chrono::steady_clock::time_point get_arrival_time() const;
+        bool has_arrival_time() const;
+        /// 这个包到达之前内核接收队列新丢弃的数据报数量, 不在报文中传输
+        void set_kernel_drops(uint32_t drops);
+        uint32_t get_kernel_drops() const;
 
     private:
         bool is_control = true;
+        std::chrono::steady_clock::time_point arrival_time{};
+        uint32_t kernel_drops = 0;
         /// Timestamp: 32 bits. @See section 3
         uint32_t time_stamp = 0;
         /// Destination Socket ID: 32 bits. @See Section 3
@@ -190,7 +200,10 @@ namespace srt {
     };
 
 
-    std::shared_ptr<buffer> create_packet(const srt_packet &) noexcept;
+    /// 控制包的默认容量, 可以容纳握手和较长的NAK列表
+    constexpr size_t control_packet_capacity = 1500;
+    /// capacity为0时, 数据包只预留包头和data的大小(负载由发送队列引用), 控制包预留control_packet_capacity
+    std::shared_ptr<buffer> create_packet(const srt_packet &, size_t capacity = 0) noexcept;
     std::shared_ptr<srt_packet> from_buffer(const char *data, size_t length);
     void set_packet_timestamp(const std::shared_ptr<buffer> &buff, uint32_t ts);
 #if 0
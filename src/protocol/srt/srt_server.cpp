@@ -2,10 +2,13 @@
 #include "Util/endian.hpp"
 #include "event_poller_pool.hpp"
 #include "net/buffer.hpp"
+#include "net/buffer_pool.hpp"
+#include "net/udp_offload.hpp"
 #include "srt_packet.h"
 #include "srt_session.hpp"
 #include <algorithm>
 #include <atomic>
+#include <cerrno>
 #include <list>
 #include <memory>
 #include <random>
@@ -19,8 +22,12 @@ namespace srt {
     static std::recursive_mutex mtx;
     static std::unordered_map<uint32_t, std::shared_ptr<srt_session_base>> _session_map_;
     static std::recursive_mutex _cookie_mtx;
-    static std::unordered_map<uint32_t, std::shared_ptr<srt_session_base>> _handshake_map;
+    static std::unordered_map<uint64_t, std::shared_ptr<srt_session_base>> _handshake_map;
+    constexpr uint32_t srt_server::cookie_period;
+
     srt_server::srt_server() {
+        std::random_device device;
+        _cookie_secret = ((uint64_t) device() << 32) | device();
         _on_create_session_func_ = [](const std::shared_ptr<asio::ip::udp::socket> &sock, const event_poller::Ptr &context) -> std::shared_ptr<srt_session_base> {
             return std::make_shared<srt_session>(sock, context);
         };
@@ -37,13 +44,14 @@ namespace srt {
                 {
                     std::lock_guard<std::recursive_mutex> lmtx(mtx);
                     stronger_self->_socks.push_back(_sock);
+                    stronger_self->_pollers.push_back(poller);
                 }
                 stronger_self->start(_sock, poller);
             }
         });
     }
 
-    void srt_server::remove_cookie_session(uint32_t _cookie) {
+    void srt_server::remove_cookie_session(uint64_t _cookie) {
         _cookie_map.erase(_cookie);
         std::lock_guard<std::recursive_mutex> lmtx(_cookie_mtx);
         _handshake_map.erase(_cookie);
@@ -66,25 +74,205 @@ namespace srt {
         Debug("session map, thread_local size = {}, global size = {}", _thread_local_session_map_.size(), _session_map_.size());
     }
 
+    void srt_server::add_local_session(const std::shared_ptr<srt_session_base> &session) {
+        _thread_local_session_map_[session->get_peer_sock_id()] = session;
+    }
+
+    void srt_server::remove_local_session(uint32_t sock_id) {
+        _thread_local_session_map_.erase(sock_id);
+    }
+
+    void srt_server::update_receive_size(uint32_t size) {
+        auto current = _receive_size.load(std::memory_order_relaxed);
+        while (size > current && !_receive_size.compare_exchange_weak(current, size, std::memory_order_relaxed)) {
+        }
+    }
+
+    std::shared_ptr<asio::ip::udp::socket> srt_server::get_listener(const event_poller::Ptr &poller) {
+        std::lock_guard<std::recursive_mutex> lmtx(mtx);
+        for (size_t i = 0; i < _pollers.size(); i++) {
+            if (_pollers[i] == poller) {
+                return _socks[i];
+            }
+        }
+        return nullptr;
+    }
+
     void srt_server::on_create_session(const on_create_session_func &f) {
         this->_on_create_session_func_ = f;
     }
 
+    void srt_server::set_connected_session_socket(bool on) {
+        _connected_session_socket.store(on);
+    }
+
+    bool srt_server::get_connected_session_socket() const {
+        return _connected_session_socket.load(std::memory_order_relaxed);
+    }
+
+    void srt_server::set_reuse_port(asio::ip::udp::socket &sock, std::error_code &e) {
+#ifdef SO_REUSEPORT
+        int on = 1;
+        if (setsockopt(sock.native_handle(), SOL_SOCKET, SO_REUSEPORT, &on, sizeof(on)) != 0) {
+            e = std::error_code(errno, std::system_category());
+            return;
+        }
+        e.clear();
+#else
+        e = std::make_error_code(std::errc::operation_not_supported);
+#endif
+    }
+
+    bool srt_server::get_receive_offload() const {
+        return _receive_offload.load(std::memory_order_relaxed);
+    }
+
+    double srt_server::get_receive_bytes_per_syscall() const {
+        auto syscalls = _receive_syscalls.load(std::memory_order_relaxed);
+        return syscalls ? (double) _receive_bytes.load(std::memory_order_relaxed) / (double) syscalls : 0;
+    }
+
+    uint64_t srt_server::get_kernel_drops() const {
+        return _kernel_drops.load(std::memory_order_relaxed);
+    }
+
+    uint64_t srt_server::get_migrated_sessions() const {
+        return _migrated_sessions.load(std::memory_order_relaxed);
+    }
+
+    void srt_server::set_auto_rebalance(uint32_t interval_ms, double threshold) {
+        /// 之前的定时器发现代数变化后自行停止
+        auto generation = ++_rebalance_generation;
+        {
+            std::lock_guard<std::mutex> lmtx(_rebalance_mtx);
+            _busy_time.clear();
+            _session_io_count.clear();
+        }
+        if (!interval_ms) {
+            return;
+        }
+        std::weak_ptr<srt_server> self(shared_from_this());
+        event_poller_pool::Instance().get_poller()->do_delay_task(std::chrono::milliseconds(interval_ms), [self, generation, interval_ms, threshold]() -> size_t {
+            auto stronger_self = self.lock();
+            if (!stronger_self || stronger_self->_rebalance_generation.load() != generation) {
+                return 0;
+            }
+            stronger_self->rebalance(threshold);
+            return interval_ms;
+        });
+    }
+
+    void srt_server::rebalance(double threshold) {
+        std::vector<event_poller::Ptr> pollers;
+        {
+            std::lock_guard<std::recursive_mutex> lmtx(mtx);
+            pollers = _pollers;
+        }
+        std::lock_guard<std::mutex> lmtx(_rebalance_mtx);
+        auto now = std::chrono::steady_clock::now();
+        std::vector<uint64_t> busy_time;
+        for (const auto &poller: pollers) {
+            busy_time.push_back(poller->get_busy_time());
+        }
+        auto last = std::move(_busy_time);
+        auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(now - _rebalance_point).count();
+        _busy_time = busy_time;
+        _rebalance_point = now;
+
+        /// 每个会话在上一个周期内的收发包数量
+        std::unordered_map<uint32_t, uint64_t> io_count;
+        std::vector<std::pair<std::shared_ptr<srt_session_base>, uint64_t>> sessions;
+        std::vector<uint64_t> poller_io(pollers.size(), 0);
+        {
+            std::lock_guard<std::recursive_mutex> lmtx(mtx);
+            for (const auto &item: _session_map_) {
+                auto count = item.second->get_io_count();
+                io_count[item.first] = count;
+                auto it = _session_io_count.find(item.first);
+                if (it == _session_io_count.end()) {
+                    continue;
+                }
+                auto index = std::find(pollers.begin(), pollers.end(), item.second->get_poller()) - pollers.begin();
+                if (index < (long) pollers.size()) {
+                    sessions.emplace_back(item.second, count - it->second);
+                    poller_io[index] += count - it->second;
+                }
+            }
+        }
+        _session_io_count.swap(io_count);
+        if (pollers.size() < 2 || last.size() != pollers.size() || elapsed <= 0) {
+            return;
+        }
+
+        /// 忙碌比例: 线程CPU时间的增量除以经过的时间
+        std::vector<double> load;
+        for (size_t i = 0; i < pollers.size(); i++) {
+            load.push_back((double) (busy_time[i] - last[i]) / (double) elapsed);
+        }
+        auto busiest = std::max_element(load.begin(), load.end()) - load.begin();
+        auto idlest = std::min_element(load.begin(), load.end()) - load.begin();
+        auto gap = load[busiest] - load[idlest];
+        if (gap < threshold || !poller_io[busiest]) {
+            return;
+        }
+        /// 会话的负载按照收发包数量占所在poller的比例估计, 迁移超过差距一半的会话只会让两个poller互换
+        std::shared_ptr<srt_session_base> candidate;
+        double candidate_load = 0;
+        for (const auto &item: sessions) {
+            if (item.first->get_poller() != pollers[busiest]) {
+                continue;
+            }
+            auto session_load = load[busiest] * (double) item.second / (double) poller_io[busiest];
+            if (session_load <= gap / 2 && session_load > candidate_load) {
+                candidate = item.first;
+                candidate_load = session_load;
+            }
+        }
+        if (!candidate) {
+            return;
+        }
+        Info("rebalance session sock_id={}, load={:.2f}, poller {} busy={:.2f} -> poller {} busy={:.2f}", candidate->get_sock_id(), candidate_load, busiest, load[busiest],
+             idlest, load[idlest]);
+        candidate->migrate(pollers[idlest]);
+    }
+
 
     /// 由各自线程的io_context 调用
     void srt_server::start(const std::shared_ptr<asio::ip::udp::socket> &sock, const event_poller::Ptr &poller) {
         Info("srt server start on {}:{}", sock->local_endpoint().address().to_string(), sock->local_endpoint().port());
-        return read_l(sock, poller);
+        /// 没有会话时使用最小的缓冲区, 之后每秒按照会话的带宽时延积调整
+        auto sock_buffer = std::make_shared<socket_buffer>();
+        sock_buffer->update(sock->native_handle(), 0);
+        std::weak_ptr<srt_server> self(shared_from_this());
+        std::weak_ptr<asio::ip::udp::socket> sock_self(sock);
+        poller->do_delay_task(std::chrono::milliseconds(1000), [self, sock_self, sock_buffer]() -> size_t {
+            auto stronger_self = self.lock();
+            auto sock_stronger_self = sock_self.lock();
+            if (!stronger_self || !sock_stronger_self) {
+                return 0;
+            }
+            stronger_self->update_socket_buffer(sock_stronger_self, sock_buffer);
+            return 1000;
+        });
+        return read_l(sock, poller, sock_buffer);
     }
 
-    void srt_server::read_l(const std::shared_ptr<asio::ip::udp::socket> &sock, const event_poller::Ptr &poller) {
+    void srt_server::update_socket_buffer(const std::shared_ptr<asio::ip::udp::socket> &sock, const std::shared_ptr<socket_buffer> &sock_buffer) {
+        uint64_t bandwidth_delay_product = 0;
+        for (const auto &item: _thread_local_session_map_) {
+            /// 使用独立socket的会话由自己调整
+            auto session = item.second.lock();
+            if (session && !session->has_connected_socket()) {
+                bandwidth_delay_product += session->get_bandwidth_delay_product();
+            }
+        }
+        sock_buffer->update(sock->native_handle(), bandwidth_delay_product);
+    }
+
+    void srt_server::read_l(const std::shared_ptr<asio::ip::udp::socket> &sock, const event_poller::Ptr &poller, const std::shared_ptr<socket_buffer> &sock_buffer) {
         std::weak_ptr<srt_server> self(shared_from_this());
         std::weak_ptr<asio::ip::udp::socket> sock_self(sock);
-        static thread_local auto endpoint = std::make_shared<asio::ip::udp::endpoint>();
-        static thread_local auto buff = std::make_shared<buffer>();
-        buff->resize(1500);
-        buff->backward();
-        sock->async_receive_from(asio::buffer((char *) buff->data(), buff->size()), *endpoint, [&, poller, self, sock_self](const std::error_code &e, size_t length) {
+        sock->async_wait(asio::ip::udp::socket::wait_read, [poller, self, sock_self, sock_buffer](const std::error_code &e) {
             auto stronger_self = self.lock();
             auto sock_stronger_self = sock_self.lock();
             if (!stronger_self || !sock_stronger_self) {
@@ -94,16 +282,56 @@ namespace srt {
             if (e) {
                 return;
             }
+            stronger_self->receive_l(sock_stronger_self, poller, sock_buffer);
+            return stronger_self->read_l(sock_stronger_self, poller, sock_buffer);
+        });
+    }
 
-            if (length <= 0) {
-                return stronger_self->read_l(sock_stronger_self, poller);
+    void srt_server::receive_l(const std::shared_ptr<asio::ip::udp::socket> &sock, const event_poller::Ptr &poller, const std::shared_ptr<socket_buffer> &sock_buffer) {
+        static thread_local auto endpoint = std::make_shared<asio::ip::udp::endpoint>();
+        auto &pool = buffer_pool::this_thread();
+        /// 一次唤醒最多读取的次数, 避免一个socket长时间占用poller
+        for (int i = 0; i < 64; i++) {
+            std::error_code e;
+            auto offload = _receive_offload.load(std::memory_order_relaxed);
+            /// 每个数据报读到池中独立的buffer里, 之后直接作为接收队列的元素交付给应用层
+            /// 缓冲区按照会话协商的mss分配, 池中的buffer保留上一次的长度, 扩大时只填充多出的部分
+            auto receive_size = _receive_size.load(std::memory_order_relaxed);
+            if (!offload && !_receive_control.load(std::memory_order_relaxed)) {
+                auto buff = pool.obtain(receive_size);
+                buff->resize(receive_size);
+                buff->backward();
+                auto length = sock->receive_from(asio::buffer((char *) buff->data(), buff->size()), *endpoint, 0, e);
+                if (e) {
+                    return;
+                }
+                _receive_syscalls.fetch_add(1, std::memory_order_relaxed);
+                _receive_bytes.fetch_add(length, std::memory_order_relaxed);
+                if (length <= 0) {
+                    continue;
+                }
+                buff->resize(length);
+                buff->backward();
+                on_receive(buff, *endpoint, sock, poller);
+                continue;
             }
 
-            buff->resize(length);
-            buff->backward();
-            stronger_self->on_receive(buff, *endpoint, sock_stronger_self, poller);
-            return stronger_self->read_l(sock_stronger_self, poller);
-        });
+            auto on_segment = [&](const std::shared_ptr<buffer> &segment, const udp_receive_info &info) {
+                /// 内核丢包归属到之后第一个到达的包
+                uint32_t drops = 0;
+                if (info.drop_counter) {
+                    drops = sock_buffer->on_drop_counter(sock->native_handle(), info.drop_counter);
+                    _kernel_drops.fetch_add(drops, std::memory_order_relaxed);
+                }
+                on_receive(segment, *endpoint, sock, poller, info.arrival, drops);
+            };
+            auto length = udp_offload::receive_segments(sock->native_handle(), pool, receive_size, offload, endpoint.get(), e, on_segment);
+            if (length < 0) {
+                return;
+            }
+            _receive_syscalls.fetch_add(1, std::memory_order_relaxed);
+            _receive_bytes.fetch_add(length, std::memory_order_relaxed);
+        }
     }
 
     std::shared_ptr<srt_session_base> srt_server::get_session(uint32_t sock_id) {
@@ -115,9 +343,9 @@ namespace srt {
         return it->second;
     }
 
-    std::shared_ptr<srt_session_base> srt_server::get_session_with_cookie(uint32_t sock_id) {
+    std::shared_ptr<srt_session_base> srt_server::get_session_with_cookie(uint64_t key) {
         std::lock_guard<std::recursive_mutex> lmtx(_cookie_mtx);
-        auto it = _handshake_map.find(sock_id);
+        auto it = _handshake_map.find(key);
         if (it == _handshake_map.end()) {
             return nullptr;
         }
@@ -128,19 +356,39 @@ namespace srt {
         auto _sock = std::make_shared<asio::ip::udp::socket>(poller->get_executor());
         _sock->open(endpoint.protocol());
         asio::ip::udp::socket::reuse_address option(true);
-        asio::ip::udp::socket::receive_buffer_size rbs(256 * 1024);
-        asio::ip::udp::socket::send_buffer_size sbs(256 * 1024);
         _sock->native_non_blocking(true);
         _sock->set_option(option);
-        _sock->set_option(rbs);
-        _sock->set_option(sbs);
+        /// 会话的独立socket绑定同一个端口, 要求所有socket都设置SO_REUSEPORT
+        if (get_connected_session_socket()) {
+            std::error_code e;
+            set_reuse_port(*_sock, e);
+            if (e) {
+                Warn("set SO_REUSEPORT failed, sessions use the listener socket, {}", e.message());
+                _connected_session_socket.store(false);
+            }
+        }
         _sock->bind(endpoint);
+        /// 内核支持时把同一条流上连续的数据报合并接收, 减少系统调用
+        if (udp_offload::enable_gro(_sock->native_handle())) {
+            _receive_offload.store(true);
+        }
+        /// 用内核接收时间计算RTT和带宽, 不受poller排队延迟的影响
+        if (udp_offload::enable_receive_timestamp(_sock->native_handle())) {
+            _receive_control.store(true);
+        }
+        /// 区分内核丢包和网络丢包
+        if (socket_buffer::enable_drop_counter(_sock->native_handle())) {
+            _receive_control.store(true);
+        }
         return _sock;
     }
 
-    void srt_server::on_receive(const std::shared_ptr<buffer> &buf, const asio::ip::udp::endpoint &endpoint, const std::shared_ptr<asio::ip::udp::socket> &sock, const event_poller::Ptr &poller) {
+    void srt_server::on_receive(const std::shared_ptr<buffer> &buf, const asio::ip::udp::endpoint &endpoint, const std::shared_ptr<asio::ip::udp::socket> &sock, const event_poller::Ptr &poller,
+                                const std::chrono::steady_clock::time_point &arrival, uint32_t kernel_drops) {
         try {
             auto pkt = from_buffer(buf->data(), buf->size());
+            pkt->set_arrival_time(arrival);
+            pkt->set_kernel_drops(kernel_drops);
             buf->remove(16);
             /// 新的session握手包
             if (pkt->get_control() && pkt->get_control_type() == control_type::handshake && pkt->get_socket_id() == 0) {
@@ -156,28 +404,26 @@ namespace srt {
         if (buff->size() < 48) {
             return;
         }
-        auto p = ((const uint32_t *) buff->data()) + 7;
-        uint32_t _cookie_ = load_be32(p);
-        if (_cookie_ == 0 && pkt->get_socket_id() == 0) {
-            /// 同步到线程局部存储
-            auto session = _on_create_session_func_(sock, poller);
-
-            /// 设置当前cookie
-            std::default_random_engine random(std::random_device{}());
-            std::uniform_int_distribution<int32_t> mt(0, (std::numeric_limits<int32_t>::max)());
-            session->set_cookie(mt(random));
-            _cookie_map.emplace(session->get_cookie(), session);
-            {
-                std::lock_guard<std::recursive_mutex> lmtx(_cookie_mtx);
-                _handshake_map.emplace(session->get_cookie(), session);
-            }
-            session->set_parent(shared_from_this());
-            session->set_current_remote_endpoint(endpoint);
-            session->begin_session();
+        /// 握手中对端的socket id和cookie, 共用一个地址的客户端通过socket id区分
+        auto p = ((const uint32_t *) buff->data()) + 6;
+        uint32_t caller_id = load_be32(p);
+        uint32_t _cookie_ = load_be32(p + 1);
+        auto now = std::chrono::steady_clock::now();
+        if (_cookie_ == 0) {
+            auto cookie = make_cookie(endpoint, now, 0);
+            auto key = cookie_key(cookie, caller_id);
+            /// 重传的induction交给同一个会话
+            auto it = _cookie_map.find(key);
+            if (it != _cookie_map.end()) {
+                if (auto session = it->second.lock()) {
+                    return session->receive(pkt, buff);
+                }
+            }
             /// 进行握手
-            return session->receive(pkt, buff);
+            return create_handshake_session(sock, poller, endpoint, cookie, key, false)->receive(pkt, buff);
         }
-        auto it = _cookie_map.find(_cookie_);
+        auto key = cookie_key(_cookie_, caller_id);
+        auto it = _cookie_map.find(key);
         //// 说明session在本线程进行握手
         if (it != _cookie_map.end()) {
             auto stronger_self = it->second.lock();
@@ -186,23 +432,88 @@ namespace srt {
             }
             ///进行握手
             return stronger_self->receive(pkt, buff);
-        } else {
-            /// 数据漂移到其他线程
-            auto session = get_session_with_cookie(_cookie_);
-            if (!session) {
-                Warn("no current session with cookie={}", _cookie_);
-                return;
-            }
-            /// 线程局部存储需要拷贝数据
+        }
+        /// 数据漂移到其他线程
+        auto session = get_session_with_cookie(key);
+        if (session) {
+            /// 每个数据报使用独立的接收缓存, 直接转交给会话所在的线程
             Warn("data received in other thread, switch to session thread...");
-            auto buf_tmp = buffer::assign(buff->data(), buff->size());
             std::weak_ptr<srt_session_base> session_self(session);
-            session->get_poller()->async([pkt, buf_tmp, endpoint, session_self]() {
+            session->get_poller()->async([pkt, buff, endpoint, session_self]() {
                 if (auto stronger_session_self = session_self.lock()) {
-                    stronger_session_self->receive(pkt, buf_tmp);
+                    stronger_session_self->receive(pkt, buff);
                 }
             });
+            return;
+        }
+        /// 没有握手中的会话: 客户端重连时使用上一次连接的cookie直接发送conclusion
+        /// cookie由对端地址计算, 验证通过说明对端最近完成过induction, 不需要再进行一次
+        if (verify_cookie(_cookie_, endpoint, now)) {
+            Debug("accept cached cookie={} from {}:{}, skip induction", _cookie_, endpoint.address().to_string(), endpoint.port());
+            return create_handshake_session(sock, poller, endpoint, _cookie_, key, true)->receive(pkt, buff);
+        }
+        /// cookie已经过期, 用新的cookie回复induction, 客户端继续完整的握手
+        Debug("expired cookie={} from {}:{}, answer with a new cookie", _cookie_, endpoint.address().to_string(), endpoint.port());
+        auto cookie = make_cookie(endpoint, now, 0);
+        key = cookie_key(cookie, caller_id);
+        it = _cookie_map.find(key);
+        if (it != _cookie_map.end()) {
+            if (auto stronger_self = it->second.lock()) {
+                return stronger_self->receive(pkt, buff);
+            }
         }
+        return create_handshake_session(sock, poller, endpoint, cookie, key, false)->receive(pkt, buff);
+    }
+
+    std::shared_ptr<srt_session_base> srt_server::create_handshake_session(const std::shared_ptr<asio::ip::udp::socket> &sock, const event_poller::Ptr &poller,
+                                                                           const asio::ip::udp::endpoint &endpoint, uint32_t cookie, uint64_t key, bool cookie_verified) {
+        auto session = _on_create_session_func_(sock, poller);
+        /// 同步到线程局部存储
+        session->set_cookie(cookie, key);
+        _cookie_map[key] = session;
+        {
+            std::lock_guard<std::recursive_mutex> lmtx(_cookie_mtx);
+            _handshake_map[key] = session;
+        }
+        session->set_parent(shared_from_this());
+        session->set_current_remote_endpoint(endpoint);
+        session->begin_session(cookie_verified);
+        return session;
+    }
+
+    uint32_t srt_server::make_cookie(const asio::ip::udp::endpoint &endpoint, const std::chrono::steady_clock::time_point &now, int period_offset) const {
+        /// FNV-1a: 密钥, 对端地址, 端口, cookie周期
+        uint64_t hash = 14695981039346656037ULL;
+        auto mix = [&hash](const unsigned char *data, size_t size) {
+            for (size_t i = 0; i < size; i++) {
+                hash ^= data[i];
+                hash *= 1099511628211ULL;
+            }
+        };
+        mix((const unsigned char *) &_cookie_secret, sizeof(_cookie_secret));
+        if (endpoint.address().is_v4()) {
+            auto bytes = endpoint.address().to_v4().to_bytes();
+            mix(bytes.data(), bytes.size());
+        } else {
+            auto bytes = endpoint.address().to_v6().to_bytes();
+            mix(bytes.data(), bytes.size());
+        }
+        uint16_t port = endpoint.port();
+        mix((const unsigned char *) &port, sizeof(port));
+        int64_t period = std::chrono::duration_cast<std::chrono::seconds>(now.time_since_epoch()).count() / cookie_period + period_offset;
+        mix((const unsigned char *) &period, sizeof(period));
+        auto cookie = (uint32_t) (hash ^ (hash >> 32));
+        /// 0表示induction请求
+        return cookie ? cookie : 1;
+    }
+
+    bool srt_server::verify_cookie(uint32_t cookie, const asio::ip::udp::endpoint &endpoint, const std::chrono::steady_clock::time_point &now) const {
+        /// 当前周期和上一个周期的cookie都有效
+        return cookie == make_cookie(endpoint, now, 0) || cookie == make_cookie(endpoint, now, -1);
+    }
+
+    uint64_t srt_server::cookie_key(uint32_t cookie, uint32_t caller_id) {
+        return ((uint64_t) cookie << 32) | caller_id;
     }
 
     void srt_server::handle_data(const std::shared_ptr<srt_packet> &pkt, const std::shared_ptr<buffer> &buff) {
@@ -226,13 +537,11 @@ namespace srt {
             if (!session) {
                 return;
             }
-            /// 线程局部存储需要拷贝缓冲区
-            auto buff_tmp = buffer::assign(buff->data(), buff->size());
-            /// 切换到其他线程
+            /// 切换到其他线程, 接收缓存随数据报一起转交
             std::weak_ptr<srt_session_base> session_self(session);
-            session->get_poller()->async([buff_tmp, session_self, pkt]() {
+            session->get_poller()->async([buff, session_self, pkt]() {
                 if (auto session_stronger = session_self.lock()) {
-                    session_stronger->receive(pkt, buff_tmp);
+                    session_stronger->receive(pkt, buff);
                 }
             });
         }
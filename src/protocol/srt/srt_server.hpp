@@ -26,7 +26,10 @@
 #ifndef TOOLKIT_SRT_SERVER_HPP
 #define TOOLKIT_SRT_SERVER_HPP
 #include "asio.hpp"
+#include "net/socket_buffer.hpp"
 #include "srt_session_base.hpp"
+#include <atomic>
+#include <chrono>
 #include <mutex>
 #include <unordered_map>
 #include <vector>
@@ -36,6 +39,8 @@ namespace srt {
     public:
         using on_create_session_func = std::function<std::shared_ptr<srt_session_base>(const std::shared_ptr<asio::ip::udp::socket> &sock, const event_poller::Ptr &context)>;
         friend class srt_session_base;
+        /// cookie的有效周期(秒), 当前周期和上一个周期签发的cookie都可以直接用于conclusion
+        static constexpr uint32_t cookie_period = 60;
 
     public:
         srt_server();
@@ -45,27 +50,85 @@ namespace srt {
         void start(const asio::ip::udp::endpoint &endpoint);
         /// 创建会话的回调
         void on_create_session(const on_create_session_func &f);
+        /// 握手完成后每个会话使用独立的socket(SO_REUSEPORT绑定到监听端口并connect到对端), 监听socket只处理握手
+        /// 内核按照四元组直接分发, 收包不需要查找会话, 发包不需要查找路由; 需要在start之前设置
+        void set_connected_session_socket(bool on);
+        bool get_connected_session_socket() const;
+        /// 接收是否开启了UDP_GRO
+        bool get_receive_offload() const;
+        /// 平均每次接收系统调用读到的字节数, 开启GRO时一次可以读到多个合并的数据报
+        double get_receive_bytes_per_syscall() const;
+        /// 所有socket的内核接收队列溢出丢弃的数据报数量
+        uint64_t get_kernel_drops() const;
+        /// 按照poller线程的忙碌时间自动迁移会话, interval_ms为0时关闭
+        /// 每个周期比较各个poller的忙碌比例, 最忙和最闲的差距超过threshold时, 从最忙的poller迁移一个会话到最闲的poller
+        /// 迁移的会话按照收发包数量估计负载, 选择不超过差距一半的最大的会话, 避免来回迁移; 需要在start之后设置
+        void set_auto_rebalance(uint32_t interval_ms, double threshold = 0.2);
+        /// 已经完成迁移的会话数量
+        uint64_t get_migrated_sessions() const;
 
     private:
-        void remove_cookie_session(uint32_t);
+        static void set_reuse_port(asio::ip::udp::socket &sock, std::error_code &e);
+        void remove_cookie_session(uint64_t);
         void remove_session(uint32_t);
         void add_connected_session(const std::shared_ptr<srt_session_base> &session);
+        /// 只修改当前线程的会话表, 迁移时使用, 全局会话表保持不变
+        void add_local_session(const std::shared_ptr<srt_session_base> &session);
+        void remove_local_session(uint32_t);
+        /// 会话协商了mss之后调用, 监听socket的接收缓冲区取所有会话中最大的mss
+        void update_receive_size(uint32_t size);
+        /// poller上的监听socket, 不是服务端的poller时返回nullptr
+        std::shared_ptr<asio::ip::udp::socket> get_listener(const event_poller::Ptr &poller);
+        void rebalance(double threshold);
 
     private:
-        void on_receive(const std::shared_ptr<buffer> &, const asio::ip::udp::endpoint &, const std::shared_ptr<asio::ip::udp::socket> &sock, const event_poller::Ptr &);
+        /// arrival为内核收到数据报的时间, 没有开启时间戳时为空
+        void on_receive(const std::shared_ptr<buffer> &, const asio::ip::udp::endpoint &, const std::shared_ptr<asio::ip::udp::socket> &sock, const event_poller::Ptr &,
+                        const std::chrono::steady_clock::time_point &arrival = {}, uint32_t kernel_drops = 0);
         void handle_handshake(const std::shared_ptr<srt_packet> &, const std::shared_ptr<buffer> &, const asio::ip::udp::endpoint &, const std::shared_ptr<asio::ip::udp::socket> &sock, const event_poller::Ptr &);
         void handle_data(const std::shared_ptr<srt_packet> &, const std::shared_ptr<buffer> &);
+        /// cookie_verified为true时对端使用有效的cookie直接发送conclusion, 会话跳过induction
+        std::shared_ptr<srt_session_base> create_handshake_session(const std::shared_ptr<asio::ip::udp::socket> &sock, const event_poller::Ptr &poller,
+                                                                   const asio::ip::udp::endpoint &endpoint, uint32_t cookie, uint64_t key, bool cookie_verified);
+        /// 无状态的cookie: 由服务端密钥、对端地址和时间周期计算, 不需要保存也能验证
+        uint32_t make_cookie(const asio::ip::udp::endpoint &endpoint, const std::chrono::steady_clock::time_point &now, int period_offset) const;
+        bool verify_cookie(uint32_t cookie, const asio::ip::udp::endpoint &endpoint, const std::chrono::steady_clock::time_point &now) const;
+        /// 握手中的会话按照cookie和对端socket id查找
+        static uint64_t cookie_key(uint32_t cookie, uint32_t caller_id);
 
     private:
         std::shared_ptr<asio::ip::udp::socket> create(const event_poller::Ptr &, const asio::ip::udp::endpoint &);
         void start(const std::shared_ptr<asio::ip::udp::socket> &, const event_poller::Ptr &context);
-        void read_l(const std::shared_ptr<asio::ip::udp::socket> &sock, const event_poller::Ptr &context);
+        void read_l(const std::shared_ptr<asio::ip::udp::socket> &sock, const event_poller::Ptr &context, const std::shared_ptr<socket_buffer> &sock_buffer);
+        /// 读取socket中所有可读的数据报, GRO合并的数据报按照分段大小拆分, 同时读取内核接收时间和丢包计数
+        void receive_l(const std::shared_ptr<asio::ip::udp::socket> &sock, const event_poller::Ptr &context, const std::shared_ptr<socket_buffer> &sock_buffer);
+        /// 按照本线程所有会话的带宽时延积之和调整socket缓冲区
+        void update_socket_buffer(const std::shared_ptr<asio::ip::udp::socket> &sock, const std::shared_ptr<socket_buffer> &sock_buffer);
         std::shared_ptr<srt_session_base> get_session(uint32_t);
-        std::shared_ptr<srt_session_base> get_session_with_cookie(uint32_t);
+        std::shared_ptr<srt_session_base> get_session_with_cookie(uint64_t);
 
     private:
         std::vector<std::shared_ptr<asio::ip::udp::socket>> _socks;
+        /// 和_socks一一对应
+        std::vector<event_poller::Ptr> _pollers;
         on_create_session_func _on_create_session_func_;
+        uint64_t _cookie_secret = 0;
+        std::atomic<bool> _connected_session_socket{false};
+        std::atomic<bool> _receive_offload{false};
+        /// 开启了内核接收时间戳或者丢包计数, 需要通过recvmsg读取控制消息
+        std::atomic<bool> _receive_control{false};
+        std::atomic<uint64_t> _kernel_drops{0};
+        std::atomic<uint64_t> _receive_syscalls{0};
+        std::atomic<uint64_t> _receive_bytes{0};
+        std::atomic<uint64_t> _migrated_sessions{0};
+        /// 监听socket上一个数据报的接收缓冲区大小, 握手包不超过常见的MTU, 之后只增不减
+        std::atomic<uint32_t> _receive_size{1500};
+        /// 自动迁移, 只在定时器所在的poller中访问
+        std::atomic<uint32_t> _rebalance_generation{0};
+        std::mutex _rebalance_mtx;
+        std::vector<uint64_t> _busy_time;
+        std::chrono::steady_clock::time_point _rebalance_point;
+        std::unordered_map<uint32_t, uint64_t> _session_io_count;
     };
 }// namespace srt
 #endif//TOOLKIT_SRT_SERVER_HPP
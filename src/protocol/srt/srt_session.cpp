@@ -29,12 +29,15 @@ namespace srt {
     }
 
     srt_session::~srt_session() {
-        Warn("~srt_session");
-        if (_id.is_publish()) {
+        if (publish_source) {
             media_source::add_or_remove_source(false, publish_source);
         }
     }
 
+    void srt_session::set_play_wait_time_out(uint32_t ms) {
+        play_wait_time_out = ms;
+    }
+
     void srt_session::onConnected() {
         try {
             const std::string &sid = get_stream_id();
@@ -62,7 +65,20 @@ namespace srt {
     }
 
     void srt_session::onError(const std::error_code &e) {
-        Error("error: {}", e.message());
+        Info("session closed, {}", e.message());
+        /// 在poller中attach, 在poller中释放
+        reader.reset();
+        /// 推流端断开时立即注销源, 同名的流可以重新推送; 源销毁后播放端收到detach
+        /// publish_source只在executor中访问
+        std::weak_ptr<srt_session> self(std::static_pointer_cast<srt_session>(shared_from_this()));
+        get_executor()->async([self]() {
+            auto stronger_self = self.lock();
+            if (!stronger_self || !stronger_self->publish_source) {
+                return;
+            }
+            media_source::add_or_remove_source(false, stronger_self->publish_source);
+            stronger_self->publish_source.reset();
+        });
     }
 
     void srt_session::handle_publish() {
@@ -76,11 +92,14 @@ namespace srt {
             shutdown();
             return;
         }
+        /// 一次收到的多个包合并成一批派发给各个播放端的poller
+        /// onRecv在executor中写入, 合并也以executor的一轮任务为单位; 迁移只改变poller, executor不变, 不需要重新绑定
+        publish_source->get_ring()->setCoalesceExecutor(get_executor());
     }
 
     void srt_session::handle_play() {
         std::weak_ptr<srt_session> self(std::static_pointer_cast<srt_session>(shared_from_this()));
-        media_source::async_find_source(_id.vhost(), _id.app(), _id.stream(), [self](const media_source::pointer &p) {
+        auto f = [self](const media_source::pointer &p) {
             if (auto stronger_self = self.lock()) {
                 return stronger_self->get_executor()->async([self, p]() {
                     if (auto stronger_self = self.lock()) {
@@ -88,7 +107,12 @@ namespace srt {
                     }
                 });
             }
-        });
+        };
+        if (play_wait_time_out) {
+            /// 推流端注册时和其他等待的播放端一起唤醒
+            return media_source::async_wait_source(_id.vhost(), _id.app(), _id.stream(), get_poller(), play_wait_time_out, f);
+        }
+        media_source::async_find_source(_id.vhost(), _id.app(), _id.stream(), f);
     }
 
     void srt_session::handle_play_l(const media_source::pointer &p) {
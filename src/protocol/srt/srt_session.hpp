@@ -33,6 +33,8 @@ namespace srt {
     public:
         srt_session(const std::shared_ptr<asio::ip::udp::socket> &_sock, const event_poller::Ptr &context);
         ~srt_session() override;
+        /// 播放端连接时流还没有推送, 等待推流端注册的最长时间(ms), 为0时立即断开
+        void set_play_wait_time_out(uint32_t ms);
 
     protected:
         void onConnected() override;
@@ -50,6 +52,7 @@ namespace srt {
         //// io
         std::weak_ptr<media_source> play_source;
         std::shared_ptr<typename toolkit::RingBuffer<std::shared_ptr<buffer>>::RingReader> reader;
+        uint32_t play_wait_time_out = 0;
     };
 };// namespace srt
 
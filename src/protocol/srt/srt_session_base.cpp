@@ -25,15 +25,25 @@
 #include "srt_session_base.hpp"
 #include "Util/random.hpp"
 #include "executor_pool.hpp"
+#include "net/path_mtu.hpp"
+#include "net/socket_pacing.hpp"
+#include "net/buffer_pool.hpp"
+#include "net/udp_offload.hpp"
 #include "spdlog/logger.hpp"
 #include "srt_error.hpp"
+#include "srt_packet.h"
 #include "srt_server.hpp"
+#include <array>
 namespace srt {
-    srt_session_base::srt_session_base(const std::shared_ptr<asio::ip::udp::socket> &_sock, const event_poller::Ptr &poller) : _sock(*_sock), srt_socket_service(poller) {
+    srt_session_base::srt_session_base(const std::shared_ptr<asio::ip::udp::socket> &_sock, const event_poller::Ptr &poller) : _listener(_sock), _sock(_sock), srt_socket_service(poller) {
         _local = _sock->local_endpoint();
         executor_ = executor_pool::instance().get_executor();
     }
 
+    bool srt_session_base::has_connected_socket() const {
+        return _connected_socket;
+    }
+
     void srt_session_base::set_parent(const std::shared_ptr<srt_server> &serv) {
         this->_parent_server = serv;
     }
@@ -42,27 +52,115 @@ namespace srt {
         this->_remote = p;
     }
 
-    void srt_session_base::set_cookie(uint32_t cookie) {
+    void srt_session_base::set_cookie(uint32_t cookie, uint64_t key) {
         this->cookie_ = cookie;
+        this->cookie_key_ = key;
     }
 
-    void srt_session_base::begin_session() {
-        std::weak_ptr<srt_session_base> self(std::static_pointer_cast<srt_session_base>(srt_socket_service::shared_from_this()));
+    void srt_session_base::begin_session(bool cookie_verified) {
         /// 设置服务端握手
-        srt_socket_service::connect_as_server();
-        srt_socket_service::begin();
+        srt_socket_service::connect_as_server(cookie_verified);
+        begin();
     }
 
     void srt_session_base::receive(const std::shared_ptr<srt_packet> &pkt, const std::shared_ptr<buffer> &buff) {
+        /// 转发到原poller的包在迁移之后才执行, 继续转发到新的poller
+        if (!in_poller_thread()) {
+            std::weak_ptr<srt_session_base> self(std::static_pointer_cast<srt_session_base>(srt_socket_service::shared_from_this()));
+            return get_poller()->async([self, pkt, buff]() {
+                if (auto stronger_self = self.lock()) {
+                    stronger_self->receive(pkt, buff);
+                }
+            });
+        }
         return srt_socket_service::input_packet(pkt, buff);
     }
 
+    void srt_session_base::migrate(const event_poller::Ptr &poller) {
+        if (!poller) {
+            return;
+        }
+        std::weak_ptr<srt_session_base> self(std::static_pointer_cast<srt_session_base>(srt_socket_service::shared_from_this()));
+        poller_async([self, poller]() {
+            if (auto stronger_self = self.lock()) {
+                stronger_self->migrate_l(poller);
+            }
+        });
+    }
+
+    void srt_session_base::migrate_l(const event_poller::Ptr &target) {
+        auto source = get_poller();
+        if (source == target) {
+            return;
+        }
+        auto server = _parent_server.lock();
+        if (!server || !is_connected()) {
+            Warn("only connected sessions can migrate, sock_id={}", get_sock_id());
+            return;
+        }
+        /// 新的poller上的监听socket, 共享socket时用它发送, 独立socket时用它处理其他连接的握手
+        auto listener = server->get_listener(target);
+        if (!_connected_socket && !listener) {
+            Warn("no listener socket on the target poller, keep the session, sock_id={}", get_sock_id());
+            return;
+        }
+        std::shared_ptr<asio::ip::udp::socket> sock;
+        if (_connected_socket) {
+            /// 取消原poller中的读取, fd重新注册到新的poller, 期间到达的包留在内核缓冲区中
+            sock = std::make_shared<asio::ip::udp::socket>(target->get_executor());
+            std::error_code e;
+            auto fd = _sock->release(e);
+            if (!e) {
+                sock->assign(_local.protocol(), fd, e);
+            }
+            if (e) {
+                Error("move connected socket to the target poller failed, {}, sock_id={}", e.message(), get_sock_id());
+                return on_error_in(e);
+            }
+            if (_sock_buffer_timer) {
+                _sock_buffer_timer->cancel();
+                _sock_buffer_timer = nullptr;
+            }
+        }
+        /// 原线程不再直接分发这个会话的包, 之后到达的包经过全局会话表转发到新的poller
+        server->remove_local_session(get_peer_sock_id());
+        if (listener) {
+            _listener = listener;
+        }
+        _sock = sock ? sock : listener;
+        srt_socket_service::migrate_poller(target);
+        std::weak_ptr<srt_session_base> self(std::static_pointer_cast<srt_session_base>(srt_socket_service::shared_from_this()));
+        target->async([self]() {
+            if (auto stronger_self = self.lock()) {
+                stronger_self->on_migrated();
+            }
+        });
+    }
+
+    void srt_session_base::on_migrated() {
+        auto server = _parent_server.lock();
+        /// 执行之前又迁移到了其他poller, 由最后一次迁移处理
+        if (!server || !is_connected() || !in_poller_thread()) {
+            return;
+        }
+        server->add_local_session(std::static_pointer_cast<srt_session_base>(srt_socket_service::shared_from_this()));
+        server->_migrated_sessions.fetch_add(1, std::memory_order_relaxed);
+        if (_connected_socket) {
+            read_l();
+            start_socket_buffer_timer();
+        } else if (get_kernel_pacing_active()) {
+            /// 新的监听socket也需要开启SO_TXTIME
+            enable_kernel_txtime();
+        }
+        Debug("session migrated, sock_id={}", get_sock_id());
+    }
+
     void srt_session_base::on_session_timeout() {
         auto server = _parent_server.lock();
         if (!server) {
             return;
         }
-        server->remove_cookie_session(cookie_);
+        server->remove_cookie_session(cookie_key_);
     }
     const asio::ip::udp::endpoint &srt_session_base::get_remote_endpoint() {
         return _remote;
@@ -89,7 +187,7 @@ namespace srt {
         if (!server) {
             return;
         }
-        server->remove_cookie_session(cookie_);
+        server->remove_cookie_session(cookie_key_);
         server->add_connected_session(std::static_pointer_cast<srt_session_base>(srt_socket_service::shared_from_this()));
         Trace("new srt session handshake done, session_id={}, stream_id={}", get_sock_id(), get_stream_id());
         std::weak_ptr<srt_session_base> self(std::static_pointer_cast<srt_session_base>(srt_socket_service::shared_from_this()));
@@ -100,14 +198,215 @@ namespace srt {
         });
     }
 
-    void srt_session_base::send(const std::shared_ptr<buffer> &buff, const asio::ip::udp::endpoint &where) {
+    void srt_session_base::on_handshake_done() {
+        auto server = _parent_server.lock();
+        if (!server) {
+            return;
+        }
+        /// 对端收到conclusion之后按照协商的mss发送, 数据报可能经过任意poller上的监听socket
+        server->update_receive_size(get_receive_size());
+        if (!server->get_connected_session_socket()) {
+            return;
+        }
+        /// 和监听socket绑定同一个端口, connect之后内核按照四元组直接分发到这个socket
+        auto sock = std::make_shared<asio::ip::udp::socket>(get_poller()->get_executor());
+        std::error_code e;
+        sock->open(_local.protocol(), e);
+        if (!e) {
+            sock->set_option(asio::socket_base::reuse_address(true), e);
+        }
+        if (!e) {
+            srt_server::set_reuse_port(*sock, e);
+        }
+        if (!e) {
+            sock->bind(_local, e);
+        }
+        if (!e) {
+            sock->connect(_remote, e);
+        }
+        if (e) {
+            Warn("create connected socket failed, use the listener socket, {}, sock_id={}", e.message(), get_sock_id());
+            std::error_code ignored;
+            sock->close(ignored);
+            return;
+        }
+        sock->native_non_blocking(true);
+        auto fd = sock->native_handle();
+        _sock_buffer.update(fd, 0);
+        _receive_offload = udp_offload::enable_gro(fd);
+        udp_offload::enable_receive_timestamp(fd);
+        socket_buffer::enable_drop_counter(fd);
+        _sock = sock;
+        _connected_socket = true;
+        Debug("session use connected socket, remote={}:{}, sock_id={}", _remote.address().to_string(), _remote.port(), get_sock_id());
+        read_l();
+        start_socket_buffer_timer();
+    }
+
+    void srt_session_base::read_l() {
+        std::weak_ptr<srt_session_base> self(std::static_pointer_cast<srt_session_base>(srt_socket_service::shared_from_this()));
+        std::weak_ptr<asio::ip::udp::socket> sock_self(_sock);
+        _sock->async_wait(asio::ip::udp::socket::wait_read, [self, sock_self](const std::error_code &e) {
+            auto stronger_self = self.lock();
+            auto sock_stronger_self = sock_self.lock();
+            if (!stronger_self || !sock_stronger_self || e) {
+                return;
+            }
+            stronger_self->receive_l();
+            if (sock_stronger_self->is_open()) {
+                stronger_self->read_l();
+            }
+        });
+    }
+
+    void srt_session_base::receive_l() {
+        static thread_local auto endpoint = std::make_shared<asio::ip::udp::endpoint>();
+        auto &pool = buffer_pool::this_thread();
+        auto server = _parent_server.lock();
+        auto on_segment = [&](const std::shared_ptr<buffer> &segment, const udp_receive_info &info) {
+            uint32_t drops = 0;
+            if (info.drop_counter) {
+                drops = _sock_buffer.on_drop_counter(_sock->native_handle(), info.drop_counter);
+                if (server) {
+                    server->_kernel_drops.fetch_add(drops, std::memory_order_relaxed);
+                }
+            }
+            on_socket_receive(segment, *endpoint, info.arrival, drops);
+        };
+        /// 一次唤醒最多读取的次数, 避免一个socket长时间占用poller
+        for (int i = 0; i < 64 && _sock->is_open(); i++) {
+            std::error_code e;
+            /// 每个数据报读到池中独立的buffer里, 交付给应用层时不再拷贝
+            /// 对端的数据报不超过协商的mss, 缓冲区不按照协议允许的最大值分配
+            auto length = udp_offload::receive_segments(_sock->native_handle(), pool, get_receive_size(), _receive_offload, endpoint.get(), e, on_segment);
+            if (length < 0) {
+                return;
+            }
+            if (server) {
+                server->_receive_syscalls.fetch_add(1, std::memory_order_relaxed);
+                server->_receive_bytes.fetch_add(length, std::memory_order_relaxed);
+            }
+        }
+    }
+
+    void srt_session_base::on_socket_receive(const std::shared_ptr<buffer> &buff, const asio::ip::udp::endpoint &from, const std::chrono::steady_clock::time_point &arrival,
+                                             uint32_t kernel_drops) {
         try {
-            if (!_sock.native_non_blocking()) {
-                _sock.native_non_blocking(true);
+            auto pkt = from_buffer(buff->data(), buff->size());
+            /// bind之后connect之前可能收到其他连接的包, 交给服务端分发
+            if (pkt->get_socket_id() != get_peer_sock_id()) {
+                /// 迁移到没有监听socket的poller之后, 监听socket不属于本线程, 丢弃这样的包
+                auto server = _parent_server.lock();
+                if (server && server->get_listener(get_poller()) == _listener) {
+                    server->on_receive(buff, from, _listener, get_poller(), arrival, kernel_drops);
+                }
+                return;
             }
-            auto ret = _sock.send_to(asio::buffer(buff->data(), buff->size()), where);
+            pkt->set_arrival_time(arrival);
+            pkt->set_kernel_drops(kernel_drops);
+            buff->remove(16);
+            return srt_socket_service::input_packet(pkt, buff);
         } catch (const std::system_error &e) {
-            return on_error_in(e.code());
+            Error("catch exception, code={}, msg={}", e.code().value(), e.what());
+        }
+    }
+
+    void srt_session_base::start_socket_buffer_timer() {
+        std::weak_ptr<srt_session_base> self(std::static_pointer_cast<srt_session_base>(srt_socket_service::shared_from_this()));
+        _sock_buffer_timer = get_poller()->do_delay_task(std::chrono::milliseconds(1000), [self]() -> size_t {
+            auto stronger_self = self.lock();
+            if (!stronger_self || !stronger_self->in_poller_thread() || !stronger_self->_sock->is_open()) {
+                return 0;
+            }
+            stronger_self->_sock_buffer.update(stronger_self->_sock->native_handle(), stronger_self->get_bandwidth_delay_product());
+            return 1000;
+        });
+    }
+
+    void srt_session_base::send(const std::shared_ptr<buffer> &buff, const asio::ip::udp::endpoint &where) {
+        return send_to(asio::buffer(buff->data(), buff->size()), where);
+    }
+
+    void srt_session_base::send(const std::shared_ptr<buffer> &header, const packet_payload &payload, const asio::ip::udp::endpoint &where) {
+        std::array<asio::const_buffer, 2> buffers{asio::buffer(header->data(), header->size()), asio::buffer(payload.data, payload.size)};
+        return send_to(buffers, where);
+    }
+
+    bool srt_session_base::send_at(const std::shared_ptr<buffer> &header, const packet_payload &payload, const asio::ip::udp::endpoint &where, uint64_t launch_ns) {
+        if (!_sock->native_non_blocking()) {
+            _sock->native_non_blocking(true);
+        }
+        std::error_code e;
+        socket_pacing::send_at(_sock->native_handle(), header->data(), header->size(), payload.data, payload.size, _connected_socket ? nullptr : where.data(),
+                               _connected_socket ? 0 : where.size(), launch_ns, e);
+        if (e && socket_pacing::is_unsupported(e)) {
+            return false;
+        }
+        if (e && !is_transient_send_error(e)) {
+            on_error_in(e);
+        }
+        return true;
+    }
+
+    bool srt_session_base::enable_kernel_txtime() {
+        return socket_pacing::enable_txtime(_sock->native_handle());
+    }
+
+    bool srt_session_base::set_kernel_pacing_rate(uint64_t bytes_per_second) {
+        if (!_connected_socket) {
+            return false;
+        }
+        return socket_pacing::set_max_pacing_rate(_sock->native_handle(), bytes_per_second);
+    }
+
+    bool srt_session_base::send_segments(const std::vector<asio::const_buffer> &buffers, uint16_t segment_size, const asio::ip::udp::endpoint &where) {
+        if (!_sock->native_non_blocking()) {
+            _sock->native_non_blocking(true);
+        }
+        std::error_code e;
+        udp_offload::send_segments(_sock->native_handle(), buffers.data(), buffers.size(), segment_size, _connected_socket ? nullptr : where.data(),
+                                   _connected_socket ? 0 : where.size(), e);
+        if (e && udp_offload::is_unsupported(e)) {
+            return false;
+        }
+        if (e && !is_transient_send_error(e)) {
+            on_error_in(e);
+        }
+        return true;
+    }
+
+    bool srt_session_base::segmentation_offload_supported() {
+        return udp_offload::gso_supported(_sock->native_handle());
+    }
+
+    bool srt_session_base::enable_path_mtu_probe() {
+        if (!_connected_socket) {
+            return false;
+        }
+        return path_mtu::enable_probe(_sock->native_handle());
+    }
+
+    uint32_t srt_session_base::get_kernel_path_mtu() {
+        if (!_connected_socket) {
+            return 0;
+        }
+        return path_mtu::query(_sock->native_handle());
+    }
+
+    template<typename ConstBufferSequence>
+    void srt_session_base::send_to(const ConstBufferSequence &buffers, const asio::ip::udp::endpoint &where) {
+        if (!_sock->native_non_blocking()) {
+            _sock->native_non_blocking(true);
+        }
+        std::error_code e;
+        /// connect之后的socket不需要每次查找路由
+        if (_connected_socket) {
+            _sock->send(buffers, 0, e);
+        } else {
+            _sock->send_to(buffers, where, 0, e);
+        }
+        if (e && !is_transient_send_error(e)) {
+            return on_error_in(e);
         }
     }
 
@@ -120,6 +419,11 @@ namespace srt {
             return;
         }
         server->remove_session(get_peer_sock_id());
+        /// 关闭独立socket, 之后对端的包回到监听socket
+        if (_connected_socket) {
+            std::error_code ignored;
+            _sock->close(ignored);
+        }
         return onError(e);
     }
 
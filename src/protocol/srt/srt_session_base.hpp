@@ -26,7 +26,9 @@
 #ifndef TOOLKIT_SRT_SESSION_BASE_HPP
 #define TOOLKIT_SRT_SESSION_BASE_HPP
 #include "executor.hpp"
+#include "net/socket_buffer.hpp"
 #include "srt_socket_service.hpp"
+#include <chrono>
 #include <memory>
 
 namespace srt {
@@ -38,6 +40,14 @@ namespace srt {
         srt_session_base(const std::shared_ptr<asio::ip::udp::socket> &_sock, const event_poller::Ptr &context);
         ~srt_session_base() override = default;
 
+    public:
+        /// 是否使用独立的connect之后的socket
+        bool has_connected_socket() const;
+        /// 把已经建立的连接迁移到另一个poller, 可以在任意线程调用, 迁移在原poller中异步进行
+        /// 独立socket的fd直接交给新的poller; 共享监听socket时改用新的poller上的监听socket, 没有时放弃迁移
+        /// 迁移过程中到达原poller的包和投递的任务都会转发到新的poller, 发送和接收队列中的数据不受影响
+        void migrate(const event_poller::Ptr &poller);
+
     protected:
         void onRecv(const std::shared_ptr<buffer> &) override = 0;
         virtual void onConnected() = 0;
@@ -53,24 +63,56 @@ namespace srt {
         void on_session_timeout();
         void set_parent(const std::shared_ptr<srt_server> &);
         void set_current_remote_endpoint(const asio::ip::udp::endpoint &);
-        void set_cookie(uint32_t);
+        /// key为握手中查找会话使用的cookie和对端socket id
+        void set_cookie(uint32_t cookie, uint64_t key);
         ///////////// socket_service_holder ////////////////
         uint32_t get_cookie() final;
         uint32_t get_unique_socket_id() final;
 
     private:
-        void begin_session();
+        void begin_session(bool cookie_verified);
         void receive(const std::shared_ptr<srt_packet> &, const std::shared_ptr<buffer> &buff);
         void on_connected() final;
+        /// 服务端开启了独立socket时, 创建绑定到监听端口并且connect到对端的socket, 之后的收发都不经过监听socket
+        void on_handshake_done() final;
+        void read_l();
+        /// 读取独立socket中所有可读的数据报, 直接交给本会话处理
+        void receive_l();
+        void on_socket_receive(const std::shared_ptr<buffer> &buff, const asio::ip::udp::endpoint &from, const std::chrono::steady_clock::time_point &arrival, uint32_t kernel_drops);
+        void start_socket_buffer_timer();
+        /// 在原poller线程中执行迁移
+        void migrate_l(const event_poller::Ptr &target);
+        /// 在新的poller线程中重新开始读取独立socket
+        void on_migrated();
         void send(const std::shared_ptr<buffer> &buff, const asio::ip::udp::endpoint &where) final;
+        void send(const std::shared_ptr<buffer> &header, const packet_payload &payload, const asio::ip::udp::endpoint &where) final;
+        /// 监听socket由所有会话共享, 只能使用每个包的发送时间点, 独立socket时才能设置整个socket的速度
+        bool send_at(const std::shared_ptr<buffer> &header, const packet_payload &payload, const asio::ip::udp::endpoint &where, uint64_t launch_ns) final;
+        bool enable_kernel_txtime() final;
+        bool set_kernel_pacing_rate(uint64_t bytes_per_second) final;
+        bool send_segments(const std::vector<asio::const_buffer> &buffers, uint16_t segment_size, const asio::ip::udp::endpoint &where) final;
+        bool segmentation_offload_supported() final;
+        /// 共享的监听socket上设置不分片会影响其他会话, 只有独立socket时才能探测路径MTU
+        bool enable_path_mtu_probe() final;
+        uint32_t get_kernel_path_mtu() final;
+        template<typename ConstBufferSequence>
+        void send_to(const ConstBufferSequence &buffers, const asio::ip::udp::endpoint &where);
         void on_error(const std::error_code &e) final;
 
     private:
         std::weak_ptr<srt_server> _parent_server;
-        asio::ip::udp::socket &_sock;
+        /// 收到握手的监听socket
+        std::shared_ptr<asio::ip::udp::socket> _listener;
+        /// 当前用于发送的socket, 开启独立socket之后为connect到对端的socket
+        std::shared_ptr<asio::ip::udp::socket> _sock;
+        bool _connected_socket = false;
+        bool _receive_offload = false;
+        socket_buffer _sock_buffer;
+        std::shared_ptr<event_poller::timer_type> _sock_buffer_timer;
         asio::ip::udp::endpoint _remote;
         asio::ip::udp::endpoint _local;
         uint32_t cookie_ = 0;
+        uint64_t cookie_key_ = 0;
         std::shared_ptr<executor> executor_;
     };
 };// namespace srt
@@ -23,20 +23,40 @@
 * SOFTWARE.
 */
 #include "srt_socket_base.hpp"
+#include "asio.hpp"
 #include "srt_error.hpp"
 #include <system_error>
 namespace srt {
+    constexpr uint32_t srt_socket_base::min_mss_limit;
+    constexpr uint32_t srt_socket_base::max_mss_limit;
 
     void srt_socket_base::set_max_payload(uint32_t length) {
         if (is_open()) {
             return;
         }
-        if (length > 1500) {
+        if (length > max_mss_limit) {
             throw std::system_error(make_srt_error(srt_error_code::too_large_payload));
         }
         this->max_payload = length == 0 ? 1500 : length;
     }
 
+    void srt_socket_base::set_min_payload(uint32_t length) {
+        if (is_open()) {
+            return;
+        }
+        if (length > max_mss_limit) {
+            throw std::system_error(make_srt_error(srt_error_code::too_large_payload));
+        }
+        this->min_payload = length < min_mss_limit ? min_mss_limit : length;
+    }
+
+    void srt_socket_base::set_path_mtu_discovery(bool on) {
+        if (is_open()) {
+            return;
+        }
+        this->path_mtu_discovery = on;
+    }
+
     void srt_socket_base::set_max_flow_window_size(uint32_t counts) {
         if (is_open()) {
             return;
@@ -93,10 +113,74 @@ namespace srt {
         this->max_receive_time_out = ms;
     }
 
+    void srt_socket_base::set_buffer_mode(bool on) {
+        if (is_open()) {
+            return;
+        }
+        this->buffer_mode = on;
+    }
+
+    void srt_socket_base::set_send_coalesce_delay(uint32_t us) {
+        if (is_open()) {
+            return;
+        }
+        this->send_coalesce_delay = us;
+    }
+
+    void srt_socket_base::set_max_bandwidth(uint64_t bytes_per_second) {
+        this->max_bandwidth.store(bytes_per_second);
+        on_rate_changed();
+    }
+
+    void srt_socket_base::set_input_bandwidth(uint64_t bytes_per_second) {
+        this->input_bandwidth.store(bytes_per_second);
+        on_rate_changed();
+    }
+
+    void srt_socket_base::set_overhead_bandwidth(uint32_t percent) {
+        if (percent < 5) {
+            percent = 5;
+        }
+        if (percent > 100) {
+            percent = 100;
+        }
+        this->overhead_bandwidth.store(percent);
+        on_rate_changed();
+    }
+
+    void srt_socket_base::set_max_reorder_tolerance(uint32_t packets) {
+        if (is_open()) {
+            return;
+        }
+        this->max_reorder_tolerance = packets;
+    }
+
+    void srt_socket_base::set_kernel_pacing(bool on) {
+        if (is_open()) {
+            return;
+        }
+        this->kernel_pacing = on;
+    }
+
+    void srt_socket_base::set_segmentation_offload(bool on) {
+        if (is_open()) {
+            return;
+        }
+        this->segmentation_offload = on;
+    }
+
     uint32_t srt_socket_base::get_max_payload() const {
         return this->max_payload;
     }
 
+    uint32_t srt_socket_base::get_min_payload() const {
+        return this->min_payload;
+    }
+
+    bool srt_socket_base::get_path_mtu_discovery() const {
+        return this->path_mtu_discovery;
+    }
+
     uint32_t srt_socket_base::get_max_flow_window_size() const {
         return this->max_flow_window_size;
     }
@@ -133,7 +217,43 @@ namespace srt {
         return this->max_receive_time_out;
     }
 
+    bool srt_socket_base::get_buffer_mode() const {
+        return this->buffer_mode;
+    }
+
+    uint32_t srt_socket_base::get_send_coalesce_delay() const {
+        return this->send_coalesce_delay;
+    }
+
+    uint64_t srt_socket_base::get_max_bandwidth() const {
+        return this->max_bandwidth.load();
+    }
+
+    uint64_t srt_socket_base::get_input_bandwidth() const {
+        return this->input_bandwidth.load();
+    }
+
+    uint32_t srt_socket_base::get_overhead_bandwidth() const {
+        return this->overhead_bandwidth.load();
+    }
+
+    uint32_t srt_socket_base::get_max_reorder_tolerance() const {
+        return this->max_reorder_tolerance;
+    }
+
+    bool srt_socket_base::get_kernel_pacing() const {
+        return this->kernel_pacing;
+    }
+
+    bool srt_socket_base::get_segmentation_offload() const {
+        return this->segmentation_offload;
+    }
+
     void srt_socket_base::set_peer_sock_id(uint32_t id){
         this->peer_sock_id = id;
     }
+
+    bool srt_socket_base::is_transient_send_error(const std::error_code &e) {
+        return e == asio::error::would_block || e == asio::error::try_again || e == asio::error::message_size;
+    }
 };// namespace srt
@@ -25,11 +25,18 @@
 
 #ifndef TOOLKIT_SRT_SOCKET_BASE_HPP
 #define TOOLKIT_SRT_SOCKET_BASE_HPP
+#include <atomic>
 #include <cstdint>
 #include <string>
+#include <system_error>
 namespace srt {
 
     class srt_socket_base {
+    public:
+        /// 握手允许的mss范围, 上限为常见的巨帧
+        static constexpr uint32_t min_mss_limit = 728;
+        static constexpr uint32_t max_mss_limit = 9000;
+
     public:
         virtual ~srt_socket_base() = default;
         /// 连接成功
@@ -37,7 +44,13 @@ namespace srt {
         virtual bool is_connected() = 0;
 
     public:
+        /// 最大mss(包含IP和UDP头), 不超过max_mss_limit, 握手时取两端的较小值
         void set_max_payload(uint32_t length);
+        /// 路径MTU探测的起点(mss), 认为路径一定能够通过的大小, 超过协商的mss时取协商值
+        void set_min_payload(uint32_t length);
+        /// 连接之后从最小mss开始, 用填充的keepalive探测路径MTU, 确认之后增大负载, 不超过协商的mss
+        /// 需要socket只属于一个连接(客户端或者会话独立socket), 否则使用最小mss
+        void set_path_mtu_discovery(bool on);
         void set_max_flow_window_size(uint32_t counts);
         void set_drop_too_late_packet(bool on);
         void set_time_based_deliver(uint32_t ms);
@@ -46,7 +59,26 @@ namespace srt {
         void set_sock_id(uint32_t id);
         void set_connect_timeout(uint32_t ms);
         void set_max_receive_time_out(uint32_t ms);
+        /// 文件模式(buffer mode), 不丢包, 使用文件拥塞控制
+        void set_buffer_mode(bool on);
+        /// 小包合并的最大等待时间(us), 连续的小数据合并成不超过最大负载的包, 0为不合并
+        void set_send_coalesce_delay(uint32_t us);
+        /// 以下码率设置可以在连接之后的任意时刻修改
+        /// 最大发送带宽(MAXBW, 字节/秒), 大于0时按照固定带宽发送, 优先级最高
+        void set_max_bandwidth(uint64_t bytes_per_second);
+        /// 输入码率(INPUTBW, 字节/秒), 大于0时按照输入码率加上重传开销发送, 为0时估计输入码率
+        void set_input_bandwidth(uint64_t bytes_per_second);
+        /// 重传开销(OHEADBW), 输入码率的百分比, 范围5-100, 同时限制重传占用的带宽
+        void set_overhead_bandwidth(uint32_t percent);
+        /// 最大乱序容忍度(LOSSMAXTTL, 包数量), 根据实际的乱序距离在0到该值之间调整, 0为不容忍
+        void set_max_reorder_tolerance(uint32_t packets);
+        /// 由内核(fq qdisc)按照每个包的发送时间点(SO_TXTIME)调度, socket不支持时回退到用户态定时器
+        void set_kernel_pacing(bool on);
+        /// 连续发送的等长数据包合并成一次UDP_SEGMENT(GSO)发送, socket不支持时逐个发送
+        void set_segmentation_offload(bool on);
         uint32_t get_max_payload() const;
+        uint32_t get_min_payload() const;
+        bool get_path_mtu_discovery() const;
         uint32_t get_max_flow_window_size() const;
         bool get_drop_too_late_packet() const;
         uint32_t get_time_based_deliver() const;
@@ -56,21 +88,44 @@ namespace srt {
         uint32_t get_peer_sock_id() const;
         uint32_t get_connect_timeout() const;
         uint32_t get_max_receive_time_out() const;
+        bool get_buffer_mode() const;
+        uint32_t get_send_coalesce_delay() const;
+        uint64_t get_max_bandwidth() const;
+        uint64_t get_input_bandwidth() const;
+        uint32_t get_overhead_bandwidth() const;
+        uint32_t get_max_reorder_tolerance() const;
+        bool get_kernel_pacing() const;
+        bool get_segmentation_offload() const;
 
     protected:
         void set_peer_sock_id(uint32_t id);
+        /// 发送缓冲区满或者超过路径MTU(探测包)时当作丢包处理, 由重传恢复, 不需要关闭连接
+        static bool is_transient_send_error(const std::error_code &e);
+        /// 码率设置发生变化
+        virtual void on_rate_changed() {}
 
     protected:
         bool drop_too_late_packet = true;
         bool report_nak = true;
         uint32_t time_deliver_ = 120;
         std::string stream_id;
-        uint32_t max_payload = 1500;
+        /// 连接之前是mss, 连接之后是数据包的负载大小, 路径MTU探测时由poller修改
+        std::atomic<uint32_t> max_payload{1500};
+        uint32_t min_payload = 1500;
+        bool path_mtu_discovery = false;
         uint32_t max_flow_window_size = 8192;
         uint32_t sock_id = 0;
         uint32_t peer_sock_id = 0;
         uint32_t connect_time_out = 3000;
         uint32_t max_receive_time_out = 10000;
+        bool buffer_mode = false;
+        uint32_t send_coalesce_delay = 0;
+        std::atomic<uint64_t> max_bandwidth{0};
+        std::atomic<uint64_t> input_bandwidth{0};
+        std::atomic<uint32_t> overhead_bandwidth{25};
+        uint32_t max_reorder_tolerance = 10;
+        bool kernel_pacing = false;
+        bool segmentation_offload = true;
     };
 
 };// namespace srt
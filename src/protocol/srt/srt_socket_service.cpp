@@ -24,9 +24,12 @@
 */
 #include "srt_socket_service.hpp"
 #include "Util/endian.hpp"
+#include "net/socket_pacing.hpp"
+#include "net/udp_offload.hpp"
 #include "packet_limited_send_rate_queue.hpp"
 #include "packet_receive_queue.hpp"
 #include "spdlog/logger.hpp"
+#include "srt_congestion.hpp"
 #include "srt_error.hpp"
 #include "srt_extension.h"
 #include "srt_handshake.h"
@@ -34,8 +37,63 @@
 #include <chrono>
 #include <numeric>
 #include <random>
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <climits>
+#include <sys/uio.h>
+#include <unistd.h>
+#endif
+#ifndef IOV_MAX
+#define IOV_MAX 1024
+#endif
 namespace srt {
     static constexpr uint32_t packet_max_seq = 0x7FFFFFFF;
+    /// 写入fd时合并的字节数
+    static constexpr size_t receive_fd_flush_bytes = 1024 * 1024;
+
+    static std::error_code write_to_fd(int fd, const std::vector<std::shared_ptr<buffer>> &buffers) {
+#ifdef _WIN32
+        for (const auto &buff: buffers) {
+            size_t offset = 0;
+            while (offset < buff->size()) {
+                auto ret = _write(fd, buff->data() + offset, static_cast<unsigned int>(buff->size() - offset));
+                if (ret < 0) {
+                    return std::error_code(errno, std::system_category());
+                }
+                offset += static_cast<size_t>(ret);
+            }
+        }
+#else
+        std::vector<struct iovec> iov(buffers.size());
+        for (size_t i = 0; i < buffers.size(); i++) {
+            iov[i].iov_base = (void *) buffers[i]->data();
+            iov[i].iov_len = buffers[i]->size();
+        }
+        size_t index = 0;
+        while (index < iov.size()) {
+            auto count = std::min<size_t>(iov.size() - index, IOV_MAX);
+            auto ret = ::writev(fd, &iov[index], static_cast<int>(count));
+            if (ret < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                return std::error_code(errno, std::system_category());
+            }
+            /// 处理部分写入
+            auto written = static_cast<size_t>(ret);
+            while (index < iov.size() && written >= iov[index].iov_len) {
+                written -= iov[index].iov_len;
+                ++index;
+            }
+            if (written > 0) {
+                iov[index].iov_base = (char *) iov[index].iov_base + written;
+                iov[index].iov_len -= written;
+            }
+        }
+#endif
+        return {};
+    }
 
     uint32_t srt_socket_service_holder::get_cookie() {
         return 0;
@@ -56,11 +114,105 @@ namespace srt {
     void srt_socket_service::begin() {}
 
     event_poller::Ptr srt_socket_service::get_poller() {
-        return this->poller;
+        return std::atomic_load(&this->poller);
+    }
+
+    bool srt_socket_service::in_poller_thread() {
+        return poller->is_current_thread();
+    }
+
+    void srt_socket_service::poller_async(const std::function<void()> &f) {
+        auto current = get_poller();
+        std::weak_ptr<srt_socket_service> self(shared_from_this());
+        current->async([self, current, f]() {
+            auto stronger_self = self.lock();
+            if (!stronger_self) {
+                return;
+            }
+            /// 投递之后连接迁移到了其他poller, 转发过去
+            if (stronger_self->get_poller() != current) {
+                return stronger_self->poller_async(f);
+            }
+            f();
+        });
+    }
+
+    void srt_socket_service::migrate_poller(const event_poller::Ptr &target) {
+        auto now = std::chrono::steady_clock::now();
+        auto remain_us = [&now](const asio::steady_timer &timer) -> uint32_t {
+            if (timer.expiry() <= now) {
+                return 0;
+            }
+            return (uint32_t) std::chrono::duration_cast<std::chrono::microseconds>(timer.expiry() - now).count();
+        };
+        /// 定时器剩余的时间, 在新的poller中按照原来的时间点继续
+        auto nak_us = report_nak_begin ? remain_us(_nak_timer) : 0;
+        auto ack_us = ack_begin ? remain_us(_ack_timer) : 0;
+        bool mtu_probing = !_mtu_search.is_done();
+        uint32_t mtu_ms = 10;
+        if (mtu_probing && _mtu_probe_timer) {
+            auto expiry = _mtu_probe_timer->expiry();
+            auto system_now = std::chrono::system_clock::now();
+            mtu_ms = expiry > system_now ? (uint32_t) std::chrono::duration_cast<std::chrono::milliseconds>(expiry - system_now).count() : 0;
+        }
+        _common_timer.cancel();
+        _nak_timer.cancel();
+        _ack_timer.cancel();
+        if (_mtu_probe_timer) {
+            _mtu_probe_timer->cancel();
+            _mtu_probe_timer = nullptr;
+        }
+        /// 之后其他线程投递的任务和转发的包都会进入新的poller
+        std::atomic_store(&poller, target);
+        _common_timer = asio::steady_timer(target->get_executor());
+        _nak_timer = asio::steady_timer(target->get_executor());
+        _ack_timer = asio::steady_timer(target->get_executor());
+        if (_sender_queue) {
+            _sender_queue->migrate(target);
+        }
+        std::weak_ptr<srt_socket_service> self(shared_from_this());
+        target->async([self, nak_us, ack_us, mtu_probing, mtu_ms]() {
+            auto stronger_self = self.lock();
+            if (!stronger_self || stronger_self->perform_error || !stronger_self->_is_connected.load(std::memory_order_relaxed) || !stronger_self->in_poller_thread()) {
+                return;
+            }
+            stronger_self->on_keep_alive_expired();
+            if (stronger_self->report_nak_begin) {
+                stronger_self->start_nak_timer(nak_us);
+            }
+            if (stronger_self->ack_begin) {
+                stronger_self->start_ack_timer(ack_us);
+            }
+            if (mtu_probing) {
+                stronger_self->start_path_mtu_probe(mtu_ms);
+            }
+        });
     }
 
     void srt_socket_service::connect() {
         Trace("srt socket begin connect to {}:{}", get_remote_endpoint().address().to_string(), get_remote_endpoint().port());
+        connect_point = std::chrono::steady_clock::now();
+        if (!_configured_mss) {
+            _configured_mss = get_max_payload();
+        }
+        /// 重连到同一个地址时使用上一次连接协商的参数和cookie直接发送conclusion
+        if (_connection_cache.cookie && _connection_cache.remote == get_remote_endpoint()) {
+            set_max_payload(_connection_cache.max_payload);
+            set_max_flow_window_size(_connection_cache.window_size);
+            set_time_based_deliver(_connection_cache.time_deliver);
+            set_drop_too_late_packet(_connection_cache.drop);
+            set_report_nak(_connection_cache.nak);
+            _is_open.store(true, std::memory_order_relaxed);
+            std::default_random_engine random(std::random_device{}());
+            std::uniform_int_distribution<int32_t> mt(0, (std::numeric_limits<int32_t>::max)());
+            _fast_connecting = true;
+            return send_conclusion(static_cast<uint32_t>(mt(random)), _connection_cache.cookie);
+        }
+        _is_open.store(true, std::memory_order_relaxed);
+        return send_induction();
+    }
+
+    void srt_socket_service::send_induction() {
         std::default_random_engine random(std::random_device{}());
         std::uniform_int_distribution<int32_t> mt(0, (std::numeric_limits<int32_t>::max)());
 
@@ -74,6 +226,8 @@ namespace srt {
         ctx._window_size = srt_socket_service::get_max_flow_window_size();
         ctx._req_type = srt::handshake_context::urq_induction;
         ctx.address = get_local_endpoint().address();
+        /// 本端的socket id, 对端之后的包都以它为目的socket id
+        ctx._socket_id = get_unique_socket_id();
 
 
         srt_packet pkt;
@@ -84,21 +238,70 @@ namespace srt {
         handshake_context::to_buffer(ctx, _pkt);
         /// save induction message
         handshake_buffer = _pkt;
-        connect_point = std::chrono::steady_clock::now();
-        {
-            _next_func = std::bind(&srt_socket_service::handle_server_induction, this, std::placeholders::_1);
-            _next_func_with_pkt = std::bind(&srt_socket_service::handle_server_induction_1, this, std::placeholders::_1, std::placeholders::_2);
-        }
-        _is_open.store(true, std::memory_order_relaxed);
+        _receive_state = receive_state::server_induction;
         /// 开始定时器, 每隔一段时间发送induction包
         return on_handshake_expired(true);
     }
 
-    void srt_socket_service::connect_as_server() {
-        _next_func = std::bind(&srt_socket_service::handle_client_induction, this, std::placeholders::_1);
-        _next_func_with_pkt = std::bind(&srt_socket_service::handle_client_induction_1, this, std::placeholders::_1, std::placeholders::_2);
+    void srt_socket_service::connect_as_server(bool cookie_verified) {
+        _receive_state = receive_state::client_induction;
         connect_point = std::chrono::steady_clock::now();
         is_server = true;
+        /// 等同于已经完成了induction
+        if (cookie_verified) {
+            handshake_conclusion = 1;
+        }
+    }
+
+    void srt_socket_service::reset_connection() {
+        _common_timer.cancel();
+        _nak_timer.cancel();
+        _ack_timer.cancel();
+        _is_connected.store(false, std::memory_order_relaxed);
+        _is_open.store(false, std::memory_order_relaxed);
+        perform_error = false;
+        handshake_conclusion = 0;
+        _handshake_cookie = 0;
+        _fast_connecting = false;
+        _fast_connected.store(false, std::memory_order_relaxed);
+        report_nak_begin = false;
+        nak_waiting_reorder = false;
+        ack_begin = false;
+        ack_number = 1;
+        handshake_buffer = nullptr;
+        keep_alive_buffer = nullptr;
+        _handshake_context = nullptr;
+        _file_congestion = nullptr;
+        _ack_queue_ = std::make_shared<srt::srt_ack_queue>();
+        _ack_frequency.reset();
+        _message_assembler.reset(0, packet_max_seq);
+        /// 连接之后max_payload是负载大小, 恢复成配置的mss重新协商
+        if (_configured_mss) {
+            srt_socket_base::max_payload = _configured_mss;
+        }
+        _negotiated_mss = 0;
+        _path_mss.store(0, std::memory_order_relaxed);
+        _mtu_search = srt_mtu_search();
+        if (_mtu_probe_timer) {
+            _mtu_probe_timer->cancel();
+            _mtu_probe_timer = nullptr;
+        }
+    }
+
+    bool srt_socket_service::get_fast_connected() const {
+        return _fast_connected.load(std::memory_order_relaxed);
+    }
+
+    uint32_t srt_socket_service::get_path_mss() const {
+        return _path_mss.load(std::memory_order_relaxed);
+    }
+
+    uint32_t srt_socket_service::get_receive_size() const {
+        /// 连接之前max_payload还是mss, 连接之后换算成了负载, 改用协商的mss
+        if (_negotiated_mss) {
+            return _negotiated_mss;
+        }
+        return max_payload.load(std::memory_order_relaxed);
     }
 
     void srt_socket_service::do_handshake_expired() {
@@ -120,6 +323,12 @@ namespace srt {
         if (ts > get_connect_timeout()) {
             return do_handshake_expired();
         }
+        /// 服务端没有回复缓存cookie的conclusion, 可能不支持跳过induction
+        if (_fast_connecting && ts >= 500) {
+            Debug("no response to the cached cookie, fall back to induction");
+            _fast_connecting = false;
+            return send_induction();
+        }
 
         if (try_send_again) {
             set_packet_timestamp(handshake_buffer, ts);
@@ -135,7 +344,7 @@ namespace srt {
             if (!stronger_self) {
                 return;
             }
-            if (e) return;
+            if (e || !stronger_self->in_poller_thread()) return;
             return stronger_self->on_handshake_expired(try_send_again);
         });
     }
@@ -148,8 +357,11 @@ namespace srt {
         auto current_time = std::chrono::steady_clock::now();
         uint32_t leave_last_receive_time_point = (uint32_t) std::chrono::duration_cast<std::chrono::milliseconds>(current_time - last_receive_point).count();
         if (leave_last_receive_time_point >= srt_socket_service::max_receive_time_out) {
-            return do_shutdown();
+            return do_shutdown(srt_error_code::lost_peer_connection);
         }
+        /// 没有在途数据时释放按需增长的接收槽位和ack窗口, 空闲会话只保留keepalive定时器
+        _receive_queue->shrink();
+        _ack_queue_->shrink();
 
         std::weak_ptr<srt_socket_service> self(shared_from_this());
         auto func = [self](const std::error_code &e) {
@@ -157,7 +369,7 @@ namespace srt {
             if (!stronger_self) {
                 return;
             }
-            if (e) return;
+            if (e || !stronger_self->in_poller_thread()) return;
             stronger_self->on_keep_alive_expired();
         };
 
@@ -181,12 +393,90 @@ namespace srt {
         _common_timer.async_wait(func);
     }
 
+    void srt_socket_service::update_path_mss(uint32_t mss) {
+        srt_socket_service::max_payload = mss - srt_mtu_search::header_size;
+        _path_mss.store(mss, std::memory_order_relaxed);
+        if (_sender_queue) {
+            _sender_queue->set_max_payload(get_max_payload());
+        }
+        Debug("path mss={}, payload={}, sock_id={}", mss, get_max_payload(), get_sock_id());
+    }
+
+    void srt_socket_service::start_path_mtu_probe(uint32_t delay_ms) {
+        std::weak_ptr<srt_socket_service> self(shared_from_this());
+        _mtu_probe_timer = poller->do_delay_task(std::chrono::milliseconds(delay_ms), [self]() -> size_t {
+            auto stronger_self = self.lock();
+            if (!stronger_self || !stronger_self->in_poller_thread()) {
+                return 0;
+            }
+            return stronger_self->on_path_mtu_probe();
+        });
+    }
+
+    size_t srt_socket_service::on_path_mtu_probe() {
+        if (perform_error || !_is_connected.load(std::memory_order_relaxed)) {
+            return 0;
+        }
+        _mtu_search.on_probe_timeout();
+        auto mss = _mtu_search.next_probe();
+        if (!mss) {
+            Info("path mtu discovery done, mss={}, payload={}, sock_id={}", _mtu_search.get_mss(), get_max_payload(), get_sock_id());
+            if (_mtu_search.get_mss() >= _mtu_search.get_max_mss()) {
+                return 0;
+            }
+            /// 路径可能发生变化, 一段时间之后从当前的mss重新向上探测
+            _mtu_search.reset(_mtu_search.get_mss(), _mtu_search.get_max_mss());
+            return srt_mtu_search::raise_interval;
+        }
+        send_path_mtu_probe(mss);
+        /// 等待两个RTT
+        return std::max<size_t>(srt_mtu_search::min_probe_timeout, 2 * _ack_queue_->get_rto() / 1000);
+    }
+
+    void srt_socket_service::send_path_mtu_probe(uint32_t mss) {
+        srt_packet pkt;
+        pkt.set_control_type(control_type::keepalive);
+        pkt.set_type_information(mss);
+        pkt.set_socket_id(get_sock_id());
+        pkt.set_timestamp(get_time_from<std::chrono::microseconds>(connect_point));
+        /// 包头之后用0填充, 数据报和负载为mss - header_size的数据包一样大
+        size_t length = mss - srt_mtu_search::header_size + 16;
+        auto probe = create_packet(pkt, length);
+        probe->resize(length);
+        Trace("send path mtu probe, mss={}, sock_id={}", mss, get_sock_id());
+        send_in(probe, get_remote_endpoint());
+    }
+
     void srt_socket_service::input_packet(const std::shared_ptr<buffer> &buff) {
-        _next_func(buff);
+        switch (_receive_state) {
+            case receive_state::connected:
+                return handle_receive(buff);
+            case receive_state::server_induction:
+                return handle_server_induction(buff);
+            case receive_state::server_conclusion:
+                return handle_server_conclusion(buff);
+            case receive_state::client_induction:
+                return handle_client_induction(buff);
+            case receive_state::none:
+                Trace("not connecting, ignore packet, sock_id={}", get_sock_id());
+                return;
+        }
     }
 
     void srt_socket_service::input_packet(const std::shared_ptr<srt_packet> &pkt, const std::shared_ptr<buffer> &buff) {
-        _next_func_with_pkt(pkt, buff);
+        switch (_receive_state) {
+            case receive_state::connected:
+                return handle_receive_1(pkt, buff);
+            case receive_state::server_induction:
+                return handle_server_induction_1(pkt, buff);
+            case receive_state::server_conclusion:
+                return handle_server_conclusion_1(pkt, buff);
+            case receive_state::client_induction:
+                return handle_client_induction_1(pkt, buff);
+            case receive_state::none:
+                Trace("not connecting, ignore packet, sock_id={}", get_sock_id());
+                return;
+        }
     }
 
     bool srt_socket_service::is_open() {
@@ -198,40 +488,313 @@ namespace srt {
     }
 
     int srt_socket_service::async_send(const char *data, size_t length) {
-        auto mss = get_max_payload();
-        size_t write_bytes = length;
-        size_t offset = 0;
-        int ret = 0;
-        while (write_bytes > 0) {
-            /// 最后一个包
-            if (write_bytes <= mss) {
-                ret = async_send(std::make_shared<buffer>(data + offset, write_bytes));
-                if (ret > 0) {
-                    write_bytes -= ret;
-                }
-                break;
+        std::error_code e;
+        return async_send(data, length, e);
+    }
+
+    int srt_socket_service::async_send(const std::shared_ptr<buffer> &buff) {
+        std::error_code e;
+        return async_send(buff, e);
+    }
+
+    int srt_socket_service::async_send(const char *data, size_t length, std::error_code &e) {
+        if (!length) {
+            return 0;
+        }
+        /// 只拷贝一次, 超过最大负载的部分由各个包引用同一块内存
+        return async_send(std::make_shared<buffer>(data, length), e);
+    }
+
+    int srt_socket_service::async_send(const std::shared_ptr<buffer> &buff, std::error_code &e) {
+        if (!_is_connected.load(std::memory_order_relaxed)) {
+            e = make_srt_error(srt_error_code::not_connected_yet);
+            return -1;
+        }
+
+        auto high = _send_high_water.load(std::memory_order_relaxed);
+        if (high && _sender_queue->get_buffered_bytes() + buff->size() > high) {
+            wait_writable(e);
+            return 0;
+        }
+
+        size_t mss = get_max_payload();
+        if (buff->size() <= mss) {
+            auto ret = _sender_queue->input_packet(buff, 0, 0);
+            if (ret == 0) {
+                /// 拥塞窗口已满
+                wait_writable(e);
             }
-            ret = async_send(std::make_shared<buffer>(data + offset, write_bytes));
-            if (ret == -1 || ret == 0) {
+            return ret;
+        }
+        /// 按最大负载切分, 每个包只生成自己的包头, 负载(包括重传)引用同一个buffer
+        /// 一个buffer扇出给多个连接时, 每个连接只增加包头的内存
+        size_t offset = 0;
+        while (offset < buff->size()) {
+            packet_payload payload;
+            payload.holder = buff;
+            payload.data = buff->data() + offset;
+            payload.size = (std::min)(mss, buff->size() - offset);
+            if (_sender_queue->input_payload(payload) <= 0) {
+                wait_writable(e);
                 break;
             }
-            /// 移动
-            offset += mss;
-            write_bytes -= mss;
+            offset += payload.size;
         }
-        return ret == -1 ? -1 : static_cast<int>(length - write_bytes);
+        return static_cast<int>(offset);
     }
 
-    int srt_socket_service::async_send(const std::shared_ptr<buffer> &buff) {
-        if (buff->size() > get_max_payload()) {
-            throw std::system_error(make_srt_error(srt_error_code::too_large_payload));
-        }
+    int srt_socket_service::async_send_message(const char *data, size_t length, std::error_code &e) {
+        return async_send_message(std::make_shared<buffer>(data, length), e);
+    }
 
+    int srt_socket_service::async_send_message(const std::shared_ptr<buffer> &buff, std::error_code &e) {
         if (!_is_connected.load(std::memory_order_relaxed)) {
+            e = make_srt_error(srt_error_code::not_connected_yet);
+            return -1;
+        }
+
+        size_t mss = get_max_payload();
+        size_t count = (buff->size() + mss - 1) / mss;
+        if (!count) {
+            return 0;
+        }
+
+        if (count > _sender_queue->get_window_size()) {
+            e = make_srt_error(srt_error_code::too_large_message);
             return -1;
         }
 
-        return _sender_queue->input_packet(buff, 0, 0);
+        auto high = _send_high_water.load(std::memory_order_relaxed);
+        if (high && _sender_queue->get_buffered_bytes() + buff->size() > high) {
+            wait_writable(e);
+            return 0;
+        }
+        /// 分片直接引用消息的内存
+        std::vector<packet_payload> fragments(count);
+        for (size_t i = 0; i < count; i++) {
+            auto offset = i * mss;
+            fragments[i].holder = buff;
+            fragments[i].data = buff->data() + offset;
+            fragments[i].size = std::min(mss, buff->size() - offset);
+        }
+
+        auto ret = _sender_queue->input_message(fragments);
+        if (ret == 0) {
+            wait_writable(e);
+        }
+        return ret;
+    }
+
+    void srt_socket_service::set_send_buffer_water_mark(uint32_t high, uint32_t low) {
+        if (low == 0 || low > high) {
+            low = high / 2;
+        }
+        _send_high_water.store(high);
+        _send_low_water.store(low);
+    }
+
+    uint64_t srt_socket_service::get_send_buffered_bytes() {
+        if (!_is_connected.load(std::memory_order_relaxed)) {
+            return 0;
+        }
+        return _sender_queue->get_buffered_bytes();
+    }
+
+    uint32_t srt_socket_service::get_send_buffered_time() {
+        if (!_is_connected.load(std::memory_order_relaxed)) {
+            return 0;
+        }
+        return _sender_queue->get_buffered_time();
+    }
+
+    uint32_t srt_socket_service::get_reorder_tolerance() {
+        if (!_is_connected.load(std::memory_order_relaxed)) {
+            return 0;
+        }
+        return _receive_queue->get_reorder_tolerance();
+    }
+
+    uint64_t srt_socket_service::get_belated_packets() {
+        if (!_is_connected.load(std::memory_order_relaxed)) {
+            return 0;
+        }
+        return _receive_queue->get_belated_count();
+    }
+
+    bool srt_socket_service::get_segmentation_offload_active() {
+        return _is_connected.load(std::memory_order_relaxed) && _segmentation_offload;
+    }
+
+    double srt_socket_service::get_send_bytes_per_syscall() {
+        auto syscalls = _send_syscalls.load(std::memory_order_relaxed);
+        return syscalls ? (double) _send_bytes.load(std::memory_order_relaxed) / (double) syscalls : 0;
+    }
+
+    uint32_t srt_socket_service::get_receive_delay() {
+        return _receive_delay.load(std::memory_order_relaxed);
+    }
+
+    uint64_t srt_socket_service::get_kernel_drops() {
+        return _kernel_drops.load(std::memory_order_relaxed);
+    }
+
+    uint64_t srt_socket_service::get_io_count() {
+        return _receive_packets.load(std::memory_order_relaxed) + _send_syscalls.load(std::memory_order_relaxed);
+    }
+
+    uint64_t srt_socket_service::get_lost_packets() {
+        if (!_is_connected.load(std::memory_order_relaxed)) {
+            return 0;
+        }
+        auto lost = _receive_queue->get_lost_count();
+        auto drops = _kernel_drops.load(std::memory_order_relaxed);
+        return lost > drops ? lost - drops : 0;
+    }
+
+    uint64_t srt_socket_service::get_bandwidth_delay_product() {
+        if (!_is_connected.load(std::memory_order_relaxed)) {
+            return 0;
+        }
+        /// 包头: srt 16字节, udp 8字节, ip 20字节
+        auto packet_size = (uint64_t) get_max_payload() + 44;
+        uint64_t rate = 0;
+        if (get_max_bandwidth() || get_input_bandwidth()) {
+            rate = _sender_queue->get_bandwidth_mode()->get_bandwidth();
+        }
+        rate = (std::max)(rate, (uint64_t) _packet_receive_rate_->get_bandwidth() * packet_size);
+        auto bdp = rate * _ack_queue_->get_rto() / 1000000;
+        return (std::min)(bdp, (uint64_t) get_max_flow_window_size() * packet_size);
+    }
+
+    bool srt_socket_service::get_kernel_pacing_active() {
+        if (!_is_connected.load(std::memory_order_relaxed)) {
+            return false;
+        }
+        return _sender_queue->get_kernel_pacing();
+    }
+
+    void srt_socket_service::async_send_file(const std::shared_ptr<mapped_file> &file, size_t offset, size_t length, const std::function<void(const std::error_code &)> &f) {
+        std::weak_ptr<srt_socket_service> self(shared_from_this());
+        poller_async([self, file, offset, length, f]() {
+            auto stronger_self = self.lock();
+            if (!stronger_self) {
+                return;
+            }
+            std::function<void(const std::error_code &)> on_complete = f;
+            if (!on_complete) {
+                on_complete = [](const std::error_code &) {};
+            }
+
+            std::error_code e;
+            if (!stronger_self->_is_connected.load(std::memory_order_relaxed)) {
+                e = make_srt_error(srt_error_code::not_connected_yet);
+            } else if (stronger_self->_send_file_context) {
+                /// 同一时间只允许发送一个文件
+                e = make_srt_error(srt_error_code::status_error);
+            } else if (!file || offset > file->size()) {
+                e = std::make_error_code(std::errc::invalid_argument);
+            }
+            if (e) {
+                stronger_self->get_executor()->async([on_complete, e]() { on_complete(e); });
+                return;
+            }
+
+            auto ctx = std::make_shared<send_file_context>();
+            ctx->file = file;
+            ctx->offset = offset;
+            ctx->end = offset + (std::min)(length, file->size() - offset);
+            ctx->on_complete = on_complete;
+            stronger_self->_send_file_context = ctx;
+            stronger_self->on_sender_writable();
+        });
+    }
+
+    void srt_socket_service::async_send_file(const std::string &path, const std::function<void(const std::error_code &)> &f) {
+        mapped_file::Ptr file;
+        try {
+            file = mapped_file::open(path);
+        } catch (const std::system_error &e) {
+            Error("open file {} failed, {}", path, e.what());
+            auto code = e.code();
+            if (f) {
+                get_executor()->async([f, code]() { f(code); });
+            }
+            return;
+        }
+        return async_send_file(file, 0, file->size(), f);
+    }
+
+    void srt_socket_service::set_receive_fd(int fd) {
+        std::weak_ptr<srt_socket_service> self(shared_from_this());
+        poller_async([self, fd]() {
+            if (auto stronger_self = self.lock()) {
+                stronger_self->flush_receive_fd();
+                stronger_self->_receive_fd = fd;
+            }
+        });
+    }
+
+    void srt_socket_service::wait_writable(std::error_code &e) {
+        e = make_srt_error(srt_error_code::send_buffer_full);
+        _wait_writable.store(true);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        /// 检查失败到标记之间poller可能已经发完缓存并收到最后一个ACK, 之后不会再调用on_sender_writable
+        /// 没有高水位时窗口里还有数据就还会收到ACK, 只有缓存全部清空才需要自己通知
+        auto high = _send_high_water.load(std::memory_order_relaxed);
+        auto low = high ? _send_low_water.load(std::memory_order_relaxed) : 0;
+        if (_sender_queue->get_buffered_bytes() <= low && _wait_writable.exchange(false)) {
+            notify_writable();
+        }
+    }
+
+    void srt_socket_service::notify_writable() {
+        std::weak_ptr<srt_socket_service> self(shared_from_this());
+        get_executor()->async([self]() {
+            if (auto stronger_self = self.lock()) {
+                stronger_self->onWritable();
+            }
+        });
+    }
+
+    void srt_socket_service::on_sender_writable() {
+        if (perform_error) {
+            return;
+        }
+        /// 和wait_writable配对: 缓存的变化先于读取等待标记, 写入方的标记先于读取缓存
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        /// 没有设置高水位时, 窗口可写就通知
+        if (_wait_writable.load(std::memory_order_relaxed)) {
+            auto high = _send_high_water.load(std::memory_order_relaxed);
+            if ((!high || _sender_queue->get_buffered_bytes() <= _send_low_water.load(std::memory_order_relaxed)) && _wait_writable.exchange(false)) {
+                notify_writable();
+            }
+        }
+        /// 发送队列在输入时可能同步回调, 避免重入
+        if (_writable_running || !_send_file_context) {
+            return;
+        }
+        auto ctx = _send_file_context;
+        auto mss = get_max_payload();
+        _writable_running = true;
+        while (ctx->offset < ctx->end) {
+            packet_payload payload;
+            payload.holder = ctx->file;
+            payload.data = ctx->file->data() + ctx->offset;
+            payload.size = (std::min)(static_cast<size_t>(mss), ctx->end - ctx->offset);
+            if (_sender_queue->input_payload(payload) <= 0) {
+                break;
+            }
+            ctx->offset += payload.size;
+        }
+        _writable_running = false;
+
+        /// 全部进入发送队列并且被对端确认
+        if (ctx->offset < ctx->end || _sender_queue->get_cached_size() || _sender_queue->get_buffer_size()) {
+            return;
+        }
+        _send_file_context = nullptr;
+        auto f = ctx->on_complete;
+        get_executor()->async([f]() { f(make_srt_error(srt_error_code::success)); });
     }
 
     void srt_socket_service::on_sender_packet(const packet_pointer &type) {
@@ -241,8 +804,69 @@ namespace srt {
         if (type->retransmit_count > 1) {
             set_retransmit(true, type->pkt);
         }
+        if (type->payload.size && type->launch_time) {
+            return send_in(type->pkt, type->payload, get_remote_endpoint(), type->launch_time);
+        }
+        if (type->payload.size && _segmentation_offload) {
+            return batch_sender_packet(type);
+        }
+        if (type->payload.size) {
+            return send_in(type->pkt, type->payload, get_remote_endpoint());
+        }
         return send_in(type->pkt, get_remote_endpoint());
     }
+    void srt_socket_service::batch_sender_packet(const packet_pointer &type) {
+        auto size = type->size();
+        /// 只有最后一个分段可以比分段大小短
+        if (!_send_batch.empty() && (size > _send_batch_segment || _send_batch.size() >= udp_offload::max_segments || _send_batch_bytes + size > udp_offload::max_bytes)) {
+            flush_sender_batch();
+        }
+        if (_send_batch.empty()) {
+            _send_batch_segment = size;
+        }
+        _send_batch.push_back(type);
+        _send_batch_bytes += size;
+        if (size < _send_batch_segment) {
+            flush_sender_batch();
+        }
+    }
+
+    void srt_socket_service::flush_sender_batch() {
+        if (_send_batch.empty()) {
+            return;
+        }
+        if (_send_batch.size() == 1) {
+            send_in(_send_batch[0]->pkt, _send_batch[0]->payload, get_remote_endpoint());
+            _send_batch.clear();
+            _send_batch_bytes = 0;
+            return;
+        }
+        _send_batch_buffers.clear();
+        for (const auto &item: _send_batch) {
+            _send_batch_buffers.emplace_back(item->pkt->data(), item->pkt->size());
+            _send_batch_buffers.emplace_back(item->payload.data, item->payload.size);
+        }
+        if (send_segments(_send_batch_buffers, (uint16_t) _send_batch_segment, get_remote_endpoint())) {
+            on_send_syscall(_send_batch_bytes);
+            last_send_point = std::chrono::steady_clock::now();
+        } else {
+            /// 例如网卡不支持校验和卸载, 之后逐个发送
+            Warn("segmentation offload is not supported, fall back to single sends, sock_id={}", get_sock_id());
+            _segmentation_offload = false;
+            for (const auto &item: _send_batch) {
+                send_in(item->pkt, item->payload, get_remote_endpoint());
+            }
+        }
+        _send_batch.clear();
+        _send_batch_buffers.clear();
+        _send_batch_bytes = 0;
+    }
+
+    void srt_socket_service::on_send_syscall(size_t bytes) {
+        _send_syscalls.fetch_add(1, std::memory_order_relaxed);
+        _send_bytes.fetch_add(bytes, std::memory_order_relaxed);
+    }
+
     /// 发送缓冲区 主动丢包回调
     void srt_socket_service::on_sender_drop_packet(size_t begin, size_t end) {
         if (perform_error) {
@@ -258,12 +882,34 @@ namespace srt {
         if (perform_error) {
             return;
         }
+        /// 文件模式下合并写入fd
+        if (_receive_fd >= 0) {
+            _receive_fd_bytes += type->pkt->size();
+            _receive_fd_cache.emplace_back(type->pkt);
+            if (_receive_fd_bytes >= receive_fd_flush_bytes) {
+                flush_receive_fd();
+            }
+            return;
+        }
+        std::vector<std::shared_ptr<buffer>> fragments;
+        if (!_message_assembler.input(type->seq, type->position, type->message_number, type->pkt, fragments)) {
+            return;
+        }
         std::weak_ptr<srt_socket_service> self(shared_from_this());
-        auto buff = std::make_shared<buffer>(type->pkt->data(), type->pkt->size());
         auto executor = get_executor();
-        return executor->async([self, buff]() {
+        /// 单包
+        if (type->position == 0b11) {
+            auto buff = type->pkt;
+            return executor->async([self, buff]() {
+                if (auto stronger_self = self.lock()) {
+                    stronger_self->onRecv(buff);
+                }
+            });
+        }
+        auto message = std::make_shared<std::vector<std::shared_ptr<buffer>>>(std::move(fragments));
+        return executor->async([self, message]() {
             if (auto stronger_self = self.lock()) {
-                stronger_self->onRecv(buff);
+                stronger_self->onRecvMessage(*message);
             }
         });
     }
@@ -272,6 +918,46 @@ namespace srt {
         Warn("active drop packet {}-{}", begin, end);
     }
 
+    void srt_socket_service::onRecvMessage(const std::vector<std::shared_ptr<buffer>> &fragments) {
+        size_t length = 0;
+        for (const auto &item : fragments) {
+            length += item->size();
+        }
+        auto buff = std::make_shared<buffer>();
+        buff->reserve(length);
+        for (const auto &item : fragments) {
+            buff->append(item->data(), item->size());
+        }
+        return onRecv(buff);
+    }
+
+    void srt_socket_service::flush_receive_fd() {
+        if (_receive_fd_cache.empty() || _receive_fd < 0) {
+            return;
+        }
+        auto cache = std::make_shared<std::vector<std::shared_ptr<buffer>>>();
+        cache->swap(_receive_fd_cache);
+        _receive_fd_bytes = 0;
+        _receive_fd_cache.reserve(cache->size());
+        auto fd = _receive_fd;
+        std::weak_ptr<srt_socket_service> self(shared_from_this());
+        /// 在executor中写入, 不阻塞io线程
+        get_executor()->async([self, fd, cache]() {
+            auto e = write_to_fd(fd, *cache);
+            if (!e) {
+                return;
+            }
+            Error("write to fd {} failed, {}", fd, e.message());
+            if (auto stronger_self = self.lock()) {
+                stronger_self->poller_async([self, e]() {
+                    if (auto stronger_self = self.lock()) {
+                        stronger_self->on_error_in(e);
+                    }
+                });
+            }
+        });
+    }
+
     void srt_socket_service::send_reject(int e, const std::shared_ptr<buffer> &buff) {
         Trace("send_reject, error_code={}", e);
         if (buff->size() < 40) {
@@ -290,28 +976,205 @@ namespace srt {
 
     void srt_socket_service::send_in(const std::shared_ptr<buffer> &buff, const asio::ip::udp::endpoint &where) {
         send(buff, where);
+        on_send_syscall(buff->size());
+        /// 更新 上一次发送的时间
+        last_send_point = std::chrono::steady_clock::now();
+    }
+
+    void srt_socket_service::send_in(const std::shared_ptr<buffer> &header, const packet_payload &payload, const asio::ip::udp::endpoint &where) {
+        send(header, payload, where);
+        on_send_syscall(header->size() + payload.size);
         /// 更新 上一次发送的时间
         last_send_point = std::chrono::steady_clock::now();
     }
 
+    void srt_socket_service::send_in(const std::shared_ptr<buffer> &header, const packet_payload &payload, const asio::ip::udp::endpoint &where, uint64_t launch_ns) {
+        if (!send_at(header, payload, where, launch_ns)) {
+            /// socket不再接受发送时间点, 回退到用户态定时器
+            Warn("send with launch time failed, fall back to timer pacing, sock_id={}", get_sock_id());
+            _sender_queue->set_kernel_pacing(false);
+            send(header, payload, where);
+        }
+        on_send_syscall(header->size() + payload.size);
+        /// 更新 上一次发送的时间
+        last_send_point = std::chrono::steady_clock::now();
+    }
+
+    void srt_socket_service::send(const std::shared_ptr<buffer> &header, const packet_payload &payload, const asio::ip::udp::endpoint &where) {
+        auto buff = std::make_shared<buffer>();
+        buff->reserve(header->size() + payload.size);
+        buff->append(header->data(), header->size());
+        buff->append(payload.data, payload.size);
+        return send(buff, where);
+    }
+
+
+    std::shared_ptr<bandwidth_mode> srt_socket_service::create_bandwidth_mode() {
+        std::shared_ptr<bandwidth_mode> mode;
+        auto max_bw = get_max_bandwidth();
+        auto input_bw = get_input_bandwidth();
+        if (max_bw) {
+            mode = std::make_shared<max_set_bandwidth_mode>();
+            mode->set_bandwidth(max_bw);
+        } else if (input_bw) {
+            mode = std::make_shared<constant_rate_mode>();
+        } else if (get_buffer_mode()) {
+            /// 文件模式尽可能快的发送
+            mode = std::make_shared<max_set_bandwidth_mode>();
+        } else {
+            mode = std::make_shared<estimated_bandwidth_mode>();
+        }
+        mode->set_overhead(get_overhead_bandwidth());
+        if (!max_bw && input_bw) {
+            mode->set_bandwidth(input_bw);
+        }
+        return mode;
+    }
+
+    void srt_socket_service::update_bandwidth_mode() {
+        if (!_sender_queue) {
+            return;
+        }
+        auto current = _sender_queue->get_bandwidth_mode();
+        auto mode = create_bandwidth_mode();
+        /// 仍然是估计模式时只修改重传开销, 保留已经估计的输入码率
+        if (std::dynamic_pointer_cast<estimated_bandwidth_mode>(current) && std::dynamic_pointer_cast<estimated_bandwidth_mode>(mode)) {
+            current->set_overhead(mode->get_overhead());
+        } else {
+            _sender_queue->set_bandwidth_mode(mode);
+        }
+        update_kernel_pacing_rate();
+        Info("update bandwidth, max_bw={}, input_bw={}, overhead={}%, current={} bytes/s", get_max_bandwidth(), get_input_bandwidth(),
+             get_overhead_bandwidth(), _sender_queue->get_bandwidth_mode()->get_bandwidth());
+    }
+
+    void srt_socket_service::update_kernel_pacing_rate() {
+        if (!_sender_queue || !_sender_queue->get_kernel_pacing()) {
+            return;
+        }
+        /// 估计模式下码率随输入变化, 只由发送时间点调度
+        uint64_t rate = 0;
+        if (get_max_bandwidth() || get_input_bandwidth()) {
+            rate = _sender_queue->get_bandwidth_mode()->get_bandwidth();
+        }
+        if (set_kernel_pacing_rate(rate)) {
+            Debug("update kernel pacing rate={} bytes/s, sock_id={}", rate, get_sock_id());
+        }
+    }
+
+    void srt_socket_service::on_rate_changed() {
+        /// 连接之前的设置在建立连接时生效
+        if (!is_open()) {
+            return;
+        }
+        std::weak_ptr<srt_socket_service> self(shared_from_this());
+        poller_async([self]() {
+            auto stronger_self = self.lock();
+            if (!stronger_self) {
+                return;
+            }
+            stronger_self->update_bandwidth_mode();
+        });
+    }
+
+    void srt_socket_service::save_connection_cache() {
+        /// 服务端不会主动重连
+        if (is_server || !_handshake_cookie) {
+            return;
+        }
+        connection_cache cache;
+        cache.remote = get_remote_endpoint();
+        cache.cookie = _handshake_cookie;
+        cache.max_payload = _negotiated_mss;
+        cache.window_size = get_max_flow_window_size();
+        cache.time_deliver = get_time_based_deliver();
+        cache.drop = get_drop_too_late_packet();
+        cache.nak = get_report_nak();
+        cache.rtt = _ack_queue_->get_rto();
+        cache.rtt_var = _ack_queue_->get_rtt_var();
+        if (_sender_queue && std::dynamic_pointer_cast<estimated_bandwidth_mode>(_sender_queue->get_bandwidth_mode())) {
+            cache.bandwidth = _sender_queue->get_bandwidth_mode()->get_bandwidth();
+        }
+        if (_file_congestion) {
+            cache.send_period = _file_congestion->get_send_period();
+            cache.cwnd = _file_congestion->get_cwnd_window();
+        }
+        _connection_cache = cache;
+        Debug("save connection cache, rtt={}us, rtt_var={}us, bandwidth={} bytes/s, send_period={}us, cwnd={}", cache.rtt, cache.rtt_var, cache.bandwidth,
+              cache.send_period, cache.cwnd);
+    }
+
+    void srt_socket_service::restore_connection_cache() {
+        if (is_server || !_connection_cache.rtt || !(_connection_cache.remote == get_remote_endpoint())) {
+            return;
+        }
+        /// 同一条路径, 从上一次的RTT开始计算RTO, 不需要等待第一个ack ack
+        _ack_queue_->set_rtt(_connection_cache.rtt, _connection_cache.rtt_var);
+        if (auto mode = std::dynamic_pointer_cast<estimated_bandwidth_mode>(_sender_queue->get_bandwidth_mode())) {
+            mode->restore(_connection_cache.bandwidth);
+        }
+        if (_file_congestion) {
+            _file_congestion->restore(_connection_cache.send_period, _connection_cache.cwnd);
+        }
+        Debug("restore connection cache, rtt={}us, bandwidth={} bytes/s, cwnd={}", _connection_cache.rtt, _connection_cache.bandwidth, _connection_cache.cwnd);
+    }
 
     /// 已经成功建立连接
     void srt_socket_service::on_connect_in() {
+        on_handshake_done();
         /// 记录最后一个包接收的时间
         last_receive_point = std::chrono::steady_clock::now();
         connect_point = last_receive_point;
-        if (get_max_payload() >= 1500)
-            srt_socket_service::max_payload = 1456;
+        /// 协商的mss换算成负载, 开启路径MTU探测时从配置的最小mss开始
+        _negotiated_mss = get_max_payload();
+        auto mss = _negotiated_mss;
+        if (get_path_mtu_discovery()) {
+            mss = std::min(get_min_payload(), _negotiated_mss);
+            if (mss < _negotiated_mss && enable_path_mtu_probe()) {
+                /// 出口网卡的MTU更小时不需要探测更大的包
+                auto max_mss = _negotiated_mss;
+                auto kernel_mtu = get_kernel_path_mtu();
+                if (kernel_mtu && kernel_mtu < max_mss) {
+                    max_mss = std::max(kernel_mtu, mss);
+                }
+                _mtu_search.reset(mss, max_mss);
+            } else if (mss < _negotiated_mss) {
+                Warn("path mtu discovery needs a socket of its own, use the min mss={}, sock_id={}", mss, get_sock_id());
+            }
+        }
+        update_path_mss(mss);
 
         Trace("init sender/receiver buffer queue...");
-        _sender_queue = std::make_shared<packet_limited_send_rate_queue<std::shared_ptr<buffer>>>(poller, _ack_queue_, get_report_nak(),
-                                                                                                  get_sock_id(), get_max_payload(), connect_point, get_max_payload());
-        _receive_queue = std::make_shared<packet_receive_queue<std::shared_ptr<buffer>>>();
+        /// 文件模式下不能丢包, 除了nak之外还需要超时重传来恢复尾部的丢包
+        auto sender_queue = std::make_shared<packet_limited_send_rate_queue<std::shared_ptr<buffer>, sender_next>>(poller, _ack_queue_, get_report_nak() && !get_buffer_mode(),
+                                                                                                                   get_sock_id(), get_max_payload(), connect_point, get_max_payload());
+        sender_queue->set_next(sender_next{this});
+        if (get_buffer_mode()) {
+            _file_congestion = std::make_shared<file_congestion>(*sender_queue);
+            sender_queue->set_congestion(_file_congestion);
+        }
+        sender_queue->set_bandwidth_mode(create_bandwidth_mode());
+        /// async_send写入的小数据合并发送, 消息不参与合并
+        sender_queue->set_coalesce_delay(get_send_coalesce_delay());
+        _sender_queue = sender_queue;
+        restore_connection_cache();
+        if (get_kernel_pacing()) {
+            /// 没有fq的网卡会立即发出, 提前交给内核的包变成突发
+            if (!socket_pacing::egress_supports_txtime(get_remote_endpoint().data(), get_remote_endpoint().size())) {
+                Warn("no fq qdisc on the egress interface, fall back to timer pacing, sock_id={}", get_sock_id());
+            } else if (enable_kernel_txtime()) {
+                sender_queue->set_kernel_pacing(true);
+                update_kernel_pacing_rate();
+            } else {
+                Warn("kernel pacing is not supported, fall back to timer pacing, sock_id={}", get_sock_id());
+            }
+        }
+        auto receive_queue = std::make_shared<packet_receive_queue<std::shared_ptr<buffer>, receive_next>>();
+        receive_queue->set_next(receive_next{this});
+        _receive_queue = receive_queue;
 
-        _sender_queue->set_on_packet(std::bind(&srt_socket_service::on_sender_packet, this, std::placeholders::_1));
-        _sender_queue->set_on_drop_packet(std::bind(&srt_socket_service::on_sender_drop_packet, this, std::placeholders::_1, std::placeholders::_2));
-        _receive_queue->set_on_packet(std::bind(&srt_socket_service::on_receive_packet, this, std::placeholders::_1));
-        _receive_queue->set_on_drop_packet(std::bind(&srt_socket_service::on_receive_drop_packet, this, std::placeholders::_1, std::placeholders::_2));
+        /// 内核调度时每个包有各自的发送时间点, 不合并
+        _segmentation_offload = get_segmentation_offload() && !_sender_queue->get_kernel_pacing() && segmentation_offload_supported();
 
         _sender_queue->set_current_sequence(_handshake_context->_sequence_number);
         _sender_queue->set_max_sequence(packet_max_seq);
@@ -321,9 +1184,11 @@ namespace srt {
 
         _receive_queue->set_current_sequence(_handshake_context->_sequence_number);
         _receive_queue->set_max_sequence(packet_max_seq);
+        _message_assembler.reset(_handshake_context->_sequence_number, packet_max_seq);
         _receive_queue->set_window_size(_handshake_context->_window_size);
-        //// 如果允许丢包
-        if (srt_socket_service::drop_too_late_packet && srt_socket_service::time_deliver_) {
+        _receive_queue->set_reorder_tolerance(get_max_reorder_tolerance());
+        //// 如果允许丢包, 文件模式下不丢包
+        if (srt_socket_service::drop_too_late_packet && srt_socket_service::time_deliver_ && !srt_socket_service::buffer_mode) {
             auto delay = srt_socket_service::time_deliver_ < 120 ? 120 : srt_socket_service::time_deliver_;
             _sender_queue->set_max_delay(delay < 1020 ? 1020 : delay);
             _receive_queue->set_max_delay(delay < 1020 ? 1020 : delay);
@@ -335,12 +1200,12 @@ namespace srt {
 
         _is_open.store(true, std::memory_order_relaxed);
         _is_connected.store(true, std::memory_order_relaxed);
-        {
-            _next_func = std::bind(&srt_socket_service::handle_receive, this, std::placeholders::_1);
-            _next_func_with_pkt = std::bind(&srt_socket_service::handle_receive_1, this, std::placeholders::_1, std::placeholders::_2);
-        }
+        _receive_state = receive_state::connected;
         _packet_receive_rate_ = std::make_shared<packet_calculate_window<16, 64>>();
         on_keep_alive_expired();
+        if (!_mtu_search.is_done()) {
+            start_path_mtu_probe(10);
+        }
         /// 成功连接
         on_connected();
         Debug("invoke connected callback end");
@@ -348,7 +1213,7 @@ namespace srt {
 
     void srt_socket_service::shutdown() {
         std::weak_ptr<srt_socket_service> self(shared_from_this());
-        get_poller()->async([self]() {
+        poller_async([self]() {
             if (auto stronger_self = self.lock()) {
                 stronger_self->do_shutdown();
             }
@@ -361,7 +1226,20 @@ namespace srt {
         _common_timer.cancel();
         _nak_timer.cancel();
         _ack_timer.cancel();
+        if (_is_connected.load(std::memory_order_relaxed)) {
+            save_connection_cache();
+        }
         _is_connected.store(false);
+        /// 已经按序收到的数据全部写入fd
+        flush_receive_fd();
+        if (_send_file_context) {
+            auto f = _send_file_context->on_complete;
+            _send_file_context = nullptr;
+            get_executor()->async([f, e]() { f(e); });
+        }
+        _send_batch.clear();
+        _send_batch_buffers.clear();
+        _send_batch_bytes = 0;
         if (_sender_queue)
             _sender_queue->clear();
         if (_receive_queue)
@@ -391,8 +1269,19 @@ namespace srt {
 
     void srt_socket_service::do_nak_in() {
         //// 检查接收队列
+        /// 乱序容忍的等待时间为RTT的1/4, 最小5ms, 最大50ms
+        uint32_t reorder_timeout = _ack_queue_->get_rto() / 4000;
+        reorder_timeout = std::min<uint32_t>(std::max<uint32_t>(reorder_timeout, 5), 50);
+        _receive_queue->set_reorder_timeout(reorder_timeout);
         auto vec = _receive_queue->get_pending_packets();
+        nak_waiting_reorder = false;
         if (vec.empty()) {
+            /// 还有空洞在乱序容忍范围内, 超时后再检查一次
+            /// 只是等待交付时间的包(TSBPD)不需要检查, 没有空洞时停止定时器, 新的丢包会重新开始
+            if (_receive_queue->has_reorder_pending()) {
+                nak_waiting_reorder = true;
+                return start_nak_timer(reorder_timeout * 1000);
+            }
             report_nak_begin = false;
             return;
         }
@@ -418,25 +1307,31 @@ namespace srt {
         send_in(pkt_buff, get_remote_endpoint());
         uint32_t nak_interval = (_ack_queue_->get_rto() + 4 * _ack_queue_->get_rtt_var()) / 2;
         nak_interval = nak_interval < 20000 ? 20000 : nak_interval;
+        start_nak_timer(nak_interval);
+    }
+
+    void srt_socket_service::start_nak_timer(uint32_t us) {
         std::weak_ptr<srt_socket_service> self(shared_from_this());
-        _nak_timer.expires_after(std::chrono::microseconds(nak_interval));
+        _nak_timer.expires_after(std::chrono::microseconds(us));
         _nak_timer.async_wait([self](const std::error_code &e) {
             auto stronger_self = self.lock();
             if (!stronger_self) {
                 return;
             }
-            if (e) return;
+            if (e || !stronger_self->in_poller_thread()) return;
             stronger_self->do_nak_in();
         });
     }
 
     void srt_socket_service::do_ack() {
         ack_begin = true;
+        _ack_frequency.reset();
         /// 至少执行一次
         do_ack_in();
     }
 
     void srt_socket_service::do_ack_in() {
+        flush_receive_fd();
         auto buff = std::make_shared<buffer>();
         auto seq = _receive_queue->get_current_sequence();
         auto rto = _ack_queue_->get_rto();
@@ -469,6 +1364,8 @@ namespace srt {
         auto pkt_buff = create_packet(pkt);
         pkt_buff->append(buff->data(), buff->size());
         send_in(pkt_buff, get_remote_endpoint());
+        /// 序号没有推进时退避full ack的间隔
+        auto interval = _ack_frequency.on_full_ack(seq);
 
         if (seq != std::get<0>(_ack_entry)) {
             _ack_entry = std::make_tuple(seq, now);
@@ -477,22 +1374,42 @@ namespace srt {
         auto spend = std::chrono::duration_cast<std::chrono::microseconds>(now - std::get<1>(_ack_entry)).count();
         if (spend > RTO) {
             Trace("stop to receive data, time out of RTO, RTO={} us, spend={} us", RTO, spend);
-            _receive_queue->clear();
+            /// 文件模式下保留乱序的包, 等待重传
+            if (!get_buffer_mode()) {
+                _receive_queue->clear();
+            }
             ack_begin = false;
             return;
         }
+        start_ack_timer(interval);
+    }
+
+    void srt_socket_service::start_ack_timer(uint32_t us) {
         std::weak_ptr<srt_socket_service> self(shared_from_this());
-        _ack_timer.expires_after(std::chrono::milliseconds(10));
+        _ack_timer.expires_after(std::chrono::microseconds(us));
         _ack_timer.async_wait([self](const std::error_code &e) {
             auto stronger_self = self.lock();
             if (!stronger_self) {
                 return;
             }
-            if (e) return;
+            if (e || !stronger_self->in_poller_thread()) return;
             stronger_self->do_ack_in();
         });
     }
 
+    void srt_socket_service::do_light_ack(uint32_t seq) {
+        Trace("send light ack, seq={}", seq);
+        srt_packet pkt;
+        pkt.set_control_type(ack);
+        /// light ack 的 type-specific information 为0
+        pkt.set_type_information(0);
+        pkt.set_timestamp(get_time_from<std::chrono::microseconds>(connect_point));
+        pkt.set_socket_id(get_sock_id());
+        auto pkt_buff = create_packet(pkt);
+        pkt_buff->put_be<uint32_t>(seq);
+        send_in(pkt_buff, get_remote_endpoint());
+    }
+
     void srt_socket_service::do_ack_ack(uint32_t ack_number) {
         Trace("send ack ack {}", ack_number);
         srt_packet pkt;
@@ -520,7 +1437,7 @@ namespace srt {
     }
 
 
-    void srt_socket_service::do_shutdown() {
+    void srt_socket_service::do_shutdown(srt_error_code code) {
         srt_packet pkt;
         pkt.set_control_type(control_type::shutdown);
         pkt.set_timestamp(get_time_from<std::chrono::microseconds>(connect_point));
@@ -528,7 +1445,7 @@ namespace srt {
         auto pkt_buffer = create_packet(pkt);
         /// shutdown 直接发送
         send(pkt_buffer, get_remote_endpoint());
-        on_error_in(make_srt_error(srt_error_code::socket_shutdown_op));
+        on_error_in(make_srt_error(code));
     }
 
     void srt_socket_service::handle_reject(int e) {
@@ -540,6 +1457,7 @@ namespace srt {
         Trace("receive server induction..");
         try {
             auto induction_pkt = srt::from_buffer(buff->data(), 16);
+            buff->remove(16);
             return handle_server_induction_1(induction_pkt, buff);
         } catch (const std::system_error &e) {
             Error("catch exception, code={}, msg={}", e.code().value(), e.what());
@@ -552,8 +1470,11 @@ namespace srt {
             return;
         }
 
-        buff->remove(16);
         auto induction_context = srt::handshake_context::from_buffer(buff->data(), buff->size());
+        /// 回退到induction之后才收到缓存cookie的conclusion回复, 服务端已经接受了连接
+        if (induction_context->_req_type == handshake_context::urq_conclusion && _connection_cache.cookie && induction_context->_cookie == _connection_cache.cookie) {
+            return handle_server_conclusion_1(induction_pkt, buff);
+        }
         /// 非法的握手包
         if (induction_context->_req_type != handshake_context::urq_induction) {
             Debug("invalid handshake packet, not a induction packet");
@@ -578,30 +1499,35 @@ namespace srt {
         }
 
         /// mtu 检查
-        if (induction_context->_max_mss > 1500) {
-            Debug("max payload is not exceed 1500");
+        if (induction_context->_max_mss > max_mss_limit) {
+            Debug("max payload is not exceed {}", max_mss_limit);
             return send_reject(handshake_context::packet_type::rej_rogue, buff);
         }
-        /// 更新mtu
-        set_max_payload(induction_context->_max_mss);
+        /// 更新mtu, 取两端允许的较小值
+        if (induction_context->_max_mss < get_max_payload()) {
+            set_max_payload(induction_context->_max_mss);
+        }
         /// 更新滑动窗口大小
         set_max_flow_window_size(induction_context->_window_size);
         /// 更新socket_id
         set_sock_id(induction_context->_socket_id);
+        return send_conclusion(induction_context->_sequence_number, induction_context->_cookie);
+    }
 
+    void srt_socket_service::send_conclusion(uint32_t sequence, uint32_t cookie) {
+        _handshake_cookie = cookie;
         handshake_context ctx;
         ctx._version = 5;
         ////
         ctx.extension_field = 1;
-        ctx._sequence_number = induction_context->_sequence_number;
+        ctx._sequence_number = sequence;
 
         ctx._max_mss = srt_socket_base::get_max_payload();
         ctx._window_size = srt_socket_service::get_max_flow_window_size();
         ctx._req_type = srt::handshake_context::urq_conclusion;
-        // random
-        //// 对应上一个induction的sock id
-        ctx._socket_id = get_sock_id();
-        ctx._cookie = induction_context->_cookie;
+        //// 和induction相同的本端sock id, 对端以它为目的socket id回复
+        ctx._socket_id = get_unique_socket_id();
+        ctx._cookie = cookie;
         ctx.address = get_local_endpoint().address();
 
         auto ts = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - connect_point).count();
@@ -613,16 +1539,13 @@ namespace srt {
         /// 加入握手
         handshake_context::to_buffer(ctx, _pkt);
         /// 加入扩展字段
-        set_extension(ctx, _pkt, get_time_based_deliver(), get_drop_too_late_packet(), get_report_nak(), 0, get_stream_id());
+        set_extension(ctx, _pkt, get_time_based_deliver(), get_drop_too_late_packet() && !get_buffer_mode(), get_report_nak(), 0, get_stream_id(), get_buffer_mode());
         /// 最后更新extension_field
         handshake_context::update_extension_field(ctx, _pkt);
         Trace("send conclusion handshake, version={}, seq={}, mtu={}, window_size={}, sock_id={}, cookie={}", ctx._version, ctx._sequence_number,
               ctx._max_mss, ctx._window_size, ctx._socket_id, ctx._cookie);
         /// 更新握手上下文
-        {
-            _next_func = std::bind(&srt_socket_service::handle_server_conclusion, this, std::placeholders::_1);
-            _next_func_with_pkt = std::bind(&srt_socket_service::handle_server_conclusion_1, this, std::placeholders::_1, std::placeholders::_2);
-        }
+        _receive_state = receive_state::server_conclusion;
         /// 保存握手缓存
         handshake_buffer = _pkt;
         return on_handshake_expired(true);
@@ -642,6 +1565,12 @@ namespace srt {
 
     void srt_socket_service::handle_server_conclusion_1(const std::shared_ptr<srt_packet> &pkt, const std::shared_ptr<buffer> &buff) {
         auto context = srt::handshake_context::from_buffer(buff->data(), buff->size());
+        /// 服务端不接受缓存的cookie, 用新签发的cookie继续完整的握手
+        if (_fast_connecting && context->_req_type == handshake_context::packet_type::urq_induction) {
+            Debug("cached cookie is not accepted, continue with the new cookie");
+            _fast_connecting = false;
+            return handle_server_induction_1(pkt, buff);
+        }
         buff->remove(48);
         auto extension = get_extension(*context, buff);
 
@@ -650,16 +1579,19 @@ namespace srt {
             return handle_reject(context->_req_type);
         }
 
-        if (extension->buffer_mode) {
-            Debug("server handshake in buffer mode, reject it");
+        if (extension->buffer_mode != get_buffer_mode()) {
+            Debug("server handshake transmission mode is not match, reject it");
             return send_reject(1012, buff);
         }
 
-        /// 最终更新mtu
-        /// set_max_payload(context->_max_mss);
+        /// 最终更新mtu, 服务端回复的mss不超过本端的配置
+        uint32_t mss = get_max_payload();
+        if (context->_max_mss >= min_mss_limit && context->_max_mss < mss) {
+            mss = context->_max_mss;
+        }
+        context->_max_mss = mss;
+        srt_socket_service::max_payload = mss;
         /// 最终更新滑动窗口大小
-        auto mss = get_max_payload() > 1500 ? 1500 : get_max_payload();
-        context->_max_mss = srt_socket_service::max_payload = mss;
         /// 设置peer_id
         srt_socket_service::peer_sock_id = pkt->get_socket_id();
         srt_socket_service::max_flow_window_size = context->_window_size;
@@ -669,6 +1601,8 @@ namespace srt {
         srt_socket_service::drop_too_late_packet = extension->drop;
         srt_socket_service::report_nak = extension->nak;
         _handshake_context = context;
+        _fast_connected.store(_fast_connecting, std::memory_order_relaxed);
+        _fast_connecting = false;
         Trace("srt handshake success, initial sequence={}, drop={}, report_nak={}, tsbpd={}, socket_id={}, window_size={}", context->_sequence_number, extension->drop, extension->nak,
               extension->receiver_tlpktd_delay, get_sock_id(), context->_window_size);
         return on_connect_in();
@@ -690,11 +1624,18 @@ namespace srt {
             auto _tmp_context = handshake_context::from_buffer(buff->data(), buff->size());
             buff->remove(48);
             if (_tmp_context->_req_type == handshake_context::packet_type::urq_conclusion) {
+                /// 过期cookie的conclusion重传, 再次回复新的cookie
+                if (handshake_conclusion == 1 && _tmp_context->_cookie != get_cookie()) {
+                    if (handshake_buffer) {
+                        send_in(handshake_buffer, get_remote_endpoint());
+                    }
+                    return;
+                }
                 if (handshake_conclusion) {
                     return handle_client_conclusion(pkt, _tmp_context, buff);
                 }
-                Warn("invalid conclusion before induction, ignore it");
-                return;
+                /// 对端使用的cookie已经过期, 当作induction回复新的cookie
+                Debug("conclusion with an expired cookie, answer with a new cookie");
             }
             /// 保存上下文
             _handshake_context = _tmp_context;
@@ -708,7 +1649,8 @@ namespace srt {
             std::default_random_engine random(std::random_device{}());
             std::uniform_int_distribution<int32_t> mt(0, (std::numeric_limits<int32_t>::max)());
             _handshake_context->extension_field = 0x4A17;
-            _handshake_context->_max_mss = _handshake_context->_max_mss > 1500 ? 1500 : _handshake_context->_max_mss;
+            /// 回复两端允许的较小的mss
+            _handshake_context->_max_mss = std::min(_handshake_context->_max_mss, get_max_payload());
             _handshake_context->_window_size = _handshake_context->_window_size < 8192 ? 8192 : _handshake_context->_window_size;
             _handshake_context->_req_type = handshake_context::packet_type::urq_induction;
             _handshake_context->address = get_local_endpoint().address();
@@ -747,10 +1689,6 @@ namespace srt {
             return send_reject(1003, buff);
         }
 
-        if (extension->buffer_mode) {
-            Error("client handshake with buffer mode, reject it");
-            return send_reject(1012, buff);
-        }
 
         if (context->_version != 5) {
             Error("client version at least 5, send reject to peer");
@@ -764,10 +1702,14 @@ namespace srt {
         //            Error("stream type is not equal to 1");
         //            return send_reject(1003, buff);
         //        }
-        if (context->_max_mss > 1500 || context->_max_mss < 728) {
+        if (context->_max_mss > max_mss_limit || context->_max_mss < min_mss_limit) {
             Error("invalid mss size={}", context->_max_mss);
             return send_reject(1003, buff);
         }
+        /// 使用缓存cookie的conclusion没有经过induction, 在这里限制到本端的配置
+        if (context->_max_mss > get_max_payload()) {
+            context->_max_mss = get_max_payload();
+        }
         if (context->_window_size < 8192) {
             Error("invalid window size ={}", context->_window_size);
             return send_reject(1003, buff);
@@ -788,6 +1730,7 @@ namespace srt {
         srt_socket_base::set_drop_too_late_packet(extension->drop);
         srt_socket_base::set_time_based_deliver(extension->receiver_tlpktd_delay);
         srt_socket_base::set_stream_id(extension->stream_id);
+        srt_socket_base::set_buffer_mode(extension->buffer_mode);
         srt_socket_base::set_peer_sock_id(_handshake_context->_socket_id);
         Trace("client handshake success, max_mss={}, window size={}, sock_id={}, report_nak={}, enable_drop={}, time based={} ms, stream_id={}",
               _handshake_context->_max_mss, _handshake_context->_window_size, _handshake_context->_socket_id,
@@ -799,7 +1742,7 @@ namespace srt {
         _pkt.set_timestamp(get_time_from<std::chrono::microseconds>(connect_point));
         handshake_buffer = create_packet(_pkt);
         handshake_context::to_buffer(*_handshake_context, handshake_buffer);
-        set_extension(*_handshake_context, handshake_buffer, extension->receiver_tlpktd_delay, extension->drop, extension->nak, extension->receiver_tlpktd_delay);
+        set_extension(*_handshake_context, handshake_buffer, extension->receiver_tlpktd_delay, extension->drop, extension->nak, extension->receiver_tlpktd_delay, "", extension->buffer_mode);
         if (extension->drop) {
             auto delay = extension->receiver_tlpktd_delay < 120 ? 120 : extension->receiver_tlpktd_delay;
             set_time_based_deliver(delay);
@@ -829,10 +1772,20 @@ namespace srt {
             return;
         }
 
-        /// 更新上一次收到的时间
-        last_receive_point = std::chrono::steady_clock::now();
+        _receive_packets.fetch_add(1, std::memory_order_relaxed);
+        /// 更新上一次收到的时间, 有内核接收时间时包间隔不包含poller的排队延迟
+        auto arrival = srt_pkt->get_arrival_time();
+        last_receive_point = arrival;
+        if (srt_pkt->has_arrival_time()) {
+            auto delay = (uint32_t) std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - arrival).count();
+            _receive_delay.store((7 * _receive_delay.load(std::memory_order_relaxed) + delay) / 8, std::memory_order_relaxed);
+        }
+        if (srt_pkt->get_kernel_drops()) {
+            _kernel_drops.fetch_add(srt_pkt->get_kernel_drops(), std::memory_order_relaxed);
+            Debug("kernel receive queue dropped {} packets, sock_id={}", srt_pkt->get_kernel_drops(), get_sock_id());
+        }
         if (_packet_receive_rate_)
-            _packet_receive_rate_->update_receive_rate((uint16_t) buff->size() + 16);
+            _packet_receive_rate_->update_receive_rate((uint16_t) buff->size() + 16, arrival);
 
         if (srt_pkt->get_control()) {
             return handle_control(srt_pkt, buff);
@@ -846,8 +1799,9 @@ namespace srt {
             case control_type::handshake:
                 return handle_client_induction_1(pkt, buff);
             case control_type::congestion_warning:
-            case control_type::user_defined_type:
                 return;
+            case control_type::user_defined_type:
+                return handle_path_mtu_ack(*pkt, buff);
             case control_type::keepalive:
                 return handle_keep_alive(*pkt, buff);
             case control_type::nak:
@@ -869,18 +1823,48 @@ namespace srt {
         /// 统计数据
         /// 丢入接收队列
         if (_packet_receive_rate_)
-            _packet_receive_rate_->update_estimated_capacity(pkt->get_packet_sequence_number(), (uint16_t) buff->size() + 16, pkt->get_in_order() || pkt->is_retransmitted());
-        _receive_queue->input_packet(buff, pkt->get_packet_sequence_number(), pkt->get_time_stamp());
-        if (srt_socket_base::report_nak && !report_nak_begin) {
+            _packet_receive_rate_->update_estimated_capacity(pkt->get_packet_sequence_number(), (uint16_t) buff->size() + 16, pkt->get_in_order() || pkt->is_retransmitted(),
+                                                             pkt->get_arrival_time());
+        /// 每个数据报独立使用接收缓存池中的buffer, 去掉包头之后直接进入接收队列并交付给应用层
+        /// 应用层释放最后一个引用后buffer回到接收缓存池
+        _receive_queue->input_message_packet(buff, pkt->get_packet_sequence_number(), pkt->get_time_stamp(), pkt->get_packet_position_flag(), pkt->get_message_number(),
+                                             pkt->is_retransmitted());
+        /// 等待乱序容忍期间每个新到达的包都可能让空洞达到上报条件
+        if (srt_socket_base::report_nak && (!report_nak_begin || nak_waiting_reorder)) {
             do_nak();
         }
         if (!ack_begin) {
-            do_ack();
+            return do_ack();
+        }
+        /// 高码率下每隔64个包发送一次light ack, 不用等待ack定时器
+        auto seq = _receive_queue->get_current_sequence();
+        if (_ack_frequency.on_data_packet(seq)) {
+            do_light_ack(seq);
         }
     }
 
-    void srt_socket_service::handle_keep_alive(const srt_packet &pkt, const std::shared_ptr<buffer> &) {
-        Info("handle keep alive..");
+    void srt_socket_service::handle_keep_alive(const srt_packet &pkt, const std::shared_ptr<buffer> &buff) {
+        /// 填充过的keepalive是路径MTU探测包, type_information为探测的mss, 完整到达时回复
+        auto mss = pkt.get_type_information();
+        if (!mss) {
+            Info("handle keep alive..");
+            return;
+        }
+        if (buff->size() + srt_mtu_search::header_size != mss) {
+            return;
+        }
+        srt_packet reply;
+        reply.set_control_type(control_type::user_defined_type);
+        reply.set_type_information(mss);
+        reply.set_socket_id(get_sock_id());
+        reply.set_timestamp(get_time_from<std::chrono::microseconds>(connect_point));
+        send_in(create_packet(reply), get_remote_endpoint());
+    }
+
+    void srt_socket_service::handle_path_mtu_ack(const srt_packet &pkt, const std::shared_ptr<buffer> &) {
+        if (_mtu_search.on_probe_ack(pkt.get_type_information())) {
+            update_path_mss(_mtu_search.get_mss());
+        }
     }
     /// Negative acknowledgment control packets are used to signal failed data packet deliveries
     /// The receiver notifies the sender about lost data packets by sending a NAK packet that contains
@@ -948,7 +1932,7 @@ namespace srt {
 
     void srt_socket_service::handle_ack_ack(const srt_packet &pkt, const std::shared_ptr<buffer> &) {
         auto ack_seq = pkt.get_type_information();
-        _ack_queue_->calculate(ack_seq);
+        _ack_queue_->calculate(ack_seq, pkt.get_arrival_time());
         Trace("handle ack ack, rtt={}, rtt_variance={}", _ack_queue_->get_rto(), _ack_queue_->get_rtt_var());
     }
 
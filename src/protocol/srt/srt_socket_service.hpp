@@ -25,13 +25,17 @@
 
 #ifndef TOOLKIT_SRT_SOCKET_SERVICE_HPP
 #define TOOLKIT_SRT_SOCKET_SERVICE_HPP
+#include "Util/mapped_file.hpp"
 #include "Util/nocopyable.hpp"
 #include "asio.hpp"
 #include "net/buffer.hpp"
 #include "net/event_poller.hpp"
 #include "packet_interface.hpp"
 #include "srt_ack.hpp"
+#include "srt_error.hpp"
 #include "srt_handshake.h"
+#include "srt_message.hpp"
+#include "srt_mtu.hpp"
 #include "srt_packet.h"
 #include "srt_socket_base.hpp"
 #include "srt_stream_id.hpp"
@@ -41,7 +45,9 @@
 #include <mutex>
 #include <string>
 #include <tuple>
+#include <vector>
 
+class file_congestion;
 namespace srt {
 
     class srt_socket_service_holder {
@@ -69,10 +75,62 @@ namespace srt {
         //// 发送数据
         int async_send(const char *, size_t length);
         int async_send(const std::shared_ptr<buffer> &);
+        /// 返回0时e说明原因: send_buffer_full为超过高水位, 等待onWritable后再写入
+        /// 超过最大负载时按最大负载切分成多个包, 返回已经写入的字节数
+        int async_send(const char *, size_t length, std::error_code &e);
+        /// 不拷贝负载, 发送和重传都引用buff, 同一个buff可以发送给多个连接
+        int async_send(const std::shared_ptr<buffer> &, std::error_code &e);
+        /// 发送任意长度的消息, 按最大负载分片, 所有分片共享同一个消息号, 对端整体交付
+        /// 要么全部写入返回消息长度, 要么返回0(send_buffer_full)或-1
+        int async_send_message(const char *, size_t length, std::error_code &e);
+        int async_send_message(const std::shared_ptr<buffer> &, std::error_code &e);
+        /// 发送缓冲区高低水位(字节), high为0表示不限制, 可以在任意时刻设置
+        void set_send_buffer_water_mark(uint32_t high, uint32_t low = 0);
+        /// 缓存和发送窗口中未被确认的字节数
+        uint64_t get_send_buffered_bytes();
+        /// 未被确认的最早的数据已经缓存的时间(ms)
+        uint32_t get_send_buffered_time();
+        /// 当前的乱序容忍度(包数量)
+        uint32_t get_reorder_tolerance();
+        /// 在NAK之后才到达的原始包数量, 即多余的重传
+        uint64_t get_belated_packets();
+        /// 当前是否由内核调度发送
+        bool get_kernel_pacing_active();
+        /// 当前是否使用UDP_SEGMENT合并发送
+        bool get_segmentation_offload_active();
+        /// 平均每次发送系统调用写出的字节数
+        double get_send_bytes_per_syscall();
+        /// 内核收到数据报到协议栈处理之间的平均延迟(us), 没有内核接收时间时为0
+        uint32_t get_receive_delay();
+        /// 内核接收队列溢出丢弃的包数量, 共享socket时按照丢包之后第一个到达的包归属会话
+        uint64_t get_kernel_drops();
+        /// 网络丢包数量: 通过NAK上报的丢包中去掉内核丢弃的部分
+        uint64_t get_lost_packets();
+        /// 收到的包数量和发送的系统调用次数之和, 用于估计连接占用poller的时间
+        uint64_t get_io_count();
+        /// 带宽时延积(字节), 用于调整socket缓冲区, 需要在poller线程调用
+        /// 码率取配置的MAXBW/INPUTBW和估计的链路容量中较大的一个, 不超过协商的流量窗口
+        uint64_t get_bandwidth_delay_product();
+        /// 发送映射文件的一段区域, 包直接引用映射的内存, 全部被对端确认后回调
+        void async_send_file(const std::shared_ptr<mapped_file> &file, size_t offset, size_t length, const std::function<void(const std::error_code &)> &f);
+        void async_send_file(const std::string &path, const std::function<void(const std::error_code &)> &f);
+        /// 按序到达的数据合并后直接写入fd, 设置后不再回调onRecv, 需要在收到数据之前设置
+        void set_receive_fd(int fd);
+        /// 本次连接是否使用上一次连接的cookie跳过了induction
+        bool get_fast_connected() const;
+        /// 当前使用的mss, 开启路径MTU探测时为已经确认的大小, 连接之前为0
+        uint32_t get_path_mss() const;
+        /// 接收一个数据报需要的缓冲区大小: 连接之后为协商的mss, 之前为配置(或握手中协商)的mss
+        /// 对端的数据报不会超过协商的mss, 接收缓冲区按照它分配, 不使用协议允许的最大值
+        uint32_t get_receive_size() const;
 
     protected:
+        /// 有上一次连接到同一个地址的缓存时直接发送conclusion, 服务端不接受时回退到induction
         void connect();
-        void connect_as_server();
+        /// cookie_verified为true时服务端已经验证了对端缓存的cookie, 不需要induction
+        void connect_as_server(bool cookie_verified = false);
+        /// 断开之后重置连接状态, 保留选项和上一次连接的缓存, 之后可以再次connect
+        void reset_connection();
         void input_packet(const std::shared_ptr<buffer> &buff);
         void input_packet(const std::shared_ptr<srt_packet> &, const std::shared_ptr<buffer> &buff);
         bool is_open() final;
@@ -80,15 +138,98 @@ namespace srt {
         virtual void begin();
         /// 连接成功
         virtual void on_connected() = 0;
+        /// 握手完成, 创建发送和接收队列之前调用, 可以在这里切换socket
+        virtual void on_handshake_done() {}
         /// 发送行为
         virtual void send(const std::shared_ptr<buffer> &buff, const asio::ip::udp::endpoint &where) = 0;
+        /// 包头和引用的负载聚合发送, 默认拷贝成一个包
+        virtual void send(const std::shared_ptr<buffer> &header, const packet_payload &payload, const asio::ip::udp::endpoint &where);
+        /// 由内核在launch_ns(steady_clock, 纳秒)时刻发送, 返回false说明socket不支持, 由调用方立即发送
+        virtual bool send_at(const std::shared_ptr<buffer> &header, const packet_payload &payload, const asio::ip::udp::endpoint &where, uint64_t launch_ns) {
+            return false;
+        }
+        /// 开启socket的SO_TXTIME, 不支持时返回false
+        virtual bool enable_kernel_txtime() {
+            return false;
+        }
+        /// 设置socket的SO_MAX_PACING_RATE(字节/秒, 0为不限制), 只有socket只属于一个连接时才能设置
+        virtual bool set_kernel_pacing_rate(uint64_t bytes_per_second) {
+            return false;
+        }
+        /// buffers拼接之后每segment_size字节一个数据报, 一次系统调用发出; 返回false说明socket不支持, 由调用方逐个发送
+        virtual bool send_segments(const std::vector<asio::const_buffer> &buffers, uint16_t segment_size, const asio::ip::udp::endpoint &where) {
+            return false;
+        }
+        /// socket是否支持UDP_SEGMENT
+        virtual bool segmentation_offload_supported() {
+            return false;
+        }
+        /// 开启socket的路径MTU探测模式(不分片), socket不只属于一个连接或者不支持时返回false
+        virtual bool enable_path_mtu_probe() {
+            return false;
+        }
+        /// 内核当前知道的路径MTU, 用于限制探测的上限, 0为不知道
+        virtual uint32_t get_kernel_path_mtu() {
+            return 0;
+        }
         virtual void onRecv(const std::shared_ptr<buffer> &) = 0;
+        /// 多个分片组成的消息完整到达时回调, 分片按顺序排列, 不做拷贝; 默认拼接后回调onRecv
+        virtual void onRecvMessage(const std::vector<std::shared_ptr<buffer>> &fragments);
+        /// 发送缓冲区满之后降到低水位以下时在executor中回调
+        virtual void onWritable() {}
         /// 出错调用
         virtual void on_error(const std::error_code &e) = 0;
 
     protected:
         void shutdown();
         void on_error_in(const std::error_code &e);
+        /// 连接之后修改码率设置, 在poller中替换发送队列的带宽模式
+        void on_rate_changed() override;
+        /// 把连接迁移到target, 需要在当前poller线程调用
+        /// 取消所有定时器后重新绑定到target, 之后投递的任务都在target中执行, 定时器在target中按照原来的时间点继续
+        /// 队列和握手状态属于对象本身, 不需要拷贝; 迁移之前已经到期的定时器回调在原poller中被忽略
+        void migrate_poller(const event_poller::Ptr &target);
+        /// 是否在当前所属的poller线程中
+        bool in_poller_thread();
+        /// 投递到所属的poller执行, 迁移过程中投递到原poller的任务转发到新的poller
+        void poller_async(const std::function<void()> &f);
+
+    private:
+        /// 发送队列和接收队列的下一级, 队列在编译期确定调用目标, 不经过std::function
+        struct sender_next {
+            srt_socket_service *service;
+            void on_packet(const packet_pointer &p) {
+                service->on_sender_packet(p);
+            }
+            void on_drop_packet(uint32_t begin, uint32_t end) {
+                service->on_sender_drop_packet(begin, end);
+            }
+            void on_writable() {
+                service->on_sender_writable();
+            }
+            void on_flush() {
+                service->flush_sender_batch();
+            }
+        };
+        struct receive_next {
+            srt_socket_service *service;
+            void on_packet(const packet_pointer &p) {
+                service->on_receive_packet(p);
+            }
+            void on_drop_packet(uint32_t begin, uint32_t end) {
+                service->on_receive_drop_packet(begin, end);
+            }
+        };
+        /// 收到的包按照握手阶段分发
+        enum class receive_state : uint8_t {
+            none,
+            /// 客户端握手
+            server_induction,
+            server_conclusion,
+            /// 服务端握手
+            client_induction,
+            connected,
+        };
 
     private:
         //// send_queue
@@ -97,23 +238,50 @@ namespace srt {
         /// receive queue
         void on_receive_packet(const packet_pointer &type);
         void on_receive_drop_packet(size_t begin, size_t end);
+        /// 发送窗口可写
+        void on_sender_writable();
+        /// 写入被拒绝时调用, 标记等待之后重新检查, 期间poller已经发完缓存时由写入方自己通知
+        void wait_writable(std::error_code &e);
+        /// 在executor中回调onWritable
+        void notify_writable();
+        /// 等长的数据包先放入批量发送队列, 一次调度结束或者不能继续合并时写出
+        void batch_sender_packet(const packet_pointer &type);
+        void flush_sender_batch();
+        void flush_receive_fd();
+        /// 根据码率设置生成带宽模式
+        std::shared_ptr<bandwidth_mode> create_bandwidth_mode();
+        void update_bandwidth_mode();
+        /// 固定码率时由内核按照码率限制整个socket的发送速度
+        void update_kernel_pacing_rate();
 
     private:
         void send_reject(int e, const std::shared_ptr<buffer> &buf);
         /// 数据统一出口
         void send_in(const std::shared_ptr<buffer> &buff, const asio::ip::udp::endpoint &where);
+        void send_in(const std::shared_ptr<buffer> &header, const packet_payload &payload, const asio::ip::udp::endpoint &where);
+        void send_in(const std::shared_ptr<buffer> &header, const packet_payload &payload, const asio::ip::udp::endpoint &where, uint64_t launch_ns);
+        void on_send_syscall(size_t bytes);
         void on_connect_in();
         void do_nak();
         void do_nak_in();
+        void start_nak_timer(uint32_t us);
+        void start_ack_timer(uint32_t us);
         /// Round-trip time (RTT) in SRT is estimated during the transmission of data packets based on
         /// difference in time between an ACK packet is send out and a corresponding ACK_ACK is received
         /// back by SRT receiver.
         /// An ACK send by the receiver triggers an ACK_ACK from the sender with minimal processing delay.
         void do_ack();
         void do_ack_in();
+        /// light ack只携带最后确认的序号, 不需要对端回复ack ack
+        void do_light_ack(uint32_t seq);
         void do_ack_ack(uint32_t ack_number);
         void do_drop_request(size_t begin, size_t end);
-        void do_shutdown();
+        void do_shutdown(srt_error_code code = srt_error_code::socket_shutdown_op);
+        /// 路径MTU探测: 按照确认的mss修改负载, 定时发送填充的keepalive
+        void update_path_mss(uint32_t mss);
+        void start_path_mtu_probe(uint32_t delay_ms);
+        size_t on_path_mtu_probe();
+        void send_path_mtu_probe(uint32_t mss);
 
         template<typename _duration>
         inline uint32_t get_time_from(const std::chrono::steady_clock::time_point &last_time_point) {
@@ -138,6 +306,7 @@ namespace srt {
         void handle_control(const std::shared_ptr<srt_packet> &pkt, const std::shared_ptr<buffer> &);
         void handle_data(const std::shared_ptr<srt_packet> &pkt, const std::shared_ptr<buffer> &);
         void handle_keep_alive(const srt_packet &pkt, const std::shared_ptr<buffer> &);
+        void handle_path_mtu_ack(const srt_packet &pkt, const std::shared_ptr<buffer> &);
         void handle_nak(const srt_packet &pkt, const std::shared_ptr<buffer> &);
         void handle_ack(const srt_packet &pkt, const std::shared_ptr<buffer> &);
         void handle_ack_ack(const srt_packet &pkt, const std::shared_ptr<buffer> &);
@@ -147,6 +316,12 @@ namespace srt {
 
     private:
         void do_handshake_expired();
+        /// 客户端握手的两个阶段, 握手包保存在handshake_buffer中定时重发
+        void send_induction();
+        void send_conclusion(uint32_t sequence, uint32_t cookie);
+        /// 连接断开时保存握手参数和网络状态, 连接成功时恢复到新的发送队列
+        void save_connection_cache();
+        void restore_connection_cache();
 
     private:
         /// 握手超时
@@ -154,6 +329,34 @@ namespace srt {
         void on_keep_alive_expired();
 
     private:
+        /// 上一次连接的握手参数和估计的网络状态
+        struct connection_cache {
+            asio::ip::udp::endpoint remote;
+            uint32_t cookie = 0;
+            uint32_t max_payload = 0;
+            uint32_t window_size = 0;
+            uint32_t time_deliver = 0;
+            bool drop = false;
+            bool nak = false;
+            /// 平滑后的RTT和RTT方差(us)
+            uint32_t rtt = 0;
+            uint32_t rtt_var = 0;
+            /// 估计模式下的输入码率(字节/秒), 其他模式由配置决定, 为0
+            uint64_t bandwidth = 0;
+            /// 文件模式的拥塞控制状态
+            double send_period = 0;
+            uint32_t cwnd = 0;
+        };
+
+        struct send_file_context {
+            std::shared_ptr<mapped_file> file;
+            size_t offset = 0;
+            size_t end = 0;
+            std::function<void(const std::error_code &)> on_complete;
+        };
+
+    private:
+        /// 迁移时由原poller线程修改, 其他线程通过get_poller读取
         event_poller::Ptr poller;
         /// 通常的定时器,处理接收超时和keepalive
         asio::steady_timer _common_timer;
@@ -167,12 +370,26 @@ namespace srt {
         std::shared_ptr<handshake_context> _handshake_context;
         bool is_server = false;
         int handshake_conclusion = 0;
+        /// 服务端签发的cookie
+        uint32_t _handshake_cookie = 0;
+        /// 已经用缓存的cookie发送了conclusion, 还没有收到回复
+        bool _fast_connecting = false;
+        std::atomic<bool> _fast_connected{false};
+        connection_cache _connection_cache;
+        /// 第一次连接时配置的mss, 重连时恢复, 连接之后max_payload变成负载大小
+        uint32_t _configured_mss = 0;
+        /// 握手协商的mss, 路径MTU探测的上限
+        uint32_t _negotiated_mss = 0;
+        std::atomic<uint32_t> _path_mss{0};
+        srt_mtu_search _mtu_search;
+        std::shared_ptr<event_poller::timer_type> _mtu_probe_timer;
         bool report_nak_begin = false;
+        /// NAK定时器在等待乱序容忍超时
+        bool nak_waiting_reorder = false;
         bool ack_begin = false;
         bool perform_error = false;
         uint32_t ack_number = 1;
-        std::function<void(const std::shared_ptr<buffer> &)> _next_func;
-        std::function<void(const std::shared_ptr<srt_packet> &, const std::shared_ptr<buffer> &)> _next_func_with_pkt;
+        receive_state _receive_state = receive_state::none;
         /// 第一次尝试连接的时间
         time_point connect_point;
         /// 上一次发送数据的时间
@@ -191,6 +408,34 @@ namespace srt {
         //// ack
         ack_entry _ack_entry;
         std::shared_ptr<srt_ack_queue> _ack_queue_;
+        /// 文件模式的拥塞控制, 断开时保存状态
+        std::shared_ptr<file_congestion> _file_congestion;
+        srt_ack_frequency _ack_frequency;
+        /// 正在发送的文件
+        std::shared_ptr<send_file_context> _send_file_context;
+        bool _writable_running = false;
+        /// 发送缓冲区水位
+        std::atomic<uint32_t> _send_high_water{0};
+        std::atomic<uint32_t> _send_low_water{0};
+        std::atomic<bool> _wait_writable{false};
+        /// 接收数据写入的fd
+        int _receive_fd = -1;
+        std::vector<std::shared_ptr<buffer>> _receive_fd_cache;
+        size_t _receive_fd_bytes = 0;
+        /// 消息模式的重组
+        srt_message_assembler _message_assembler;
+        /// UDP_SEGMENT批量发送
+        bool _segmentation_offload = false;
+        std::vector<packet_pointer> _send_batch;
+        std::vector<asio::const_buffer> _send_batch_buffers;
+        size_t _send_batch_segment = 0;
+        size_t _send_batch_bytes = 0;
+        std::atomic<uint64_t> _send_syscalls{0};
+        std::atomic<uint64_t> _send_bytes{0};
+        /// 接收排队延迟的滑动平均(us)
+        std::atomic<uint32_t> _receive_delay{0};
+        std::atomic<uint64_t> _kernel_drops{0};
+        std::atomic<uint64_t> _receive_packets{0};
     };
 };// namespace srt
 
@@ -87,10 +87,15 @@ namespace srt {
                     }
                     break;
                 case 'r':
+                    /// 资源名: [vhost/]app/stream
                     v = string_util::split(v.back(), "/");
-                    if (vec.size() > 2) {
+                    if (v.size() > 3 || v.size() < 2) {
                         throw std::system_error(make_srt_error(srt_stream_serialize_error));
                     }
+                    if (v.size() == 3) {
+                        _stream_id.vhost(v.front());
+                        v.pop_front();
+                    }
                     _stream_id.app(v.front());
                     _stream_id.stream(v.back());
                     break;
@@ -0,0 +1,81 @@
+//
+// Created by 沈昊 on 2026/10/19.
+//
+#include <gtest/gtest.h>
+#include <memory>
+#include <net/buffer_pool.hpp>
+#include <thread>
+#include <vector>
+
+TEST(reuse, buffer_pool) {
+    buffer_pool pool(4);
+    auto first = pool.obtain();
+    first->append("hello", 5);
+    auto capacity = first->capacity();
+    auto data = first->data();
+    EXPECT_EQ(pool.size(), 1);
+    EXPECT_EQ(pool.idle(), 0);
+
+    /// 还被引用的buffer不会被再次分配
+    auto second = pool.obtain();
+    EXPECT_NE(first, second);
+    EXPECT_EQ(pool.size(), 2);
+
+    /// 切片之后释放最后一个引用, buffer回到池中并保留容量
+    first->remove(2);
+    first.reset();
+    EXPECT_EQ(pool.idle(), 1);
+    auto third = pool.obtain();
+    EXPECT_EQ(third->data(), data);
+    EXPECT_GE(third->capacity(), capacity);
+    EXPECT_EQ(pool.size(), 2);
+}
+
+TEST(overflow, buffer_pool) {
+    buffer_pool pool(4);
+    std::vector<std::shared_ptr<buffer>> hold;
+    for (int i = 0; i < 8; i++) {
+        hold.push_back(pool.obtain());
+    }
+    /// 池满之后分配不属于池的buffer
+    EXPECT_EQ(pool.size(), 4);
+    EXPECT_EQ(pool.idle(), 0);
+    hold.clear();
+    EXPECT_EQ(pool.idle(), 4);
+}
+
+TEST(release_in_other_thread, buffer_pool) {
+    buffer_pool pool(16);
+    for (int round = 0; round < 100; round++) {
+        std::vector<std::shared_ptr<buffer>> buffers;
+        for (int i = 0; i < 8; i++) {
+            auto buff = pool.obtain();
+            buff->resize(1500);
+            buff->backward();
+            buffers.push_back(buff);
+        }
+        std::thread worker([&buffers]() {
+            buffers.clear();
+        });
+        worker.join();
+    }
+    EXPECT_EQ(pool.size(), 8);
+    EXPECT_EQ(pool.idle(), 8);
+}
+
+TEST(obtain_capacity, buffer_pool) {
+    buffer_pool pool(4);
+    auto buff = pool.obtain(1332);
+    buff->resize(1332);
+    buff.reset();
+    /// 扩容时按照请求的大小分配, 不按照原来的容量翻倍
+    buff = pool.obtain(1500);
+    EXPECT_GE(buff->capacity(), 1500);
+    EXPECT_LT(buff->capacity(), 2 * 1332);
+    buff->resize(1500);
+    auto data = buff->data();
+    buff.reset();
+    /// 容量足够时直接复用
+    buff = pool.obtain(1400);
+    EXPECT_EQ(buff->data(), data);
+}
@@ -0,0 +1,42 @@
+﻿//
+// Created by 沈昊 on 2026/10/19.
+//
+#include <Util/mapped_file.hpp>
+#include <cstdio>
+#include <cstring>
+#include <gtest/gtest.h>
+#include <string>
+
+TEST(mapped_file, read) {
+    const char *path = "mapped_file_unittest.data";
+    std::string content(64 * 1024 + 17, 'a');
+    for (size_t i = 0; i < content.size(); i++) {
+        content[i] = static_cast<char>(i % 251);
+    }
+    auto *fp = std::fopen(path, "wb");
+    ASSERT_NE(fp, nullptr);
+    std::fwrite(content.data(), 1, content.size(), fp);
+    std::fclose(fp);
+
+    auto file = mapped_file::open(path);
+    EXPECT_EQ(file->size(), content.size());
+    EXPECT_EQ(std::memcmp(file->data(), content.data(), content.size()), 0);
+    EXPECT_EQ(file->path(), path);
+    std::remove(path);
+}
+
+TEST(mapped_file, empty) {
+    const char *path = "mapped_file_unittest.empty";
+    auto *fp = std::fopen(path, "wb");
+    ASSERT_NE(fp, nullptr);
+    std::fclose(fp);
+
+    auto file = mapped_file::open(path);
+    EXPECT_EQ(file->size(), 0);
+    EXPECT_EQ(file->data(), nullptr);
+    std::remove(path);
+}
+
+TEST(mapped_file, not_exist) {
+    EXPECT_THROW(mapped_file::open("mapped_file_unittest.not_exist"), std::system_error);
+}
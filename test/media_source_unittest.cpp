@@ -0,0 +1,94 @@
+//
+// Created by 沈昊 on 2026/10/19.
+//
+#include "media/media_source.hpp"
+#include "net/event_poller.hpp"
+#include "spdlog/logger.hpp"
+#include <atomic>
+#include <chrono>
+#include <gtest/gtest.h>
+#include <memory>
+#include <thread>
+#include <vector>
+
+static media_source::pointer make_source(const std::string &app, const std::string &stream) {
+    auto source = std::make_shared<media_source>();
+    source->app(app);
+    source->stream(stream);
+    return source;
+}
+
+TEST(register, media_source) {
+    logger::initialize("logs/media_source_unittest.log", spdlog::level::warn);
+    auto source = make_source("live", "register");
+    EXPECT_EQ(media_source::add_or_remove_source(true, source), source);
+    EXPECT_EQ(media_source::find_source("", "live", "register"), source);
+    /// 同名的源只能注册一个
+    auto other = make_source("live", "register");
+    EXPECT_EQ(media_source::add_or_remove_source(true, other), nullptr);
+    /// 只移除自己注册的源
+    media_source::add_or_remove_source(false, other);
+    EXPECT_EQ(media_source::find_source("", "live", "register"), source);
+    media_source::add_or_remove_source(false, source);
+    EXPECT_EQ(media_source::find_source("", "live", "register"), nullptr);
+}
+
+TEST(wait_source, media_source) {
+    logger::initialize("logs/media_source_unittest.log", spdlog::level::warn);
+    std::vector<event_poller::Ptr> pollers;
+    for (int i = 0; i < 2; i++) {
+        pollers.emplace_back(std::make_shared<event_poller>());
+        pollers.back()->start();
+    }
+    const int waiters = 100;
+    auto source = make_source("live", "wait");
+    std::atomic<int> found{0};
+    std::atomic<int> in_poller{0};
+    for (int i = 0; i < waiters; i++) {
+        auto poller = pollers[i % pollers.size()];
+        media_source::async_wait_source("", "live", "wait", poller, 3000, [&, poller, source](const media_source::pointer &p) {
+            if (p == source) {
+                ++found;
+            }
+            if (poller->is_current_thread()) {
+                ++in_poller;
+            }
+        });
+    }
+    EXPECT_EQ(media_source::waiting_size(), waiters);
+    /// 注册之后一次唤醒所有等待者
+    media_source::add_or_remove_source(true, source);
+    EXPECT_EQ(media_source::waiting_size(), 0);
+    for (int i = 0; i < 300 && found.load() < waiters; i++) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    EXPECT_EQ(found.load(), waiters);
+    EXPECT_EQ(in_poller.load(), waiters);
+
+    /// 已经存在时立即回调
+    std::atomic<bool> exist{false};
+    media_source::async_wait_source("", "live", "wait", pollers[0], 3000, [&](const media_source::pointer &p) {
+        exist.store(p == source);
+    });
+    for (int i = 0; i < 300 && !exist.load(); i++) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    EXPECT_TRUE(exist.load());
+    media_source::add_or_remove_source(false, source);
+
+    /// 超时之后回调nullptr, 不再等待
+    std::atomic<int> timeout{0};
+    auto begin = std::chrono::steady_clock::now();
+    media_source::async_wait_source("", "live", "wait", pollers[1], 100, [&](const media_source::pointer &p) {
+        timeout.store(p ? 1 : 2);
+    });
+    for (int i = 0; i < 300 && !timeout.load(); i++) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    EXPECT_EQ(timeout.load(), 2);
+    EXPECT_GE(std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - begin).count(), 90);
+    EXPECT_EQ(media_source::waiting_size(), 0);
+    for (auto &item: pollers) {
+        item->stop();
+    }
+}
@@ -0,0 +1,348 @@
+﻿//
+// Created by 沈昊 on 2026/10/19.
+//
+#include "net/buffer.hpp"
+#include "net/event_poller_pool.hpp"
+#include "protocol/srt/packet_limited_send_rate_queue.hpp"
+#include "protocol/srt/srt_ack.hpp"
+#include "spdlog/logger.hpp"
+#include <atomic>
+#include <gtest/gtest.h>
+#include <mutex>
+#include <thread>
+#include <vector>
+using namespace srt;
+
+TEST(buffered_bytes, packet_limited_send_rate_queue) {
+    logger::initialize("logs/packet_limited_send_rate_queue_unittest.log", spdlog::level::info);
+    auto poller = event_poller_pool::Instance().get_poller(false);
+    auto ack_queue = std::make_shared<srt_ack_queue>();
+    auto queue = std::make_shared<packet_limited_send_rate_queue<std::shared_ptr<buffer>>>(poller, ack_queue, true, 1, 1456, std::chrono::steady_clock::now());
+    std::atomic<int> writable{0};
+    queue->set_on_writable([&]() { ++writable; });
+    queue->set_current_sequence(0);
+    queue->set_window_size(8192);
+    queue->update_flow_window(8192);
+    queue->start();
+    EXPECT_EQ(queue->get_buffered_bytes(), 0);
+    EXPECT_EQ(queue->get_buffered_time(), 0);
+
+    auto payload = std::make_shared<buffer>(std::string(100, 'a'));
+    for (int i = 0; i < 10; i++) {
+        EXPECT_EQ(queue->input_packet(payload, 0, 0), 100);
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    /// 全部进入发送窗口, 字节数包括包头
+    EXPECT_EQ(queue->get_cached_size(), 0);
+    EXPECT_EQ(queue->get_buffered_bytes(), 10 * (100 + 16));
+    EXPECT_GE(queue->get_buffered_time(), 40);
+    EXPECT_GE(writable.load(), 1);
+
+    std::atomic<bool> acked{false};
+    poller->async([&]() {
+        queue->ack_sequence_to(false, 10, 0, 0);
+        acked = true;
+    });
+    while (!acked) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    EXPECT_EQ(queue->get_buffered_bytes(), 0);
+    EXPECT_EQ(queue->get_buffered_time(), 0);
+    queue->clear();
+}
+
+TEST(message, packet_limited_send_rate_queue) {
+    logger::initialize("logs/packet_limited_send_rate_queue_unittest.log", spdlog::level::info);
+    auto poller = event_poller_pool::Instance().get_poller(false);
+    auto ack_queue = std::make_shared<srt_ack_queue>();
+    auto queue = std::make_shared<packet_limited_send_rate_queue<std::shared_ptr<buffer>>>(poller, ack_queue, true, 1, 1456, std::chrono::steady_clock::now());
+    std::mutex mtx;
+    std::vector<std::shared_ptr<srt_packet>> packets;
+    queue->set_on_packet([&](const packet_limited_send_rate_queue<std::shared_ptr<buffer>>::packet_pointer &p) {
+        std::lock_guard<std::mutex> lmtx(mtx);
+        packets.push_back(from_buffer(p->pkt->data(), p->pkt->size()));
+    });
+    queue->set_current_sequence(0);
+    queue->set_window_size(4);
+    queue->update_flow_window(4);
+    queue->start();
+
+    auto message = std::make_shared<buffer>(std::string(300, 'a'));
+    std::vector<packet_payload> fragments(3);
+    for (size_t i = 0; i < fragments.size(); i++) {
+        fragments[i].holder = message;
+        fragments[i].data = message->data() + i * 100;
+        fragments[i].size = 100;
+    }
+    EXPECT_EQ(queue->input_message(fragments), 300);
+    std::vector<packet_payload> solo(1, fragments[0]);
+    EXPECT_EQ(queue->input_message(solo), 100);
+    /// 窗口已经用完, 整个消息被拒绝
+    EXPECT_EQ(queue->input_message(fragments), 0);
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+
+    std::lock_guard<std::mutex> lmtx(mtx);
+    ASSERT_EQ(packets.size(), 4);
+    EXPECT_EQ(packets[0]->get_packet_position_flag(), 0b10);
+    EXPECT_EQ(packets[1]->get_packet_position_flag(), 0b00);
+    EXPECT_EQ(packets[2]->get_packet_position_flag(), 0b01);
+    EXPECT_EQ(packets[3]->get_packet_position_flag(), 0b11);
+    EXPECT_EQ(packets[0]->get_message_number(), packets[2]->get_message_number());
+    EXPECT_NE(packets[0]->get_message_number(), packets[3]->get_message_number());
+    queue->clear();
+}
+
+/// 多个线程同时写入, 生产者之间由自旋锁串行化, 每个消息的分片连续且序号不重复
+TEST(multi_producer, packet_limited_send_rate_queue) {
+    logger::initialize("logs/packet_limited_send_rate_queue_unittest.log", spdlog::level::info);
+    auto poller = event_poller_pool::Instance().get_poller(false);
+    auto ack_queue = std::make_shared<srt_ack_queue>();
+    auto queue = std::make_shared<packet_limited_send_rate_queue<std::shared_ptr<buffer>>>(poller, ack_queue, true, 1, 1456, std::chrono::steady_clock::now());
+    std::mutex mtx;
+    /// 包头和负载的第一个字节(生产者)
+    std::vector<std::pair<std::shared_ptr<srt_packet>, char>> packets;
+    queue->set_on_packet([&](const packet_limited_send_rate_queue<std::shared_ptr<buffer>>::packet_pointer &p) {
+        std::lock_guard<std::mutex> lmtx(mtx);
+        packets.emplace_back(from_buffer(p->pkt->data(), p->pkt->size()), p->payload.size ? p->payload.data[0] : p->pkt->data()[16]);
+    });
+    queue->set_current_sequence(0);
+    queue->set_window_size(8192);
+    queue->update_flow_window(8192);
+    queue->start();
+
+    const int producers = 4;
+    const int messages = 100;
+    std::vector<std::thread> threads;
+    for (int n = 0; n < producers; n++) {
+        threads.emplace_back([&, n]() {
+            auto message = std::make_shared<buffer>(std::string(300, (char) ('a' + n)));
+            std::vector<packet_payload> fragments(3);
+            for (size_t i = 0; i < fragments.size(); i++) {
+                fragments[i].holder = message;
+                fragments[i].data = message->data() + i * 100;
+                fragments[i].size = 100;
+            }
+            for (int i = 0; i < messages;) {
+                if (queue->input_message(fragments) == 300) {
+                    ++i;
+                } else {
+                    std::this_thread::yield();
+                }
+            }
+        });
+    }
+    for (auto &item : threads) {
+        item.join();
+    }
+    const size_t total = producers * messages * 3;
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (std::chrono::steady_clock::now() < deadline) {
+        {
+            std::lock_guard<std::mutex> lmtx(mtx);
+            if (packets.size() >= total) {
+                break;
+            }
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+
+    std::lock_guard<std::mutex> lmtx(mtx);
+    ASSERT_EQ(packets.size(), total);
+    for (size_t i = 0; i < packets.size(); i += 3) {
+        for (size_t k = 0; k < 3; k++) {
+            EXPECT_EQ(packets[i + k].first->get_packet_sequence_number(), i + k);
+            EXPECT_EQ(packets[i + k].first->get_message_number(), packets[i].first->get_message_number());
+            /// 同一个消息的负载来自同一个生产者
+            EXPECT_EQ(packets[i + k].second, packets[i].second);
+        }
+        EXPECT_EQ(packets[i].first->get_packet_position_flag(), 0b10);
+        EXPECT_EQ(packets[i + 1].first->get_packet_position_flag(), 0b00);
+        EXPECT_EQ(packets[i + 2].first->get_packet_position_flag(), 0b01);
+    }
+    queue->clear();
+}
+
+TEST(coalesce, packet_limited_send_rate_queue) {
+    logger::initialize("logs/packet_limited_send_rate_queue_unittest.log", spdlog::level::info);
+    auto poller = event_poller_pool::Instance().get_poller(false);
+    auto ack_queue = std::make_shared<srt_ack_queue>();
+    auto queue = std::make_shared<packet_limited_send_rate_queue<std::shared_ptr<buffer>>>(poller, ack_queue, true, 1, 1456, std::chrono::steady_clock::now());
+    std::mutex mtx;
+    std::vector<size_t> sizes;
+    queue->set_on_packet([&](const packet_limited_send_rate_queue<std::shared_ptr<buffer>>::packet_pointer &p) {
+        std::lock_guard<std::mutex> lmtx(mtx);
+        sizes.push_back(p->payload.size);
+    });
+    queue->set_current_sequence(0);
+    queue->set_window_size(8192);
+    queue->update_flow_window(8192);
+    queue->set_coalesce_delay(20000);
+    queue->start();
+
+    /// 14个TS包合并成两个满包
+    auto ts = std::make_shared<buffer>(std::string(188, 'a'));
+    for (int i = 0; i < 14; i++) {
+        EXPECT_EQ(queue->input_packet(ts, 0, 0), 188);
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    {
+        std::lock_guard<std::mutex> lmtx(mtx);
+        ASSERT_EQ(sizes.size(), 2);
+        EXPECT_EQ(sizes[0], 7 * 188);
+        EXPECT_EQ(sizes[1], 7 * 188);
+    }
+
+    /// 凑不满一个包, 超过等待时间后发送
+    for (int i = 0; i < 3; i++) {
+        EXPECT_EQ(queue->input_packet(ts, 0, 0), 188);
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    {
+        std::lock_guard<std::mutex> lmtx(mtx);
+        ASSERT_EQ(sizes.size(), 3);
+        EXPECT_EQ(sizes[2], 3 * 188);
+    }
+    queue->clear();
+}
+
+TEST(rexmit_budget, packet_limited_send_rate_queue) {
+    logger::initialize("logs/packet_limited_send_rate_queue_unittest.log", spdlog::level::info);
+    auto poller = event_poller_pool::Instance().get_poller(false);
+    auto ack_queue = std::make_shared<srt_ack_queue>();
+    auto queue = std::make_shared<packet_limited_send_rate_queue<std::shared_ptr<buffer>>>(poller, ack_queue, true, 1, 1456, std::chrono::steady_clock::now());
+    std::atomic<int> fresh{0};
+    std::atomic<int> rexmit{0};
+    queue->set_on_packet([&](const packet_limited_send_rate_queue<std::shared_ptr<buffer>>::packet_pointer &p) {
+        if (p->retransmit_count > 1) {
+            ++rexmit;
+        } else {
+            ++fresh;
+        }
+    });
+    /// 输入码率1MB/s, 重传预算为5%, 即50KB/s
+    auto mode = std::make_shared<constant_rate_mode>();
+    mode->set_overhead(5);
+    mode->set_bandwidth(1000 * 1000);
+    EXPECT_EQ(mode->get_bandwidth(), 1050 * 1000);
+    queue->set_bandwidth_mode(mode);
+    queue->set_current_sequence(0);
+    queue->set_window_size(8192);
+    queue->update_flow_window(8192);
+    queue->start();
+
+    auto payload = std::make_shared<buffer>(std::string(1000, 'a'));
+    for (int i = 0; i < 20; i++) {
+        EXPECT_EQ(queue->input_packet(payload, 0, 0), 1000);
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    EXPECT_EQ(fresh.load(), 20);
+
+    /// 整个窗口都丢失, 重传只能用完突发预算, 剩下的按照预算的速率发送
+    poller->async([&]() {
+        queue->send_again(0, 19);
+    });
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    EXPECT_GE(rexmit.load(), 4);
+    EXPECT_LE(rexmit.load(), 8);
+    EXPECT_GT(queue->get_rexmit_deferred_count(), 0);
+
+    /// 重传的同时新数据不受影响
+    for (int i = 0; i < 10; i++) {
+        EXPECT_EQ(queue->input_packet(payload, 0, 0), 1000);
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(30));
+    EXPECT_EQ(fresh.load(), 30);
+    EXPECT_LT(rexmit.load(), 20);
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(400));
+    EXPECT_EQ(rexmit.load(), 20);
+    queue->clear();
+}
+
+TEST(kernel_pacing, packet_limited_send_rate_queue) {
+    logger::initialize("logs/packet_limited_send_rate_queue_unittest.log", spdlog::level::info);
+    auto poller = event_poller_pool::Instance().get_poller(false);
+    auto ack_queue = std::make_shared<srt_ack_queue>();
+    auto queue = std::make_shared<packet_limited_send_rate_queue<std::shared_ptr<buffer>>>(poller, ack_queue, true, 1, 1456, std::chrono::steady_clock::now());
+    std::mutex mtx;
+    std::vector<uint64_t> launch_times;
+    /// 交给内核的时间早于发送时间点的包数量
+    std::atomic<int> ahead{0};
+    queue->set_on_packet([&](const packet_limited_send_rate_queue<std::shared_ptr<buffer>>::packet_pointer &p) {
+        auto now = (uint64_t) std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+        if (p->launch_time > now) {
+            ++ahead;
+        }
+        std::lock_guard<std::mutex> lmtx(mtx);
+        launch_times.push_back(p->launch_time);
+    });
+    /// 10MB/s, 每个包的发送间隔在100us以上
+    auto mode = std::make_shared<constant_rate_mode>();
+    mode->set_overhead(5);
+    mode->set_bandwidth(10 * 1000 * 1000);
+    queue->set_bandwidth_mode(mode);
+    queue->set_current_sequence(0);
+    queue->set_window_size(8192);
+    queue->update_flow_window(8192);
+    queue->set_kernel_pacing(true);
+    EXPECT_TRUE(queue->get_kernel_pacing());
+    queue->start();
+
+    auto payload = std::make_shared<buffer>(std::string(1000, 'a'));
+    for (int i = 0; i < 20; i++) {
+        EXPECT_EQ(queue->input_packet(payload, 0, 0), 1000);
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    std::lock_guard<std::mutex> lmtx(mtx);
+    ASSERT_EQ(launch_times.size(), 20);
+    for (size_t i = 1; i < launch_times.size(); i++) {
+        EXPECT_GE(launch_times[i] - launch_times[i - 1], 90 * 1000);
+    }
+    EXPECT_GT(ahead.load(), 0);
+    queue->clear();
+}
+
+/// 上层持有发送过的包时, 已经被确认的包也不会再从重传队列中发送
+TEST(rexmit_acked, packet_limited_send_rate_queue) {
+    logger::initialize("logs/packet_limited_send_rate_queue_unittest.log", spdlog::level::info);
+    auto poller = event_poller_pool::Instance().get_poller(false);
+    auto ack_queue = std::make_shared<srt_ack_queue>();
+    auto queue = std::make_shared<packet_limited_send_rate_queue<std::shared_ptr<buffer>>>(poller, ack_queue, true, 1, 1456, std::chrono::steady_clock::now());
+    std::mutex mtx;
+    std::vector<packet_limited_send_rate_queue<std::shared_ptr<buffer>>::packet_pointer> holder;
+    std::atomic<int> rexmit{0};
+    queue->set_on_packet([&](const packet_limited_send_rate_queue<std::shared_ptr<buffer>>::packet_pointer &p) {
+        if (p->retransmit_count > 1) {
+            ++rexmit;
+        }
+        std::lock_guard<std::mutex> lmtx(mtx);
+        holder.push_back(p);
+    });
+    auto mode = std::make_shared<constant_rate_mode>();
+    mode->set_overhead(5);
+    mode->set_bandwidth(1000 * 1000);
+    queue->set_bandwidth_mode(mode);
+    queue->set_current_sequence(0);
+    queue->set_window_size(8192);
+    queue->update_flow_window(8192);
+    queue->start();
+
+    auto payload = std::make_shared<buffer>(std::string(1000, 'a'));
+    for (int i = 0; i < 20; i++) {
+        EXPECT_EQ(queue->input_packet(payload, 0, 0), 1000);
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+
+    /// 重传预算只够发送一部分, 剩下的在重传队列中等待时被确认
+    poller->async([&]() {
+        queue->send_again(0, 19);
+        queue->ack_sequence_to(true, 20, 0, 0);
+    });
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    auto sent = rexmit.load();
+    EXPECT_LT(sent, 20);
+    std::this_thread::sleep_for(std::chrono::milliseconds(400));
+    EXPECT_EQ(rexmit.load(), sent);
+    EXPECT_EQ(queue->get_buffered_bytes(), 0);
+    queue->clear();
+}
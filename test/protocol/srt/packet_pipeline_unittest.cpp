@@ -0,0 +1,98 @@
+//
+// Created by 沈昊 on 2026/10/19.
+//
+/// 静态组合的流水线: 发送队列 -> 过滤 -> 接收队列 -> 应用层, 相邻两级直接调用
+#include "net/buffer.hpp"
+#include "protocol/srt/packet_pipeline.hpp"
+#include "protocol/srt/packet_receive_queue.hpp"
+#include "protocol/srt/packet_sending_queue.hpp"
+#include "protocol/srt/srt_ack.hpp"
+#include "spdlog/logger.hpp"
+#include <gtest/gtest.h>
+#include <memory>
+#include <vector>
+using payload_type = std::shared_ptr<buffer>;
+using packet_pointer = std::shared_ptr<packet<payload_type>>;
+
+struct collect_sink {
+    std::vector<uint32_t> *delivered;
+    std::vector<uint32_t> *dropped;
+    void on_packet(const packet_pointer &p) {
+        delivered->push_back(p->seq);
+    }
+    void on_drop_packet(uint32_t begin, uint32_t) {
+        dropped->push_back(begin);
+    }
+};
+
+using receiver_type = packet_receive_queue<payload_type, collect_sink>;
+
+struct receiver_transport {
+    receiver_type *receiver;
+    void on_packet(const packet_pointer &p) {
+        receiver->input_packet(p->pkt, p->seq, 0);
+    }
+    void on_drop_packet(uint32_t, uint32_t) {}
+    void on_writable() {}
+    void on_flush() {}
+};
+
+/// 丢弃序号为5的包
+struct drop_five {
+    bool operator()(const packet_pointer &p) const {
+        return p->seq != 5;
+    }
+};
+
+TEST(static_stage, packet_pipeline) {
+    logger::initialize("logs/packet_pipeline_unittest.log", spdlog::level::warn);
+    std::vector<uint32_t> delivered, dropped;
+    auto receiver = std::make_shared<receiver_type>();
+    receiver->set_next(collect_sink{&delivered, &dropped});
+    receiver->set_current_sequence(0);
+    receiver->set_window_size(64);
+
+    /// 队列的定时器只在当前线程中设置, poller不需要运行
+    auto poller = std::make_shared<event_poller>();
+    using filter_type = packet_filter<payload_type, drop_five, receiver_transport>;
+    auto sender = std::make_shared<packet_sending_queue<payload_type, filter_type>>(poller, std::make_shared<srt::srt_ack_queue>(), true, false);
+    sender->set_next(filter_type(drop_five(), receiver_transport{receiver.get()}));
+    sender->set_current_sequence(0);
+    /// 静态组合时类型擦除的回调不起作用
+    bool erased = false;
+    sender->set_on_packet([&erased](const packet_pointer &) {
+        erased = true;
+    });
+    auto payload = std::make_shared<buffer>(std::string(100, 'a'));
+    for (int i = 0; i < 10; i++) {
+        sender->input_packet(payload, 0, 0);
+    }
+    EXPECT_FALSE(erased);
+    EXPECT_EQ(delivered, std::vector<uint32_t>({0, 1, 2, 3, 4}));
+    /// 被过滤的包在接收端丢弃, 之后的包继续交付
+    receiver->drop(5, 5);
+    EXPECT_EQ(dropped, std::vector<uint32_t>({5}));
+    receiver->drop(9, 9);
+    EXPECT_EQ(delivered.size(), 9);
+    EXPECT_EQ(delivered.back(), 9);
+}
+
+TEST(function_next, packet_pipeline) {
+    logger::initialize("logs/packet_pipeline_unittest.log", spdlog::level::warn);
+    /// 运行时才能确定的下一级使用类型擦除的适配器, 没有设置的回调被忽略
+    auto receiver = std::make_shared<packet_receive_queue<payload_type, function_next<payload_type>>>();
+    uint32_t count = 0;
+    function_next<payload_type> next;
+    next.packet_func = [&count](const packet_pointer &) {
+        ++count;
+    };
+    receiver->set_next(next);
+    receiver->set_current_sequence(0);
+    auto payload = std::make_shared<buffer>(std::string(100, 'a'));
+    receiver->input_packet(payload, 0, 0);
+    receiver->input_packet(payload, 2, 0);
+    receiver->drop(1, 1);
+    EXPECT_EQ(count, 1);
+    receiver->drop(2, 2);
+    EXPECT_EQ(count, 2);
+}
@@ -0,0 +1,144 @@
+﻿//
+// Created by 沈昊 on 2026/10/19.
+//
+#include "net/buffer.hpp"
+#include "protocol/srt/packet_receive_queue.hpp"
+#include "spdlog/logger.hpp"
+#include <gtest/gtest.h>
+#include <thread>
+#include <vector>
+
+TEST(reorder_tolerance, packet_receive_queue) {
+    logger::initialize("logs/packet_receive_queue_unittest.log", spdlog::level::info);
+    auto queue = std::make_shared<packet_receive_queue<std::shared_ptr<buffer>>>();
+    std::vector<uint32_t> delivered;
+    queue->set_on_packet([&](const packet_receive_queue<std::shared_ptr<buffer>>::packet_pointer &p) {
+        delivered.push_back(p->seq);
+    });
+    queue->set_on_drop_packet([](uint32_t, uint32_t) {});
+    queue->set_current_sequence(0);
+    queue->set_window_size(64);
+    queue->set_reorder_tolerance(4);
+    queue->set_reorder_timeout(1000);
+    auto payload = std::make_shared<buffer>(std::string(100, 'a'));
+
+    /// 容忍度为0时立即上报
+    queue->input_message_packet(payload, 0, 0, 0b11, 0, false);
+    queue->input_message_packet(payload, 1, 0, 0b11, 0, false);
+    queue->input_message_packet(payload, 3, 0, 0b11, 0, false);
+    auto pending = queue->get_pending_packets();
+    ASSERT_EQ(pending.size(), 1);
+    EXPECT_EQ(pending[0].first, 2);
+    EXPECT_EQ(queue->get_reorder_tolerance(), 0);
+
+    /// 原始包在NAK之后才到达, 容忍度调整为乱序距离
+    queue->input_message_packet(payload, 2, 0, 0b11, 0, false);
+    EXPECT_EQ(queue->get_belated_count(), 1);
+    EXPECT_EQ(queue->get_reorder_tolerance(), 2);
+    EXPECT_EQ(delivered.size(), 4);
+
+    /// 空洞之后只到达了1个包, 暂不上报
+    queue->input_message_packet(payload, 5, 0, 0b11, 0, false);
+    EXPECT_TRUE(queue->get_pending_packets().empty());
+    queue->input_message_packet(payload, 6, 0, 0b11, 0, false);
+    pending = queue->get_pending_packets();
+    ASSERT_EQ(pending.size(), 1);
+    EXPECT_EQ(pending[0].first, 4);
+    /// 重传包不算作乱序
+    queue->input_message_packet(payload, 4, 0, 0b11, 0, true);
+    EXPECT_EQ(queue->get_belated_count(), 1);
+    EXPECT_EQ(delivered.size(), 7);
+
+    /// 超过等待时间后上报
+    queue->set_reorder_timeout(10);
+    queue->input_message_packet(payload, 8, 0, 0b11, 0, false);
+    EXPECT_TRUE(queue->get_pending_packets().empty());
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    pending = queue->get_pending_packets();
+    ASSERT_EQ(pending.size(), 1);
+    EXPECT_EQ(pending[0].first, 7);
+
+    /// 不能超过最大容忍度
+    queue->input_message_packet(payload, 20, 0, 0b11, 0, false);
+    queue->get_pending_packets();
+    queue->input_message_packet(payload, 7, 0, 0b11, 0, false);
+    EXPECT_EQ(queue->get_belated_count(), 2);
+    EXPECT_EQ(queue->get_reorder_tolerance(), 4);
+}
+
+/// 只有乱序容忍暂缓上报空洞时才需要再次检查, NAK定时器依此决定是否继续
+TEST(reorder_pending, packet_receive_queue) {
+    logger::initialize("logs/packet_receive_queue_unittest.log", spdlog::level::info);
+    auto queue = std::make_shared<packet_receive_queue<std::shared_ptr<buffer>>>();
+    queue->set_on_packet([](const packet_receive_queue<std::shared_ptr<buffer>>::packet_pointer &) {});
+    queue->set_on_drop_packet([](uint32_t, uint32_t) {});
+    queue->set_current_sequence(0);
+    queue->set_window_size(64);
+    queue->set_reorder_tolerance(4);
+    queue->set_reorder_timeout(1000);
+    auto payload = std::make_shared<buffer>(std::string(100, 'a'));
+
+    /// 没有空洞
+    queue->input_message_packet(payload, 0, 0, 0b11, 0, false);
+    EXPECT_TRUE(queue->get_pending_packets().empty());
+    EXPECT_FALSE(queue->has_reorder_pending());
+
+    /// 容忍度为0时立即上报, 不需要等待
+    queue->input_message_packet(payload, 2, 0, 0b11, 0, false);
+    EXPECT_EQ(queue->get_pending_packets().size(), 1);
+    EXPECT_FALSE(queue->has_reorder_pending());
+    queue->input_message_packet(payload, 1, 0, 0b11, 0, false);
+    EXPECT_GT(queue->get_reorder_tolerance(), 0);
+
+    /// 空洞在容忍范围内
+    queue->input_message_packet(payload, 4, 0, 0b11, 0, false);
+    EXPECT_TRUE(queue->get_pending_packets().empty());
+    EXPECT_TRUE(queue->has_reorder_pending());
+    /// 空洞补齐之后不再需要检查
+    queue->input_message_packet(payload, 3, 0, 0b11, 0, false);
+    EXPECT_EQ(queue->get_buffer_size(), 0);
+    EXPECT_TRUE(queue->get_pending_packets().empty());
+    EXPECT_FALSE(queue->has_reorder_pending());
+}
+
+TEST(lazy_slots, packet_receive_queue) {
+    logger::initialize("logs/packet_receive_queue_unittest.log", spdlog::level::info);
+    auto queue = std::make_shared<packet_receive_queue<std::shared_ptr<buffer>>>();
+    std::vector<uint32_t> delivered;
+    queue->set_on_packet([&](const packet_receive_queue<std::shared_ptr<buffer>>::packet_pointer &p) {
+        delivered.push_back(p->seq);
+    });
+    queue->set_on_drop_packet([](uint32_t, uint32_t) {});
+    queue->set_current_sequence(0);
+    queue->set_window_size(8192);
+    EXPECT_EQ(queue->get_slot_size(), packet_receive_queue<std::shared_ptr<buffer>>::initial_slots);
+    auto payload = std::make_shared<buffer>(std::string(100, 'a'));
+
+    /// 按序到达时不需要增长
+    for (uint32_t i = 0; i < 100; i++) {
+        queue->input_packet(payload, i, 0);
+    }
+    EXPECT_EQ(queue->get_slot_size(), packet_receive_queue<std::shared_ptr<buffer>>::initial_slots);
+
+    /// 丢包之后按需增长, 已经缓存的包保持顺序
+    for (uint32_t i = 101; i < 300; i++) {
+        queue->input_packet(payload, i, 0);
+    }
+    EXPECT_EQ(queue->get_slot_size(), 256);
+    EXPECT_EQ(queue->get_buffer_size(), 199);
+    /// 超过窗口的包被拒绝
+    EXPECT_EQ(queue->input_packet(payload, 100 + 8192, 0), -1);
+    queue->shrink();
+    EXPECT_EQ(queue->get_slot_size(), 256);
+
+    queue->input_packet(payload, 100, 0);
+    ASSERT_EQ(delivered.size(), 300);
+    for (uint32_t i = 0; i < 300; i++) {
+        ASSERT_EQ(delivered[i], i);
+    }
+    /// 没有缓存的包时恢复到初始大小
+    queue->shrink();
+    EXPECT_EQ(queue->get_slot_size(), packet_receive_queue<std::shared_ptr<buffer>>::initial_slots);
+    queue->input_packet(payload, 300, 0);
+    EXPECT_EQ(delivered.size(), 301);
+}
@@ -0,0 +1,93 @@
+﻿//
+// Created by 沈昊 on 2026/10/19.
+//
+#include <gtest/gtest.h>
+#include <protocol/srt/srt_ack.hpp>
+#include <spdlog/logger.hpp>
+#include <thread>
+using namespace srt;
+
+TEST(ack_window, srt_ack_queue) {
+    logger::initialize("logs/srt_ack_unittest.log", spdlog::level::info);
+    srt_ack_queue queue;
+    queue.set_rtt(100000, 50000);
+    queue.add_ack(1);
+    std::this_thread::sleep_for(std::chrono::milliseconds(2));
+    queue.calculate(1);
+    /// 收到ack ack后rtt会被更新
+    EXPECT_LT(queue.get_rto(), 100000);
+    auto rtt = queue.get_rto();
+    /// 同一个ack ack只计算一次
+    queue.calculate(1);
+    EXPECT_EQ(rtt, queue.get_rto());
+    /// 被覆盖的槽位不再参与计算
+    queue.add_ack(2);
+    queue.add_ack(2 + srt_ack_queue::ack_window_size);
+    queue.calculate(2);
+    EXPECT_EQ(rtt, queue.get_rto());
+    queue.calculate(2 + srt_ack_queue::ack_window_size);
+    EXPECT_NE(rtt, queue.get_rto());
+}
+
+TEST(ack_window_grow, srt_ack_queue) {
+    logger::initialize("logs/srt_ack_unittest.log", spdlog::level::info);
+    srt_ack_queue queue;
+    /// 没有发送过ack时不分配窗口
+    EXPECT_EQ(queue.get_window_size(), 0);
+    queue.add_ack(1);
+    EXPECT_EQ(queue.get_window_size(), srt_ack_queue::min_ack_window_size);
+    /// 等待ack ack的数量超过窗口时扩大
+    for (uint32_t i = 2; i <= 40; i++) {
+        queue.add_ack(i);
+    }
+    EXPECT_EQ(queue.get_window_size(), 64);
+    auto rtt = queue.get_rto();
+    queue.calculate(3);
+    EXPECT_NE(rtt, queue.get_rto());
+    /// 还有等待ack ack的槽位时不释放
+    queue.shrink();
+    EXPECT_EQ(queue.get_window_size(), 64);
+    for (uint32_t i = 1; i <= 40; i++) {
+        queue.calculate(i);
+    }
+    queue.shrink();
+    EXPECT_EQ(queue.get_window_size(), 0);
+}
+
+TEST(arrival_time, srt_ack_queue) {
+    logger::initialize("logs/srt_ack_unittest.log", spdlog::level::info);
+    srt_ack_queue queue;
+    queue.set_rtt(100000, 50000);
+    queue.add_ack(1);
+    auto arrival = std::chrono::steady_clock::now() + std::chrono::milliseconds(1);
+    /// ack ack在socket中等待的时间不计入rtt
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    queue.calculate(1, arrival);
+    EXPECT_LT(queue.get_rto(), 20000);
+}
+
+TEST(light_ack, srt_ack_frequency) {
+    srt_ack_frequency frequency;
+    uint32_t seq = 100;
+    for (uint32_t i = 1; i < srt_ack_frequency::light_ack_packets; i++) {
+        EXPECT_FALSE(frequency.on_data_packet(++seq));
+    }
+    EXPECT_TRUE(frequency.on_data_packet(++seq));
+    /// 序号没有推进, 不发送light ack
+    for (uint32_t i = 0; i < srt_ack_frequency::light_ack_packets; i++) {
+        EXPECT_FALSE(frequency.on_data_packet(seq));
+    }
+}
+
+TEST(full_ack_backoff, srt_ack_frequency) {
+    srt_ack_frequency frequency;
+    EXPECT_EQ(frequency.on_full_ack(10), srt_ack_frequency::min_full_ack_interval);
+    EXPECT_EQ(frequency.on_full_ack(10), srt_ack_frequency::min_full_ack_interval * 2);
+    EXPECT_EQ(frequency.on_full_ack(10), srt_ack_frequency::min_full_ack_interval * 4);
+    for (int i = 0; i < 8; i++) {
+        frequency.on_full_ack(10);
+    }
+    EXPECT_EQ(frequency.get_full_ack_interval(), srt_ack_frequency::max_full_ack_interval);
+    /// 序号推进后立即恢复
+    EXPECT_EQ(frequency.on_full_ack(11), srt_ack_frequency::min_full_ack_interval);
+}
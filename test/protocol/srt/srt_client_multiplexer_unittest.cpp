@@ -0,0 +1,145 @@
+//
+// Created by 沈昊 on 2026/10/19.
+//
+/// 多个客户端共用一个socket, 收到的包按照目的socket id分发到各自的客户端
+#include "event_poller_pool.hpp"
+#include "protocol/srt/srt_client.hpp"
+#include "protocol/srt/srt_packet.h"
+#include "protocol/srt/srt_server.hpp"
+#include "spdlog/logger.hpp"
+#include <atomic>
+#include <gtest/gtest.h>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <thread>
+#include <vector>
+using namespace srt;
+
+/// 收到的数据原样发回
+class echo_session : public srt_session_base {
+public:
+    echo_session(const std::shared_ptr<asio::ip::udp::socket> &sock, const event_poller::Ptr &context) : srt_session_base(sock, context) {}
+
+protected:
+    void onRecv(const std::shared_ptr<buffer> &buff) override {
+        async_send((const char *) buff->data(), buff->size());
+    }
+    void onConnected() override {}
+    void onError(const std::error_code &) override {}
+};
+
+TEST(echo, srt_client_multiplexer) {
+    logger::initialize("logs/srt_client_multiplexer_unittest.log", spdlog::level::warn);
+    const uint16_t port = 19303;
+    const size_t count = 32;
+    const uint32_t messages = 50;
+    auto server = std::make_shared<srt_server>();
+    server->on_create_session([](const std::shared_ptr<asio::ip::udp::socket> &sock, const event_poller::Ptr &context) -> std::shared_ptr<srt_session_base> {
+        return std::make_shared<echo_session>(sock, context);
+    });
+    server->start(asio::ip::udp::endpoint(asio::ip::udp::v4(), port));
+
+    std::vector<std::shared_ptr<srt_client>> clients;
+    std::vector<std::shared_ptr<std::atomic<uint32_t>>> received;
+    std::atomic<size_t> connected{0};
+    std::set<uint16_t> ports;
+    for (size_t i = 0; i < count; i++) {
+        auto client = std::make_shared<srt_client>(asio::ip::udp::endpoint(asio::ip::udp::v4(), 0), true);
+        auto counter = std::make_shared<std::atomic<uint32_t>>(0);
+        client->set_on_receive([counter](const std::shared_ptr<buffer> &) {
+            ++*counter;
+        });
+        client->async_connect(asio::ip::udp::endpoint(asio::ip::address::from_string("127.0.0.1"), port), [&](const std::error_code &e) {
+            if (!e) {
+                ++connected;
+            }
+        });
+        ports.insert(client->local_endpoint().port());
+        clients.push_back(client);
+        received.push_back(counter);
+    }
+    /// 每个poller最多一个socket
+    EXPECT_LE(ports.size(), event_poller_pool::Instance().size());
+    for (int i = 0; i < 500 && connected < count; i++) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    ASSERT_EQ(connected.load(), count);
+
+    std::string message(1000, 'a');
+    for (uint32_t i = 0; i < messages; i++) {
+        for (auto &client: clients) {
+            client->async_send(message.data(), message.size());
+        }
+    }
+    auto all_received = [&]() {
+        for (auto &counter: received) {
+            if (counter->load() < messages) {
+                return false;
+            }
+        }
+        return true;
+    };
+    for (int i = 0; i < 500 && !all_received(); i++) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    for (auto &counter: received) {
+        EXPECT_EQ(counter->load(), messages);
+    }
+}
+
+/// 其他地址伪造客户端的socket id发送shutdown, 复用器按照源地址丢弃, 连接不受影响
+TEST(foreign_source, srt_client_multiplexer) {
+    logger::initialize("logs/srt_client_multiplexer_unittest.log", spdlog::level::warn);
+    const uint16_t port = 19320;
+    std::mutex mtx;
+    std::shared_ptr<echo_session> session;
+    auto server = std::make_shared<srt_server>();
+    server->on_create_session([&](const std::shared_ptr<asio::ip::udp::socket> &sock, const event_poller::Ptr &context) -> std::shared_ptr<srt_session_base> {
+        std::lock_guard<std::mutex> lock(mtx);
+        session = std::make_shared<echo_session>(sock, context);
+        return session;
+    });
+    server->start(asio::ip::udp::endpoint(asio::ip::udp::v4(), port));
+
+    auto client = std::make_shared<srt_client>(asio::ip::udp::endpoint(asio::ip::udp::v4(), 0), true);
+    std::atomic<bool> connected{false};
+    std::atomic<bool> failed{false};
+    std::atomic<uint32_t> received{0};
+    client->set_on_error([&](const std::error_code &) { failed.store(true); });
+    client->set_on_receive([&](const std::shared_ptr<buffer> &) { ++received; });
+    client->async_connect(asio::ip::udp::endpoint(asio::ip::address::from_string("127.0.0.1"), port), [&](const std::error_code &e) {
+        connected.store(!e);
+    });
+    for (int i = 0; i < 500 && !connected; i++) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    ASSERT_TRUE(connected.load());
+    uint32_t client_id = 0;
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        ASSERT_TRUE(session);
+        /// 会话发往客户端的包中的目的socket id
+        client_id = session->get_sock_id();
+    }
+
+    asio::io_context context;
+    asio::ip::udp::socket foreign(context, asio::ip::udp::endpoint(asio::ip::udp::v4(), 0));
+    srt_packet pkt;
+    pkt.set_control_type(control_type::shutdown);
+    pkt.set_socket_id(client_id);
+    auto pkt_buffer = create_packet(pkt);
+    asio::ip::udp::endpoint target(asio::ip::address::from_string("127.0.0.1"), client->local_endpoint().port());
+    foreign.send_to(asio::buffer(pkt_buffer->data(), pkt_buffer->size()), target);
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    /// 接受了伪造的shutdown时连接断开, 客户端报错或者重连
+    EXPECT_FALSE(failed.load());
+    EXPECT_EQ(client->reconnects(), 0u);
+
+    std::string message(1000, 'a');
+    client->async_send(message.data(), message.size());
+    for (int i = 0; i < 200 && !received; i++) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    EXPECT_EQ(received.load(), 1u);
+}
@@ -0,0 +1,120 @@
+//
+// Created by 沈昊 on 2026/10/19.
+//
+/// 扇出发送: 同一个buffer发送给多个连接, 超过最大负载时切分, 各个连接的包只引用这个buffer, 确认之后释放引用
+#include "protocol/srt/srt_client.hpp"
+#include "protocol/srt/srt_server.hpp"
+#include "spdlog/logger.hpp"
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <gtest/gtest.h>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+using namespace srt;
+
+class fanout_session : public srt_session_base {
+public:
+    fanout_session(const std::shared_ptr<asio::ip::udp::socket> &sock, const event_poller::Ptr &context) : srt_session_base(sock, context) {}
+    std::atomic<bool> connected{false};
+
+protected:
+    void onRecv(const std::shared_ptr<buffer> &) override {}
+    void onConnected() override {
+        connected.store(true);
+    }
+    void onError(const std::error_code &) override {}
+};
+
+static bool connect_client(srt_client &client, uint16_t port) {
+    std::promise<std::error_code> connected;
+    client.async_connect(asio::ip::udp::endpoint(asio::ip::address::from_string("127.0.0.1"), port), [&](const std::error_code &e) {
+        connected.set_value(e);
+    });
+    auto future = connected.get_future();
+    return future.wait_for(std::chrono::seconds(5)) == std::future_status::ready && !future.get();
+}
+
+TEST(shared_payload, srt_fanout) {
+    logger::initialize("logs/srt_fanout_unittest.log", spdlog::level::warn);
+    const uint16_t port = 19315;
+    const size_t destinations = 4;
+    std::mutex mtx;
+    std::vector<std::shared_ptr<fanout_session>> sessions;
+    auto server = std::make_shared<srt_server>();
+    server->on_create_session([&sessions, &mtx](const std::shared_ptr<asio::ip::udp::socket> &sock, const event_poller::Ptr &context) -> std::shared_ptr<srt_session_base> {
+        auto session = std::make_shared<fanout_session>(sock, context);
+        std::lock_guard<std::mutex> lock(mtx);
+        sessions.push_back(session);
+        return session;
+    });
+    server->start(asio::ip::udp::endpoint(asio::ip::udp::v4(), port));
+
+    std::vector<std::shared_ptr<srt_client>> clients;
+    std::vector<std::shared_ptr<std::string>> received;
+    std::vector<std::shared_ptr<std::mutex>> locks;
+    for (size_t i = 0; i < destinations; i++) {
+        auto client = std::make_shared<srt_client>();
+        auto data = std::make_shared<std::string>();
+        auto lock = std::make_shared<std::mutex>();
+        client->set_on_receive([data, lock](const std::shared_ptr<buffer> &buff) {
+            std::lock_guard<std::mutex> guard(*lock);
+            data->append(buff->data(), buff->size());
+        });
+        ASSERT_TRUE(connect_client(*client, port));
+        clients.push_back(client);
+        received.push_back(data);
+        locks.push_back(lock);
+    }
+    for (int i = 0; i < 300; i++) {
+        std::lock_guard<std::mutex> lock(mtx);
+        size_t connected = 0;
+        for (auto &item: sessions) {
+            connected += item->connected.load() ? 1 : 0;
+        }
+        if (connected == destinations) {
+            break;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+
+    /// 超过最大负载, 每个连接切分成3个包
+    auto payload = std::make_shared<buffer>();
+    payload->resize(sessions[0]->get_max_payload() * 2 + 100);
+    for (size_t i = 0; i < payload->size(); i++) {
+        ((char *) payload->data())[i] = (char) (i & 0xFF);
+    }
+    for (auto &item: sessions) {
+        std::error_code e;
+        EXPECT_EQ(item->async_send(payload, e), (int) payload->size());
+    }
+    /// 在途的包和重传都引用同一个buffer
+    EXPECT_GT(payload.use_count(), 1);
+
+    std::string expected(payload->data(), payload->size());
+    for (size_t i = 0; i < destinations; i++) {
+        for (int j = 0; j < 300; j++) {
+            {
+                std::lock_guard<std::mutex> guard(*locks[i]);
+                if (received[i]->size() >= expected.size()) {
+                    break;
+                }
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+        std::lock_guard<std::mutex> guard(*locks[i]);
+        EXPECT_EQ(*received[i], expected);
+    }
+    /// 所有连接确认之后不再持有引用
+    for (int i = 0; i < 300 && payload.use_count() > 1; i++) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    EXPECT_EQ(payload.use_count(), 1);
+
+    /// 客户端同样可以发送共享的buffer
+    std::error_code e;
+    EXPECT_EQ(clients[0]->async_send(payload, e), (int) payload->size());
+}
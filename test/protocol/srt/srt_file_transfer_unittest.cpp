@@ -0,0 +1,146 @@
+﻿//
+// Created by 沈昊 on 2026/10/19.
+//
+/// 本地回环文件传输: 文件模式发送映射的文件, 接收端直接写入fd, 比较两端的校验和
+/// 默认传输64MB, 设置环境变量SRT_FILE_TRANSFER_MB可以测试更大的文件, 如SRT_FILE_TRANSFER_MB=4096
+/// 打开ENABLE_LONG_TEST后会注册srt_file_transfer_long(标签long), 以4096MB运行: ctest -L long
+#include "Util/mapped_file.hpp"
+#include "protocol/srt/srt_client.hpp"
+#include "protocol/srt/srt_server.hpp"
+#include "spdlog/logger.hpp"
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <fcntl.h>
+#include <future>
+#include <gtest/gtest.h>
+#include <memory>
+#include <random>
+#include <string>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+using namespace srt;
+
+static const char *source_path = "srt_file_transfer_unittest.src";
+static const char *dest_path = "srt_file_transfer_unittest.dst";
+
+class file_session : public srt_session_base {
+public:
+    file_session(const std::shared_ptr<asio::ip::udp::socket> &sock, const event_poller::Ptr &context) : srt_session_base(sock, context) {
+        fd = ::open(dest_path, O_CREAT | O_TRUNC | O_WRONLY, 0644);
+    }
+    ~file_session() override {
+        if (fd >= 0) {
+            ::close(fd);
+        }
+    }
+
+protected:
+    void begin() override {
+        srt_session_base::begin();
+        set_receive_fd(fd);
+    }
+    void onRecv(const std::shared_ptr<buffer> &) override {}
+    void onConnected() override {}
+    void onError(const std::error_code &) override {}
+
+private:
+    int fd = -1;
+};
+
+static size_t transfer_size() {
+    auto env = std::getenv("SRT_FILE_TRANSFER_MB");
+    size_t mb = env ? std::strtoull(env, nullptr, 10) : 0;
+    return (mb ? mb : 64) * 1024 * 1024;
+}
+
+static bool create_source_file(size_t size) {
+    auto fd = ::open(source_path, O_CREAT | O_TRUNC | O_WRONLY, 0644);
+    if (fd < 0) {
+        return false;
+    }
+    std::mt19937 mt(20261019);
+    std::vector<uint32_t> block(1024 * 1024 / sizeof(uint32_t));
+    for (auto &item: block) {
+        item = mt();
+    }
+    size_t written = 0;
+    uint32_t index = 0;
+    while (written < size) {
+        /// 每一块都不同, 乱序或者重复的块会改变校验和
+        block[0] = index++;
+        auto length = (std::min)(size - written, block.size() * sizeof(uint32_t));
+        if (::write(fd, block.data(), length) != (ssize_t) length) {
+            ::close(fd);
+            return false;
+        }
+        written += length;
+    }
+    ::close(fd);
+    return true;
+}
+
+static size_t file_size(const char *path) {
+    try {
+        return mapped_file::open(path)->size();
+    } catch (const std::system_error &) {
+        return 0;
+    }
+}
+
+/// FNV-1a 64
+static uint64_t file_checksum(const char *path) {
+    auto file = mapped_file::open(path);
+    uint64_t hash = 14695981039346656037ULL;
+    auto data = (const unsigned char *) file->data();
+    for (size_t i = 0; i < file->size(); i++) {
+        hash = (hash ^ data[i]) * 1099511628211ULL;
+    }
+    return hash;
+}
+
+TEST(loopback, srt_file_transfer) {
+    logger::initialize("logs/srt_file_transfer_unittest.log", spdlog::level::warn);
+    const uint16_t port = 19319;
+    auto size = transfer_size();
+    ASSERT_TRUE(create_source_file(size));
+
+    auto server = std::make_shared<srt_server>();
+    server->on_create_session([](const std::shared_ptr<asio::ip::udp::socket> &sock, const event_poller::Ptr &context) -> std::shared_ptr<srt_session_base> {
+        return std::make_shared<file_session>(sock, context);
+    });
+    server->start(asio::ip::udp::endpoint(asio::ip::udp::v4(), port));
+
+    srt_client client;
+    client.set_buffer_mode(true);
+    std::promise<std::error_code> connected;
+    client.async_connect(asio::ip::udp::endpoint(asio::ip::address::from_string("127.0.0.1"), port), [&](const std::error_code &e) {
+        connected.set_value(e);
+    });
+    auto connect_future = connected.get_future();
+    ASSERT_EQ(connect_future.wait_for(std::chrono::seconds(5)), std::future_status::ready);
+    ASSERT_FALSE(connect_future.get());
+
+    auto begin = std::chrono::steady_clock::now();
+    std::promise<std::error_code> finished;
+    client.async_send_file(source_path, [&](const std::error_code &e) {
+        finished.set_value(e);
+    });
+    /// 回环上至少按照10MB/s估计超时
+    auto timeout = std::chrono::seconds(30 + size / (10 * 1024 * 1024));
+    auto finish_future = finished.get_future();
+    ASSERT_EQ(finish_future.wait_for(timeout), std::future_status::ready);
+    EXPECT_FALSE(finish_future.get());
+    auto spend = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - begin).count();
+    std::cout << "send " << size << " bytes in " << spend << " ms, throughput=" << (spend ? size / 1000.0 / spend : 0) << " MB/s" << std::endl;
+
+    /// 全部确认之后接收端可能还没有写完
+    for (int i = 0; i < 100 && file_size(dest_path) < size; i++) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    }
+    EXPECT_EQ(file_size(dest_path), size);
+    EXPECT_EQ(file_checksum(source_path), file_checksum(dest_path));
+    ::unlink(source_path);
+    ::unlink(dest_path);
+}
@@ -0,0 +1,125 @@
+﻿//
+// Created by 沈昊 on 2026/10/19.
+//
+/// 消息模式重组: 接收队列按序交付给srt_message_assembler, 和srt_socket_service中的路径相同
+#include "net/buffer.hpp"
+#include "protocol/srt/packet_receive_queue.hpp"
+#include "protocol/srt/srt_message.hpp"
+#include "spdlog/logger.hpp"
+#include <gtest/gtest.h>
+#include <string>
+#include <vector>
+
+using namespace srt;
+
+class message_receiver {
+public:
+    using queue_type = packet_receive_queue<std::shared_ptr<buffer>>;
+
+    explicit message_receiver(uint32_t seq) {
+        queue = std::make_shared<queue_type>();
+        queue->set_on_packet([this](const queue_type::packet_pointer &p) {
+            std::vector<std::shared_ptr<buffer>> fragments;
+            if (!assembler.input(p->seq, p->position, p->message_number, p->pkt, fragments)) {
+                return;
+            }
+            std::string message;
+            for (const auto &item : fragments) {
+                message.append(item->data(), item->size());
+            }
+            messages.push_back(message);
+        });
+        queue->set_on_drop_packet([](uint32_t, uint32_t) {});
+        queue->set_current_sequence(seq);
+        queue->set_max_sequence(0x7FFFFFFF);
+        queue->set_window_size(64);
+        assembler.reset(seq, 0x7FFFFFFF);
+    }
+
+    void input(uint32_t seq, uint8_t position, uint32_t message_number, const std::string &payload) {
+        queue->input_message_packet(std::make_shared<buffer>(payload), seq, 0, position, message_number, false);
+    }
+
+public:
+    std::shared_ptr<queue_type> queue;
+    srt_message_assembler assembler;
+    std::vector<std::string> messages;
+};
+
+TEST(in_order, srt_message) {
+    logger::initialize("logs/srt_message_unittest.log", spdlog::level::info);
+    message_receiver receiver(100);
+    receiver.input(100, 0b11, 1, "single");
+    ASSERT_EQ(receiver.messages.size(), 1);
+    EXPECT_EQ(receiver.messages[0], "single");
+
+    /// 首包和中间包不交付, 尾包到达后整体交付
+    receiver.input(101, 0b10, 2, "first-");
+    receiver.input(102, 0b00, 2, "middle-");
+    EXPECT_EQ(receiver.messages.size(), 1);
+    receiver.input(103, 0b01, 2, "last");
+    ASSERT_EQ(receiver.messages.size(), 2);
+    EXPECT_EQ(receiver.messages[1], "first-middle-last");
+
+    /// 只有首包和尾包
+    receiver.input(104, 0b10, 3, "a");
+    receiver.input(105, 0b01, 3, "b");
+    ASSERT_EQ(receiver.messages.size(), 3);
+    EXPECT_EQ(receiver.messages[2], "ab");
+    EXPECT_EQ(receiver.assembler.get_dropped_messages(), 0);
+}
+
+TEST(reordered, srt_message) {
+    logger::initialize("logs/srt_message_unittest.log", spdlog::level::info);
+    message_receiver receiver(0);
+    /// 乱序到达的分片由接收队列排序, 重组后的顺序和发送顺序一致
+    receiver.input(3, 0b01, 1, "last");
+    receiver.input(1, 0b00, 1, "middle-");
+    EXPECT_TRUE(receiver.messages.empty());
+    receiver.input(0, 0b10, 1, "first-");
+    EXPECT_TRUE(receiver.messages.empty());
+    receiver.input(2, 0b00, 1, "middle-");
+    ASSERT_EQ(receiver.messages.size(), 1);
+    EXPECT_EQ(receiver.messages[0], "first-middle-middle-last");
+
+    /// 后一个消息先到达, 在前一个消息之后交付
+    receiver.input(6, 0b11, 3, "third");
+    receiver.input(5, 0b01, 2, "b");
+    receiver.input(4, 0b10, 2, "a");
+    ASSERT_EQ(receiver.messages.size(), 3);
+    EXPECT_EQ(receiver.messages[1], "ab");
+    EXPECT_EQ(receiver.messages[2], "third");
+    EXPECT_EQ(receiver.assembler.get_dropped_messages(), 0);
+}
+
+TEST(gapped, srt_message) {
+    logger::initialize("logs/srt_message_unittest.log", spdlog::level::info);
+    message_receiver receiver(0);
+    /// 中间包丢失, 丢包请求之后队列跳过空洞, 已经收到的首包和尾包都不交付
+    receiver.input(0, 0b10, 1, "first-");
+    receiver.input(2, 0b01, 1, "last");
+    receiver.queue->drop(1, 2);
+    EXPECT_TRUE(receiver.messages.empty());
+    EXPECT_EQ(receiver.assembler.get_dropped_messages(), 1);
+
+    /// 空洞之后的完整消息正常交付
+    receiver.input(3, 0b11, 2, "single");
+    ASSERT_EQ(receiver.messages.size(), 1);
+    EXPECT_EQ(receiver.messages[0], "single");
+
+    /// 首包丢失, 后面的分片全部丢弃
+    receiver.input(5, 0b00, 3, "middle-");
+    receiver.input(6, 0b01, 3, "last");
+    receiver.queue->drop(4, 6);
+    EXPECT_EQ(receiver.messages.size(), 1);
+
+    /// 尾包丢失, 下一个消息的首包到达时丢弃未完成的消息
+    receiver.input(7, 0b10, 4, "first-");
+    receiver.input(8, 0b00, 4, "middle-");
+    receiver.input(10, 0b10, 5, "a");
+    receiver.input(11, 0b01, 5, "b");
+    receiver.queue->drop(9, 11);
+    ASSERT_EQ(receiver.messages.size(), 2);
+    EXPECT_EQ(receiver.messages[1], "ab");
+    EXPECT_EQ(receiver.assembler.get_dropped_messages(), 2);
+}
@@ -0,0 +1,229 @@
+//
+// Created by 沈昊 on 2026/10/19.
+//
+/// 路径MTU探测: 二分查找的收敛, 本地回环上确认巨帧, 经过丢弃大包的UDP代理时收敛到代理允许的大小
+#include "asio.hpp"
+#include "protocol/srt/srt_client.hpp"
+#include "protocol/srt/srt_mtu.hpp"
+#include "protocol/srt/srt_server.hpp"
+#include "spdlog/logger.hpp"
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <gtest/gtest.h>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+using namespace srt;
+
+TEST(search, srt_mtu_search) {
+    srt_mtu_search search;
+    EXPECT_TRUE(search.is_done());
+    search.reset(1500, 1500);
+    EXPECT_TRUE(search.is_done());
+    EXPECT_EQ(search.next_probe(), 0);
+    EXPECT_EQ(search.get_mss(), 1500);
+
+    /// 路径能通过最大值时一次确认
+    search.reset(1500, 9000);
+    EXPECT_EQ(search.next_probe(), 9000);
+    EXPECT_TRUE(search.on_probe_ack(9000));
+    EXPECT_EQ(search.get_mss(), 9000);
+    EXPECT_EQ(search.next_probe(), 0);
+    EXPECT_TRUE(search.is_done());
+
+    /// 路径MTU为4000, 超过的探测都没有回复
+    const uint32_t path = 4000;
+    search.reset(1500, 9000);
+    uint32_t probes = 0;
+    for (auto mss = search.next_probe(); mss; mss = search.next_probe()) {
+        ++probes;
+        if (mss <= path) {
+            EXPECT_TRUE(search.on_probe_ack(mss));
+        }
+        search.on_probe_timeout();
+        /// 过期的回复被忽略
+        EXPECT_FALSE(search.on_probe_ack(1500));
+    }
+    EXPECT_TRUE(search.is_done());
+    EXPECT_LE(search.get_mss(), path);
+    EXPECT_GT(search.get_mss() + srt_mtu_search::granularity, path);
+    EXPECT_LT(probes, 40);
+}
+
+class mtu_session : public srt_session_base {
+public:
+    mtu_session(const std::shared_ptr<asio::ip::udp::socket> &sock, const event_poller::Ptr &context) : srt_session_base(sock, context) {}
+    std::atomic<uint32_t> received{0};
+    std::atomic<uint32_t> max_size{0};
+
+protected:
+    void onRecv(const std::shared_ptr<buffer> &buff) override {
+        if (buff->size() > max_size.load()) {
+            max_size.store((uint32_t) buff->size());
+        }
+        ++received;
+    }
+    void onConnected() override {}
+    void onError(const std::error_code &) override {}
+};
+
+/// 单向转发的UDP代理, 丢弃超过limit字节的数据报, 模拟MTU较小的路径
+class mtu_proxy {
+public:
+    mtu_proxy(uint16_t port, const asio::ip::udp::endpoint &server, size_t limit) : front(context, asio::ip::udp::endpoint(asio::ip::address::from_string("127.0.0.1"), port)),
+                                                                                  back(context), limit(limit) {
+        back.open(asio::ip::udp::v4());
+        back.connect(server);
+        read_front();
+        read_back();
+        worker = std::thread([this]() { context.run(); });
+    }
+
+    ~mtu_proxy() {
+        context.stop();
+        worker.join();
+    }
+
+private:
+    void read_front() {
+        front.async_receive_from(asio::buffer(front_data), client, [this](const std::error_code &e, size_t length) {
+            if (e) {
+                return;
+            }
+            if (length <= limit) {
+                std::error_code ignored;
+                back.send(asio::buffer(front_data, length), 0, ignored);
+            }
+            read_front();
+        });
+    }
+
+    void read_back() {
+        back.async_receive(asio::buffer(back_data), [this](const std::error_code &e, size_t length) {
+            if (e && e != asio::error::connection_refused) {
+                return;
+            }
+            if (!e && length <= limit) {
+                std::error_code ignored;
+                front.send_to(asio::buffer(back_data, length), client, 0, ignored);
+            }
+            read_back();
+        });
+    }
+
+private:
+    asio::io_context context;
+    asio::ip::udp::socket front;
+    asio::ip::udp::socket back;
+    asio::ip::udp::endpoint client;
+    size_t limit;
+    char front_data[65536];
+    char back_data[65536];
+    std::thread worker;
+};
+
+static std::shared_ptr<srt_server> start_mtu_server(uint16_t port, bool connected_socket, std::vector<std::shared_ptr<mtu_session>> &sessions, std::mutex &mtx) {
+    auto server = std::make_shared<srt_server>();
+    server->set_connected_session_socket(connected_socket);
+    server->on_create_session([&sessions, &mtx](const std::shared_ptr<asio::ip::udp::socket> &sock, const event_poller::Ptr &context) -> std::shared_ptr<srt_session_base> {
+        auto session = std::make_shared<mtu_session>(sock, context);
+        session->set_max_payload(srt_socket_base::max_mss_limit);
+        session->set_path_mtu_discovery(true);
+        std::lock_guard<std::mutex> lock(mtx);
+        sessions.push_back(session);
+        return session;
+    });
+    server->start(asio::ip::udp::endpoint(asio::ip::udp::v4(), port));
+    return server;
+}
+
+static bool connect_client(srt_client &client, uint16_t port) {
+    std::promise<std::error_code> connected;
+    client.async_connect(asio::ip::udp::endpoint(asio::ip::address::from_string("127.0.0.1"), port), [&](const std::error_code &e) {
+        connected.set_value(e);
+    });
+    auto future = connected.get_future();
+    return future.wait_for(std::chrono::seconds(5)) == std::future_status::ready && !future.get();
+}
+
+TEST(loopback, path_mtu_discovery) {
+    logger::initialize("logs/srt_mtu_unittest.log", spdlog::level::warn);
+    const uint16_t port = 19307;
+    std::mutex mtx;
+    std::vector<std::shared_ptr<mtu_session>> sessions;
+    auto server = start_mtu_server(port, true, sessions, mtx);
+
+    srt_client client;
+    client.set_max_payload(srt_socket_base::max_mss_limit);
+    client.set_min_payload(1500);
+    client.set_path_mtu_discovery(true);
+    ASSERT_TRUE(connect_client(client, port));
+    EXPECT_GE(client.path_mtu(), 1500);
+
+    /// 本地回环的MTU为64KB, 第一次探测就能确认协商的最大值
+    for (int i = 0; i < 300 && client.path_mtu() < srt_socket_base::max_mss_limit; i++) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    EXPECT_EQ(client.path_mtu(), srt_socket_base::max_mss_limit);
+    EXPECT_EQ(client.get_max_payload(), srt_socket_base::max_mss_limit - srt_mtu_search::header_size);
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        ASSERT_EQ(sessions.size(), 1);
+    }
+    /// 会话使用独立socket, 反方向同样可以探测
+    for (int i = 0; i < 300 && sessions[0]->get_path_mss() < srt_socket_base::max_mss_limit; i++) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    EXPECT_EQ(sessions[0]->get_path_mss(), srt_socket_base::max_mss_limit);
+
+    /// 一个巨帧携带整个消息
+    std::string message(8000, 'a');
+    EXPECT_EQ(client.async_send(message.data(), message.size()), (int) message.size());
+    for (int i = 0; i < 300 && !sessions[0]->received.load(); i++) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    EXPECT_EQ(sessions[0]->received.load(), 1);
+    EXPECT_EQ(sessions[0]->max_size.load(), message.size());
+}
+
+TEST(proxy, path_mtu_discovery) {
+    logger::initialize("logs/srt_mtu_unittest.log", spdlog::level::warn);
+    const uint16_t port = 19308;
+    const uint16_t proxy_port = 19309;
+    /// 代理只转发不超过1400字节的数据报, 对应的mss为1428
+    const uint32_t path_mss = 1400 + 28;
+    std::mutex mtx;
+    std::vector<std::shared_ptr<mtu_session>> sessions;
+    auto server = start_mtu_server(port, false, sessions, mtx);
+    mtu_proxy proxy(proxy_port, asio::ip::udp::endpoint(asio::ip::address::from_string("127.0.0.1"), port), 1400);
+
+    srt_client client;
+    client.set_max_payload(srt_socket_base::max_mss_limit);
+    client.set_min_payload(1200);
+    client.set_path_mtu_discovery(true);
+    ASSERT_TRUE(connect_client(client, proxy_port));
+    EXPECT_EQ(client.path_mtu(), 1200);
+
+    for (int i = 0; i < 800 && client.path_mtu() + srt_mtu_search::granularity <= path_mss; i++) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    EXPECT_GT(client.path_mtu() + srt_mtu_search::granularity, path_mss);
+    EXPECT_LE(client.path_mtu(), path_mss);
+
+    /// 按照确认的负载发送的包都能通过代理
+    const uint32_t count = 50;
+    std::string message(client.get_max_payload(), 'a');
+    for (uint32_t i = 0; i < count; i++) {
+        client.async_send(message.data(), message.size());
+    }
+    for (int i = 0; i < 300 && (sessions.empty() || sessions[0]->received.load() < count); i++) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    std::lock_guard<std::mutex> lock(mtx);
+    ASSERT_EQ(sessions.size(), 1);
+    EXPECT_EQ(sessions[0]->received.load(), count);
+    EXPECT_EQ(sessions[0]->max_size.load(), message.size());
+}
@@ -153,4 +153,22 @@ TEST(data_packet_2, srt){
     EXPECT_EQ(false, packet->is_retransmitted());
     EXPECT_EQ(0x3b17938f, packet->get_socket_id());
 
-}
\ No newline at end of file
+}
+TEST(data_packet_position, srt){
+    srt::srt_packet pkt;
+    pkt.set_control(false);
+    pkt.set_packet_sequence_number(100);
+    pkt.set_packet_position_flag(0b10);
+    pkt.set_in_order(true);
+    pkt.set_retransmitted(true);
+    pkt.set_message_number(0x03ABCDEF);
+    pkt.set_socket_id(1);
+
+    auto b = srt::create_packet(pkt);
+    auto packet = srt::from_buffer(b->data(), b->size());
+    EXPECT_EQ(0b10, packet->get_packet_position_flag());
+    EXPECT_EQ(true, packet->get_in_order());
+    EXPECT_EQ(true, packet->is_retransmitted());
+    EXPECT_EQ(0x03ABCDEF, packet->get_message_number());
+    EXPECT_EQ(100, packet->get_packet_sequence_number());
+}
@@ -0,0 +1,202 @@
+//
+// Created by 沈昊 on 2026/10/19.
+//
+/// 客户端经过本地UDP代理连接服务端, 代理丢弃所有数据模拟断网, 客户端读超时之后自动重连
+/// 重连使用上一次连接的cookie跳过induction, 测量从断开到第一个包被交付的时间
+#include "asio.hpp"
+#include "protocol/srt/srt_client.hpp"
+#include "protocol/srt/srt_server.hpp"
+#include "spdlog/logger.hpp"
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <future>
+#include <gtest/gtest.h>
+#include <iostream>
+#include <memory>
+#include <thread>
+using namespace srt;
+
+/// 收到的数据原样发回
+class reconnect_echo_session : public srt_session_base {
+public:
+    reconnect_echo_session(const std::shared_ptr<asio::ip::udp::socket> &sock, const event_poller::Ptr &context) : srt_session_base(sock, context) {}
+
+protected:
+    void onRecv(const std::shared_ptr<buffer> &buff) override {
+        async_send((const char *) buff->data(), buff->size());
+    }
+    void onConnected() override {}
+    void onError(const std::error_code &) override {}
+};
+
+/// 双向转发的UDP代理, blocked时丢弃所有数据
+class udp_proxy {
+public:
+    udp_proxy(uint16_t port, const asio::ip::udp::endpoint &server) : front(context, asio::ip::udp::endpoint(asio::ip::address::from_string("127.0.0.1"), port)), back(context) {
+        back.open(asio::ip::udp::v4());
+        back.connect(server);
+        read_front();
+        read_back();
+        worker = std::thread([this]() { context.run(); });
+    }
+
+    ~udp_proxy() {
+        context.stop();
+        worker.join();
+    }
+
+    /// 之后的数据转发到另一个服务端
+    void set_server(const asio::ip::udp::endpoint &server) {
+        std::promise<void> done;
+        asio::post(context, [&]() {
+            std::error_code ignored;
+            back.connect(server, ignored);
+            done.set_value();
+        });
+        done.get_future().wait();
+    }
+
+    std::atomic<bool> blocked{false};
+
+private:
+    void read_front() {
+        front.async_receive_from(asio::buffer(front_data), client, [this](const std::error_code &e, size_t length) {
+            if (e) {
+                return;
+            }
+            if (!blocked.load()) {
+                std::error_code ignored;
+                back.send(asio::buffer(front_data, length), 0, ignored);
+            }
+            read_front();
+        });
+    }
+
+    void read_back() {
+        back.async_receive(asio::buffer(back_data), [this](const std::error_code &e, size_t length) {
+            if (e && e != asio::error::connection_refused) {
+                return;
+            }
+            if (!e && !blocked.load()) {
+                std::error_code ignored;
+                front.send_to(asio::buffer(back_data, length), client, 0, ignored);
+            }
+            read_back();
+        });
+    }
+
+private:
+    asio::io_context context;
+    asio::ip::udp::socket front;
+    asio::ip::udp::socket back;
+    asio::ip::udp::endpoint client;
+    char front_data[1500];
+    char back_data[1500];
+    std::thread worker;
+};
+
+static std::shared_ptr<srt_server> start_echo_server(uint16_t port) {
+    auto server = std::make_shared<srt_server>();
+    server->on_create_session([](const std::shared_ptr<asio::ip::udp::socket> &sock, const event_poller::Ptr &context) -> std::shared_ptr<srt_session_base> {
+        return std::make_shared<reconnect_echo_session>(sock, context);
+    });
+    server->start(asio::ip::udp::endpoint(asio::ip::udp::v4(), port));
+    return server;
+}
+
+/// 断网到客户端读超时, 恢复之后返回第一个包被交付的时间(ms)
+static int64_t blackout_and_measure(srt_client &client, udp_proxy &proxy, std::atomic<uint32_t> &received, const std::function<void()> &on_disconnected) {
+    std::string message(1000, 'a');
+    proxy.blocked.store(true);
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (client.async_send(message.data(), message.size()) >= 0 && std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+    auto disconnected = std::chrono::steady_clock::now();
+    if (disconnected >= deadline) {
+        return -1;
+    }
+    on_disconnected();
+    proxy.blocked.store(false);
+
+    /// 恢复之后第一个发出并且回显到达的包
+    received.store(0);
+    while (received.load() == 0 && std::chrono::steady_clock::now() < disconnected + std::chrono::seconds(5)) {
+        client.async_send(message.data(), message.size());
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    if (!received.load()) {
+        return -1;
+    }
+    return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - disconnected).count();
+}
+
+TEST(fast_reconnect, srt_client) {
+    logger::initialize("logs/srt_reconnect_unittest.log", spdlog::level::warn);
+    const uint16_t port = 19304;
+    const uint16_t other_port = 19306;
+    const uint16_t proxy_port = 19305;
+    auto server = start_echo_server(port);
+    auto other_server = start_echo_server(other_port);
+    udp_proxy proxy(proxy_port, asio::ip::udp::endpoint(asio::ip::address::from_string("127.0.0.1"), port));
+
+    srt_client client;
+    client.set_max_receive_time_out(500);
+    client.set_reconnect(5, 20, 500);
+    std::atomic<uint32_t> received{0};
+    std::atomic<int> errors{0};
+    std::atomic<uint32_t> reconnected{0};
+    client.set_on_receive([&](const std::shared_ptr<buffer> &) {
+        ++received;
+    });
+    client.set_on_error([&](const std::error_code &) {
+        ++errors;
+    });
+    client.set_on_reconnect([&]() {
+        ++reconnected;
+    });
+    std::atomic<int> connected{-1};
+    client.async_connect(asio::ip::udp::endpoint(asio::ip::address::from_string("127.0.0.1"), proxy_port), [&](const std::error_code &e) {
+        connected.store(e ? 1 : 0);
+    });
+    for (int i = 0; i < 300 && connected.load() < 0; i++) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    ASSERT_EQ(connected.load(), 0);
+    EXPECT_FALSE(client.fast_connected());
+
+    std::string message(1000, 'a');
+    for (int i = 0; i < 10; i++) {
+        client.async_send(message.data(), message.size());
+    }
+    for (int i = 0; i < 300 && received.load() < 10; i++) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    ASSERT_EQ(received.load(), 10u);
+
+    auto spend = blackout_and_measure(client, proxy, received, []() {});
+    std::cout << "time to first delivered packet after disconnect: " << spend << " ms, fast=" << client.fast_connected() << std::endl;
+    ASSERT_GE(spend, 0);
+    for (int i = 0; i < 100 && reconnected.load() < 1; i++) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    EXPECT_EQ(client.reconnects(), 1u);
+    /// 服务端接受了缓存的cookie, 没有经过induction
+    EXPECT_TRUE(client.fast_connected());
+    /// 退避等待不超过20ms, 握手只需要一个RTT
+    EXPECT_LT(spend, 1000);
+
+    /// 另一个服务端不认识缓存的cookie, 回复新的cookie之后完成完整的握手
+    spend = blackout_and_measure(client, proxy, received, [&]() {
+        proxy.set_server(asio::ip::udp::endpoint(asio::ip::address::from_string("127.0.0.1"), other_port));
+    });
+    std::cout << "time to first delivered packet after switching server: " << spend << " ms, fast=" << client.fast_connected() << std::endl;
+    ASSERT_GE(spend, 0);
+    for (int i = 0; i < 100 && reconnected.load() < 2; i++) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    EXPECT_EQ(client.reconnects(), 2u);
+    EXPECT_FALSE(client.fast_connected());
+    EXPECT_EQ(errors.load(), 0);
+}
@@ -0,0 +1,129 @@
+//
+// Created by 沈昊 on 2026/10/19.
+//
+/// 按照stream id推流和播放: 一个推流端的数据转发给所有播放端, 先连接的播放端等待推流端注册
+/// 推流端断开后注销源并断开播放端, 同名的流可以重新推送
+#include "media/media_source.hpp"
+#include "protocol/srt/srt_client.hpp"
+#include "protocol/srt/srt_server.hpp"
+#include "protocol/srt/srt_session.hpp"
+#include "spdlog/logger.hpp"
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <gtest/gtest.h>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+using namespace srt;
+
+static bool connect_client(srt_client &client, uint16_t port) {
+    std::promise<std::error_code> connected;
+    client.async_connect(asio::ip::udp::endpoint(asio::ip::address::from_string("127.0.0.1"), port), [&](const std::error_code &e) {
+        connected.set_value(e);
+    });
+    auto future = connected.get_future();
+    return future.wait_for(std::chrono::seconds(5)) == std::future_status::ready && !future.get();
+}
+
+static bool wait_source(bool exist) {
+    for (int i = 0; i < 500; i++) {
+        if ((media_source::find_source("", "live", "relay") != nullptr) == exist) {
+            return true;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    return false;
+}
+
+TEST(publish_play, srt_relay) {
+    logger::initialize("logs/srt_relay_unittest.log", spdlog::level::warn);
+    const uint16_t port = 19314;
+    const uint32_t players = 3;
+    const uint32_t count = 200;
+    auto server = std::make_shared<srt_server>();
+    /// 客户端销毁时不发送shutdown, 缩短服务端的接收超时
+    server->on_create_session([](const std::shared_ptr<asio::ip::udp::socket> &sock, const event_poller::Ptr &context) -> std::shared_ptr<srt_session_base> {
+        auto session = std::make_shared<srt_session>(sock, context);
+        session->set_max_receive_time_out(1000);
+        session->set_play_wait_time_out(1000);
+        return session;
+    });
+    server->start(asio::ip::udp::endpoint(asio::ip::udp::v4(), port));
+
+    /// 等待超时之后播放失败
+    {
+        std::promise<void> closed;
+        std::atomic<bool> once{false};
+        srt_client client;
+        client.set_stream_id("#!::r=live/relay");
+        client.set_on_error([&](const std::error_code &) {
+            if (!once.exchange(true)) {
+                closed.set_value();
+            }
+        });
+        ASSERT_TRUE(connect_client(client, port));
+        EXPECT_EQ(closed.get_future().wait_for(std::chrono::seconds(3)), std::future_status::ready);
+    }
+
+    std::shared_ptr<srt_client> publisher;
+    std::vector<std::shared_ptr<srt_client>> clients;
+    std::vector<std::shared_ptr<std::atomic<uint32_t>>> received;
+    std::vector<std::shared_ptr<std::atomic<bool>>> closed;
+    for (uint32_t i = 0; i < players; i++) {
+        auto client = std::make_shared<srt_client>();
+        auto counter = std::make_shared<std::atomic<uint32_t>>(0);
+        auto error = std::make_shared<std::atomic<bool>>(false);
+        client->set_stream_id("#!::r=live/relay");
+        client->set_on_receive([counter](const std::shared_ptr<buffer> &) {
+            ++*counter;
+        });
+        client->set_on_error([error](const std::error_code &) {
+            error->store(true);
+        });
+        ASSERT_TRUE(connect_client(*client, port));
+        clients.push_back(client);
+        received.push_back(counter);
+        closed.push_back(error);
+        /// 第一个播放端在推流之前连接
+        if (i == 0) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(100));
+            EXPECT_EQ(media_source::waiting_size(), 1);
+            publisher = std::make_shared<srt_client>();
+            publisher->set_stream_id("#!::r=live/relay,m=publish");
+            ASSERT_TRUE(connect_client(*publisher, port));
+            ASSERT_TRUE(wait_source(true));
+        }
+    }
+    /// 播放端在自己的poller上attach
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+
+    std::string payload(1316, 'a');
+    for (uint32_t i = 0; i < count; i++) {
+        publisher->async_send(payload.data(), payload.size());
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    for (auto &item: received) {
+        for (int i = 0; i < 300 && item->load() < count; i++) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+        EXPECT_EQ(item->load(), count);
+    }
+
+    /// 推流端断开, 源被注销, 播放端随之断开
+    publisher.reset();
+    EXPECT_TRUE(wait_source(false));
+    for (auto &item: closed) {
+        for (int i = 0; i < 300 && !item->load(); i++) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+        EXPECT_TRUE(item->load());
+    }
+
+    /// 同名的流可以重新推送
+    srt_client again;
+    again.set_stream_id("#!::r=live/relay,m=publish");
+    ASSERT_TRUE(connect_client(again, port));
+    EXPECT_TRUE(wait_source(true));
+}
@@ -0,0 +1,127 @@
+﻿//
+// Created by 沈昊 on 2026/10/19.
+//
+/// 测量空闲会话的常驻内存, 每个会话的内存应该和实际在途的数据成正比
+#include "event_poller_pool.hpp"
+#include "protocol/srt/srt_client.hpp"
+#include "protocol/srt/srt_server.hpp"
+#include "spdlog/logger.hpp"
+#include <atomic>
+#include <fstream>
+#include <gtest/gtest.h>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+using namespace srt;
+
+static uint64_t get_resident_bytes() {
+    std::ifstream in("/proc/self/statm");
+    uint64_t size = 0, resident = 0;
+    in >> size >> resident;
+    return resident * (uint64_t) sysconf(_SC_PAGESIZE);
+}
+
+class idle_session : public srt_session_base {
+public:
+    idle_session(const std::shared_ptr<asio::ip::udp::socket> &sock, const event_poller::Ptr &context) : srt_session_base(sock, context) {}
+
+protected:
+    void onRecv(const std::shared_ptr<buffer> &) override {}
+    void onConnected() override {}
+    void onError(const std::error_code &) override {}
+};
+
+static bool connect_clients(std::vector<std::shared_ptr<srt_client>> &clients, size_t count, uint16_t port) {
+    std::atomic<size_t> connected{0};
+    std::atomic<size_t> failed{0};
+    for (size_t i = 0; i < count; i++) {
+        auto client = std::make_shared<srt_client>();
+        client->async_connect(asio::ip::udp::endpoint(asio::ip::address::from_string("127.0.0.1"), port), [&](const std::error_code &e) {
+            e ? ++failed : ++connected;
+        });
+        clients.push_back(client);
+    }
+    for (int i = 0; i < 1000 && connected + failed < count; i++) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    return connected == count;
+}
+
+TEST(idle_memory, srt_session) {
+    logger::initialize("logs/srt_session_memory_unittest.log", spdlog::level::warn);
+    const uint16_t port = 19301;
+    const size_t count = 200;
+    auto server = std::make_shared<srt_server>();
+    server->on_create_session([](const std::shared_ptr<asio::ip::udp::socket> &sock, const event_poller::Ptr &context) -> std::shared_ptr<srt_session_base> {
+        return std::make_shared<idle_session>(sock, context);
+    });
+    server->start(asio::ip::udp::endpoint(asio::ip::udp::v4(), port));
+
+    /// 预热, 排除线程池和日志等一次性的分配
+    std::vector<std::shared_ptr<srt_client>> clients;
+    ASSERT_TRUE(connect_clients(clients, 4, port));
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    auto before = get_resident_bytes();
+
+    ASSERT_TRUE(connect_clients(clients, count, port));
+    /// 等待连接建立时的ACK等定时器全部停止
+    std::this_thread::sleep_for(std::chrono::milliseconds(500));
+    auto after = get_resident_bytes();
+    /// 客户端和服务端会话各一个
+    auto per_session = (after > before ? after - before : 0) / (count * 2);
+    std::cout << "resident memory per idle session: " << per_session << " bytes" << std::endl;
+    EXPECT_LT(per_session, 32 * 1024);
+}
+
+class capacity_session : public srt_session_base {
+public:
+    capacity_session(const std::shared_ptr<asio::ip::udp::socket> &sock, const event_poller::Ptr &context) : srt_session_base(sock, context) {}
+    std::atomic<uint32_t> received{0};
+    std::atomic<size_t> max_capacity{0};
+
+protected:
+    void onRecv(const std::shared_ptr<buffer> &buff) override {
+        if (buff->capacity() > max_capacity) {
+            max_capacity = buff->capacity();
+        }
+        ++received;
+    }
+    void onConnected() override {}
+    void onError(const std::error_code &) override {}
+};
+
+/// 交付给应用层的buffer按照协商的mss分配, 而不是协议允许的最大mss
+TEST(receive_buffer, srt_session) {
+    logger::initialize("logs/srt_session_memory_unittest.log", spdlog::level::warn);
+    const uint16_t port = 19316;
+    const uint32_t messages = 200;
+    std::shared_ptr<capacity_session> session;
+    std::mutex mtx;
+    auto server = std::make_shared<srt_server>();
+    server->on_create_session([&](const std::shared_ptr<asio::ip::udp::socket> &sock, const event_poller::Ptr &context) -> std::shared_ptr<srt_session_base> {
+        std::lock_guard<std::mutex> lock(mtx);
+        session = std::make_shared<capacity_session>(sock, context);
+        return session;
+    });
+    server->start(asio::ip::udp::endpoint(asio::ip::udp::v4(), port));
+
+    std::vector<std::shared_ptr<srt_client>> clients;
+    ASSERT_TRUE(connect_clients(clients, 1, port));
+    std::string message(1316, 'a');
+    for (uint32_t i = 0; i < messages; i++) {
+        clients[0]->async_send(message.data(), message.size());
+    }
+    auto received = [&]() {
+        std::lock_guard<std::mutex> lock(mtx);
+        return session ? session->received.load() : 0;
+    };
+    for (int i = 0; i < 500 && received() < messages; i++) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    ASSERT_EQ(received(), messages);
+    std::lock_guard<std::mutex> lock(mtx);
+    std::cout << "max receive buffer capacity: " << session->max_capacity.load() << " bytes" << std::endl;
+    EXPECT_LT(session->max_capacity.load(), 2 * 1500u);
+}
@@ -0,0 +1,243 @@
+//
+// Created by 沈昊 on 2026/10/19.
+//
+/// 会话在poller之间迁移: poller的忙碌时间, 收发过程中迁移独立socket的会话不丢包, 目标poller没有监听socket时放弃迁移
+#include "Util/endian.hpp"
+#include "event_poller_pool.hpp"
+#include "protocol/srt/srt_client.hpp"
+#include "protocol/srt/srt_server.hpp"
+#include "spdlog/logger.hpp"
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <gtest/gtest.h>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <time.h>
+#include <vector>
+using namespace srt;
+
+TEST(busy_time, event_poller) {
+    logger::initialize("logs/srt_session_migrate_unittest.log", spdlog::level::warn);
+    auto poller = std::make_shared<event_poller>();
+    poller->start();
+    /// 等待线程获取CPU时钟
+    for (int i = 0; i < 100 && !poller->get_busy_time(); i++) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    auto begin = poller->get_busy_time();
+    ASSERT_GT(begin, 0);
+    /// 空闲时阻塞在epoll中, 不计入忙碌时间
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    auto idle = poller->get_busy_time();
+    EXPECT_LT(idle - begin, 30000);
+
+    std::promise<void> done;
+    poller->async([&done]() {
+        /// 按照线程自己的CPU时间计算, 机器繁忙时墙上时间100ms内可能只分到很少的CPU时间
+        auto cpu_now = []() {
+            struct timespec ts {};
+            clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+            return (uint64_t) ts.tv_sec * 1000000 + (uint64_t) ts.tv_nsec / 1000;
+        };
+        auto begin = cpu_now();
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+        volatile uint64_t counter = 0;
+        while (cpu_now() - begin < 100000 && std::chrono::steady_clock::now() < deadline) {
+            counter = counter + 1;
+        }
+        done.set_value();
+    });
+    done.get_future().wait();
+    auto busy = poller->get_busy_time();
+    EXPECT_GE(busy - idle, 90000);
+    poller->stop();
+    /// 线程退出之后返回退出时的值, 不再读取失效的时钟
+    auto stopped = poller->get_busy_time();
+    EXPECT_GE(stopped, busy);
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    EXPECT_EQ(poller->get_busy_time(), stopped);
+}
+
+/// 其他线程持续采样的同时poller退出
+TEST(busy_time_stop, event_poller) {
+    logger::initialize("logs/srt_session_migrate_unittest.log", spdlog::level::warn);
+    for (int round = 0; round < 20; round++) {
+        auto poller = std::make_shared<event_poller>();
+        poller->start();
+        std::atomic<bool> exit{false};
+        std::atomic<bool> decreased{false};
+        std::thread sampler([&]() {
+            uint64_t last = 0;
+            while (!exit.load()) {
+                auto now = poller->get_busy_time();
+                if (now < last) {
+                    decreased.store(true);
+                }
+                last = now;
+            }
+        });
+        std::this_thread::sleep_for(std::chrono::milliseconds(2));
+        poller->stop();
+        exit.store(true);
+        sampler.join();
+        EXPECT_FALSE(decreased.load());
+    }
+}
+
+class migrate_session : public srt_session_base {
+public:
+    migrate_session(const std::shared_ptr<asio::ip::udp::socket> &sock, const event_poller::Ptr &context) : srt_session_base(sock, context) {}
+    std::atomic<uint32_t> received{0};
+    std::atomic<uint32_t> disorder{0};
+    std::atomic<bool> connected{false};
+
+protected:
+    void onRecv(const std::shared_ptr<buffer> &buff) override {
+        if (buff->size() < 4 || load_be32(buff->data()) != received.load()) {
+            ++disorder;
+        }
+        ++received;
+    }
+    void onConnected() override {
+        connected.store(true);
+    }
+    void onError(const std::error_code &) override {}
+};
+
+static std::shared_ptr<srt_server> start_migrate_server(uint16_t port, bool connected_socket, std::vector<std::shared_ptr<migrate_session>> &sessions, std::mutex &mtx) {
+    auto server = std::make_shared<srt_server>();
+    server->set_connected_session_socket(connected_socket);
+    server->on_create_session([&sessions, &mtx](const std::shared_ptr<asio::ip::udp::socket> &sock, const event_poller::Ptr &context) -> std::shared_ptr<srt_session_base> {
+        auto session = std::make_shared<migrate_session>(sock, context);
+        std::lock_guard<std::mutex> lock(mtx);
+        sessions.push_back(session);
+        return session;
+    });
+    server->start(asio::ip::udp::endpoint(asio::ip::udp::v4(), port));
+    return server;
+}
+
+static bool connect_client(srt_client &client, uint16_t port) {
+    std::promise<std::error_code> connected;
+    client.async_connect(asio::ip::udp::endpoint(asio::ip::address::from_string("127.0.0.1"), port), [&](const std::error_code &e) {
+        connected.set_value(e);
+    });
+    auto future = connected.get_future();
+    return future.wait_for(std::chrono::seconds(5)) == std::future_status::ready && !future.get();
+}
+
+/// 每毫秒发送一个带序号的消息, 发送的同时由migrate在会话之间切换poller
+static void send_numbered(srt_client &client, uint32_t count, const std::function<void(uint32_t)> &migrate) {
+    for (uint32_t i = 0; i < count; i++) {
+        char data[64] = {0};
+        set_be32(data, i);
+        client.async_send(data, sizeof(data));
+        migrate(i);
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+}
+
+static std::shared_ptr<migrate_session> wait_session(std::vector<std::shared_ptr<migrate_session>> &sessions, std::mutex &mtx) {
+    for (int i = 0; i < 300; i++) {
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            if (!sessions.empty() && sessions[0]->connected.load()) {
+                return sessions[0];
+            }
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    return nullptr;
+}
+
+TEST(connected_socket, srt_session_migrate) {
+    logger::initialize("logs/srt_session_migrate_unittest.log", spdlog::level::warn);
+    const uint16_t port = 19311;
+    const uint32_t count = 600;
+    std::mutex mtx;
+    std::vector<std::shared_ptr<migrate_session>> sessions;
+    auto server = start_migrate_server(port, true, sessions, mtx);
+    auto target = std::make_shared<event_poller>();
+    target->start();
+
+    srt_client client;
+    client.set_enable_drop_late_packet(false);
+    ASSERT_TRUE(connect_client(client, port));
+    auto session = wait_session(sessions, mtx);
+    ASSERT_TRUE(session);
+    auto source = session->get_poller();
+    ASSERT_NE(source, target);
+
+    /// 收发过程中迁移到另一个poller, 再迁移回来
+    send_numbered(client, count, [&](uint32_t i) {
+        if (i == count / 3) {
+            session->migrate(target);
+        } else if (i == count * 2 / 3) {
+            EXPECT_EQ(session->get_poller(), target);
+            session->migrate(source);
+        }
+    });
+    for (int i = 0; i < 300 && session->received.load() < count; i++) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    EXPECT_EQ(session->received.load(), count);
+    EXPECT_EQ(session->disorder.load(), 0);
+    EXPECT_EQ(session->get_poller(), source);
+    EXPECT_EQ(server->get_migrated_sessions(), 2);
+    EXPECT_TRUE(session->has_connected_socket());
+
+    /// 迁移之后反方向仍然可以发送
+    std::promise<void> echoed;
+    std::atomic<bool> once{false};
+    client.set_on_receive([&](const std::shared_ptr<buffer> &) {
+        if (!once.exchange(true)) {
+            echoed.set_value();
+        }
+    });
+    session->migrate(target);
+    for (int i = 0; i < 300 && session->get_poller() != target; i++) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    EXPECT_EQ(session->async_send("pong", 4), 4);
+    EXPECT_EQ(echoed.get_future().wait_for(std::chrono::seconds(3)), std::future_status::ready);
+    /// 会话由全局会话表持有, 结束之前回到服务端的poller
+    session->migrate(source);
+    for (int i = 0; i < 300 && server->get_migrated_sessions() < 4; i++) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    EXPECT_EQ(server->get_migrated_sessions(), 4);
+}
+
+TEST(listener, srt_session_migrate) {
+    logger::initialize("logs/srt_session_migrate_unittest.log", spdlog::level::warn);
+    const uint16_t port = 19312;
+    const uint32_t count = 200;
+    std::mutex mtx;
+    std::vector<std::shared_ptr<migrate_session>> sessions;
+    auto server = start_migrate_server(port, false, sessions, mtx);
+    auto target = std::make_shared<event_poller>();
+    target->start();
+
+    srt_client client;
+    client.set_enable_drop_late_packet(false);
+    ASSERT_TRUE(connect_client(client, port));
+    auto session = wait_session(sessions, mtx);
+    ASSERT_TRUE(session);
+    auto source = session->get_poller();
+
+    /// 共享监听socket的会话只能迁移到服务端的poller, 其他poller上没有可以发送的socket
+    send_numbered(client, count, [&](uint32_t i) {
+        if (i == count / 2) {
+            session->migrate(target);
+        }
+    });
+    for (int i = 0; i < 300 && session->received.load() < count; i++) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    EXPECT_EQ(session->received.load(), count);
+    EXPECT_EQ(session->disorder.load(), 0);
+    EXPECT_EQ(session->get_poller(), source);
+    EXPECT_EQ(server->get_migrated_sessions(), 0);
+}
@@ -0,0 +1,87 @@
+//
+// Created by 沈昊 on 2026/10/19.
+//
+/// 会话使用独立的connect之后的socket时, 多个客户端的数据由内核直接分发到各自的会话
+#include "event_poller_pool.hpp"
+#include "protocol/srt/srt_client.hpp"
+#include "protocol/srt/srt_server.hpp"
+#include "spdlog/logger.hpp"
+#include <atomic>
+#include <gtest/gtest.h>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+using namespace srt;
+
+class count_session : public srt_session_base {
+public:
+    count_session(const std::shared_ptr<asio::ip::udp::socket> &sock, const event_poller::Ptr &context) : srt_session_base(sock, context) {}
+    std::atomic<uint32_t> received{0};
+
+protected:
+    void onRecv(const std::shared_ptr<buffer> &) override {
+        ++received;
+    }
+    void onConnected() override {}
+    void onError(const std::error_code &) override {}
+};
+
+TEST(connected_socket, srt_session) {
+    logger::initialize("logs/srt_session_socket_unittest.log", spdlog::level::warn);
+    const uint16_t port = 19302;
+    const size_t count = 8;
+    const uint32_t messages = 100;
+    std::mutex mtx;
+    std::vector<std::shared_ptr<count_session>> sessions;
+    auto server = std::make_shared<srt_server>();
+    server->set_connected_session_socket(true);
+    server->on_create_session([&](const std::shared_ptr<asio::ip::udp::socket> &sock, const event_poller::Ptr &context) -> std::shared_ptr<srt_session_base> {
+        auto session = std::make_shared<count_session>(sock, context);
+        std::lock_guard<std::mutex> lock(mtx);
+        sessions.push_back(session);
+        return session;
+    });
+    server->start(asio::ip::udp::endpoint(asio::ip::udp::v4(), port));
+    ASSERT_TRUE(server->get_connected_session_socket());
+
+    std::vector<std::shared_ptr<srt_client>> clients;
+    std::atomic<size_t> connected{0};
+    for (size_t i = 0; i < count; i++) {
+        auto client = std::make_shared<srt_client>();
+        client->async_connect(asio::ip::udp::endpoint(asio::ip::address::from_string("127.0.0.1"), port), [&](const std::error_code &e) {
+            if (!e) {
+                ++connected;
+            }
+        });
+        clients.push_back(client);
+    }
+    for (int i = 0; i < 500 && connected < count; i++) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    ASSERT_EQ(connected.load(), count);
+
+    std::string message(1000, 'a');
+    for (uint32_t i = 0; i < messages; i++) {
+        for (auto &client: clients) {
+            client->async_send(message.data(), message.size());
+        }
+    }
+    auto all_received = [&]() {
+        std::lock_guard<std::mutex> lock(mtx);
+        uint32_t total = 0;
+        for (auto &session: sessions) {
+            total += session->received.load();
+        }
+        return total == count * messages;
+    };
+    for (int i = 0; i < 500 && !all_received(); i++) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    EXPECT_TRUE(all_received());
+    std::lock_guard<std::mutex> lock(mtx);
+    for (auto &session: sessions) {
+        EXPECT_TRUE(session->has_connected_socket());
+        EXPECT_EQ(session->received.load(), messages);
+    }
+}
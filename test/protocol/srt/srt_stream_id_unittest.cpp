@@ -26,4 +26,22 @@ TEST(srt_stream_id, serialize_1) {
 
     str = srt::stream_id::to_buffer(stream_id_);
     EXPECT_EQ(str.size(), strlen(stream_id));
-}
\ No newline at end of file
+}
+
+TEST(srt_stream_id, resource) {
+    auto stream_id_ = srt::stream_id::from_buffer("#!::r=live/test");
+    EXPECT_EQ(stream_id_.vhost(), "");
+    EXPECT_EQ(stream_id_.app(), "live");
+    EXPECT_EQ(stream_id_.stream(), "test");
+    EXPECT_EQ(stream_id_.is_publish(), false);
+
+    stream_id_ = srt::stream_id::from_buffer("#!::r=example.com/live/test,m=publish,token=abc");
+    EXPECT_EQ(stream_id_.vhost(), "example.com");
+    EXPECT_EQ(stream_id_.app(), "live");
+    EXPECT_EQ(stream_id_.stream(), "test");
+    EXPECT_EQ(stream_id_.is_publish(), true);
+    EXPECT_EQ(stream_id_.get_query("token"), "abc");
+
+    EXPECT_THROW(srt::stream_id::from_buffer("#!::r=test"), std::system_error);
+    EXPECT_THROW(srt::stream_id::from_buffer("#!::r=a/b/c/d"), std::system_error);
+}
@@ -0,0 +1,141 @@
+//
+// Created by 沈昊 on 2026/10/19.
+//
+/// 写入方在其他线程被高水位阻塞, poller同时发送和确认缓存中的数据, 每次阻塞之后都应该收到onWritable
+#include "protocol/srt/srt_client.hpp"
+#include "protocol/srt/srt_server.hpp"
+#include "spdlog/logger.hpp"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <future>
+#include <gtest/gtest.h>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+using namespace srt;
+
+class drain_session : public srt_session_base {
+public:
+    drain_session(const std::shared_ptr<asio::ip::udp::socket> &sock, const event_poller::Ptr &context) : srt_session_base(sock, context) {}
+    std::atomic<uint64_t> received{0};
+
+protected:
+    void onRecv(const std::shared_ptr<buffer> &buff) override {
+        received += buff->size();
+    }
+    void onConnected() override {}
+    void onError(const std::error_code &) override {}
+};
+
+TEST(blocked_writer, srt_writable) {
+    logger::initialize("logs/srt_writable_unittest.log", spdlog::level::warn);
+    const uint16_t port = 19317;
+    const uint64_t total = 1316 * 4000;
+    std::mutex mtx;
+    std::shared_ptr<drain_session> session;
+    auto server = std::make_shared<srt_server>();
+    server->on_create_session([&](const std::shared_ptr<asio::ip::udp::socket> &sock, const event_poller::Ptr &context) -> std::shared_ptr<srt_session_base> {
+        std::lock_guard<std::mutex> lock(mtx);
+        session = std::make_shared<drain_session>(sock, context);
+        return session;
+    });
+    server->start(asio::ip::udp::endpoint(asio::ip::udp::v4(), port));
+
+    srt_client client;
+    std::promise<std::error_code> connected;
+    client.async_connect(asio::ip::udp::endpoint(asio::ip::address::from_string("127.0.0.1"), port), [&](const std::error_code &e) {
+        connected.set_value(e);
+    });
+    auto future = connected.get_future();
+    ASSERT_EQ(future.wait_for(std::chrono::seconds(5)), std::future_status::ready);
+    ASSERT_FALSE(future.get());
+
+    /// 水位很小, 写入方频繁阻塞, poller在它检查和等待之间清空缓存的机会很多
+    client.set_send_buffer_water_mark(16 * 1316, 8 * 1316);
+    std::mutex writable_mtx;
+    std::condition_variable writable_cv;
+    bool writable = false;
+    client.set_on_writable([&]() {
+        std::lock_guard<std::mutex> lock(writable_mtx);
+        writable = true;
+        writable_cv.notify_one();
+    });
+
+    std::atomic<bool> stalled{false};
+    uint64_t blocked = 0;
+    std::thread writer([&]() {
+        std::string chunk(1316, 'w');
+        uint64_t sent = 0;
+        while (sent < total) {
+            std::error_code e;
+            std::unique_lock<std::mutex> lock(writable_mtx);
+            writable = false;
+            lock.unlock();
+            auto ret = client.async_send(chunk.data(), chunk.size(), e);
+            if (ret > 0) {
+                sent += ret;
+                continue;
+            }
+            if (ret < 0 || e != make_srt_error(srt_error_code::send_buffer_full)) {
+                stalled.store(true);
+                return;
+            }
+            ++blocked;
+            lock.lock();
+            if (!writable_cv.wait_for(lock, std::chrono::seconds(5), [&]() { return writable; })) {
+                stalled.store(true);
+                return;
+            }
+        }
+    });
+    writer.join();
+    EXPECT_FALSE(stalled.load());
+    EXPECT_GT(blocked, 0u);
+    std::cout << "writer blocked " << blocked << " times" << std::endl;
+
+    auto received = [&]() {
+        std::lock_guard<std::mutex> lock(mtx);
+        return session ? session->received.load() : 0;
+    };
+    for (int i = 0; i < 500 && received() < total; i++) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    EXPECT_EQ(received(), total);
+}
+
+/// 写入被拒绝时缓存已经清空(竞争之后的状态), 不会再有ACK触发通知, 写入方需要自己通知
+TEST(drained_before_wait, srt_writable) {
+    logger::initialize("logs/srt_writable_unittest.log", spdlog::level::warn);
+    const uint16_t port = 19318;
+    auto server = std::make_shared<srt_server>();
+    server->on_create_session([&](const std::shared_ptr<asio::ip::udp::socket> &sock, const event_poller::Ptr &context) -> std::shared_ptr<srt_session_base> {
+        return std::make_shared<drain_session>(sock, context);
+    });
+    server->start(asio::ip::udp::endpoint(asio::ip::udp::v4(), port));
+
+    srt_client client;
+    std::promise<std::error_code> connected;
+    client.async_connect(asio::ip::udp::endpoint(asio::ip::address::from_string("127.0.0.1"), port), [&](const std::error_code &e) {
+        connected.set_value(e);
+    });
+    auto future = connected.get_future();
+    ASSERT_EQ(future.wait_for(std::chrono::seconds(5)), std::future_status::ready);
+    ASSERT_FALSE(future.get());
+
+    std::promise<void> writable;
+    std::atomic<bool> notified{false};
+    client.set_on_writable([&]() {
+        if (!notified.exchange(true)) {
+            writable.set_value();
+        }
+    });
+    client.set_send_buffer_water_mark(1000, 500);
+    ASSERT_EQ(client.send_buffered_bytes(), 0u);
+    std::string chunk(1316, 'w');
+    std::error_code e;
+    EXPECT_EQ(client.async_send(chunk.data(), chunk.size(), e), 0);
+    EXPECT_EQ(e, make_srt_error(srt_error_code::send_buffer_full));
+    EXPECT_EQ(writable.get_future().wait_for(std::chrono::seconds(2)), std::future_status::ready);
+}
@@ -0,0 +1,80 @@
+//
+// Created by 沈昊 on 2026/10/19.
+//
+#include <Util/read_mostly.hpp>
+#include <atomic>
+#include <gtest/gtest.h>
+#include <map>
+#include <thread>
+#include <vector>
+
+TEST(read_update, read_mostly) {
+    read_mostly<std::map<int, int>> table;
+    EXPECT_EQ(table.read([](const std::map<int, int> &m) { return m.size(); }), 0);
+    EXPECT_TRUE(table.update([](std::map<int, int> &m) {
+        m[1] = 10;
+        return true;
+    }));
+    /// 放弃修改时不替换
+    EXPECT_FALSE(table.update([](std::map<int, int> &m) {
+        m[2] = 20;
+        return false;
+    }));
+    EXPECT_EQ(table.read([](const std::map<int, int> &m) { return m.size(); }), 1);
+
+    /// 读的过程中替换的旧数据在读完之前不会释放
+    table.read([&](const std::map<int, int> &old) {
+        table.update([](std::map<int, int> &m) {
+            m[1] = 11;
+            return true;
+        });
+        EXPECT_EQ(table.retired_size(), 1);
+        EXPECT_EQ(old.at(1), 10);
+        /// 嵌套读取看到新的数据
+        EXPECT_EQ(table.read([](const std::map<int, int> &m) { return m.at(1); }), 11);
+        return 0;
+    });
+    table.update([](std::map<int, int> &m) {
+        m[3] = 30;
+        return true;
+    });
+    EXPECT_EQ(table.retired_size(), 0);
+}
+
+TEST(concurrent, read_mostly) {
+    read_mostly<std::vector<uint32_t>> table;
+    std::atomic<bool> stop{false};
+    std::atomic<uint32_t> corrupted{0};
+    std::vector<std::thread> readers;
+    for (int i = 0; i < 4; i++) {
+        readers.emplace_back([&]() {
+            while (!stop.load()) {
+                /// 每个版本的所有元素都等于版本号
+                table.read([&](const std::vector<uint32_t> &v) {
+                    for (auto item: v) {
+                        if (item != v.size()) {
+                            ++corrupted;
+                        }
+                    }
+                    return 0;
+                });
+            }
+        });
+    }
+    const uint32_t versions = 2000;
+    for (uint32_t i = 1; i <= versions; i++) {
+        table.update([i](std::vector<uint32_t> &v) {
+            v.assign(i, i);
+            return true;
+        });
+    }
+    stop.store(true);
+    for (auto &item: readers) {
+        item.join();
+    }
+    EXPECT_EQ(corrupted.load(), 0);
+    EXPECT_EQ(table.read([](const std::vector<uint32_t> &v) { return v.size(); }), versions);
+    /// 读者全部退出之后, 下一次修改释放所有旧数据
+    table.update([](std::vector<uint32_t> &) { return true; });
+    EXPECT_EQ(table.retired_size(), 0);
+}
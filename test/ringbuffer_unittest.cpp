@@ -0,0 +1,240 @@
+//
+// Created by 沈昊 on 2026/10/19.
+//
+#include "Util/RingBuffer.h"
+#include "net/event_poller.hpp"
+#include "net/executor.hpp"
+#include "spdlog/logger.hpp"
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <gtest/gtest.h>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+using ring_type = toolkit::RingBuffer<int>;
+
+struct ring_fixture {
+    std::vector<event_poller::Ptr> pollers;
+    std::vector<std::shared_ptr<ring_type::RingReader>> readers;
+    std::vector<std::vector<int>> values;
+    std::mutex mtx;
+
+    ring_fixture(const std::shared_ptr<ring_type> &ring, size_t count) : values(count) {
+        readers.resize(count);
+        for (size_t i = 0; i < count; i++) {
+            pollers.emplace_back(std::make_shared<event_poller>());
+            pollers.back()->start();
+            std::promise<void> attached;
+            auto poller = pollers.back();
+            poller->async([&, i, poller]() {
+                readers[i] = ring->attach(poller, false);
+                readers[i]->setReadCB([this, i](int v) {
+                    std::lock_guard<std::mutex> lock(mtx);
+                    values[i].push_back(v);
+                });
+                attached.set_value();
+            });
+            attached.get_future().wait();
+        }
+    }
+
+    ~ring_fixture() {
+        for (size_t i = 0; i < readers.size(); i++) {
+            std::promise<void> released;
+            pollers[i]->async([&, i]() {
+                readers[i].reset();
+                released.set_value();
+            });
+            released.get_future().wait();
+        }
+        for (auto &item: pollers) {
+            item->stop();
+        }
+    }
+
+    bool wait(size_t count) {
+        for (int i = 0; i < 300; i++) {
+            {
+                std::lock_guard<std::mutex> lock(mtx);
+                bool done = true;
+                for (auto &item: values) {
+                    done = done && item.size() >= count;
+                }
+                if (done) {
+                    return true;
+                }
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+        return false;
+    }
+};
+
+TEST(write_batch, ring_buffer) {
+    logger::initialize("logs/ringbuffer_unittest.log", spdlog::level::warn);
+    auto ring = std::make_shared<ring_type>();
+    ring_fixture fixture(ring, 2);
+    ring_type::Batch batch;
+    for (int i = 0; i < 100; i++) {
+        batch.emplace_back(true, i);
+    }
+    ring->writeBatch(std::move(batch));
+    /// 每个poller只投递一次
+    EXPECT_EQ(ring->postCount(), 2);
+    ASSERT_TRUE(fixture.wait(100));
+    for (auto &item: fixture.values) {
+        ASSERT_EQ(item.size(), 100);
+        for (int i = 0; i < 100; i++) {
+            EXPECT_EQ(item[i], i);
+        }
+    }
+}
+
+TEST(coalesce, ring_buffer) {
+    logger::initialize("logs/ringbuffer_unittest.log", spdlog::level::warn);
+    auto ring = std::make_shared<ring_type>();
+    ring_fixture fixture(ring, 2);
+    auto writer = std::make_shared<event_poller>();
+    writer->start();
+    ring->setCoalescePoller(writer);
+
+    /// 同一个poller任务中的写入合并成一批
+    writer->async([ring]() {
+        for (int i = 0; i < 50; i++) {
+            ring->write(i);
+        }
+    });
+    ASSERT_TRUE(fixture.wait(50));
+    EXPECT_EQ(ring->postCount(), 2);
+
+    /// 关闭之后逐个派发
+    std::promise<void> done;
+    writer->async([&]() {
+        ring->setCoalescePoller(nullptr);
+        ring->write(50);
+        ring->write(51);
+        done.set_value();
+    });
+    done.get_future().wait();
+    ASSERT_TRUE(fixture.wait(52));
+    EXPECT_EQ(ring->postCount(), 6);
+    for (auto &item: fixture.values) {
+        for (int i = 0; i < 52; i++) {
+            EXPECT_EQ(item[i], i);
+        }
+    }
+    writer->stop();
+}
+
+/// 写入分散在executor的多个任务中(推流会话每个包一个onRecv任务), 同一轮执行的任务合并成一批
+TEST(coalesce_executor, ring_buffer) {
+    logger::initialize("logs/ringbuffer_unittest.log", spdlog::level::warn);
+    auto ring = std::make_shared<ring_type>();
+    ring_fixture fixture(ring, 2);
+    auto writer = std::make_shared<executor>();
+    writer->start();
+    ring->setCoalesceExecutor(writer);
+
+    /// 先阻塞executor, 之后投递的写入任务在下一轮一起执行
+    std::promise<void> blocked;
+    auto release = blocked.get_future().share();
+    writer->async([release]() {
+        release.wait();
+    });
+    for (int i = 0; i < 50; i++) {
+        writer->async([ring, i]() {
+            ring->write(i);
+        });
+    }
+    blocked.set_value();
+    ASSERT_TRUE(fixture.wait(50));
+    EXPECT_EQ(ring->postCount(), 2);
+
+    ring->setCoalesceExecutor(nullptr);
+    ring->write(50);
+    ASSERT_TRUE(fixture.wait(51));
+    EXPECT_EQ(ring->postCount(), 4);
+    for (auto &item: fixture.values) {
+        for (int i = 0; i < 51; i++) {
+            EXPECT_EQ(item[i], i);
+        }
+    }
+}
+
+/// 在poller线程中同步执行, 同时等待之前投递的派发任务完成
+static void run_on(const event_poller::Ptr &poller, const std::function<void()> &f) {
+    std::promise<void> done;
+    poller->async([&]() {
+        f();
+        done.set_value();
+    });
+    done.get_future().wait();
+}
+
+TEST(shared_gop, ring_buffer) {
+    logger::initialize("logs/ringbuffer_unittest.log", spdlog::level::warn);
+    using frame_ring = toolkit::RingBuffer<std::shared_ptr<int>>;
+    auto ring = std::make_shared<frame_ring>();
+    std::vector<event_poller::Ptr> pollers;
+    std::vector<std::shared_ptr<frame_ring::RingReader>> readers;
+    for (int i = 0; i < 3; i++) {
+        pollers.emplace_back(std::make_shared<event_poller>());
+        pollers.back()->start();
+    }
+    /// 前两个poller在写入之前已经有读取器
+    for (int i = 0; i < 2; i++) {
+        auto poller = pollers[i];
+        run_on(poller, [&]() {
+            readers.emplace_back(ring->attach(poller, false));
+        });
+    }
+    std::vector<std::shared_ptr<int>> frames;
+    for (int i = 0; i < 100; i++) {
+        frames.emplace_back(std::make_shared<int>(i));
+        ring->write(frames.back(), i == 0);
+    }
+
+    /// 晚加入的读取器重放整个GOP, 包括没有派发器的poller
+    std::vector<std::vector<int>> replays(pollers.size());
+    for (size_t index = 0; index < pollers.size(); index++) {
+        auto poller = pollers[index];
+        auto &replay = replays[index];
+        run_on(poller, [&]() {
+            auto reader = ring->attach(poller, true);
+            reader->setReadCB([&](const std::shared_ptr<int> &frame) {
+                replay.push_back(*frame);
+            });
+            readers.emplace_back(reader);
+        });
+        ASSERT_EQ(replay.size(), 100);
+        for (int i = 0; i < 100; i++) {
+            EXPECT_EQ(replay[i], i);
+        }
+    }
+    /// 所有poller共享同一份GOP缓存
+    for (auto &poller: pollers) {
+        run_on(poller, []() {});
+    }
+    EXPECT_EQ(frames[0].use_count(), 2);
+    EXPECT_EQ(frames[99].use_count(), 2);
+
+    /// 新的关键帧到来之后, 老的GOP在所有poller派发完成时释放
+    ring->write(std::make_shared<int>(100), true);
+    for (auto &poller: pollers) {
+        run_on(poller, []() {});
+    }
+    EXPECT_EQ(frames[0].use_count(), 1);
+    EXPECT_EQ(frames[99].use_count(), 1);
+
+    /// 读取器在所属的poller中释放
+    for (size_t i = 0; i < readers.size(); i++) {
+        run_on(pollers[i < 2 ? i : i - 2], [&]() {
+            readers[i].reset();
+        });
+    }
+    for (auto &poller: pollers) {
+        poller->stop();
+    }
+}
@@ -0,0 +1,99 @@
+//
+// Created by 沈昊 on 2026/10/19.
+//
+#include <arpa/inet.h>
+#include <gtest/gtest.h>
+#include <net/socket_buffer.hpp>
+#include <net/udp_offload.hpp>
+#include <netinet/in.h>
+#include <spdlog/logger.hpp>
+#include <string>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <vector>
+
+static int bind_loopback(sockaddr_in &addr) {
+    int fd = socket(AF_INET, SOCK_DGRAM, 0);
+    addr = sockaddr_in{};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    bind(fd, (sockaddr *) &addr, sizeof(addr));
+    socklen_t len = sizeof(addr);
+    getsockname(fd, (sockaddr *) &addr, &len);
+    return fd;
+}
+
+TEST(resize, socket_buffer) {
+    logger::initialize("logs/socket_buffer_unittest.log", spdlog::level::info);
+    sockaddr_in addr{};
+    int fd = bind_loopback(addr);
+    socket_buffer sock_buffer;
+    /// 没有会话时使用最小值
+    sock_buffer.update(fd, 0);
+    EXPECT_GE(sock_buffer.get_receive_buffer(), socket_buffer::min_size);
+    auto min_buffer = sock_buffer.get_receive_buffer();
+    /// 按照带宽时延积的两倍增大
+    sock_buffer.update(fd, 4 * 1024 * 1024);
+    EXPECT_GE(sock_buffer.get_receive_buffer(), min_buffer);
+    if (geteuid() == 0) {
+        /// SO_RCVBUFFORCE可以超过rmem_max
+        EXPECT_EQ(sock_buffer.get_receive_buffer(), 8 * 1024 * 1024);
+    }
+    auto buffer_size = sock_buffer.get_receive_buffer();
+    /// 小幅减小不调整
+    sock_buffer.update(fd, 3 * 1024 * 1024);
+    EXPECT_EQ(sock_buffer.get_receive_buffer(), buffer_size);
+    /// 新增的内核丢包使缓冲区成倍增大
+    EXPECT_EQ(sock_buffer.on_drop_counter(fd, 10), 10);
+    EXPECT_EQ(sock_buffer.on_drop_counter(fd, 10), 0);
+    EXPECT_EQ(sock_buffer.get_drops(), 10);
+    if (geteuid() == 0) {
+        EXPECT_EQ(sock_buffer.get_receive_buffer(), 12 * 1024 * 1024);
+    }
+    close(fd);
+}
+
+TEST(drop_counter, socket_buffer) {
+    logger::initialize("logs/socket_buffer_unittest.log", spdlog::level::info);
+    sockaddr_in receiver_addr{}, sender_addr{};
+    int receiver = bind_loopback(receiver_addr);
+    int sender = bind_loopback(sender_addr);
+    if (!socket_buffer::enable_drop_counter(receiver)) {
+        close(receiver);
+        close(sender);
+        GTEST_SKIP() << "SO_RXQ_OVFL is not supported";
+    }
+    /// 接收缓冲区设置到最小, 发送的数据报超过缓冲区后被内核丢弃
+    int size = 1;
+    setsockopt(receiver, SOL_SOCKET, SO_RCVBUF, &size, sizeof(size));
+    std::string message(1400, 'a');
+    for (int i = 0; i < 200; i++) {
+        sendto(sender, message.data(), message.size(), 0, (sockaddr *) &receiver_addr, sizeof(receiver_addr));
+    }
+    std::vector<char> data(1500);
+    uint32_t counter = 0;
+    uint32_t received = 0;
+    auto receive_all = [&]() {
+        while (true) {
+            sockaddr_in from{};
+            size_t from_size = sizeof(from);
+            udp_receive_info info;
+            std::error_code e;
+            if (udp_offload::receive(receiver, data.data(), data.size(), (sockaddr *) &from, from_size, info, e) < 0) {
+                break;
+            }
+            ++received;
+            counter = info.drop_counter;
+        }
+    };
+    receive_all();
+    EXPECT_GT(received, 0u);
+    /// 计数器是数据报进入接收队列时的累计值, 溢出之后到达的数据报才带有丢包数
+    sendto(sender, message.data(), message.size(), 0, (sockaddr *) &receiver_addr, sizeof(receiver_addr));
+    auto first = received;
+    receive_all();
+    EXPECT_EQ(received, first + 1);
+    EXPECT_EQ(counter + first, 200u);
+    close(receiver);
+    close(sender);
+}
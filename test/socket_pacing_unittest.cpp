@@ -0,0 +1,87 @@
+//
+// Created by 沈昊 on 2026/10/19.
+//
+#include <arpa/inet.h>
+#include <chrono>
+#include <cstdio>
+#include <gtest/gtest.h>
+#include <net/socket_pacing.hpp>
+#include <netinet/in.h>
+#include <spdlog/logger.hpp>
+#include <string>
+#include <sys/socket.h>
+#include <unistd.h>
+
+/// lo上配置了fq qdisc时内核才会按照发送时间点调度: tc qdisc replace dev lo root fq
+static bool loopback_has_fq() {
+    auto fp = popen("tc qdisc show dev lo 2>/dev/null", "r");
+    if (!fp) {
+        return false;
+    }
+    std::string output;
+    char line[256];
+    while (fgets(line, sizeof(line), fp)) {
+        output += line;
+    }
+    pclose(fp);
+    return output.find("qdisc fq ") != std::string::npos;
+}
+
+TEST(send_at, socket_pacing) {
+    logger::initialize("logs/socket_pacing_unittest.log", spdlog::level::info);
+    int receiver = socket(AF_INET, SOCK_DGRAM, 0);
+    int sender = socket(AF_INET, SOCK_DGRAM, 0);
+    ASSERT_GE(receiver, 0);
+    ASSERT_GE(sender, 0);
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = 0;
+    ASSERT_EQ(bind(receiver, (sockaddr *) &addr, sizeof(addr)), 0);
+    socklen_t len = sizeof(addr);
+    ASSERT_EQ(getsockname(receiver, (sockaddr *) &addr, &len), 0);
+    timeval tv{1, 0};
+    setsockopt(receiver, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+
+    /// 通过rtnetlink查询到的结果和tc一致
+    EXPECT_EQ(socket_pacing::egress_supports_txtime((sockaddr *) &addr, sizeof(addr)), loopback_has_fq());
+
+    /// 不支持的内核上两个选项都会失败, 调用方回退到用户态定时器
+    if (!socket_pacing::enable_txtime(sender)) {
+        close(receiver);
+        close(sender);
+        GTEST_SKIP() << "SO_TXTIME is not supported";
+    }
+    EXPECT_TRUE(socket_pacing::set_max_pacing_rate(sender, 0));
+
+    const int count = 10;
+    const uint64_t interval = 5 * 1000 * 1000;
+    auto begin = std::chrono::steady_clock::now();
+    auto now = socket_pacing::now_ns();
+    auto steady = (uint64_t) std::chrono::duration_cast<std::chrono::nanoseconds>(begin.time_since_epoch()).count();
+    /// 和steady_clock使用同一个时钟
+    EXPECT_LT(now - steady, 1000 * 1000 * 1000ULL);
+    for (int i = 0; i < count; i++) {
+        std::string header = "header" + std::to_string(i);
+        std::string payload(1000, (char) ('a' + i));
+        std::error_code e;
+        auto ret = socket_pacing::send_at(sender, header.data(), header.size(), payload.data(), payload.size(), (sockaddr *) &addr, sizeof(addr), now + (i + 1) * interval, e);
+        ASSERT_FALSE(e) << e.message();
+        EXPECT_EQ(ret, (int) (header.size() + payload.size()));
+    }
+    for (int i = 0; i < count; i++) {
+        char data[2048];
+        auto ret = recv(receiver, data, sizeof(data), 0);
+        std::string header = "header" + std::to_string(i);
+        ASSERT_EQ(ret, (ssize_t) (header.size() + 1000));
+        EXPECT_EQ(std::string(data, header.size()), header);
+        EXPECT_EQ(data[header.size()], (char) ('a' + i));
+    }
+    auto spend = std::chrono::steady_clock::now() - begin;
+    /// 只有fq会按照发送时间点延迟发送
+    if (loopback_has_fq()) {
+        EXPECT_GE(spend, std::chrono::nanoseconds((count - 1) * interval));
+    }
+    close(receiver);
+    close(sender);
+}
@@ -0,0 +1,96 @@
+﻿//
+// Created by 沈昊 on 2026/10/19.
+//
+#include <Util/spsc_ring.hpp>
+#include <gtest/gtest.h>
+#include <memory>
+#include <thread>
+
+TEST(push_pop, spsc_ring) {
+    spsc_ring<int> ring(5);
+    EXPECT_EQ(ring.capacity(), 8);
+    EXPECT_TRUE(ring.empty());
+    EXPECT_EQ(ring.front(), nullptr);
+    for (int i = 0; i < 8; i++) {
+        EXPECT_TRUE(ring.push(std::move(i)));
+    }
+    EXPECT_FALSE(ring.push(8));
+    EXPECT_EQ(ring.size(), 8);
+    EXPECT_EQ(*ring.front(), 0);
+    ring.pop();
+    EXPECT_EQ(ring.free_size(), 1);
+
+    /// 批量写入, 提交之前对消费者不可见
+    EXPECT_TRUE(ring.push(100));
+    EXPECT_EQ(ring.free_size(), 0);
+    for (int i = 1; i <= 8; i++) {
+        ASSERT_NE(ring.front(), nullptr);
+        EXPECT_EQ(*ring.front(), i == 8 ? 100 : i);
+        ring.pop();
+    }
+    ring.producer_slot(0) = 1;
+    ring.producer_slot(1) = 2;
+    EXPECT_TRUE(ring.empty());
+    ring.commit(2);
+    EXPECT_EQ(ring.size(), 2);
+    EXPECT_EQ(*ring.front(), 1);
+}
+
+TEST(two_thread, spsc_ring) {
+    spsc_ring<uint32_t> ring(64);
+    const uint32_t count = 100000;
+    std::thread producer([&]() {
+        for (uint32_t i = 0; i < count;) {
+            if (ring.push(std::move(i))) {
+                ++i;
+            } else {
+                std::this_thread::yield();
+            }
+        }
+    });
+    uint32_t expected = 0;
+    while (expected < count) {
+        auto front = ring.front();
+        if (!front) {
+            std::this_thread::yield();
+            continue;
+        }
+        ASSERT_EQ(*front, expected);
+        ring.pop();
+        ++expected;
+    }
+    producer.join();
+    EXPECT_TRUE(ring.empty());
+}
+
+TEST(segment, spsc_ring) {
+    spsc_ring<std::shared_ptr<int>> ring(8192);
+    EXPECT_EQ(ring.capacity(), 8192);
+    /// 空队列不分配槽位
+    EXPECT_EQ(ring.allocated_segments(), 0);
+    auto value = std::make_shared<int>(1);
+    for (int i = 0; i < 200; i++) {
+        EXPECT_TRUE(ring.push(std::shared_ptr<int>(value)));
+    }
+    EXPECT_EQ(ring.allocated_segments(), 4);
+    EXPECT_EQ(value.use_count(), 201);
+    for (int i = 0; i < 200; i++) {
+        ASSERT_NE(ring.front(), nullptr);
+        ring.pop();
+    }
+    /// 读完的分段已经释放, 只保留正在使用的分段
+    EXPECT_EQ(ring.allocated_segments(), 1);
+    EXPECT_EQ(value.use_count(), 1);
+
+    /// 写满整个队列, 跨越分段表的回绕
+    for (size_t i = 0; i < ring.capacity(); i++) {
+        EXPECT_TRUE(ring.push(std::make_shared<int>((int) i)));
+    }
+    EXPECT_FALSE(ring.push(std::make_shared<int>(0)));
+    for (size_t i = 0; i < ring.capacity(); i++) {
+        ASSERT_NE(ring.front(), nullptr);
+        EXPECT_EQ(**ring.front(), (int) i);
+        ring.pop();
+    }
+    EXPECT_TRUE(ring.empty());
+}
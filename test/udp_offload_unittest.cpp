@@ -0,0 +1,128 @@
+//
+// Created by 沈昊 on 2026/10/19.
+//
+#include <arpa/inet.h>
+#include <gtest/gtest.h>
+#include <net/udp_offload.hpp>
+#include <netinet/in.h>
+#include <spdlog/logger.hpp>
+#include <string>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <vector>
+
+static int bind_loopback(sockaddr_in &addr) {
+    int fd = socket(AF_INET, SOCK_DGRAM, 0);
+    addr = sockaddr_in{};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    bind(fd, (sockaddr *) &addr, sizeof(addr));
+    socklen_t len = sizeof(addr);
+    getsockname(fd, (sockaddr *) &addr, &len);
+    return fd;
+}
+
+/// 接收所有数据报, 按照分段大小拆分
+static std::vector<std::string> receive_all(int fd, size_t expected, size_t &syscalls) {
+    std::vector<std::string> datagrams;
+    std::vector<char> data(65536);
+    syscalls = 0;
+    for (int retry = 0; retry < 1000 && datagrams.size() < expected; retry++) {
+        sockaddr_in from{};
+        size_t from_size = sizeof(from);
+        udp_receive_info info;
+        std::error_code e;
+        auto length = udp_offload::receive(fd, data.data(), data.size(), (sockaddr *) &from, from_size, info, e);
+        if (length < 0) {
+            usleep(1000);
+            continue;
+        }
+        ++syscalls;
+        auto segment_size = info.segment_size ? info.segment_size : (uint16_t) length;
+        for (int offset = 0; offset < length; offset += segment_size) {
+            datagrams.emplace_back(data.data() + offset, std::min<int>(segment_size, length - offset));
+        }
+    }
+    return datagrams;
+}
+
+TEST(segment, udp_offload) {
+    logger::initialize("logs/udp_offload_unittest.log", spdlog::level::info);
+    sockaddr_in plain_addr{}, gro_addr{}, sender_addr{};
+    int plain = bind_loopback(plain_addr);
+    int gro = bind_loopback(gro_addr);
+    int sender = bind_loopback(sender_addr);
+    if (!udp_offload::gso_supported(sender)) {
+        close(plain);
+        close(gro);
+        close(sender);
+        GTEST_SKIP() << "UDP_SEGMENT is not supported";
+    }
+    EXPECT_TRUE(udp_offload::enable_gro(gro));
+
+    /// 10个包头加负载组成的等长分段, 最后一个分段更短
+    std::vector<std::string> headers, payloads;
+    for (int i = 0; i < 11; i++) {
+        headers.push_back(std::string(16, (char) ('A' + i)));
+        payloads.push_back(std::string(i == 10 ? 500 : 1000, (char) ('a' + i)));
+    }
+    std::vector<asio::const_buffer> buffers;
+    for (int i = 0; i < 11; i++) {
+        buffers.emplace_back(headers[i].data(), headers[i].size());
+        buffers.emplace_back(payloads[i].data(), payloads[i].size());
+    }
+    for (auto fd_addr: {&plain_addr, &gro_addr}) {
+        std::error_code e;
+        auto ret = udp_offload::send_segments(sender, buffers.data(), buffers.size(), 1016, (sockaddr *) fd_addr, sizeof(sockaddr_in), e);
+        ASSERT_FALSE(e) << e.message();
+        EXPECT_EQ(ret, 10 * 1016 + 516);
+    }
+
+    for (int fd: {plain, gro}) {
+        size_t syscalls = 0;
+        auto datagrams = receive_all(fd, 11, syscalls);
+        ASSERT_EQ(datagrams.size(), 11);
+        for (int i = 0; i < 11; i++) {
+            EXPECT_EQ(datagrams[i], headers[i] + payloads[i]);
+        }
+        /// 没有开启GRO时内核切分成独立的数据报
+        if (fd == plain) {
+            EXPECT_EQ(syscalls, 11);
+        } else {
+            EXPECT_LE(syscalls, 11);
+        }
+    }
+    close(plain);
+    close(gro);
+    close(sender);
+}
+
+TEST(receive_timestamp, udp_offload) {
+    logger::initialize("logs/udp_offload_unittest.log", spdlog::level::info);
+    sockaddr_in receiver_addr{}, sender_addr{};
+    int receiver = bind_loopback(receiver_addr);
+    int sender = bind_loopback(sender_addr);
+    if (!udp_offload::enable_receive_timestamp(receiver)) {
+        close(receiver);
+        close(sender);
+        GTEST_SKIP() << "SO_TIMESTAMPNS is not supported";
+    }
+    std::string message(100, 'a');
+    sendto(sender, message.data(), message.size(), 0, (sockaddr *) &receiver_addr, sizeof(receiver_addr));
+    /// 数据报在socket中等待, 内核接收时间不包含这段时间
+    usleep(20000);
+    std::vector<char> data(1500);
+    sockaddr_in from{};
+    size_t from_size = sizeof(from);
+    udp_receive_info info;
+    std::error_code e;
+    auto length = udp_offload::receive(receiver, data.data(), data.size(), (sockaddr *) &from, from_size, info, e);
+    auto now = std::chrono::steady_clock::now();
+    ASSERT_EQ(length, (int) message.size()) << e.message();
+    ASSERT_NE(info.arrival, std::chrono::steady_clock::time_point{});
+    auto age = std::chrono::duration_cast<std::chrono::milliseconds>(now - info.arrival).count();
+    EXPECT_GE(age, 19);
+    EXPECT_LT(age, 1000);
+    close(receiver);
+    close(sender);
+}